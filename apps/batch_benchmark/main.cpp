@@ -0,0 +1,92 @@
+#include <ellipsoid/batch.h>
+#include <ellipsoid/columnar.h>
+#include <ellipsoid/generate.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <unistd.h>
+
+/*
+ * Throughput of fitBatch() on many small point sets compared to calling
+ * fit() on each of them, on the raw points or on their moments, and cost of
+ * writing the columnar results to an Arrow file
+ */
+
+int main(int argc, char const* argv[]) {
+    using Clock = std::chrono::steady_clock;
+
+    const size_t problems =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    const size_t points = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+
+    std::vector<Eigen::Matrix<double, Eigen::Dynamic, 3>> point_sets;
+    std::vector<ellipsoid::Moments,
+                Eigen::aligned_allocator<ellipsoid::Moments>>
+        moments(problems);
+    for (size_t i = 0; i < problems; ++i) {
+        ellipsoid::Parameters parameters;
+        parameters.center = 10. * Eigen::Vector3d::Random();
+        parameters.radii =
+            5. * Eigen::Vector3d::Random().cwiseAbs().array() + 0.5;
+        point_sets.push_back(ellipsoid::generate(parameters, points));
+        moments[i].add(point_sets.back());
+    }
+
+    auto start = Clock::now();
+    for (const auto& set : point_sets) {
+        ellipsoid::fit(set);
+    }
+    const double loop_points =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    for (const auto& m : moments) {
+        ellipsoid::fit(m);
+    }
+    const double loop_moments =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    ellipsoid::fitBatch(moments);
+    const double batch_moments =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    ellipsoid::fitBatch(point_sets);
+    const double batch_points =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    ellipsoid::BatchResults columns;
+    start = Clock::now();
+    ellipsoid::fitBatch(moments, columns);
+    const double batch_columns =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    const auto path = "/tmp/batch-benchmark-" + std::to_string(getpid()) +
+                      ".arrow";
+    start = Clock::now();
+    ellipsoid::writeArrow(path, columns);
+    const double arrow =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    ::unlink(path.c_str());
+
+    const auto report = [problems](const char* name, double seconds) {
+        std::cout << name << seconds / problems * 1e6 << " us per fit, "
+                  << problems / seconds << " fits/s\n";
+    };
+    std::cout << problems << " point sets of " << points << " points\n";
+    report("fit(points) loop:      ", loop_points);
+    report("fit(moments) loop:     ", loop_moments);
+    report("fitBatch(moments):     ", batch_moments);
+    report("fitBatch(point sets):  ", batch_points);
+    report("fitBatch(columns):     ", batch_columns);
+    report("writeArrow(columns):   ", arrow);
+    std::cout << "Speedup: " << loop_points / batch_points
+              << "x on points, " << loop_moments / batch_moments
+              << "x on moments\n";
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <ellipsoid/cache.h>
+#include <ellipsoid/generate.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+/*
+ * Cost of a repeated request with FitCache: the hashing pass of a hit
+ * compared to the fit computed on a miss
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    const size_t iterations =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20;
+
+    ellipsoid::Parameters parameters;
+    parameters.center << 1., 2., 3.;
+    parameters.radii << 4., 5., 6.;
+
+    for (size_t rows : {1000, 100000, 1000000}) {
+        const Eigen::Matrix<double, Eigen::Dynamic, 3> points =
+            ellipsoid::generate(parameters, rows);
+
+        double fit_time = 0.;
+        double miss_time = 0.;
+        double hit_time = 0.;
+        double hash_time = 0.;
+        for (size_t i = 0; i < iterations; ++i) {
+            ellipsoid::FitCache cache;
+            auto start = Clock::now();
+            ellipsoid::fit(points);
+            fit_time += elapsed(start);
+
+            start = Clock::now();
+            cache.fit(points);
+            miss_time += elapsed(start);
+
+            start = Clock::now();
+            cache.fit(points);
+            hit_time += elapsed(start);
+
+            start = Clock::now();
+            ellipsoid::hashPoints(points);
+            hash_time += elapsed(start);
+        }
+
+        const auto per_call = [iterations](double seconds) {
+            return seconds / static_cast<double>(iterations) * 1e3;
+        };
+        std::cout << rows << " points: fit() " << per_call(fit_time)
+                  << " ms, miss " << per_call(miss_time) << " ms, hit "
+                  << per_call(hit_time) << " ms, hashPoints() "
+                  << per_call(hash_time) << " ms ("
+                  << static_cast<double>(rows * 3 * sizeof(double)) /
+                         (hash_time / static_cast<double>(iterations)) / 1e9
+                  << " GB/s)\n";
+    }
+
+    return 0;
+}
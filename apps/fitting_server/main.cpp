@@ -0,0 +1,56 @@
+#include <ellipsoid/server.h>
+
+#include <signal.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <system_error>
+
+int main(int argc, char const* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " socket_path [workers] [max_batch_size]\n";
+        return 1;
+    }
+
+    ellipsoid::ServerOptions options;
+    options.socket_path = argv[1];
+    if (argc > 2) {
+        options.workers = std::strtoul(argv[2], nullptr, 10);
+    }
+    if (argc > 3) {
+        options.max_batch_size = std::strtoul(argv[3], nullptr, 10);
+    }
+
+    // handle termination signals synchronously, before any thread is created
+    // so that they all inherit the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    ellipsoid::Server server(options);
+    try {
+        server.start();
+    } catch (const std::system_error& error) {
+        std::cerr << error.what() << '\n';
+        return 1;
+    }
+    std::cout << "Listening on " << options.socket_path << '\n';
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    server.stop();
+
+    const auto metrics = server.metrics();
+    std::cout << "Requests: " << metrics.requests
+              << "\nRejected: " << metrics.rejected
+              << "\nBatches: " << metrics.batches
+              << "\nPoints: " << metrics.points
+              << "\nMean latency: " << metrics.mean_latency.count() * 1e-3
+              << " us\nMax latency: " << metrics.max_latency.count() * 1e-3
+              << " us\n";
+
+    return 0;
+}
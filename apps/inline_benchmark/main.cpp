@@ -0,0 +1,76 @@
+#include <ellipsoid/generate.h>
+#include <ellipsoid/inline.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/*
+ * Cost of small fits through the shared library compared to the header-only
+ * fitInline() on fixed and dynamic size points
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <int N>
+void run(size_t iterations) {
+    ellipsoid::Parameters parameters;
+    parameters.center << 1., 2., 3.;
+    parameters.radii << 4., 5., 6.;
+    std::vector<Eigen::Matrix<double, N, 3>,
+                Eigen::aligned_allocator<Eigen::Matrix<double, N, 3>>>
+        fixed;
+    std::vector<Eigen::Matrix<double, Eigen::Dynamic, 3>> dynamic;
+    for (size_t i = 0; i < 64; ++i) {
+        fixed.push_back(ellipsoid::generate(parameters, N) +
+                        0.01 * Eigen::Matrix<double, N, 3>::Random());
+        dynamic.push_back(fixed.back());
+    }
+
+    // the sum of the centers keeps the fits from being optimized out
+    double sum = 0.;
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        sum += ellipsoid::fit(dynamic[i % 64]).center.x();
+    }
+    const double library =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        sum += ellipsoid::fitInline(dynamic[i % 64]).parameters.center.x();
+    }
+    const double inline_dynamic =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        sum += ellipsoid::fitInline(fixed[i % 64]).parameters.center.x();
+    }
+    const double inline_fixed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    const auto per_fit = [iterations](double seconds) {
+        return seconds / static_cast<double>(iterations) * 1e6;
+    };
+    std::cout << N << " points: fit() " << per_fit(library)
+              << " us, fitInline() dynamic " << per_fit(inline_dynamic)
+              << " us, fitInline() fixed " << per_fit(inline_fixed)
+              << " us (checksum " << sum << ")\n";
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    const size_t iterations =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+
+    run<10>(iterations);
+    run<20>(iterations);
+    run<50>(iterations);
+
+    return 0;
+}
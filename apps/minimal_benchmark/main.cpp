@@ -0,0 +1,100 @@
+#include <ellipsoid/minimal.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Host-side harness of the minimal profile, built like the firmware would be
+ * (no exceptions, no RTTI, no heap, no iostream): static memory used by
+ * StaticFitter and cycles per sample and per solve. Without a cycle counter
+ * (non x86 hosts) the figures are in nanoseconds.
+ */
+
+namespace {
+
+uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+#endif
+}
+
+// magnetometer-like samples spread over an ellipsoid far from the origin
+template <typename Scalar>
+Eigen::Matrix<Scalar, 3, 1> sample(size_t i, size_t count) {
+    const double phi = std::acos(1. - 2. * (i + 0.5) / count);
+    const double theta = 2.399963229728653 * i; // golden angle
+    return Eigen::Matrix<Scalar, 3, 1>(
+        static_cast<Scalar>(12. + 30. * std::sin(phi) * std::cos(theta)),
+        static_cast<Scalar>(-45. + 35. * std::sin(phi) * std::sin(theta)),
+        static_cast<Scalar>(20. + 25. * std::cos(phi)));
+}
+
+const size_t max_samples = 1000;
+
+template <ellipsoid::EllipsoidType Type, typename Scalar>
+void run(const char* name, size_t samples, size_t iterations) {
+    static Eigen::Matrix<Scalar, 3, max_samples> points;
+    static ellipsoid::StaticFitter<Type, Scalar> fitter;
+    static ellipsoid::FitResult result;
+    for (size_t i = 0; i < samples; ++i) {
+        points.col(i) = sample<Scalar>(i, samples);
+    }
+
+    uint64_t add_cycles = 0;
+    uint64_t fit_cycles = 0;
+    bool fitted = true;
+    for (size_t it = 0; it < iterations; ++it) {
+        fitter.reset();
+        const uint64_t start = now();
+        for (size_t i = 0; i < samples; ++i) {
+            fitter.add(points.col(i));
+        }
+        const uint64_t added = now();
+        fitted = fitter.fit(result) and fitted;
+        fit_cycles += now() - added;
+        add_cycles += added - start;
+    }
+
+    std::printf("%-18s state %4u bytes, add() %7.1f, fit() %9.1f, center "
+                "%.3f %.3f %.3f, radii %.3f %.3f %.3f%s\n",
+                name, static_cast<unsigned>(sizeof(fitter)),
+                static_cast<double>(add_cycles) /
+                    static_cast<double>(iterations * samples),
+                static_cast<double>(fit_cycles) /
+                    static_cast<double>(iterations),
+                result.parameters.center.x(), result.parameters.center.y(),
+                result.parameters.center.z(), result.parameters.radii.x(),
+                result.parameters.radii.y(), result.parameters.radii.z(),
+                fitted ? "" : " (failed)");
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    size_t samples = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+    if (samples > max_samples) {
+        samples = max_samples;
+    }
+    const size_t iterations = 1000;
+
+    using ellipsoid::EllipsoidType;
+    run<EllipsoidType::Arbitrary, float>("arbitrary float", samples,
+                                         iterations);
+    run<EllipsoidType::Arbitrary, double>("arbitrary double", samples,
+                                          iterations);
+    run<EllipsoidType::Aligned, float>("aligned float", samples, iterations);
+    run<EllipsoidType::Sphere, float>("sphere float", samples, iterations);
+
+    return 0;
+}
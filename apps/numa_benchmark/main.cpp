@@ -0,0 +1,124 @@
+#include <ellipsoid/fit.h>
+#include <ellipsoid/numa.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+/*
+ * Scaling of the parallel accumulation over a large NUMA aware buffer. The
+ * buffer is first touched by a NumaExecutor using all the nodes, then the
+ * accumulation is timed with an increasing number of nodes, and with an
+ * unpinned pool of as many threads for comparison.
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Best of a few runs, in seconds
+double timeAccumulation(const ellipsoid::PointBuffer& buffer,
+                        const std::shared_ptr<ellipsoid::Executor>& executor,
+                        size_t chunk_rows) {
+    ellipsoid::setDefaultExecutor(executor);
+    double best = 1e9;
+    for (int run = 0; run < 3; ++run) {
+        const auto start = Clock::now();
+        const auto moments =
+            ellipsoid::accumulateParallel(buffer.points(), chunk_rows);
+        best = std::min(
+            best, std::chrono::duration<double>(Clock::now() - start).count());
+        if (moments.count() != buffer.rows()) {
+            std::cerr << "Wrong number of accumulated points\n";
+            std::exit(1);
+        }
+    }
+    return best;
+}
+
+// Uniform number in [0, 1) from a linear congruential generator
+double uniform(uint64_t& state) {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    return static_cast<double>(state >> 11) / 9007199254740992.;
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    const size_t rows =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : size_t(1) << 24;
+    ellipsoid::BufferOptions options;
+    if (argc > 2) {
+        options.huge_pages =
+            static_cast<ellipsoid::HugePages>(std::atoi(argv[2]));
+    }
+
+    const auto nodes = ellipsoid::numaTopology();
+    std::cout << nodes.size() << " NUMA node(s):";
+    for (const auto& node : nodes) {
+        std::cout << " node" << node.id << " (" << node.cpus.size()
+                  << " CPUs)";
+    }
+    std::cout << '\n';
+
+    ellipsoid::setDefaultExecutor(
+        std::make_shared<ellipsoid::NumaExecutor>(nodes));
+    ellipsoid::PointBuffer buffer(rows, options);
+
+    // points on an ellipsoid, written by the threads owning each chunk
+    auto points = buffer.points();
+    const auto chunk_rows = options.chunk_rows;
+    ellipsoid::defaultExecutor()->parallelFor(
+        (rows + chunk_rows - 1) / chunk_rows, [&](size_t chunk) {
+            const auto first = chunk * chunk_rows;
+            const auto last = std::min(first + chunk_rows, rows);
+            uint64_t state = 0x9E3779B97F4A7C15ull * (chunk + 1);
+            for (auto i = first; i < last; ++i) {
+                const double theta = uniform(state) * M_PI - M_PI / 2.;
+                const double phi = uniform(state) * 2. * M_PI - M_PI;
+                const auto row = static_cast<Eigen::Index>(i);
+                points(row, 0) = 1. + 3. * std::cos(theta) * std::cos(phi);
+                points(row, 1) = -2. + 2. * std::cos(theta) * std::sin(phi);
+                points(row, 2) = 0.5 + 1. * std::sin(theta);
+            }
+        });
+
+    const double gigabytes = rows * 3. * sizeof(double) * 1e-9;
+    std::cout << rows << " points (" << gigabytes << " GB), "
+              << (buffer.explicitHugePages() ? "explicit huge pages"
+                                              : "regular/transparent pages")
+              << '\n';
+
+    const auto serial = timeAccumulation(
+        buffer, std::make_shared<ellipsoid::SerialExecutor>(), chunk_rows);
+    std::cout << "serial:            " << gigabytes / serial << " GB/s\n";
+
+    size_t threads = 0;
+    for (size_t count = 1; count <= nodes.size(); ++count) {
+        const std::vector<ellipsoid::NumaNode> used(nodes.begin(),
+                                                    nodes.begin() + count);
+        threads += nodes[count - 1].cpus.size();
+        const auto numa = timeAccumulation(
+            buffer, std::make_shared<ellipsoid::NumaExecutor>(used),
+            chunk_rows);
+        const auto unpinned = timeAccumulation(
+            buffer, std::make_shared<ellipsoid::WorkStealingExecutor>(threads),
+            chunk_rows);
+        std::cout << count << " node(s), " << threads
+                  << " threads: " << gigabytes / numa << " GB/s pinned ("
+                  << serial / numa << "x), " << gigabytes / unpinned
+                  << " GB/s unpinned (" << serial / unpinned << "x)\n";
+    }
+
+    ellipsoid::setDefaultExecutor(nullptr);
+    const auto moments = ellipsoid::accumulateParallel(buffer.points());
+    std::cout << "Radii: " << ellipsoid::fit(moments).radii.transpose()
+              << '\n';
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <ellipsoid/overlap.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+/*
+ * All the overlapping pairs of a set of ellipsoids: EllipsoidSet compared to
+ * testing every pair, with a bounding sphere check first
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    const size_t count =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+
+    // about ten neighbors per ellipsoid
+    const double extent = std::cbrt(static_cast<double>(count)) * 0.6;
+    ellipsoid::Ellipsoids ellipsoids(count);
+    for (auto& e : ellipsoids) {
+        e.center = extent * Eigen::Vector3d::Random();
+        e.radii = 0.5 * Eigen::Vector3d::Random().cwiseAbs() +
+                  Eigen::Vector3d::Constant(0.1);
+        e.axes = Eigen::Quaterniond(Eigen::Vector4d::Random().normalized())
+                     .toRotationMatrix();
+    }
+
+    auto start = Clock::now();
+    size_t brute_force = 0;
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = i + 1; j < count; ++j) {
+            const auto& a = ellipsoids[i];
+            const auto& b = ellipsoids[j];
+            if ((b.center - a.center).norm() <=
+                    a.radii.maxCoeff() + b.radii.maxCoeff() and
+                ellipsoid::overlap(a, b)) {
+                ++brute_force;
+            }
+        }
+    }
+    const double brute_force_time = elapsed(start);
+
+    start = Clock::now();
+    const ellipsoid::EllipsoidSet set(ellipsoids);
+    const double build_time = elapsed(start);
+    start = Clock::now();
+    const auto pairs = set.overlappingPairs();
+    const double query_time = elapsed(start);
+    start = Clock::now();
+    const auto close = set.pairsWithin(0.1);
+    const double within_time = elapsed(start);
+
+    std::cout << count << " ellipsoids, " << pairs.size()
+              << " overlapping pairs (" << brute_force
+              << " testing all pairs)\n";
+    std::cout << "all pairs: " << brute_force_time * 1e3 << " ms\n";
+    std::cout << "EllipsoidSet: " << build_time * 1e3 << " ms to build, "
+              << query_time * 1e3 << " ms for overlappingPairs(), "
+              << within_time * 1e3 << " ms for pairsWithin(0.1) ("
+              << close.size() << " pairs)\n";
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <ellipsoid/generate.h>
+#include <ellipsoid/planner.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+/*
+ * Measure the cost model of this machine then compare, for several numbers
+ * of points, the time of each strategy with its estimate and with the
+ * strategy chosen by planFit()
+ */
+
+namespace {
+
+const char* name(ellipsoid::FitStrategy strategy) {
+    switch (strategy) {
+    case ellipsoid::FitStrategy::DesignMatrix:
+        return "design matrix";
+    case ellipsoid::FitStrategy::Streaming:
+        return "streaming";
+    case ellipsoid::FitStrategy::ParallelAccumulation:
+        return "parallel";
+    case ellipsoid::FitStrategy::Subsampling:
+        return "subsampling";
+    case ellipsoid::FitStrategy::Tsqr:
+        return "TSQR";
+    default:
+        return "automatic";
+    }
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    const size_t max_rows =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+
+    ellipsoid::FitOptions options;
+    options.cost_model = ellipsoid::CostModel::measure();
+    const auto& model = options.cost_model;
+    std::cout << "Cost model (ns per point): design matrix "
+              << model.design_matrix_per_point * 1e9 << ", moments "
+              << model.moments_per_point * 1e9 << ", TSQR "
+              << model.tsqr_per_point * 1e9 << ", gather "
+              << model.gather_per_point * 1e9 << "\n"
+              << "Cost model (us): task " << model.task * 1e6 << ", solve "
+              << model.solve * 1e6 << "\n\n";
+
+    const ellipsoid::FitStrategy strategies[] = {
+        ellipsoid::FitStrategy::DesignMatrix,
+        ellipsoid::FitStrategy::Streaming,
+        ellipsoid::FitStrategy::ParallelAccumulation,
+        ellipsoid::FitStrategy::Tsqr,
+    };
+    std::cout << std::setw(10) << "points" << std::setw(16) << "strategy"
+              << std::setw(14) << "estimate (ms)" << std::setw(14)
+              << "measured (ms)" << std::setw(14) << "memory (kB)" << "\n";
+    ellipsoid::Parameters parameters;
+    parameters.center << 1., 2., 3.;
+    parameters.radii << 4., 5., 6.;
+    for (size_t rows = 1000; rows <= max_rows; rows *= 10) {
+        const auto points = ellipsoid::generate(parameters, rows);
+        auto run = [&](const ellipsoid::FitOptions& run_options,
+                       const char* label) {
+            ellipsoid::Diagnostics diagnostics;
+            ellipsoid::fit(points, run_options, &diagnostics);
+            std::cout << std::setw(10) << rows << std::setw(16) << label
+                      << std::setw(14) << diagnostics.plan.seconds * 1e3
+                      << std::setw(14) << diagnostics.seconds * 1e3
+                      << std::setw(14) << diagnostics.plan.memory / 1024
+                      << "\n";
+        };
+        for (const auto strategy : strategies) {
+            auto forced = options;
+            forced.strategy = strategy;
+            run(forced, name(strategy));
+        }
+        ellipsoid::Diagnostics diagnostics;
+        ellipsoid::fit(points, options, &diagnostics);
+        std::cout << std::setw(10) << rows << std::setw(16)
+                  << (std::string("-> ") + name(diagnostics.plan.strategy))
+                  << std::setw(14) << diagnostics.plan.seconds * 1e3
+                  << std::setw(14) << diagnostics.seconds * 1e3 << "\n";
+    }
+
+    return 0;
+}
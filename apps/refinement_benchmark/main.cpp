@@ -0,0 +1,104 @@
+#include <ellipsoid/refinement.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+/*
+ * Solve times and accuracy of the SVD of fit(moments) and of the refined
+ * solves, on caps of an ellipsoid of decreasing size, i.e increasingly ill
+ * conditioned normal equations
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int repetitions = 10000;
+
+double elapsed(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void print(const char* name, const ellipsoid::Parameters& fitted,
+           const ellipsoid::Parameters& expected, double time) {
+    std::cout << "  " << name << ": " << time / repetitions * 1e6
+              << " us, center error "
+              << (fitted.center - expected.center).norm()
+              << ", radii error "
+              << (fitted.radii - expected.radii).norm() << "\n";
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    const auto count = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 5000;
+
+    ellipsoid::Parameters expected;
+    expected.center = Eigen::Vector3d(5., -3., 2.);
+    expected.radii = Eigen::Vector3d(1., 2., 3.);
+
+    for (double half_angle : {M_PI, 0.5, 0.1}) {
+        Eigen::Matrix<double, Eigen::Dynamic, 3> points(count, 3);
+        for (Eigen::Index i = 0; i < points.rows(); ++i) {
+            const Eigen::Vector2d random =
+                0.5 * (Eigen::Vector2d::Random() + Eigen::Vector2d::Ones());
+            const double theta = half_angle * std::sqrt(random(0));
+            const double phi = 2. * M_PI * random(1);
+            const Eigen::Vector3d direction(std::sin(theta) * std::cos(phi),
+                                            std::sin(theta) * std::sin(phi),
+                                            std::cos(theta));
+            points.row(i) =
+                (expected.center + expected.radii.cwiseProduct(direction))
+                    .transpose();
+        }
+        ellipsoid::Moments moments;
+        moments.add(points);
+        std::cout << "cap of half angle " << half_angle << " rad\n";
+
+        ellipsoid::Parameters svd;
+        auto start = Clock::now();
+        for (int i = 0; i < repetitions; ++i) {
+            svd = ellipsoid::fit(moments);
+        }
+        print("SVD", svd, expected, elapsed(start));
+
+        const struct {
+            const char* name;
+            ellipsoid::Factorization factorization;
+            ellipsoid::ResidualPrecision residuals;
+        } modes[] = {
+            {"float, double residuals", ellipsoid::Factorization::Float,
+             ellipsoid::ResidualPrecision::Double},
+            {"float, double-double residuals",
+             ellipsoid::Factorization::Float,
+             ellipsoid::ResidualPrecision::DoubleDouble},
+            {"LDLT, double residuals", ellipsoid::Factorization::LDLT,
+             ellipsoid::ResidualPrecision::Double},
+            {"LDLT, double-double residuals", ellipsoid::Factorization::LDLT,
+             ellipsoid::ResidualPrecision::DoubleDouble},
+        };
+        for (const auto& mode : modes) {
+            ellipsoid::RefinementOptions options;
+            options.factorization = mode.factorization;
+            options.residuals = mode.residuals;
+            ellipsoid::RefinementReport report;
+            ellipsoid::FitResult refined;
+            start = Clock::now();
+            for (int i = 0; i < repetitions; ++i) {
+                refined = ellipsoid::fitRefined(
+                    moments, ellipsoid::EllipsoidType::Arbitrary, options,
+                    &report);
+            }
+            print(mode.name, refined.parameters, expected, elapsed(start));
+            std::cout << "    " << report.iterations << " steps, "
+                      << (report.converged ? "converged" : "not converged")
+                      << (report.fallback ? ", SVD fallback" : "")
+                      << ", backward error " << report.backward_error
+                      << "\n";
+        }
+    }
+
+    return 0;
+}
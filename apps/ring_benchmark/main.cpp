@@ -0,0 +1,95 @@
+#include <ellipsoid/generate.h>
+#include <ellipsoid/online.h>
+#include <ellipsoid/ring.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Shared memory ingestion benchmark: a forked calibration process consumes
+ * the samples written by this process with an OnlineFitter. The latency is
+ * measured from the write of a single sample to its consumption, then the
+ * throughput with samples written in blocks.
+ */
+
+int main(int argc, char const* argv[]) {
+    using Clock = std::chrono::steady_clock;
+
+    const size_t samples =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    const size_t block = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1024;
+    const size_t pings = 10000;
+
+    const auto name =
+        "/ellipsoid-fit-benchmark-" + std::to_string(::getpid());
+    ellipsoid::RingWriter writer(name, 1 << 16);
+
+    const pid_t consumer = ::fork();
+    if (consumer == 0) {
+        ellipsoid::RingReader reader(name);
+        ellipsoid::OnlineFitter fitter;
+        while (reader.wait(std::chrono::seconds(10))) {
+            fitter.update(reader);
+        }
+        std::cout << "Consumer: " << fitter.moments().count()
+                  << " samples, " << fitter.fits() << " fits, radii "
+                  << fitter.result().parameters.radii.transpose()
+                  << std::endl;
+        ::_exit(0);
+    }
+
+    ellipsoid::Parameters parameters;
+    parameters.center = Eigen::Vector3d::Random();
+    parameters.radii = Eigen::Vector3d::Random().cwiseAbs().array() + 0.5;
+    const auto data = ellipsoid::generate(parameters, 1 << 16);
+
+    std::vector<double> latencies;
+    latencies.reserve(pings);
+    for (size_t i = 0; i < pings; ++i) {
+        const auto point = data.row(i % data.rows());
+        const auto sent = Clock::now();
+        writer.write(point.x(), point.y(), point.z(),
+                     std::chrono::seconds(1));
+        while (writer.counters().read != i + 1) {
+            std::this_thread::yield();
+        }
+        latencies.push_back(
+            std::chrono::duration<double>(Clock::now() - sent).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    const auto start = Clock::now();
+    size_t written = 0;
+    while (written < samples) {
+        const auto row = static_cast<Eigen::Index>(written % data.rows());
+        const auto n = static_cast<Eigen::Index>(
+            std::min({block, samples - written,
+                      static_cast<size_t>(data.rows() - row)}));
+        written += writer.write(data.middleRows(row, n),
+                                std::chrono::seconds(1));
+    }
+    const auto elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    const auto counters = writer.counters();
+    writer.close();
+    ::waitpid(consumer, nullptr, 0);
+
+    std::cout << "Latency (write to consumption): p50 "
+              << latencies[pings / 2] * 1e6 << " us, p99 "
+              << latencies[pings * 99 / 100] * 1e6 << " us, max "
+              << latencies.back() * 1e6 << " us\n";
+    std::cout << "Throughput: " << samples / elapsed * 1e-6
+              << " Msamples/s with blocks of " << block << " samples\n";
+    std::cout << "Overruns: " << counters.overruns
+              << ", stalls: " << counters.stalls << '\n';
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <ellipsoid/client.h>
+#include <ellipsoid/generate.h>
+#include <ellipsoid/server.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Load generator for ellipsoid::Server: several clients send small fit
+ * requests as fast as possible and the achieved throughput and latencies
+ * are compared to fitting the same data in process.
+ */
+
+int main(int argc, char const* argv[]) {
+    using Clock = std::chrono::steady_clock;
+
+    const size_t clients = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8;
+    const size_t requests = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+    const size_t points = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 100;
+
+    ellipsoid::ServerOptions options;
+    options.socket_path =
+        "/tmp/ellipsoid-fit-benchmark-" + std::to_string(::getpid()) + ".sock";
+    ellipsoid::Server server(options);
+    server.start();
+
+    ellipsoid::Parameters parameters;
+    parameters.center = Eigen::Vector3d::Random();
+    parameters.radii = Eigen::Vector3d::Random().cwiseAbs().array() + 0.5;
+    const auto data = ellipsoid::generate(parameters, points);
+
+    // in process reference
+    auto start = Clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        ellipsoid::fit(data);
+    }
+    const auto local =
+        std::chrono::duration<double>(Clock::now() - start).count() / requests;
+
+    std::vector<std::vector<double>> latencies(clients);
+    std::vector<std::thread> threads;
+    start = Clock::now();
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            ellipsoid::Client client(options.socket_path);
+            auto& latency = latencies[c];
+            latency.reserve(requests);
+            for (size_t i = 0; i < requests; ++i) {
+                const auto sent = Clock::now();
+                client.fit(data);
+                latency.push_back(
+                    std::chrono::duration<double>(Clock::now() - sent).count());
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    const auto metrics = server.metrics();
+    server.stop();
+
+    std::vector<double> all;
+    for (const auto& latency : latencies) {
+        all.insert(all.end(), latency.begin(), latency.end());
+    }
+    std::sort(all.begin(), all.end());
+    const auto percentile = [&all](double p) {
+        return all[std::min(all.size() - 1,
+                            static_cast<size_t>(p * all.size()))] *
+               1e6;
+    };
+
+    std::cout << clients << " clients, " << requests << " requests of "
+              << points << " points each\n";
+    std::cout << "In process fit: " << local * 1e6 << " us ("
+              << 1. / local << " fits/s on one thread)\n";
+    std::cout << "Server throughput: " << all.size() / elapsed
+              << " fits/s\n";
+    std::cout << "Round trip latency: p50 " << percentile(0.5) << " us, p99 "
+              << percentile(0.99) << " us, max " << all.back() * 1e6
+              << " us\n";
+    std::cout << "Server side: " << metrics.batches << " batches ("
+              << static_cast<double>(metrics.requests) / metrics.batches
+              << " requests per batch), mean latency "
+              << metrics.mean_latency.count() * 1e-3 << " us, max latency "
+              << metrics.max_latency.count() * 1e-3 << " us\n";
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <ellipsoid/superquadric.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+/*
+ * Superquadric fits on a box like object cloud: all the points at each
+ * iteration, subsamples, and refinement from the previous result as done
+ * when tracking an object
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+double signedPower(double value, double exponent) {
+    return std::copysign(std::pow(std::abs(value), exponent), value);
+}
+
+void print(const char* name, const ellipsoid::Superquadric& sq,
+           double time) {
+    std::cout << name << ": " << time * 1e3 << " ms, " << sq.iterations
+              << " iterations, radii " << sq.radii.transpose()
+              << ", exponents " << sq.exponents.transpose()
+              << ", RMS distance " << sq.rms_distance << "\n";
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    const auto count =
+        argc > 1 ? std::strtol(argv[1], nullptr, 10) : 100000;
+
+    const Eigen::Vector3d radii(0.1, 0.05, 0.2);
+    const Eigen::Matrix3d axes =
+        Eigen::AngleAxisd(0.4, Eigen::Vector3d(1., 2., 3.).normalized())
+            .toRotationMatrix();
+    const Eigen::Vector3d center(0.3, -0.2, 1.);
+    Eigen::Matrix<double, Eigen::Dynamic, 3> points(count, 3);
+    for (Eigen::Index i = 0; i < points.rows(); ++i) {
+        const Eigen::Vector2d angles =
+            Eigen::Vector2d::Random().cwiseProduct(
+                Eigen::Vector2d(M_PI / 2., M_PI));
+        const Eigen::Vector3d local(
+            radii(0) * signedPower(std::cos(angles(0)), 0.2) *
+                signedPower(std::cos(angles(1)), 0.3),
+            radii(1) * signedPower(std::cos(angles(0)), 0.2) *
+                signedPower(std::sin(angles(1)), 0.3),
+            radii(2) * signedPower(std::sin(angles(0)), 0.2));
+        points.row(i) = (center + axes * local +
+                         1e-4 * Eigen::Vector3d::Random())
+                            .transpose();
+    }
+
+    auto start = Clock::now();
+    const auto full = ellipsoid::fitSuperquadric(points);
+    print("all the points", full, elapsed(start));
+
+    ellipsoid::SuperquadricOptions options;
+    options.samples = 5000;
+    start = Clock::now();
+    const auto subsampled = ellipsoid::fitSuperquadric(points, options);
+    print("5000 points per iteration", subsampled, elapsed(start));
+
+    start = Clock::now();
+    const auto tracked =
+        ellipsoid::fitSuperquadric(points, subsampled, options);
+    print("from the previous result", tracked, elapsed(start));
+
+    return 0;
+}
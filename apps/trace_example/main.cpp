@@ -0,0 +1,53 @@
+#include <ellipsoid/batch.h>
+#include <ellipsoid/generate.h>
+#include <ellipsoid/trace.h>
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+/*
+ * Record the stages of a few fits and write them as a Chrome trace, to be
+ * opened in Perfetto (ui.perfetto.dev). The library must be built with the
+ * ENABLE_TRACING option.
+ */
+
+int main(int argc, char const* argv[]) {
+    const std::string path = argc > 1 ? argv[1] : "ellipsoid-trace.json";
+
+    if (not ellipsoid::trace::available()) {
+        std::cerr << "ellipsoid-fit was built without ENABLE_TRACING, "
+                     "nothing will be recorded\n";
+    }
+
+    ellipsoid::Parameters parameters;
+    parameters.center << 1., 2., 3.;
+    parameters.radii << 4., 5., 6.;
+    const auto points = ellipsoid::generate(parameters, 100000);
+    const std::vector<Eigen::Matrix<double, Eigen::Dynamic, 3>> point_sets(
+        1000, points.topRows(100));
+
+    ellipsoid::trace::start();
+    ellipsoid::fit(points);
+    ellipsoid::Moments moments;
+    moments.add(points);
+    ellipsoid::fit(moments);
+    ellipsoid::fitBatch(point_sets);
+    ellipsoid::trace::stop();
+
+    std::cout << std::left << std::setw(24) << "stage" << std::right
+              << std::setw(8) << "calls" << std::setw(14) << "total (us)"
+              << std::setw(12) << "points" << std::setw(14) << "bytes"
+              << "\n";
+    for (const auto& stage : ellipsoid::trace::statistics()) {
+        std::cout << std::left << std::setw(24) << stage.name << std::right
+                  << std::setw(8) << stage.calls << std::setw(14)
+                  << stage.seconds * 1e6 << std::setw(12) << stage.points
+                  << std::setw(14) << stage.bytes << "\n";
+    }
+
+    ellipsoid::trace::writeChromeTrace(path);
+    std::cout << "Trace written to " << path << "\n";
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <ellipsoid/executor.h>
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+namespace ellipsoid {
+
+/**
+ * Cancellation flag shared between the caller and an asynchronous fit.
+ * Copies refer to the same flag.
+ */
+class CancellationToken {
+public:
+    CancellationToken();
+
+    //! Ask the fits using this token to stop as soon as possible
+    void cancel();
+
+    //! Whether cancel() has been called
+    bool cancelled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+//! Exception stored in the future of a cancelled fit
+class FitCancelled : public std::runtime_error {
+public:
+    FitCancelled();
+};
+
+//! Settings of fitAsync()
+struct AsyncOptions {
+    //! Type of ellipsoid to fit
+    EllipsoidType type{EllipsoidType::Arbitrary};
+    //! Checked before each chunk of points is accumulated
+    CancellationToken cancellation;
+    //! Called with the fraction of points processed after each chunk, from
+    //! the thread running the fit
+    std::function<void(double)> progress;
+    //! Number of points accumulated between cancellation checks
+    size_t chunk_size{1 << 16};
+    //! Runs the fit, defaultExecutor() if null
+    std::shared_ptr<Executor> executor;
+};
+
+/**
+ * Fit an ellipsoid in the background.
+ *
+ * The points are accumulated chunk by chunk so that the fit can be
+ * cancelled and report its progress in between.
+ *
+ * @param[in]   data Nx3 matrix with the cartesian coordinates to fit the
+ * ellipsoid on, moved in to avoid a copy
+ * @param[in]   options type of ellipsoid, cancellation, progress and
+ * executor settings
+ * @return      future of everything computed by the fit, holding a
+ * FitCancelled exception if cancelled
+ */
+std::future<FitResult>
+fitAsync(Eigen::Matrix<double, Eigen::Dynamic, 3> data,
+         const AsyncOptions& options = AsyncOptions());
+
+} // namespace ellipsoid
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <ellipsoid/moments.h>
+#include <Eigen/Dense>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ellipsoid {
+
+//! Results of fitBatch(), in the order of the problems
+using FitResults = std::vector<FitResult, Eigen::aligned_allocator<FitResult>>;
+
+/**
+ * Results of many fits stored as columns: each field of the results, e.g the
+ * x coordinate of the centers, is contiguous in memory. Row i holds the
+ * results of the problem i.
+ */
+struct BatchResults {
+    //! centers of the ellipsoids
+    Eigen::Matrix<double, Eigen::Dynamic, 3> centers;
+    //! radii, in the same order as the eigenvalues
+    Eigen::Matrix<double, Eigen::Dynamic, 3> radii;
+    //! eigenvalues, see FitResult::eval
+    Eigen::Matrix<double, Eigen::Dynamic, 3> eigenvalues;
+    //! eigenvectors in columns, see FitResult::evec_column, stored in column
+    //! major order (column 3 * j + i holds the element (i, j))
+    Eigen::Matrix<double, Eigen::Dynamic, 9> rotations;
+    //! the 10 coefficients of the algebraic form
+    Eigen::Matrix<double, Eigen::Dynamic, 10> coefficients;
+    //! number of points of each problem
+    Eigen::Matrix<uint64_t, Eigen::Dynamic, 1> point_counts;
+    //! 1 for the problems too ill-conditioned for the batched solver, solved
+    //! by fit(moments)
+    Eigen::Matrix<uint8_t, Eigen::Dynamic, 1> fallback;
+    //! smallest pivot of the equilibrated normal equations, an estimate of
+    //! the inverse of their condition number, NaN for the fallback problems
+    Eigen::VectorXd min_pivots;
+
+    //! Set the number of rows, the content is left uninitialized
+    void resize(size_t size);
+
+    //! Number of rows
+    size_t size() const;
+
+    //! The results of a single problem
+    FitResult result(size_t index) const;
+
+    //! Store the results of a single problem, the diagnostics are left
+    //! untouched
+    void set(size_t index, const FitResult& result);
+};
+
+/**
+ * Fit an ellipsoid on each set of moments.
+ *
+ * Meant for many small problems, where solving the normal equations and
+ * extracting the parameters dominate the cost. The problems are processed
+ * in groups laid out as structure of arrays, one problem per SIMD lane: the
+ * normal equations are solved with an equilibrated Cholesky factorization,
+ * the center with a closed form 3x3 inverse and the eigenproblem with
+ * Jacobi rotations. Ill-conditioned problems fall back to fit(moments).
+ * The groups are spread over defaultExecutor().
+ *
+ * @param[in]   problems moments of each point set
+ * @param[in]   type type of ellipsoid to fit
+ * @return      everything computed for each problem, matching fit(moments)
+ * up to rounding errors. For repeated eigenvalues, the eigenvectors may be
+ * another (orthonormal) basis of the same eigenspace.
+ */
+FitResults
+fitBatch(const std::vector<Moments, Eigen::aligned_allocator<Moments>>& problems,
+         EllipsoidType type = EllipsoidType::Arbitrary);
+
+/**
+ * Fit an ellipsoid on each set of moments, see fitBatch(problems, type)
+ * @param[in]   problems moments of each point set
+ * @param[out]  results everything computed for each problem, resized to the
+ * number of problems
+ * @param[in]   type type of ellipsoid to fit
+ */
+void fitBatch(
+    const std::vector<Moments, Eigen::aligned_allocator<Moments>>& problems,
+    BatchResults& results, EllipsoidType type = EllipsoidType::Arbitrary);
+
+/**
+ * Fit an ellipsoid on each point set, see fitBatch(problems, type)
+ * @param[in]   point_sets Nx3 matrices with the cartesian coordinates of
+ * each point set
+ * @param[out]  results everything computed for each point set
+ * @param[in]   type type of ellipsoid to fit
+ */
+void fitBatch(
+    const std::vector<Eigen::Matrix<double, Eigen::Dynamic, 3>>& point_sets,
+    BatchResults& results, EllipsoidType type = EllipsoidType::Arbitrary);
+
+/**
+ * Fit an ellipsoid on each point set, see fitBatch(problems, type)
+ * @param[in]   point_sets Nx3 matrices with the cartesian coordinates of
+ * each point set
+ * @param[in]   type type of ellipsoid to fit
+ * @return      everything computed for each point set
+ */
+FitResults
+fitBatch(const std::vector<Eigen::Matrix<double, Eigen::Dynamic, 3>>& point_sets,
+         EllipsoidType type = EllipsoidType::Arbitrary);
+
+} // namespace ellipsoid
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <ellipsoid/planner.h>
+#include <Eigen/Dense>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ellipsoid {
+
+//! Settings of a FitCache
+struct CacheOptions {
+    //! Memory used by the cached results, in bytes. The least recently used
+    //! results are evicted to stay below it
+    size_t memory_budget{size_t(16) << 20};
+    //! File the cache is loaded from on construction and written to by
+    //! save(), no persistence if empty
+    std::string path;
+};
+
+//! Counters describing the activity of a FitCache
+struct CacheStatistics {
+    //! Number of fits served from the cache
+    uint64_t hits;
+    //! Number of fits computed because they were not cached
+    uint64_t misses;
+    //! Number of results evicted to respect the memory budget
+    uint64_t evictions;
+    //! Number of results currently cached
+    size_t entries;
+    //! Memory used by the cached results, in bytes
+    size_t memory;
+};
+
+/**
+ * Hash of the coordinates of a point set, computed on their bit patterns in
+ * a single pass over the data. Four independent lanes are mixed so the pass
+ * runs at memory bandwidth rather than at the latency of the multiplications.
+ * @param data Nx3 matrix with the cartesian coordinates of the points
+ * @return the 64 bits hash
+ */
+uint64_t hashPoints(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data);
+
+/**
+ * Cache of fit results keyed by the content of the points and the fitting
+ * options, for services receiving the same point sets again (retries,
+ * duplicate uploads, reprocessing).
+ *
+ * A lookup costs one pass over the points, computing hashPoints() and a
+ * second independent 64 bits hash together. On a miss, the fit is computed
+ * as the corresponding ellipsoid::fit() overload would, so cached and
+ * computed results are identical. Points that only differ by the sign of a
+ * zero or the payload of a NaN are considered different.
+ *
+ * The points themselves are not stored: two point sets with the same number
+ * of rows and both hashes equal share their result. The hashes are not
+ * cryptographic, so such a collision is only unlikely (about 2^-128 for
+ * unrelated sets) and a cache must not be shared with untrusted clients able
+ * to craft colliding point sets.
+ *
+ * All member functions can be called concurrently.
+ */
+class FitCache {
+public:
+    /**
+     * Create a cache, loading the results saved in options.path if it exists
+     * @param options cache settings
+     * @throw std::system_error if the file exists but cannot be read
+     * @throw std::runtime_error if the file is not a saved cache
+     */
+    explicit FitCache(const CacheOptions& options = CacheOptions());
+
+    ~FitCache();
+
+    FitCache(const FitCache&) = delete;
+    FitCache& operator=(const FitCache&) = delete;
+
+    /**
+     * Cached equivalent of fit(data, coefficients_p, eval_p, evec_column_p,
+     * type)
+     * @param data Nx3 matrix with the cartesian coordinates of the points
+     * @param type type of ellipsoid to fit
+     * @return everything computed by the fit
+     */
+    FitResult
+    fit(const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+        EllipsoidType type = EllipsoidType::Arbitrary);
+
+    /**
+     * Cached equivalent of fit(data, options). All the options are part of
+     * the key since they can change the plan and so the result.
+     * @param data    Nx3 matrix with the cartesian coordinates of the points
+     * @param options fitting options
+     * @return everything computed by the fit
+     */
+    FitResult
+    fit(const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+        const FitOptions& options);
+
+    //! Current activity counters
+    CacheStatistics statistics() const;
+
+    //! Remove all the cached results, the counters are kept
+    void clear();
+
+    /**
+     * Write the cached results to CacheOptions::path, replacing the file
+     * atomically. Does nothing without a path.
+     * @throw std::system_error if the file cannot be written
+     */
+    void save() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace ellipsoid
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+#include <string>
+
+namespace ellipsoid {
+
+/**
+ * Connection to a fitting Server, to offload fits from short-lived processes.
+ *
+ * A Client must not be used by several threads at the same time.
+ */
+class Client {
+public:
+    /**
+     * Connect to a server
+     * @param socket_path path of the server's Unix domain socket
+     * @throw std::system_error if the connection fails
+     */
+    explicit Client(const std::string& socket_path);
+
+    //! Close the connection
+    ~Client();
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    /**
+     * Ask the server to fit an ellipsoid on the given data
+     * @param[in]   data Nx3 matrix with the cartesian coordinates to fit the
+     * ellipsoid on
+     * @return      everything computed by the fit
+     * @throw std::system_error if the communication fails
+     * @throw std::runtime_error if the server rejects the request
+     */
+    FitResult fit(const Eigen::Matrix<double, Eigen::Dynamic, 3>& data,
+                  EllipsoidType type = EllipsoidType::Arbitrary);
+
+private:
+    int fd_;
+};
+
+} // namespace ellipsoid
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <ellipsoid/batch.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ellipsoid {
+
+/**
+ * Write BatchResults to a file in the Apache Arrow IPC file format, readable
+ * by pyarrow, pandas, polars, DuckDB, etc. The Arrow library is not needed.
+ *
+ * Each call to write() appends a record batch with one column per field of
+ * the results: center_x, center_y, center_z, radius_x, radius_y, radius_z,
+ * eigenvalue_0 to eigenvalue_2, rotation_ij (row i, column j),
+ * coefficient_0 to coefficient_9, point_count (uint64), fallback (uint8)
+ * and min_pivot. The columns are written directly from the memory of the
+ * results, without any copy.
+ */
+class ArrowWriter {
+public:
+    /**
+     * Create the file, replacing any existing one, and write the schema
+     * @param path path of the file to create
+     * @throw std::system_error if the file cannot be created or written
+     */
+    explicit ArrowWriter(const std::string& path);
+
+    //! Close the file if close() was not called, errors are ignored
+    ~ArrowWriter();
+
+    ArrowWriter(const ArrowWriter&) = delete;
+    ArrowWriter& operator=(const ArrowWriter&) = delete;
+
+    /**
+     * Append the results as a new record batch
+     * @param results the results to write
+     * @throw std::system_error if the file cannot be written
+     * @throw std::logic_error if the writer is closed
+     */
+    void write(const BatchResults& results);
+
+    /**
+     * Write the footer and close the file, the file is not a valid Arrow
+     * file before
+     * @throw std::system_error if the file cannot be written
+     */
+    void close();
+
+    //! Number of record batches written so far
+    size_t batches() const;
+
+private:
+    struct Block {
+        int64_t offset;
+        int32_t metadata_length;
+        int32_t padding;
+        int64_t body_length;
+    };
+
+    void writeMessage(const std::vector<uint8_t>& metadata);
+
+    std::string path_;
+    int fd_;
+    int64_t offset_;
+    std::vector<Block> blocks_;
+};
+
+/**
+ * Write the results to a new Arrow IPC file, see ArrowWriter
+ * @param path    path of the file to create
+ * @param results the results to write
+ * @throw std::system_error if the file cannot be written
+ */
+void writeArrow(const std::string& path, const BatchResults& results);
+
+} // namespace ellipsoid
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace ellipsoid {
+
+//! Scalar types used to store coordinates
+enum class ScalarFormat {
+    Float32,
+    Float64,
+};
+
+/**
+ * Layout of the binary capture files: an optional header followed by fixed
+ * size records, each containing the x, y and z coordinates stored
+ * contiguously (host endianness) among other fields
+ */
+struct RecordLayout {
+    //! Number of bytes to skip at the beginning of each file
+    size_t header_size{0};
+    //! Size of a record, in bytes
+    size_t record_size{3 * sizeof(double)};
+    //! Offset of the x coordinate inside a record, in bytes
+    size_t coordinates_offset{0};
+    //! Type of the coordinates
+    ScalarFormat format{ScalarFormat::Float64};
+};
+
+//! Settings of fitDataset()
+struct DatasetOptions {
+    //! Layout of the files
+    RecordLayout layout;
+    //! Number of bytes read at once from a file
+    size_t chunk_size{4 << 20};
+    //! Number of files read concurrently, and of reader threads
+    size_t concurrent_files{8};
+};
+
+//! Fit of a single file of a dataset
+struct FileResult {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    //! Path of the file
+    std::string path;
+    //! Moments of the file's points
+    Moments moments;
+    //! Ellipsoid fitted on the file's points
+    Parameters parameters;
+    //! Description of the problem encountered, empty if the file was read
+    std::string error;
+};
+
+//! Fit of a whole dataset
+struct DatasetResult {
+    //! Per file results, in the same order as the given paths
+    std::vector<FileResult, Eigen::aligned_allocator<FileResult>> files;
+    //! Moments of all the points successfully read
+    Moments moments;
+    //! Ellipsoid fitted on all the points successfully read
+    Parameters parameters;
+};
+
+/**
+ * Fit ellipsoids on a dataset made of several binary files, too large to
+ * fit in memory.
+ *
+ * Files are accumulated concurrently on defaultExecutor(), in chunks, the
+ * next chunk of a file being read while the current one is accumulated. The
+ * reads are performed by a pool of concurrent_files reader threads, so that
+ * the reads of the different files are in flight together. Only the moments
+ * of each file are kept in memory, giving both per file and aggregate
+ * ellipsoids.
+ *
+ * Unreadable files are reported in their result and excluded from the
+ * aggregate. So are files ending with a truncated record, their result
+ * still holding the moments and ellipsoid of their complete records.
+ *
+ * @param[in]   paths files to process
+ * @param[in]   options layout of the files and I/O settings
+ * @return      per file and aggregate results
+ */
+DatasetResult fitDataset(const std::vector<std::string>& paths,
+                         EllipsoidType type = EllipsoidType::Arbitrary,
+                         const DatasetOptions& options = DatasetOptions());
+
+} // namespace ellipsoid
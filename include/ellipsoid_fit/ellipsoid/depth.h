@@ -0,0 +1,90 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ellipsoid {
+
+//! Pinhole camera model used to unproject depth images
+struct CameraIntrinsics {
+    double fx; //!< focal length along x, in pixels
+    double fy; //!< focal length along y, in pixels
+    double cx; //!< principal point x coordinate, in pixels
+    double cy; //!< principal point y coordinate, in pixels
+};
+
+//! Pixel formats supported for depth images
+enum class DepthFormat {
+    UInt16,  //!< integer depth, e.g millimeters
+    Float32, //!< floating point depth
+};
+
+/**
+ * Non owning view on an organized depth image. Pixels with a zero or
+ * non-finite depth are considered invalid and skipped.
+ */
+struct DepthImage {
+    const void* data;   //!< first pixel of the image
+    DepthFormat format; //!< pixel format
+    size_t width;       //!< number of columns
+    size_t height;      //!< number of rows
+    size_t row_stride;  //!< distance between two rows, in bytes
+    double depth_scale; //!< scaling from pixel values to distances
+};
+
+/**
+ * Non owning view on a binary or label mask with the same size as the depth
+ * image
+ */
+struct ImageMask {
+    const uint8_t* data; //!< first pixel of the mask
+    size_t row_stride;   //!< distance between two rows, in bytes
+    int label;           //!< label to select, any non-zero value if negative
+};
+
+//! Rectangular part of an image
+struct RegionOfInterest {
+    size_t x;      //!< first column
+    size_t y;      //!< first row
+    size_t width;  //!< number of columns
+    size_t height; //!< number of rows
+};
+
+/**
+ * Unproject the selected pixels of a depth image and accumulate them
+ * directly into the given moments, without building the point cloud.
+ *
+ * The cost is linear in the number of selected pixels, about 4.5 ns per
+ * pixel and core with AVX2 (SSE2 only builds are 2 to 3 times slower). A
+ * fully valid 640x480 frame thus takes about 1.4 ms on a single core and
+ * only meets a 1 ms budget with at least two cores, the row bands being
+ * processed in parallel on defaultExecutor(). Masked objects covering less
+ * than two thirds of the frame stay under 1 ms on one core.
+ * @param[in,out]   moments moments to accumulate the points into
+ * @param[in]       image the depth image
+ * @param[in]       intrinsics camera intrinsic parameters
+ * @param[in]       mask optional mask selecting the pixels to use
+ * @param[in]       roi optional region of the image to process
+ */
+void accumulate(Moments& moments, const DepthImage& image,
+                const CameraIntrinsics& intrinsics,
+                const ImageMask* mask = nullptr,
+                const RegionOfInterest* roi = nullptr);
+
+/**
+ * Fit an ellipsoid on the points unprojected from a depth image
+ * @param[in]   image the depth image
+ * @param[in]   intrinsics camera intrinsic parameters
+ * @param[in]   mask optional mask selecting the pixels to use
+ * @param[in]   roi optional region of the image to process
+ * @return      ellipsoid's parameters, in the camera frame
+ */
+Parameters fit(const DepthImage& image, const CameraIntrinsics& intrinsics,
+               const ImageMask* mask = nullptr,
+               const RegionOfInterest* roi = nullptr,
+               EllipsoidType type = EllipsoidType::Arbitrary);
+
+} // namespace ellipsoid
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ellipsoid {
+
+/**
+ * Runs the tasks of the library's parallel algorithms.
+ *
+ * All the parallel code paths use the executor returned by defaultExecutor()
+ * so that an application can make the library share its own thread pool
+ * (see CallbackExecutor) or run everything on the calling thread (see
+ * SerialExecutor).
+ */
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    /**
+     * Run a task, possibly later and on another thread
+     * @param task function to run
+     */
+    virtual void submit(std::function<void()> task) = 0;
+
+    //! Number of tasks that can run at the same time
+    virtual size_t concurrency() const = 0;
+
+    /**
+     * Call body(i) for every i in [0, count) and wait for all the calls to
+     * complete.
+     *
+     * The calling thread takes part in the loop so it completes even if the
+     * submitted tasks cannot start, e.g when called from a task of a busy
+     * pool. The first exception thrown by body is rethrown.
+     *
+     * @param count     number of iterations
+     * @param body      function to call for each iteration
+     * @param max_tasks maximum number of concurrent calls, concurrency() if
+     * zero
+     */
+    virtual void parallelFor(size_t count,
+                             const std::function<void(size_t)>& body,
+                             size_t max_tasks = 0);
+};
+
+//! Executor running everything on the calling thread
+class SerialExecutor : public Executor {
+public:
+    void submit(std::function<void()> task) override;
+
+    size_t concurrency() const override;
+
+    void parallelFor(size_t count, const std::function<void(size_t)>& body,
+                     size_t max_tasks = 0) override;
+};
+
+/**
+ * Adapter submitting the tasks to an application's thread pool
+ */
+class CallbackExecutor : public Executor {
+public:
+    /**
+     * @param submit      function giving a task to the pool
+     * @param concurrency number of threads of the pool
+     */
+    CallbackExecutor(std::function<void(std::function<void()>)> submit,
+                     size_t concurrency);
+
+    void submit(std::function<void()> task) override;
+
+    size_t concurrency() const override;
+
+private:
+    std::function<void(std::function<void()>)> submit_;
+    size_t concurrency_;
+};
+
+/**
+ * Work stealing thread pool, the default executor.
+ *
+ * Each thread has its own queue: tasks submitted from a pool thread go to
+ * its queue and are taken back in LIFO order, idle threads steal the oldest
+ * tasks of the others.
+ */
+class WorkStealingExecutor : public Executor {
+public:
+    /**
+     * Start the threads
+     * @param threads number of threads, the number of hardware threads if
+     * zero
+     * @param cpus    CPUs the threads are restricted to, no restriction if
+     * empty
+     */
+    explicit WorkStealingExecutor(size_t threads = 0,
+                                  std::vector<int> cpus = std::vector<int>());
+
+    //! Run the remaining tasks and join the threads
+    ~WorkStealingExecutor() override;
+
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+    void submit(std::function<void()> task) override;
+
+    size_t concurrency() const override;
+
+    //! Whether the calling thread is one of the pool's threads
+    bool isWorker() const;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(size_t index);
+    bool pop(size_t index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::vector<int> cpus_;
+    std::atomic<size_t> next_queue_;
+    std::atomic<size_t> pending_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stop_;
+};
+
+/**
+ * Executor used by the library, a WorkStealingExecutor with one thread per
+ * hardware thread unless replaced by setDefaultExecutor()
+ */
+std::shared_ptr<Executor> defaultExecutor();
+
+/**
+ * Replace the executor used by the library
+ * @param executor executor to use, the built-in one if null
+ */
+void setDefaultExecutor(std::shared_ptr<Executor> executor);
+
+} // namespace ellipsoid
@@ -2,6 +2,7 @@
 
 #include <ellipsoid/common.h>
 #include <ellipsoid/eigenOrder.h>
+#include <ellipsoid/moments.h>
 #include <Eigen/Dense>
 
 namespace ellipsoid {
@@ -16,8 +17,29 @@ enum class EllipsoidType {
     AlignedXZEqual,
 };
 
+/**
+ * Everything fit() can compute on a set of points
+ */
+struct FitResult {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    //! ellipsoid's parameters
+    Parameters parameters;
+    //! the 10 coefficents of the ellipsoid in algebraic form
+    Eigen::Matrix<double, 10, 1> coefficients;
+    //! the eigenvalues, in the same order as the radii
+    Eigen::Vector3d eval;
+    //! the eigenvectors in columns, matching the eigenvalues
+    Eigen::Matrix3d evec_column;
+};
+
 /**
  * Fit an ellipsoid on the given data
+ *
+ * This overload and the following ones taking points are the unplanned
+ * path: they always build the Nxk design matrix, about 100 bytes per point,
+ * whatever the available memory. Use fit(data, FitOptions) from
+ * ellipsoid/planner.h for large point sets.
  * @param[in]   data 3xN matrix with the cartesian coordinates to fit the ellipsoid
  * on
  * @return      ellipsoid's parameters
@@ -82,5 +104,67 @@ Parameters fit(const Eigen::Matrix<double, Eigen::Dynamic, 3>& data,
     Eigen::Vector3d* eval_p, Eigen::Matrix3d* evec_column_p,
     EllipsoidType type = EllipsoidType::Arbitrary);
 
+/**
+ * Fit an ellipsoid on previously accumulated moments
+ * @param[in]   moments moments of the points to fit the ellipsoid on
+ * @return      ellipsoid's parameters
+ */
+Parameters fit(const Moments& moments,
+               EllipsoidType type = EllipsoidType::Arbitrary);
+
+/**
+ * Fit an ellipsoid on previously accumulated moments
+ * @param[in]   moments moments of the points to fit the ellipsoid on
+ * @param[out]  coefficients_p pointer storing the 10 coefficents of the fitted
+ * ellipsoid in algebraic form
+ * @return      ellipsoid's parameters
+ */
+Parameters fit(const Moments& moments,
+    Eigen::Matrix<double, 10, 1>* coefficients_p,
+    EllipsoidType type = EllipsoidType::Arbitrary);
+
+/**
+ * Fit an ellipsoid on previously accumulated moments
+ * @param[in]   moments moments of the points to fit the ellipsoid on
+ * @param[out]  eval_p pointer storing the eigenvalues
+ * @param[out]  evec_column_p pointer storing the eigenvectors in columns
+ * @return      ellipsoid's parameters
+ */
+Parameters fit(const Moments& moments,
+    Eigen::Vector3d* eval_p, Eigen::Matrix3d* evec_column_p,
+    EllipsoidType type = EllipsoidType::Arbitrary);
+
+/**
+ * Fit an ellipsoid on previously accumulated moments
+ * @param[in]   moments moments of the points to fit the ellipsoid on
+ * @param[out]  coefficients_p pointer storing the 10 coefficents of the fitted
+ * ellipsoid in algebraic form
+ * @param[out]  eval_p pointer storing the eigenvalues
+ * @param[out]  evec_column_p pointer storing the eigenvectors in columns
+ * @return      ellipsoid's parameters
+ *
+ * @note Solving from the moments gives the same ellipsoid as fitting on the
+ * points directly, without having to keep them in memory.
+ */
+Parameters fit(const Moments& moments,
+    Eigen::Matrix<double, 10, 1>* coefficients_p,
+    Eigen::Vector3d* eval_p, Eigen::Matrix3d* evec_column_p,
+    EllipsoidType type = EllipsoidType::Arbitrary);
+
+/**
+ * Compute the ellipsoid's parameters from its algebraic form
+ * @param[in]   coefficients the 10 coefficents of the ellipsoid in algebraic
+ * form, as given by fit()
+ * @param[out]  eval_p pointer storing the eigenvalues, solved from the
+ * ellipsoid after its centre translated to the origin of ref. frame.
+ * @param[out]  evec_column_p pointer storing the eigenvectors in columns,
+ * solved from the ellipsoid after its centre translated to the origin of ref.
+ * frame.
+ * @return      ellipsoid's parameters
+ */
+Parameters fromCoefficients(const Eigen::Matrix<double, 10, 1>& coefficients,
+                            Eigen::Vector3d* eval_p = nullptr,
+                            Eigen::Matrix3d* evec_column_p = nullptr);
+
 } // namespace ellipsoid
 
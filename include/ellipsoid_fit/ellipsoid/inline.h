@@ -0,0 +1,299 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+#include <Eigen/Eigenvalues>
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <array>
+
+/*
+ * Header-only implementation of fit() on points, also used by the library.
+ *
+ * fitInline() is templated on the type of the points so that, for a fixed
+ * number of points, every matrix has a fixed maximum size: the fit runs
+ * without heap allocation and can be inlined and unrolled in the caller's
+ * loops. It only needs Eigen, not the ellipsoid-fit library.
+ */
+
+namespace ellipsoid {
+
+namespace detail {
+
+// Matrix types of a fit on points of type Derived, the columns being bounded
+// by the 9 unknowns of the arbitrary ellipsoid
+template <typename Derived>
+struct FitTypes {
+    static constexpr int Rows = Derived::RowsAtCompileTime;
+    static constexpr int MaxRows = Derived::MaxRowsAtCompileTime;
+
+    using Design =
+        Eigen::Matrix<double, Rows, Eigen::Dynamic, Eigen::ColMajor, MaxRows, 9>;
+    using Points = Eigen::Matrix<double, Rows, 1, Eigen::ColMajor, MaxRows, 1>;
+    using Normal = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                                 Eigen::ColMajor, 9, 9>;
+    using Unknowns =
+        Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, 9, 1>;
+};
+
+// Convert the solution of the normal equations back to the conventional
+// algebraic form
+inline Eigen::Matrix<double, 10, 1> coefficientsFromSolution(
+    const Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, 9, 1>& u,
+    EllipsoidType type) {
+    Eigen::Matrix<double, 10, 1> v;
+    switch (type) {
+    case EllipsoidType::Arbitrary:
+        v(0) = u(0) + u(1) - 1.;
+        v(1) = u(0) - 2. * u(1) - 1.;
+        v(2) = u(1) - 2. * u(0) - 1.;
+        v.segment<7>(3) = u.segment<7>(2);
+        break;
+    case EllipsoidType::XYEqual:
+        v(0) = u(0) - 1.;
+        v(1) = u(0) - 1.;
+        v(2) = -2. * u(0) - 1.;
+        v.segment<7>(3) = u.segment<7>(1);
+        break;
+    case EllipsoidType::XZEqual:
+        v(0) = u(0) - 1.;
+        v(1) = -2. * u(0) - 1.;
+        v(2) = u(0) - 1.;
+        v.segment<7>(3) = u.segment<7>(1);
+        break;
+    case EllipsoidType::Sphere:
+        v.segment<3>(0).setConstant(-1.);
+        v.segment<3>(3).setZero();
+        v.segment<4>(6) = u.segment<4>(0);
+        break;
+    case EllipsoidType::Aligned:
+        v(0) = u(0) + u(1) - 1.;
+        v(1) = u(0) - 2. * u(1) - 1.;
+        v(2) = u(1) - 2. * u(0) - 1.;
+        v.segment<3>(3).setZero();
+        v.segment<4>(6) = u.segment<4>(2);
+        break;
+    case EllipsoidType::AlignedXYEqual:
+        v(0) = u(0) - 1.;
+        v(1) = u(0) - 1.;
+        v(2) = -2. * u(0) - 1.;
+        v.segment<3>(3).setZero();
+        v.segment<4>(6) = u.segment<4>(1);
+        break;
+    case EllipsoidType::AlignedXZEqual:
+        v(0) = u(0) - 1.;
+        v(1) = -2. * u(0) - 1.;
+        v(2) = u(0) - 1.;
+        v.segment<3>(3).setZero();
+        v.segment<4>(6) = u.segment<4>(1);
+        break;
+    }
+
+    return v;
+}
+
+// Design matrix of the llsq problem, one row per point, and its RHS
+template <typename Derived>
+typename FitTypes<Derived>::Design
+designMatrix(const Eigen::MatrixBase<Derived>& data, EllipsoidType type,
+             typename FitTypes<Derived>::Points& d2) {
+    const auto& x = data.col(0);
+    const auto& y = data.col(1);
+    const auto& z = data.col(2);
+
+    auto x_sq = x.cwiseProduct(x).eval();
+    auto y_sq = y.cwiseProduct(y).eval();
+    auto z_sq = z.cwiseProduct(z).eval();
+
+    typename FitTypes<Derived>::Design D;
+    switch (type) {
+    case EllipsoidType::Arbitrary:
+        D.resize(data.rows(), 9);
+        D.col(0) = x_sq + y_sq - 2. * z_sq;
+        D.col(1) = x_sq + z_sq - 2. * y_sq;
+        D.col(2) = 2. * x.cwiseProduct(y);
+        D.col(3) = 2. * x.cwiseProduct(z);
+        D.col(4) = 2. * y.cwiseProduct(z);
+        D.col(5) = 2. * x;
+        D.col(6) = 2. * y;
+        D.col(7) = 2. * z;
+        D.col(8).setOnes();
+        break;
+    case EllipsoidType::XYEqual:
+        D.resize(data.rows(), 8);
+        D.col(0) = x_sq + y_sq - 2. * z_sq;
+        D.col(1) = 2. * x.cwiseProduct(y);
+        D.col(2) = 2. * x.cwiseProduct(z);
+        D.col(3) = 2. * y.cwiseProduct(z);
+        D.col(4) = 2. * x;
+        D.col(5) = 2. * y;
+        D.col(6) = 2. * z;
+        D.col(7).setOnes();
+        break;
+    case EllipsoidType::XZEqual:
+        D.resize(data.rows(), 8);
+        D.col(0) = x_sq + z_sq - 2. * y_sq;
+        D.col(1) = 2. * x.cwiseProduct(y);
+        D.col(2) = 2. * x.cwiseProduct(z);
+        D.col(3) = 2. * y.cwiseProduct(z);
+        D.col(4) = 2. * x;
+        D.col(5) = 2. * y;
+        D.col(6) = 2. * z;
+        D.col(7).setOnes();
+        break;
+    case EllipsoidType::Sphere:
+        D.resize(data.rows(), 4);
+        D.col(0) = 2. * x;
+        D.col(1) = 2. * y;
+        D.col(2) = 2. * z;
+        D.col(3).setOnes();
+        break;
+    case EllipsoidType::Aligned:
+        D.resize(data.rows(), 6);
+        D.col(0) = x_sq + y_sq - 2. * z_sq;
+        D.col(1) = x_sq + z_sq - 2. * y_sq;
+        D.col(2) = 2. * x;
+        D.col(3) = 2. * y;
+        D.col(4) = 2. * z;
+        D.col(5).setOnes();
+        break;
+    case EllipsoidType::AlignedXYEqual:
+        D.resize(data.rows(), 5);
+        D.col(0) = x_sq + y_sq - 2. * z_sq;
+        D.col(1) = 2. * x;
+        D.col(2) = 2. * y;
+        D.col(3) = 2. * z;
+        D.col(4).setOnes();
+        break;
+    case EllipsoidType::AlignedXZEqual:
+        D.resize(data.rows(), 5);
+        D.col(0) = x_sq + z_sq - 2. * y_sq;
+        D.col(1) = 2. * x;
+        D.col(2) = 2. * y;
+        D.col(3) = 2. * z;
+        D.col(4).setOnes();
+        break;
+    }
+    d2 = x_sq + y_sq + z_sq;
+
+    return D;
+}
+
+// Center of the quadric given by its algebraic coefficients
+inline Eigen::Vector3d solveCenter(const Eigen::Matrix<double, 10, 1>& v) {
+    Eigen::Matrix3d A;
+    A << v(0), v(3), v(4), v(3), v(1), v(5), v(4), v(5), v(2);
+    return -Eigen::JacobiSVD<Eigen::Matrix3d>(A, Eigen::ComputeFullU |
+                                                     Eigen::ComputeFullV)
+                .solve(v.segment<3>(6));
+}
+
+// Eigenvalues and eigenvectors of the quadric translated to its center, in
+// the order of the eigensolver. The matrix being symmetric, Solver can also be
+// a SelfAdjointEigenSolver, which compiles to much less code
+template <typename Solver = Eigen::EigenSolver<Eigen::Matrix3d>>
+void solveAxes(const Eigen::Matrix<double, 10, 1>& v,
+                      const Eigen::Vector3d& center, Eigen::Vector3d& eval,
+                      Eigen::Matrix3d& evec_column) {
+    // form the algebraic form of the ellipsoid
+    Eigen::Matrix4d A;
+    A << v(0), v(3), v(4), v(6), v(3), v(1), v(5), v(7), v(4), v(5), v(2), v(8),
+        v(6), v(7), v(8), v(9);
+
+    // form the corresponding translation matrix
+    Eigen::Matrix4d T(Eigen::Matrix4d::Identity());
+    T.block<1, 3>(3, 0) = center.transpose();
+    // translate to the center
+    const Eigen::Matrix4d R = T * A * T.transpose();
+    // solve the eigenproblem
+    const Solver solver(R.block<3, 3>(0, 0) / -R(3, 3));
+    eval = solver.eigenvalues().real();
+    evec_column = solver.eigenvectors().real();
+}
+
+// See eigenOrder::leastRotationAngle()
+inline void orderAxes(Eigen::Vector3d& eval, Eigen::Matrix3d& evec_column) {
+    // All possible placements of eigenvalues and eigenvectors
+    const std::array<const std::array<const int, 3>, 6> order_set = {{
+        {0, 1, 2}, {0, 2, 1},
+        {1, 0, 2}, {1, 2, 0},
+        {2, 0, 1}, {2, 1, 0}
+    }};
+    // All possible signs assigned to eigenvectors
+    const std::array<const std::array<const int, 3>, 4> sign_set = {{
+        {0, 0, 0}, {0, 1, 0},
+        {1, 0, 0}, {1, 1, 0}
+    }};
+
+    // Keep the configuration with the least rotation angle, the first one
+    // in case of ties
+    double min_angle = 0.;
+    Eigen::Vector3d best_eval = Eigen::Vector3d::Zero();
+    Eigen::Matrix3d best_evec = Eigen::Matrix3d::Zero();
+    bool first = true;
+    for (const auto& order : order_set) {
+        for (const auto& sign : sign_set) {
+            Eigen::Vector3d temp_vector;
+            Eigen::Matrix3d temp_matrix;
+            for (int i = 0; i < 3; i++) {
+                temp_matrix.col(i) = (sign[i] != 0 ? -1. : 1.) *
+                                     evec_column.col(order[i]);
+                temp_vector(i) = eval(order[i]);
+            }
+            // Ensure the determinant always positive to preserve orientation
+            if (temp_matrix.determinant() < 0) {
+                temp_matrix.col(2) = -temp_matrix.col(2);
+            }
+
+            // rotation angle based on Rodrigues' rotation formula
+            const double angle = Eigen::AngleAxisd(temp_matrix).angle();
+            if (first or angle < min_angle) {
+                min_angle = angle;
+                best_eval = temp_vector;
+                best_evec = temp_matrix;
+                first = false;
+            }
+        }
+    }
+
+    // Overwrites the inputs
+    eval = best_eval;
+    evec_column = best_evec;
+}
+
+} // namespace detail
+
+/**
+ * Fit an ellipsoid on the given data, as fit() does but inline and without
+ * heap allocation for a fixed number of points
+ * @param[in]   data Nx3 matrix with the cartesian coordinates to fit the
+ * ellipsoid on, e.g a Eigen::Matrix<double, 20, 3>
+ * @param[in]   type type of ellipsoid to fit
+ * @return      everything computed by the fit
+ */
+template <typename Derived>
+FitResult fitInline(const Eigen::MatrixBase<Derived>& data,
+                    EllipsoidType type = EllipsoidType::Arbitrary) {
+    using Types = detail::FitTypes<Derived>;
+
+    typename Types::Points d2;
+    const auto D = detail::designMatrix(data, type, d2);
+    const typename Types::Normal N = D.transpose() * D;
+    const typename Types::Unknowns rhs = D.transpose() * d2;
+    const typename Types::Unknowns u =
+        Eigen::JacobiSVD<typename Types::Normal>(
+            N, Eigen::ComputeFullU | Eigen::ComputeFullV)
+            .solve(rhs);
+
+    FitResult result;
+    result.coefficients = detail::coefficientsFromSolution(u, type);
+    result.parameters.center = detail::solveCenter(result.coefficients);
+    detail::solveAxes(result.coefficients, result.parameters.center,
+                      result.eval, result.evec_column);
+    detail::orderAxes(result.eval, result.evec_column);
+    result.parameters.radii = result.eval.cwiseInverse().cwiseSqrt();
+    return result;
+}
+
+} // namespace ellipsoid
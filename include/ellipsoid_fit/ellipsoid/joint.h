@@ -0,0 +1,64 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+#include <vector>
+
+namespace ellipsoid {
+
+/**
+ * Calibration of one sensor obtained from fitJoint()
+ */
+struct SensorCalibration {
+    //! Ellipsoid fitted on the sensor's raw data
+    Parameters parameters;
+    //! Symmetric matrix mapping the centered raw data onto the shared sphere
+    Eigen::Matrix3d soft_iron;
+    //! Rotation from the sensor's frame to the reference sensor's frame
+    Eigen::Matrix3d rotation;
+};
+
+/**
+ * Result of the joint calibration of sensors measuring the same field
+ */
+struct JointCalibration {
+    //! Magnitude of the field, shared by all the sensors
+    double field_magnitude;
+    //! Per sensor calibration, in the same order as the input data
+    std::vector<SensorCalibration> sensors;
+    //! Whether the relative rotations have been estimated (synchronized data)
+    bool rotations_estimated;
+
+    /**
+     * Calibrate a raw sample and express it in the reference sensor's frame
+     * @param sensor index of the sensor that produced the sample
+     * @param raw    raw sample
+     * @return       calibrated sample
+     */
+    Eigen::Vector3d apply(size_t sensor, const Eigen::Vector3d& raw) const;
+};
+
+/**
+ * Jointly calibrate several sensors measuring the same field (e.g
+ * magnetometers mounted on the same board).
+ *
+ * Each sensor gets its own ellipsoid, all of them are mapped on a sphere of
+ * the same radius and, if all data sets have the same number of samples
+ * (i.e sample i of each set has been taken at the same time), the rotation
+ * between each sensor and the reference one is estimated.
+ *
+ * The per sensor normal equations are independent blocks, so they are
+ * accumulated and solved in parallel with a cost linear in the number of
+ * sensors.
+ *
+ * @param[in]   data one Nx3 matrix of raw samples per sensor
+ * @param[in]   type type of ellipsoid to fit for all sensors
+ * @param[in]   reference index of the sensor giving the reference frame
+ * @return      the calibration of all sensors
+ */
+JointCalibration fitJoint(
+    const std::vector<Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    EllipsoidType type = EllipsoidType::Arbitrary, size_t reference = 0);
+
+} // namespace ellipsoid
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <ellipsoid/moments.h>
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <vector>
+
+namespace ellipsoid {
+
+/**
+ * Result of fitLazy(): the algebraic coefficients solved by the fit, the
+ * quantities derived from them being computed on first use then cached.
+ *
+ * The center costs a 3x3 solve, the eigenvalues, eigenvectors and radii an
+ * additional eigen decomposition and the least rotation ordering (see
+ * eigenOrder::leastRotationAngle). contains() only uses the coefficients.
+ *
+ * The cache makes the const member functions unsafe to call concurrently on
+ * the same instance.
+ */
+class LazyFit {
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    //! Result of an empty fit, with null coefficients
+    LazyFit();
+
+    /**
+     * Build the result from algebraic coefficients
+     * @param coefficients the 10 coefficients, see fit(), relative to origin
+     * @param origin point the coefficients are expressed relative to
+     */
+    explicit LazyFit(
+        const Eigen::Matrix<double, 10, 1>& coefficients,
+        const Eigen::Vector3d& origin = Eigen::Vector3d::Zero());
+
+    //! The 10 coefficients of the algebraic form in the ref. frame
+    const Eigen::Matrix<double, 10, 1>& coefficients() const;
+
+    /**
+     * Value of the algebraic form at a point
+     * @param point cartesian coordinates of the point
+     * @return zero on the surface
+     */
+    double evaluate(const Eigen::Vector3d& point) const;
+
+    /**
+     * Tell if a point is inside the ellipsoid
+     * @param point cartesian coordinates of the point
+     * @return true if strictly inside
+     */
+    bool contains(const Eigen::Vector3d& point) const;
+
+    //! Center of the ellipsoid
+    const Eigen::Vector3d& center() const;
+
+    //! Eigenvalues, in the order of the radii
+    const Eigen::Vector3d& eigenvalues() const;
+
+    //! Eigenvectors in columns, matching the eigenvalues
+    const Eigen::Matrix3d& eigenvectors() const;
+
+    //! Radii of the ellipsoid, NaN for a hyperboloid
+    Eigen::Vector3d radii() const;
+
+    //! Center and radii, as returned by fit()
+    Parameters parameters() const;
+
+    //! Everything, as computed by fit()
+    FitResult result() const;
+
+private:
+    enum Computed : uint8_t {
+        Coefficients = 1,
+        Center = 2,
+        Axes = 4,
+    };
+
+    bool computed(Computed part) const;
+
+    // coefficients relative to origin_
+    Eigen::Matrix<double, 10, 1> local_;
+    Eigen::Vector3d origin_;
+
+    mutable Eigen::Matrix<double, 10, 1> coefficients_;
+    mutable Eigen::Vector3d center_;
+    mutable Eigen::Vector3d eval_;
+    mutable Eigen::Matrix3d evec_column_;
+    mutable uint8_t computed_;
+};
+
+//! Results of fitLazy() on several problems
+using LazyFits = std::vector<LazyFit, Eigen::aligned_allocator<LazyFit>>;
+
+/**
+ * Fit an ellipsoid on the given data, only solving for its coefficients
+ * @param[in]   data Nx3 matrix with the cartesian coordinates to fit the
+ * ellipsoid on
+ * @param[in]   type type of ellipsoid to fit
+ * @return      the coefficients, the other quantities being computed on
+ * demand
+ */
+LazyFit fitLazy(const Eigen::Matrix<double, Eigen::Dynamic, 3>& data,
+                EllipsoidType type = EllipsoidType::Arbitrary);
+
+/**
+ * Fit an ellipsoid on the given moments, only solving for its coefficients
+ * @param[in]   moments moments of the points to fit the ellipsoid on
+ * @param[in]   type type of ellipsoid to fit
+ * @return      the coefficients, the other quantities being computed on
+ * demand
+ */
+LazyFit fitLazy(const Moments& moments,
+                EllipsoidType type = EllipsoidType::Arbitrary);
+
+/**
+ * Fit an ellipsoid on each set of moments, in parallel using
+ * defaultExecutor(), only solving for their coefficients
+ * @param[in]   problems moments of each point set
+ * @param[in]   type type of ellipsoid to fit
+ * @return      the results, in the order of the problems
+ */
+LazyFits
+fitLazy(const std::vector<Moments, Eigen::aligned_allocator<Moments>>& problems,
+        EllipsoidType type = EllipsoidType::Arbitrary);
+
+} // namespace ellipsoid
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+namespace ellipsoid {
+
+/**
+ * Accumulate the moments of the surface of a triangle mesh.
+ *
+ * The moments are integrated exactly over each triangle (they are
+ * polynomials of degree 4 at most) so the result only depends on the
+ * surface and not on its tessellation.
+ *
+ * @param[in,out]   moments moments to accumulate the surface into
+ * @param[in]       vertices Nx3 matrix with the cartesian coordinates of the
+ * mesh vertices
+ * @param[in]       triangles Mx3 matrix with the indices of the vertices of
+ * each triangle
+ */
+void accumulate(Moments& moments,
+                const Eigen::Matrix<double, Eigen::Dynamic, 3>& vertices,
+                const Eigen::Matrix<int, Eigen::Dynamic, 3>& triangles);
+
+/**
+ * Fit an ellipsoid on the surface of a triangle mesh, each part of the
+ * surface being weighted by its area
+ * @param[in]   vertices Nx3 matrix with the cartesian coordinates of the mesh
+ * vertices
+ * @param[in]   triangles Mx3 matrix with the indices of the vertices of each
+ * triangle
+ * @return      ellipsoid's parameters
+ */
+Parameters fit(const Eigen::Matrix<double, Eigen::Dynamic, 3>& vertices,
+               const Eigen::Matrix<int, Eigen::Dynamic, 3>& triangles,
+               EllipsoidType type = EllipsoidType::Arbitrary);
+
+} // namespace ellipsoid
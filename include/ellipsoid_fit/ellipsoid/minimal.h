@@ -0,0 +1,197 @@
+#pragma once
+
+#include <ellipsoid/inline.h>
+#include <Eigen/Cholesky>
+
+#include <cstddef>
+
+/*
+ * Minimal profile for microcontroller-class targets: header-only, fixed-size
+ * storage only, no heap allocation, no exceptions and no iostream. Only this
+ * header is needed, the ellipsoid-fit library doesn't have to be linked.
+ *
+ * Suggested flags: -fno-exceptions -fno-rtti -DEIGEN_NO_MALLOC -DEIGEN_NO_IO
+ */
+
+namespace ellipsoid {
+
+namespace detail {
+
+// Number of unknowns of the normal equations for each type of ellipsoid
+constexpr int unknowns(EllipsoidType type) {
+    return type == EllipsoidType::Arbitrary
+               ? 9
+               : (type == EllipsoidType::XYEqual or
+                  type == EllipsoidType::XZEqual)
+                     ? 8
+                     : type == EllipsoidType::Sphere
+                           ? 4
+                           : type == EllipsoidType::Aligned ? 6 : 5;
+}
+
+// One row of the design matrix, see designMatrix()
+template <EllipsoidType Type, typename Scalar>
+void designRow(Scalar x, Scalar y, Scalar z,
+               Eigen::Matrix<Scalar, unknowns(Type), 1>& row) {
+    const Scalar x_sq = x * x;
+    const Scalar y_sq = y * y;
+    const Scalar z_sq = z * z;
+    const Scalar two(2);
+    switch (Type) {
+    case EllipsoidType::Arbitrary:
+        row(0) = x_sq + y_sq - two * z_sq;
+        row(1) = x_sq + z_sq - two * y_sq;
+        row(2) = two * x * y;
+        row(3) = two * x * z;
+        row(4) = two * y * z;
+        break;
+    case EllipsoidType::XYEqual:
+        row(0) = x_sq + y_sq - two * z_sq;
+        row(1) = two * x * y;
+        row(2) = two * x * z;
+        row(3) = two * y * z;
+        break;
+    case EllipsoidType::XZEqual:
+        row(0) = x_sq + z_sq - two * y_sq;
+        row(1) = two * x * y;
+        row(2) = two * x * z;
+        row(3) = two * y * z;
+        break;
+    case EllipsoidType::Sphere:
+        break;
+    case EllipsoidType::Aligned:
+        row(0) = x_sq + y_sq - two * z_sq;
+        row(1) = x_sq + z_sq - two * y_sq;
+        break;
+    case EllipsoidType::AlignedXYEqual:
+        row(0) = x_sq + y_sq - two * z_sq;
+        break;
+    case EllipsoidType::AlignedXZEqual:
+        row(0) = x_sq + z_sq - two * y_sq;
+        break;
+    }
+    // the linear and constant terms always come last
+    const int n = unknowns(Type);
+    row(n - 4) = two * x;
+    row(n - 3) = two * y;
+    row(n - 2) = two * z;
+    row(n - 1) = Scalar(1);
+}
+
+} // namespace detail
+
+/**
+ * Streaming fit with static memory, e.g for magnetometer calibration: each
+ * sample updates the normal equations of the least squares problem in place,
+ * so the memory used doesn't depend on the number of samples.
+ *
+ * The samples are taken relative to the first one, which keeps the sums
+ * well conditioned in single precision when the center is far from the
+ * origin. In exact arithmetic, the result is the one of fit() on all the samples.
+ *
+ * @tparam Type   type of ellipsoid to fit
+ * @tparam Scalar type of the accumulated sums, float on targets with a
+ * single precision FPU
+ */
+template <EllipsoidType Type = EllipsoidType::Arbitrary,
+          typename Scalar = float>
+class StaticFitter {
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    static constexpr int Unknowns = detail::unknowns(Type);
+
+    using Vector3 = Eigen::Matrix<Scalar, 3, 1>;
+
+    StaticFitter() {
+        reset();
+    }
+
+    //! Add one sample
+    void add(Scalar x, Scalar y, Scalar z) {
+        if (count_ == 0) {
+            reference_ << x, y, z;
+        }
+        x -= reference_.x();
+        y -= reference_.y();
+        z -= reference_.z();
+
+        Eigen::Matrix<Scalar, Unknowns, 1> row;
+        detail::designRow<Type>(x, y, z, row);
+        normal_.noalias() += row * row.transpose();
+        rhs_ += (x * x + y * y + z * z) * row;
+        ++count_;
+    }
+
+    //! Add one sample
+    void add(const Vector3& sample) {
+        add(sample.x(), sample.y(), sample.z());
+    }
+
+    /**
+     * Solve for the ellipsoid fitting the samples added so far
+     * @param[out] result everything computed by the fit, left untouched on
+     * failure
+     * @return false if there are not enough samples or they don't define a
+     * unique solution
+     */
+    bool fit(FitResult& result) const {
+        if (count_ < static_cast<size_t>(Unknowns)) {
+            return false;
+        }
+        const Eigen::LDLT<Eigen::Matrix<Scalar, Unknowns, Unknowns>> ldlt(
+            normal_);
+        if (ldlt.info() != Eigen::Success or not ldlt.isPositive()) {
+            return false;
+        }
+        const Eigen::Matrix<double, Unknowns, 1> u =
+            ldlt.solve(rhs_).template cast<double>();
+        if (not u.allFinite()) {
+            return false;
+        }
+
+        // coefficients relative to the reference sample
+        const Eigen::Matrix<double, 10, 1> v =
+            detail::coefficientsFromSolution(u, Type);
+        const Eigen::Vector3d reference = reference_.template cast<double>();
+
+        result.parameters.center = detail::solveCenter(v) + reference;
+        detail::solveAxes<Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d>>(
+            v, result.parameters.center - reference, result.eval,
+            result.evec_column);
+        detail::orderAxes(result.eval, result.evec_column);
+        result.parameters.radii = result.eval.cwiseInverse().cwiseSqrt();
+
+        // move the coefficients back to the original frame: the quadratic
+        // part is unchanged, the linear and constant ones are shifted
+        Eigen::Matrix3d A;
+        A << v(0), v(3), v(4), v(3), v(1), v(5), v(4), v(5), v(2);
+        const Eigen::Vector3d b = v.segment<3>(6);
+        result.coefficients = v;
+        result.coefficients.segment<3>(6) = b - A * reference;
+        result.coefficients(9) = v(9) + reference.dot(A * reference) -
+                                 2. * b.dot(reference);
+        return true;
+    }
+
+    //! Number of samples added so far
+    size_t count() const {
+        return count_;
+    }
+
+    //! Discard all samples
+    void reset() {
+        normal_.setZero();
+        rhs_.setZero();
+        reference_.setZero();
+        count_ = 0;
+    }
+
+private:
+    Eigen::Matrix<Scalar, Unknowns, Unknowns> normal_;
+    Eigen::Matrix<Scalar, Unknowns, 1> rhs_;
+    Vector3 reference_;
+    size_t count_;
+};
+
+} // namespace ellipsoid
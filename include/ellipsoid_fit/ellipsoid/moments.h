@@ -0,0 +1,133 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+#include <cstddef>
+
+namespace ellipsoid {
+
+/**
+ * Accumulate the second order moments of the monomials
+ * \f$m = [x^2, y^2, z^2, 2xy, 2xz, 2yz, 2x, 2y, 2z, 1]^T\f$ of a point set,
+ * i.e \f$M = \sum_i w_i m_i m_i^T\f$.
+ *
+ * The normal equations of every EllipsoidType can be formed from \f$M\f$ so
+ * the points never have to be stored and partial sums computed on disjoint
+ * subsets of the data can be merged together.
+ *
+ * To keep the normal equations well conditioned, the points are expressed
+ * relative to an origin close to the data. Unless given explicitly, it is
+ * taken as the first point (or mean of the first chunk of points) added.
+ */
+class Moments {
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    using Matrix = Eigen::Matrix<double, 10, 10>;
+
+    Moments();
+
+    /**
+     * Create an empty set of moments using the given origin
+     * @param origin point subtracted from all the points before accumulation
+     */
+    explicit Moments(const Eigen::Vector3d& origin);
+
+    /**
+     * Add a single point
+     * @param x      point's x coordinate
+     * @param y      point's y coordinate
+     * @param z      point's z coordinate
+     * @param weight point's weight, must be positive
+     */
+    void add(double x, double y, double z, double weight = 1.);
+
+    /**
+     * Add a set of points
+     * @param data Nx3 matrix with the cartesian coordinates of the points
+     */
+    void add(const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>&
+                 data);
+
+    /**
+     * Add a set of weighted points
+     * @param data    Nx3 matrix with the cartesian coordinates of the points
+     * @param weights N vector with the (positive) weight of each point
+     */
+    void add(const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>&
+                 data,
+             const Eigen::Ref<const Eigen::VectorXd>& weights);
+
+    /**
+     * Add a set of points already expressed relative to origin(), which is
+     * the ref. frame's origin if not set yet. This avoids a subtraction when
+     * the coordinates are produced relative to a known point.
+     * @param data Nx3 matrix with the coordinates of the points relative to
+     * origin()
+     */
+    void addRelative(
+        const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>&
+            data);
+
+    /**
+     * Add the moments accumulated by another instance, expressing them
+     * relative to this instance's origin if needed
+     * @param other moments to add
+     */
+    void merge(const Moments& other);
+
+    Moments& operator+=(const Moments& other);
+
+    //! Discard everything accumulated so far, keeping the current origin
+    void reset();
+
+    //! The symmetric 10x10 moment matrix, relative to origin()
+    Matrix matrix() const;
+
+    //! Origin the points are expressed relative to
+    const Eigen::Vector3d& origin() const;
+
+    /**
+     * Express the moments relative to another origin
+     * @param origin new origin
+     */
+    void setOrigin(const Eigen::Vector3d& origin);
+
+    /**
+     * Linear map transforming the monomials of a point expressed relative to
+     * some origin o into the monomials of the same point expressed relative
+     * to o - offset, i.e \f$m(p - o + offset) = L m(p - o)\f$
+     * @param offset translation to apply
+     * @return the 10x10 matrix L
+     */
+    static Matrix translation(const Eigen::Vector3d& offset);
+
+    //! Number of points accumulated so far
+    size_t count() const;
+
+private:
+    void initOrigin(const Eigen::Vector3d& origin);
+
+    void accumulate(
+        const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+        const double* weights, const Eigen::Vector3d& shift);
+
+    Matrix lower_; // only the lower triangular part is kept up to date
+    Eigen::Vector3d origin_;
+    size_t count_;
+    bool has_origin_;
+};
+
+/**
+ * Accumulate the moments of a large point set in parallel, chunk by chunk,
+ * on defaultExecutor(). The chunk moments are merged in order so the result
+ * doesn't depend on the scheduling.
+ * @param data       Nx3 matrix with the cartesian coordinates of the points
+ * @param chunk_rows number of points per chunk, see BufferOptions
+ * @return the moments of all the points
+ */
+Moments accumulateParallel(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    size_t chunk_rows = size_t(1) << 18);
+
+} // namespace ellipsoid
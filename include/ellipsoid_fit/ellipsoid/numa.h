@@ -0,0 +1,137 @@
+#pragma once
+
+#include <ellipsoid/executor.h>
+#include <Eigen/Dense>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace ellipsoid {
+
+//! A NUMA node and the CPUs it contains
+struct NumaNode {
+    //! Node number, as in /sys/devices/system/node/node<id>
+    int id;
+    //! CPUs of the node usable by the process
+    std::vector<int> cpus;
+};
+
+/**
+ * NUMA nodes having CPUs usable by the process, read from sysfs. A single
+ * node with all the usable CPUs is returned when the information is not
+ * available.
+ */
+std::vector<NumaNode> numaTopology();
+
+/**
+ * Executor with one WorkStealingExecutor per NUMA node, whose threads are
+ * restricted to the node's CPUs.
+ *
+ * parallelFor() splits the iterations in contiguous ranges, one per node
+ * proportionally to its number of threads, so that a buffer initialized by
+ * a parallelFor() over its chunks (first touch) is later processed by the
+ * same node, see PointBuffer and accumulateParallel().
+ */
+class NumaExecutor : public Executor {
+public:
+    /**
+     * Start the threads
+     * @param nodes            nodes to use
+     * @param threads_per_node number of threads per node, one per CPU of the
+     * node if zero
+     */
+    explicit NumaExecutor(const std::vector<NumaNode>& nodes = numaTopology(),
+                          size_t threads_per_node = 0);
+
+    void submit(std::function<void()> task) override;
+
+    size_t concurrency() const override;
+
+    void parallelFor(size_t count, const std::function<void(size_t)>& body,
+                     size_t max_tasks = 0) override;
+
+    //! Number of nodes used
+    size_t nodes() const;
+
+private:
+    std::vector<std::unique_ptr<WorkStealingExecutor>> pools_;
+    size_t concurrency_;
+    std::atomic<size_t> next_pool_;
+};
+
+//! Huge pages usage of a PointBuffer
+enum class HugePages {
+    //! Regular pages only
+    None,
+    //! Transparent huge pages, if enabled by the system
+    Transparent,
+    //! Pages from the reserved huge pages pool (MAP_HUGETLB), falling back to
+    //! transparent huge pages if none are available
+    Explicit,
+};
+
+//! Settings of a PointBuffer
+struct BufferOptions {
+    //! Huge pages usage
+    HugePages huge_pages{HugePages::Transparent};
+    //! Number of rows of the chunks used for the first touch, should match
+    //! the chunks given to accumulateParallel()
+    size_t chunk_rows{size_t(1) << 18};
+};
+
+/**
+ * Nx3 point storage for very large inputs, with NUMA aware placement.
+ *
+ * The memory is mapped directly, optionally backed by huge pages, and
+ * zeroed chunk by chunk with defaultExecutor()->parallelFor(). With a
+ * NumaExecutor, each chunk is thus placed on the node that later processes
+ * it in accumulateParallel(). Each column is padded to a multiple of the
+ * chunk size so that chunks do not share pages.
+ */
+class PointBuffer {
+public:
+    using Points = Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 3>, 0,
+                              Eigen::OuterStride<>>;
+    using ConstPoints =
+        Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 3>, 0,
+                   Eigen::OuterStride<>>;
+
+    /**
+     * Allocate and zero the buffer
+     * @param rows    number of points
+     * @param options huge pages and chunking settings
+     * @throw std::bad_alloc if the memory cannot be mapped
+     */
+    explicit PointBuffer(size_t rows,
+                         const BufferOptions& options = BufferOptions());
+
+    ~PointBuffer();
+
+    PointBuffer(const PointBuffer&) = delete;
+    PointBuffer& operator=(const PointBuffer&) = delete;
+
+    //! The points, as a Nx3 matrix
+    Points points();
+
+    //! The points, as a Nx3 matrix
+    ConstPoints points() const;
+
+    //! Number of points
+    size_t rows() const;
+
+    //! Whether the buffer comes from the reserved huge pages pool
+    bool explicitHugePages() const;
+
+private:
+    void* mapping_;
+    size_t mapping_size_;
+    double* data_;
+    size_t rows_;
+    size_t stride_;
+    bool explicit_huge_pages_;
+};
+
+} // namespace ellipsoid
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <ellipsoid/moments.h>
+#include <ellipsoid/ring.h>
+
+#include <cstddef>
+
+namespace ellipsoid {
+
+/**
+ * Incremental fit of a stream of samples: new samples are accumulated into
+ * running moments and the ellipsoid is solved again from them, at a cost
+ * independent of the number of samples received so far.
+ */
+class OnlineFitter {
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    /**
+     * @param type        type of ellipsoid to fit
+     * @param min_samples number of samples required before the first fit
+     */
+    explicit OnlineFitter(EllipsoidType type = EllipsoidType::Arbitrary,
+                          size_t min_samples = 10);
+
+    /**
+     * Consume the samples pending in a ring and update the fit
+     * @param reader ring to consume the samples from
+     * @return true if the result has been updated
+     */
+    bool update(RingReader& reader);
+
+    /**
+     * Add samples and update the fit
+     * @param samples Nx3 matrix with the cartesian coordinates of the samples
+     * @return true if the result has been updated
+     */
+    bool update(
+        const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>&
+            samples);
+
+    //! Latest fit, valid once ready() is true
+    const FitResult& result() const;
+
+    //! Whether a fit has been computed
+    bool ready() const;
+
+    //! Number of fits computed so far
+    size_t fits() const;
+
+    //! Moments of all the samples received
+    const Moments& moments() const;
+
+    //! Discard all samples and results
+    void reset();
+
+private:
+    bool solve();
+
+    Moments moments_;
+    FitResult result_;
+    EllipsoidType type_;
+    size_t min_samples_;
+    size_t fits_;
+    size_t fitted_count_;
+};
+
+} // namespace ellipsoid
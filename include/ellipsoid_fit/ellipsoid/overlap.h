@@ -0,0 +1,149 @@
+#pragma once
+
+#include <ellipsoid/batch.h>
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace ellipsoid {
+
+/**
+ * Solid ellipsoid given by the outputs of a fit: the points x such that
+ * \f$\sum_i ((x - center) \cdot axes_i / radii_i)^2 \leq 1\f$
+ */
+struct Ellipsoid {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    //! center of the ellipsoid
+    Eigen::Vector3d center;
+    //! semi-axis lengths, must be positive and finite
+    Eigen::Vector3d radii;
+    //! unit axes in columns, column i is the direction of radii(i)
+    Eigen::Matrix3d axes;
+};
+
+//! Ellipsoids stored by value, see EllipsoidSet
+using Ellipsoids = std::vector<Ellipsoid, Eigen::aligned_allocator<Ellipsoid>>;
+
+/**
+ * Ellipsoid described by a fit result
+ * @param result result of fit(), fitBatch() or FitCache::fit()
+ * @return the fitted ellipsoid
+ */
+Ellipsoid makeEllipsoid(const FitResult& result);
+
+/**
+ * Ellipsoid described by fit outputs
+ * @param parameters  center and radii of the ellipsoid
+ * @param evec_column eigenvectors in columns, in the same order as the radii
+ * @return the fitted ellipsoid
+ */
+Ellipsoid makeEllipsoid(const Parameters& parameters,
+                        const Eigen::Matrix3d& evec_column);
+
+/**
+ * Whether two solid ellipsoids have a common point, touching ones included.
+ *
+ * Uses the contact function of Perram and Wertheim,
+ * \f$F(\lambda) = \lambda (1 - \lambda) d^T ((1 - \lambda) A^{-1} + \lambda
+ * B^{-1})^{-1} d\f$ with d the difference of the centers and A, B the
+ * matrices of the ellipsoids: they overlap if and only if the maximum of F
+ * over [0, 1] is at most 1. F is concave, its maximum is found with a
+ * safeguarded Newton method.
+ */
+bool overlap(const Ellipsoid& a, const Ellipsoid& b);
+
+/**
+ * Whether the solid ellipsoid a contains b.
+ *
+ * In the frame where a is the unit ball, b is contained if its farthest
+ * point from the origin is in the ball. That distance is the solution of a
+ * trust region problem, solved exactly through its one dimensional dual.
+ */
+bool contains(const Ellipsoid& a, const Ellipsoid& b);
+
+/**
+ * Smallest distance between the points of two solid ellipsoids, zero if
+ * they overlap. Computed by alternating projections of the closest points
+ * from one ellipsoid onto the other, until the gap between the planes
+ * supporting both ellipsoids at these points is within 1e-10 times the
+ * largest radius.
+ */
+double distance(const Ellipsoid& a, const Ellipsoid& b);
+
+//! Two ellipsoids of an EllipsoidSet, first < second except for
+//! EllipsoidSet::containedPairs()
+struct EllipsoidPair {
+    //! index of the first ellipsoid
+    size_t first;
+    //! index of the second ellipsoid
+    size_t second;
+    //! distance between the ellipsoids, zero if they overlap
+    double distance;
+};
+
+/**
+ * Pairwise queries on a set of ellipsoids, e.g all the ones fitted in a
+ * frame: overlaps, containment and separation distances.
+ *
+ * The ellipsoids are kept in a bounding volume hierarchy of axis aligned
+ * boxes, built once on construction. A pair query walks the hierarchy from
+ * each ellipsoid's box, then rejects the candidates whose bounding spheres
+ * are too far apart before running the exact tests. The overlap tests are
+ * evaluated in groups, one pair per SIMD lane, and the work is spread over
+ * defaultExecutor().
+ *
+ * The results are sorted by first then second index.
+ */
+class EllipsoidSet {
+public:
+    //! @param ellipsoids ellipsoids of the set, indexed in that order
+    explicit EllipsoidSet(Ellipsoids ellipsoids);
+
+    //! @param results fit results, indexed in that order
+    explicit EllipsoidSet(const FitResults& results);
+
+    //! @param results batch fit results, indexed in the same order
+    explicit EllipsoidSet(const BatchResults& results);
+
+    ~EllipsoidSet();
+
+    EllipsoidSet(const EllipsoidSet&) = delete;
+    EllipsoidSet& operator=(const EllipsoidSet&) = delete;
+
+    //! Number of ellipsoids
+    size_t size() const;
+
+    //! The ellipsoid of the given index
+    const Ellipsoid& operator[](size_t index) const;
+
+    //! All the pairs of overlapping ellipsoids
+    std::vector<EllipsoidPair> overlappingPairs() const;
+
+    /**
+     * All the pairs of ellipsoids closer than a distance
+     * @param max_distance largest distance between the ellipsoids of a pair
+     * @return the pairs with their distance, zero for the overlapping ones
+     */
+    std::vector<EllipsoidPair> pairsWithin(double max_distance) const;
+
+    //! All the pairs where the first ellipsoid contains the second one, two
+    //! identical ellipsoids give two pairs
+    std::vector<EllipsoidPair> containedPairs() const;
+
+    /**
+     * Ellipsoids of the set overlapping another one
+     * @param query ellipsoid to test against the set
+     * @return the indices of the overlapping ellipsoids, in increasing order
+     */
+    std::vector<size_t> overlapping(const Ellipsoid& query) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace ellipsoid
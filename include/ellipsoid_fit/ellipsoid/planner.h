@@ -0,0 +1,131 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+#include <cstddef>
+
+namespace ellipsoid {
+
+//! How fit(data, options) processes the points
+enum class FitStrategy {
+    //! let planFit() choose
+    Automatic,
+    //! build the Nxk design matrix, as fit(data) does
+    DesignMatrix,
+    //! accumulate the moments of the points on the calling thread
+    Streaming,
+    //! accumulate the moments of chunks of points in parallel
+    ParallelAccumulation,
+    //! accumulate the moments of a regular subsample of the points
+    Subsampling,
+    //! solve the least squares problem on the design matrix with a parallel
+    //! tall-skinny QR, see fitTsqr(). More accurate than the normal
+    //! equations of the other strategies, never chosen by planFit()
+    Tsqr,
+};
+
+/**
+ * Linear cost model used by planFit(), in seconds. The defaults were measured
+ * on a single x86 core with plan-benchmark. CostModel::measure() gives the
+ * values of the running machine.
+ */
+struct CostModel {
+    //! time to build the design matrix and its normal equations, per point
+    double design_matrix_per_point = 60e-9;
+    //! time to accumulate the moments, per point
+    double moments_per_point = 25e-9;
+    //! time to factorize the design matrix with fitTsqr(), per point
+    double tsqr_per_point = 80e-9;
+    //! time to copy a point when subsampling
+    double gather_per_point = 3e-9;
+    //! time to schedule and merge a parallel task
+    double task = 2e-6;
+    //! time to solve the normal equations and extract the parameters
+    double solve = 30e-6;
+
+    /**
+     * Measure the model on this machine, on synthetic points
+     * @param rows number of points used for the per point costs
+     * @return the measured model
+     */
+    static CostModel measure(size_t rows = 1 << 18);
+};
+
+/**
+ * Default working memory budget of the fits: a quarter of the physical
+ * memory, or no limit if it cannot be determined
+ * @return the budget in bytes, 0 for no limit
+ */
+size_t defaultMemoryBudget();
+
+//! Options of fit(data, options)
+struct FitOptions {
+    //! type of ellipsoid to fit
+    EllipsoidType type = EllipsoidType::Arbitrary;
+    //! strategy to use, planFit() chooses one by default
+    FitStrategy strategy = FitStrategy::Automatic;
+    //! maximum working memory in bytes, the points excluded. 0 for no limit
+    size_t memory_budget = defaultMemoryBudget();
+    //! time allowed for the fit in seconds, 0 for no limit. The points are
+    //! subsampled if the estimated time of the exact strategies exceeds it
+    double time_budget = 0.;
+    //! smallest number of points kept when subsampling
+    size_t min_sample_rows = 1000;
+    //! number of cores available, the concurrency of defaultExecutor() if 0
+    size_t threads = 0;
+    //! cost model used to compare the strategies
+    CostModel cost_model;
+};
+
+//! Execution strategy chosen by planFit()
+struct FitPlan {
+    //! strategy to use, never Automatic
+    FitStrategy strategy;
+    //! number of points per parallel task or per subsampled chunk
+    size_t chunk_rows;
+    //! number of parallel tasks
+    size_t tasks;
+    //! distance between two consecutive points used, 1 unless subsampling
+    size_t stride;
+    //! number of points used
+    size_t rows_used;
+    //! estimated working memory, in bytes
+    size_t memory;
+    //! estimated duration, in seconds
+    double seconds;
+};
+
+//! What fit(data, options) did
+struct Diagnostics {
+    //! the plan followed
+    FitPlan plan;
+    //! number of points given
+    size_t rows;
+    //! measured duration, in seconds
+    double seconds;
+};
+
+/**
+ * Choose how to fit a number of points: the fastest strategy, according to
+ * the cost model, whose working memory fits in the budget. The moments based
+ * strategies use a constant or per task memory, the design matrix grows with
+ * the number of points.
+ * @param rows    number of points
+ * @param options fitting options
+ * @return the execution plan
+ */
+FitPlan planFit(size_t rows, const FitOptions& options);
+
+/**
+ * Fit an ellipsoid on the given data, following planFit()
+ * @param[in]   data Nx3 matrix with the cartesian coordinates of the points
+ * @param[in]   options fitting options
+ * @param[out]  diagnostics if not null, the plan followed and its duration
+ * @return      everything computed by the fit
+ */
+FitResult
+fit(const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    const FitOptions& options, Diagnostics* diagnostics = nullptr);
+
+} // namespace ellipsoid
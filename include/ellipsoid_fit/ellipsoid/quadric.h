@@ -0,0 +1,103 @@
+#pragma once
+
+#include <ellipsoid/moments.h>
+#include <Eigen/Dense>
+
+namespace ellipsoid {
+
+//! Kinds of surfaces a general quadric can describe
+enum class QuadricType {
+    Ellipsoid,
+    HyperboloidOfOneSheet,
+    HyperboloidOfTwoSheets,
+    Cone,
+    EllipticParaboloid,
+    HyperbolicParaboloid,
+    EllipticCylinder,
+    HyperbolicCylinder,
+    ParabolicCylinder,
+    //! planes, lines, points or imaginary surfaces, and fits on too few or
+    //! degenerate points
+    Degenerate,
+};
+
+//! Settings of fitQuadric()
+struct QuadricOptions {
+    //! Relative threshold below which the eigenvalues of the quadratic part
+    //! and the other terms of the equation are considered zero, in a frame
+    //! where the points have a unit RMS distance to their centroid. E.g with
+    //! 1e-3, an ellipsoid axis is considered infinite (a cylinder) if it is
+    //! about 30 times longer than the extent of the points.
+    double tolerance{1e-3};
+};
+
+/**
+ * General quadric fitted on a set of points, with the parameters of its type
+ * in a frame of principal axes. The fields not defined for a type are NaN.
+ */
+struct Quadric {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    //! kind of surface
+    QuadricType type;
+    //! the 10 coefficients of the algebraic form, as for fit(), with a unit
+    //! norm and the largest eigenvalue of the quadratic part positive
+    Eigen::Matrix<double, 10, 1> coefficients;
+    //! center of the ellipsoid and hyperboloids, apex of the cone, vertex of
+    //! the paraboloids, point of the axis of the cylinders closest to the
+    //! centroid of the points
+    Eigen::Vector3d center;
+    //! orthonormal principal axes in columns. The last one is the axis of the
+    //! hyperboloids and cone (the eigenvalue of a different sign), of the
+    //! elliptic and hyperbolic cylinders, and the direction the paraboloids
+    //! and parabolic cylinder open towards. The second one is the direction
+    //! of the lines of a parabolic cylinder.
+    Eigen::Matrix3d axes;
+    //! semi-axis lengths of the ellipsoid and hyperboloids, in the same order
+    //! as the axes, those of the cylinders' sections then infinity, the radii
+    //! of curvature at the vertex of the paraboloids (along the first two
+    //! axes, the smallest first) and parabolic cylinder (along the first
+    //! one) then infinity. A hyperbolic paraboloid opens towards the last
+    //! axis along the first one.
+    Eigen::Vector3d radii;
+    //! half-angles of the cone along the first two axes, in radians
+    Eigen::Vector2d angles;
+    //! approximation of the RMS distance from the points to the surface
+    double rms_distance;
+};
+
+/**
+ * Fit a general quadric on previously accumulated moments and classify it.
+ *
+ * fit() constrains the trace of the quadratic part, which excludes the
+ * quadrics where it vanishes, e.g some cones. This fit uses the method of
+ * Taubin instead: the algebraic error is minimized relative to the norm of
+ * the gradient on the points, which approximates the geometric distance and
+ * is invariant to rigid transformations. The moments of the gradients are
+ * obtained from the moments of the linear monomials, so no other pass on the
+ * data is needed.
+ *
+ * The type is then given by the signs and rank of the eigenvalues of the
+ * quadratic part, the linear terms along its null space and the constant
+ * term at the center, see QuadricOptions::tolerance.
+ *
+ * @param moments moments of the points to fit the quadric on
+ * @param options classification settings
+ * @return the fitted quadric, Degenerate with NaN coefficients if there are
+ * less than 9 points
+ */
+Quadric fitQuadric(const Moments& moments,
+                   const QuadricOptions& options = QuadricOptions());
+
+/**
+ * Fit a general quadric on the given data and classify it, see
+ * fitQuadric(moments, options)
+ * @param data    Nx3 matrix with the cartesian coordinates of the points
+ * @param options classification settings
+ * @return the fitted quadric
+ */
+Quadric fitQuadric(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    const QuadricOptions& options = QuadricOptions());
+
+} // namespace ellipsoid
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+#include <cstddef>
+
+namespace ellipsoid {
+
+/**
+ * Non owning view on point records storing quantized coordinates, as in LAS
+ * files: each record holds three consecutive int32 values X, Y and Z (host
+ * endianness) and the cartesian coordinates are given by
+ * \f$x = s_x X + o_x\f$, \f$y = s_y Y + o_y\f$ and \f$z = s_z Z + o_z\f$
+ */
+struct QuantizedRecords {
+    //! First record
+    const void* data;
+    //! Number of records
+    size_t count;
+    //! Distance between two records, in bytes
+    size_t stride;
+    //! Offset of the X value inside a record, in bytes
+    size_t coordinates_offset;
+    //! Per axis scale factors
+    Eigen::Vector3d scale;
+    //! Per axis offsets
+    Eigen::Vector3d offset;
+};
+
+/**
+ * Accumulate the points of quantized records into the given moments,
+ * without decoding them to an intermediate array.
+ *
+ * If the moments are empty, their origin is moved to a point of the
+ * quantization grid close to the data so that the integer coordinates are
+ * centered exactly before being scaled.
+ *
+ * @param[in,out]   moments moments to accumulate the points into
+ * @param[in]       records the records to accumulate
+ */
+void accumulate(Moments& moments, const QuantizedRecords& records);
+
+/**
+ * Fit an ellipsoid on quantized point records
+ * @param[in]   records the records to fit the ellipsoid on
+ * @return      ellipsoid's parameters
+ */
+Parameters fit(const QuantizedRecords& records,
+               EllipsoidType type = EllipsoidType::Arbitrary);
+
+} // namespace ellipsoid
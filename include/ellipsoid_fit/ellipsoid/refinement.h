@@ -0,0 +1,102 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <ellipsoid/moments.h>
+#include <Eigen/Dense>
+
+#include <cstddef>
+#include <limits>
+
+namespace ellipsoid {
+
+//! Factorization of the normal equations used by fitRefined()
+enum class Factorization {
+    //! Cholesky factorization in single precision
+    Float,
+    //! LDLT factorization in double precision
+    LDLT,
+};
+
+//! Precision of the residuals of the refinement steps
+enum class ResidualPrecision {
+    //! from the normal matrix formed in double precision
+    Double,
+    //! from the moments in double-double arithmetic, about 106 bits
+    DoubleDouble,
+};
+
+//! Settings of fitRefined()
+struct RefinementOptions {
+    //! factorization used for the first solution and its corrections
+    Factorization factorization{Factorization::Float};
+    //! precision of the residuals the corrections are solved for
+    ResidualPrecision residuals{ResidualPrecision::DoubleDouble};
+    //! maximum number of refinement steps
+    size_t max_iterations{10};
+    //! the refinement has converged when the last correction is smaller
+    //! than this fraction of the solution (infinity norms), or once the
+    //! corrections stop decreasing if the backward error is below it
+    double tolerance{4. * std::numeric_limits<double>::epsilon()};
+    //! solve with the SVD of fit(moments) when the refinement doesn't
+    //! converge
+    bool fallback{true};
+};
+
+//! What the refinement did
+struct RefinementReport {
+    //! number of refinement steps performed
+    size_t iterations;
+    //! whether the solution is within the tolerance, see
+    //! RefinementOptions::tolerance
+    bool converged;
+    //! size of the last correction relative to the solution
+    double correction;
+    //! normwise backward error of the returned solution u, relative to the
+    //! moments with double-double residuals,
+    //! \f$\|b - N u\| / (\|N\| \|u\| + \|b\|)\f$ with infinity norms
+    double backward_error;
+    //! whether the solution comes from the SVD instead
+    bool fallback;
+};
+
+/**
+ * Fit an ellipsoid on previously accumulated moments by mixed precision
+ * iterative refinement.
+ *
+ * The normal equations are equilibrated and factorized once, in single
+ * precision or as an LDLT. The solution is then repeatedly corrected by
+ * solving for its residual with that factorization. The factorization's
+ * precision only limits the speed of convergence, not the final accuracy,
+ * as long as it captures the system (a condition number of the
+ * equilibrated system well below 1e7 in single precision). With
+ * double-double residuals, computed from the moments rather than from the
+ * rounded normal matrix, the accuracy can exceed that of the SVD solve of
+ * fit(moments).
+ *
+ * @param[in]   moments moments of the points to fit the ellipsoid on
+ * @param[in]   type type of ellipsoid to fit
+ * @param[in]   options refinement settings
+ * @param[out]  report if not null, the outcome of the refinement
+ * @return      everything computed by the fit
+ */
+FitResult fitRefined(const Moments& moments,
+                     EllipsoidType type = EllipsoidType::Arbitrary,
+                     const RefinementOptions& options = RefinementOptions(),
+                     RefinementReport* report = nullptr);
+
+/**
+ * Fit an ellipsoid on the given data by mixed precision iterative
+ * refinement, see fitRefined(moments, type, options, report)
+ * @param[in]   data Nx3 matrix with the cartesian coordinates of the points
+ * @param[in]   type type of ellipsoid to fit
+ * @param[in]   options refinement settings
+ * @param[out]  report if not null, the outcome of the refinement
+ * @return      everything computed by the fit
+ */
+FitResult fitRefined(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    EllipsoidType type = EllipsoidType::Arbitrary,
+    const RefinementOptions& options = RefinementOptions(),
+    RefinementReport* report = nullptr);
+
+} // namespace ellipsoid
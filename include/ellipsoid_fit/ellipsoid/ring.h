@@ -0,0 +1,161 @@
+#pragma once
+
+#include <ellipsoid/moments.h>
+#include <Eigen/Dense>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace ellipsoid {
+
+namespace detail {
+struct RingHeader;
+}
+
+//! Counters shared by both ends of a sample ring
+struct RingCounters {
+    //! Number of samples written by the producer
+    uint64_t written;
+    //! Number of samples consumed by the reader
+    uint64_t read;
+    //! Number of samples dropped because the ring stayed full
+    uint64_t overruns;
+    //! Number of times the producer had to wait for free space
+    uint64_t stalls;
+};
+
+/**
+ * Producer end of a lock-free single producer/single consumer ring of 3D
+ * samples living in POSIX shared memory, to stream samples from an
+ * acquisition process to a calibration process (see RingReader) without
+ * serialization.
+ *
+ * The coordinates are stored as three arrays (x, y and z) so that the reader
+ * can accumulate them directly from the mapped memory.
+ */
+class RingWriter {
+public:
+    /**
+     * Create the shared memory segment, replacing any existing one with the
+     * same name. The segment is removed when the writer is destroyed.
+     * @param name     name of the shared memory segment, e.g "/imu0"
+     * @param capacity maximum number of samples stored, rounded up to a
+     * power of two
+     * @throw std::system_error if the segment cannot be created
+     */
+    RingWriter(const std::string& name, size_t capacity);
+
+    //! Close the ring and remove the shared memory segment
+    ~RingWriter();
+
+    RingWriter(const RingWriter&) = delete;
+    RingWriter& operator=(const RingWriter&) = delete;
+
+    /**
+     * Write samples, waiting for the reader to free space if needed
+     * (backpressure). The samples still not written after the timeout are
+     * dropped and counted as overruns.
+     * @param samples Nx3 matrix with the cartesian coordinates of the samples
+     * @param timeout maximum time to wait for free space
+     * @return the number of samples written
+     */
+    size_t write(
+        const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>&
+            samples,
+        std::chrono::nanoseconds timeout = std::chrono::nanoseconds::zero());
+
+    /**
+     * Write a single sample, see write(samples, timeout)
+     * @param x       sample's x coordinate
+     * @param y       sample's y coordinate
+     * @param z       sample's z coordinate
+     * @param timeout maximum time to wait for free space
+     * @return true if the sample has been written
+     */
+    bool write(double x, double y, double z,
+               std::chrono::nanoseconds timeout =
+                   std::chrono::nanoseconds::zero());
+
+    //! Signal the reader that no more samples will be written
+    void close();
+
+    //! Number of samples that can be written without waiting
+    size_t available() const;
+
+    //! Maximum number of samples stored
+    size_t capacity() const;
+
+    //! Current counters
+    RingCounters counters() const;
+
+private:
+    std::string name_;
+    detail::RingHeader* header_;
+    double* samples_;
+    size_t size_;
+    uint64_t head_;
+    uint64_t cached_tail_;
+};
+
+/**
+ * Consumer end of a ring created by a RingWriter, possibly in another
+ * process
+ */
+class RingReader {
+public:
+    /**
+     * Attach to an existing ring
+     * @param name name of the shared memory segment given to the RingWriter
+     * @throw std::system_error if the segment cannot be opened
+     * @throw std::runtime_error if the segment is not a valid ring
+     */
+    explicit RingReader(const std::string& name);
+
+    //! Detach from the ring
+    ~RingReader();
+
+    RingReader(const RingReader&) = delete;
+    RingReader& operator=(const RingReader&) = delete;
+
+    /**
+     * Accumulate the pending samples directly from the shared memory and
+     * release their space to the writer
+     * @param moments moments to add the samples to
+     * @param max     maximum number of samples consumed
+     * @return the number of samples consumed
+     */
+    size_t read(Moments& moments,
+                size_t max = std::numeric_limits<size_t>::max());
+
+    /**
+     * Wait for samples to be available, busy waiting first for the lowest
+     * latency
+     * @param timeout maximum time to wait
+     * @return true if samples are available, false on timeout or if the
+     * writer closed the ring and all samples have been consumed
+     */
+    bool wait(std::chrono::nanoseconds timeout);
+
+    //! Number of samples waiting to be consumed
+    size_t available() const;
+
+    //! Whether the writer closed the ring
+    bool closed() const;
+
+    //! Maximum number of samples stored
+    size_t capacity() const;
+
+    //! Current counters
+    RingCounters counters() const;
+
+private:
+    detail::RingHeader* header_;
+    const double* samples_;
+    size_t size_;
+    uint64_t tail_;
+};
+
+} // namespace ellipsoid
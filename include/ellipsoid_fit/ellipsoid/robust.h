@@ -0,0 +1,113 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+#include <cstddef>
+#include <vector>
+
+namespace ellipsoid {
+
+/**
+ * Mergeable sketch of the distribution of positive values.
+ *
+ * Values are counted in logarithmically spaced bins, giving quantiles with a
+ * bounded relative error using a fixed amount of memory. Sketches built on
+ * disjoint subsets of the data can be merged.
+ */
+class QuantileSketch {
+public:
+    /**
+     * Create an empty sketch
+     * @param relative_accuracy relative error on the quantiles
+     * @param min_value         smallest distinguishable value, smaller ones
+     * are counted with it
+     * @param max_value         largest distinguishable value, larger ones are
+     * counted with it
+     */
+    explicit QuantileSketch(double relative_accuracy = 0.01,
+                            double min_value = 1e-12, double max_value = 1e6);
+
+    /**
+     * Count a value
+     * @param value value to count
+     */
+    void add(double value);
+
+    /**
+     * Add the values counted by another sketch, with the same settings
+     * @param other sketch to merge
+     */
+    void merge(const QuantileSketch& other);
+
+    /**
+     * Estimate a quantile of the values counted so far
+     * @param q quantile to estimate, in [0,1]
+     * @return  the estimated quantile, 0 if the sketch is empty
+     */
+    double quantile(double q) const;
+
+    //! Number of values counted so far
+    size_t count() const;
+
+private:
+    size_t bin(double value) const;
+
+    double gamma_;
+    double log_gamma_;
+    double min_value_;
+    std::vector<size_t> bins_;
+    size_t count_;
+};
+
+//! Settings of fitRobust()
+struct RobustOptions {
+    //! Fraction of the points expected to be inliers
+    double quantile{0.9};
+    //! Points with a residual larger than margin times the quantile are
+    //! rejected
+    double margin{2.};
+    //! Number of points used for the provisional fit
+    size_t provisional_samples{4096};
+    //! Number of outlier rejection steps performed on the provisional fit
+    size_t provisional_iterations{5};
+};
+
+/**
+ * Fit an ellipsoid on data corrupted by gross outliers.
+ *
+ * A provisional ellipsoid is first fitted on a subsample of the data,
+ * iteratively rejecting the outliers of the subsample. Then
+ * the distribution of the residuals to this ellipsoid is estimated in a
+ * first pass over all the points, and a second pass accumulates only the
+ * points whose residual is within the bound given by the options. Both
+ * passes run in parallel using a bounded amount of memory.
+ *
+ * @param[in]   data Nx3 matrix with the cartesian coordinates to fit the
+ * ellipsoid on
+ * @param[in]   options outlier rejection settings
+ * @return      ellipsoid's parameters, NaN if data is empty
+ */
+Parameters fitRobust(const Eigen::Matrix<double, Eigen::Dynamic, 3>& data,
+                     EllipsoidType type = EllipsoidType::Arbitrary,
+                     const RobustOptions& options = RobustOptions());
+
+/**
+ * Fit an ellipsoid on data corrupted by gross outliers
+ * @param[in]   data Nx3 matrix with the cartesian coordinates to fit the
+ * ellipsoid on
+ * @param[out]  coefficients_p pointer storing the 10 coefficents of the
+ * fitted ellipsoid in algebraic form
+ * @param[out]  inliers_p pointer storing the number of points kept for the
+ * fit
+ * @param[in]   options outlier rejection settings
+ * @return      ellipsoid's parameters, NaN if data is empty (as are the
+ * coefficients, no point being kept)
+ */
+Parameters fitRobust(const Eigen::Matrix<double, Eigen::Dynamic, 3>& data,
+                     Eigen::Matrix<double, 10, 1>* coefficients_p,
+                     size_t* inliers_p,
+                     EllipsoidType type = EllipsoidType::Arbitrary,
+                     const RobustOptions& options = RobustOptions());
+
+} // namespace ellipsoid
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ellipsoid {
+
+//! Settings of a Server
+struct ServerOptions {
+    //! Path of the Unix domain socket to listen on
+    std::string socket_path;
+    //! Number of threads solving the requests, the number of hardware
+    //! threads if zero
+    size_t workers{0};
+    //! Maximum number of requests solved together by a worker
+    size_t max_batch_size{64};
+    //! Time a worker waits for more requests before solving a partial batch.
+    //! With zero, the requests already queued are solved right away
+    std::chrono::microseconds batch_window{0};
+    //! Maximum number of points accepted in a single request
+    uint64_t max_points{uint64_t(1) << 26};
+    //! Maximum number of requests waiting to be solved
+    size_t max_pending{4096};
+};
+
+//! Counters describing the activity of a Server
+struct ServerMetrics {
+    //! Number of requests solved
+    uint64_t requests;
+    //! Number of requests rejected (invalid or server overloaded)
+    uint64_t rejected;
+    //! Number of batches solved
+    uint64_t batches;
+    //! Number of points received
+    uint64_t points;
+    //! Mean time between the reception of a request and its reply
+    std::chrono::nanoseconds mean_latency;
+    //! Largest time between the reception of a request and its reply
+    std::chrono::nanoseconds max_latency;
+    //! Mean number of solved requests per second since the server started
+    double throughput;
+};
+
+/**
+ * Long running fitting server, accepting requests from Client instances over
+ * a Unix domain socket.
+ *
+ * Requests received concurrently are grouped in batches, up to
+ * ServerOptions::max_batch_size requests, taken by a pool of workers. The
+ * requests of a batch are solved together by fitBatch(), one call per
+ * ellipsoid type. This amortizes the synchronization costs and vectorizes
+ * the solves when many small requests are sent.
+ */
+class Server {
+public:
+    /**
+     * Create a server, call start() to begin serving
+     * @param options server settings
+     */
+    explicit Server(const ServerOptions& options);
+
+    //! Stop the server if it is running
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    /**
+     * Bind the socket and start serving requests in background threads
+     * @throw std::system_error if the socket cannot be created
+     */
+    void start();
+
+    //! Close the socket and all connections and wait for the threads
+    void stop();
+
+    //! Current activity counters
+    ServerMetrics metrics() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace ellipsoid
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+#include <cstddef>
+
+namespace ellipsoid {
+
+/**
+ * Superellipsoid, the points x such that \f$F(y) = 1\f$ with y = axes^T (x -
+ * center) and \f{equation}{
+ * F(y) = \left(\left|\frac{y_0}{a_0}\right|^{2/\epsilon_2} +
+ * \left|\frac{y_1}{a_1}\right|^{2/\epsilon_2}\right)^{\epsilon_2/\epsilon_1}
+ * + \left|\frac{y_2}{a_2}\right|^{2/\epsilon_1}
+ * \f}
+ * a being the radii and \f$\epsilon\f$ the exponents. Exponents of 1 give an
+ * ellipsoid, close to 0 a box, \f$\epsilon_1\f$ close to 0 and
+ * \f$\epsilon_2 = 1\f$ a cylinder along the last axis.
+ */
+struct Superquadric {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    //! center of the superquadric
+    Eigen::Vector3d center;
+    //! semi-axis lengths, in the same order as the axes
+    Eigen::Vector3d radii;
+    //! orthonormal axes in columns, a rotation
+    Eigen::Matrix3d axes;
+    //! shape exponents: along the last axis (\f$\epsilon_1\f$) then in the
+    //! plane of the first two (\f$\epsilon_2\f$)
+    Eigen::Vector2d exponents;
+    //! RMS radial distance from the points to the surface
+    double rms_distance;
+    //! number of Levenberg-Marquardt iterations performed, including the
+    //! ones choosing the frame
+    size_t iterations;
+};
+
+//! Settings of fitSuperquadric()
+struct SuperquadricOptions {
+    //! Maximum number of Levenberg-Marquardt iterations, per initial frame
+    size_t max_iterations{100};
+    //! The iterations stop when the cost decreases by less than this
+    //! fraction
+    double tolerance{1e-10};
+    //! Number of points used by each iteration, all of them if zero. A
+    //! different subsample is drawn at each iteration, the final distance is
+    //! computed on all the points. The iterations stop once the decrease of
+    //! the cost is within what fitting the parameters on a subsample
+    //! explains.
+    size_t samples{0};
+    //! Bounds of the exponents, the residuals and their derivatives are
+    //! badly conditioned out of ]0, 2[
+    double min_exponent{0.1};
+    double max_exponent{1.9};
+    //! Refine the superquadric from the three cyclic permutations of the
+    //! seed's axes and keep the best, since the last axis plays a special
+    //! role (e.g the axis of a cylinder) that the iterations can't swap
+    bool all_axes{true};
+    //! Number of points the three permutations are refined on before the
+    //! best one is refined on all the points, all of them if zero
+    size_t frame_samples{4096};
+};
+
+/**
+ * Fit a superellipsoid on the given data.
+ *
+ * The ellipsoid given by fit() is used as the initial guess, with its axes
+ * ordered by eigenOrder::leastRotationAngle(). The 11 parameters (radii,
+ * exponents, rotation and center) are then refined by Levenberg-Marquardt
+ * on the radial distances \f$|y| (1 - F(y)^{-\epsilon_1/2})\f$, an
+ * approximation of the Euclidean distance to the surface.
+ *
+ * The residuals and their analytic Jacobian are evaluated several points at
+ * a time in SIMD registers and the normal equations are accumulated in
+ * parallel on defaultExecutor().
+ *
+ * @param data    Nx3 matrix with the cartesian coordinates of the points
+ * @param options iteration settings
+ * @return the fitted superquadric, with NaN parameters if there are less
+ * than 11 points
+ */
+Superquadric fitSuperquadric(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    const SuperquadricOptions& options = SuperquadricOptions());
+
+/**
+ * Refine a superellipsoid from an initial guess, e.g the result of a
+ * previous frame, see fitSuperquadric(data, options). The axes of the guess
+ * are not permuted.
+ * @param data    Nx3 matrix with the cartesian coordinates of the points
+ * @param initial initial guess, its distance and iterations are ignored
+ * @param options iteration settings
+ * @return the fitted superquadric
+ */
+Superquadric fitSuperquadric(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    const Superquadric& initial,
+    const SuperquadricOptions& options = SuperquadricOptions());
+
+} // namespace ellipsoid
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ellipsoid {
+
+/**
+ * Per-stage instrumentation of the fitting code (design matrix, normal
+ * equations, SVD solve, center solve, eigensolver, least rotation, moments
+ * accumulation, batched and online solvers).
+ *
+ * The instrumentation points are only compiled in when the library is built
+ * with the ENABLE_TRACING option, otherwise they generate no code at all and
+ * the functions below do nothing. When compiled in, nothing is recorded
+ * until start() is called: each stage then records its CPU timestamp
+ * counter interval and the number of points and bytes it touched in a
+ * buffer owned by the calling thread, without any lock.
+ */
+namespace trace {
+
+//! Aggregated records of a stage
+struct StageStatistics {
+    //! name of the stage, e.g "fit.svd_solve"
+    std::string name;
+    //! number of times the stage ran
+    uint64_t calls;
+    //! total time spent in the stage, in seconds
+    double seconds;
+    //! total number of points processed by the stage
+    uint64_t points;
+    //! total number of bytes read and written by the stage
+    uint64_t bytes;
+};
+
+//! True if the library was built with the instrumentation points
+bool available();
+
+//! Start recording, the previous records are kept
+void start();
+
+//! Stop recording
+void stop();
+
+//! True between start() and stop()
+bool recording();
+
+/**
+ * Remove all the records. Must not be called while instrumented code runs
+ * in other threads.
+ */
+void clear();
+
+//! Number of records dropped because a thread's buffer was full
+uint64_t dropped();
+
+//! Records aggregated per stage, sorted by name
+std::vector<StageStatistics> statistics();
+
+/**
+ * Write the records in the Chrome trace event JSON format, to be viewed in
+ * Perfetto (ui.perfetto.dev) or chrome://tracing. Each record is a complete
+ * event with the points and bytes as arguments, and the cumulated points and
+ * bytes are given as counter tracks.
+ * @param path path of the file to create
+ * @throw std::system_error if the file cannot be written
+ */
+void writeChromeTrace(const std::string& path);
+
+} // namespace trace
+
+} // namespace ellipsoid
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+#include <cstddef>
+
+namespace ellipsoid {
+
+/**
+ * Fit an ellipsoid by a tall-skinny QR (TSQR) of the design matrix.
+ *
+ * fit() solves the normal equations \f$D^T D u = D^T d\f$, whose condition
+ * number is the square of the design matrix's. Here the least squares
+ * problem is solved on \f$[D\ d]\f$ directly: the chunks of points are
+ * factorized in parallel on defaultExecutor(), each one block of rows at a
+ * time so that the design matrix is never formed in full, and their R
+ * factors are combined pairwise in a reduction tree. The solution then
+ * comes from the SVD of the final R factor, as accurate as the data allows
+ * for badly conditioned problems (e.g. points on a small part of the
+ * ellipsoid, or far from the origin).
+ *
+ * The tree has a fixed shape, the result doesn't depend on the scheduling.
+ *
+ * @param[in]   data Nx3 matrix with the cartesian coordinates of the points
+ * @param[in]   type type of ellipsoid to fit
+ * @param[in]   chunk_rows number of points per parallel task
+ * @return      everything computed by the fit
+ */
+FitResult fitTsqr(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    EllipsoidType type = EllipsoidType::Arbitrary,
+    size_t chunk_rows = size_t(1) << 16);
+
+} // namespace ellipsoid
@@ -0,0 +1,74 @@
+#include <ellipsoid/async.h>
+
+#include <algorithm>
+
+namespace ellipsoid {
+
+namespace {
+
+using Points = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+
+FitResult run(const Points& data, const AsyncOptions& options) {
+    const auto rows = data.rows();
+    const auto chunk_size = static_cast<Eigen::Index>(
+        std::max<size_t>(options.chunk_size, 1));
+
+    Moments moments;
+    for (Eigen::Index start = 0; start < rows; start += chunk_size) {
+        if (options.cancellation.cancelled()) {
+            throw FitCancelled();
+        }
+        moments.add(data.middleRows(start, std::min(chunk_size, rows - start)));
+        if (options.progress) {
+            options.progress(static_cast<double>(moments.count()) /
+                             static_cast<double>(rows));
+        }
+    }
+    if (options.cancellation.cancelled()) {
+        throw FitCancelled();
+    }
+
+    FitResult result;
+    result.parameters = fit(moments, &result.coefficients, &result.eval,
+                            &result.evec_column, options.type);
+    return result;
+}
+
+} // namespace
+
+CancellationToken::CancellationToken()
+    : flag_(std::make_shared<std::atomic<bool>>(false)) {
+}
+
+void CancellationToken::cancel() {
+    flag_->store(true, std::memory_order_relaxed);
+}
+
+bool CancellationToken::cancelled() const {
+    return flag_->load(std::memory_order_relaxed);
+}
+
+FitCancelled::FitCancelled() : std::runtime_error("ellipsoid fit cancelled") {
+}
+
+std::future<FitResult> fitAsync(Points data, const AsyncOptions& options) {
+    // std::function needs copyable tasks, the state is shared instead
+    auto promise = std::make_shared<std::promise<FitResult>>();
+    auto points = std::make_shared<Points>(std::move(data));
+    auto future = promise->get_future();
+
+    auto task = [promise, points, options] {
+        try {
+            promise->set_value(run(*points, options));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    };
+
+    const auto executor =
+        options.executor ? options.executor : defaultExecutor();
+    executor->submit(task);
+    return future;
+}
+
+} // namespace ellipsoid
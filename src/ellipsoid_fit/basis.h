@@ -0,0 +1,53 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+#include <Eigen/Dense>
+
+namespace ellipsoid {
+namespace detail {
+
+/**
+ * Matrix B mapping the unknowns u of the given type to the monomials used by
+ * Moments, i.e D = m^T B. The RHS of the llsq problem is m^T s with
+ * s = [1, 1, 1, 0, ..., 0] and the algebraic coefficients are B u - s.
+ */
+Eigen::Matrix<double, 10, Eigen::Dynamic> monomialBasis(EllipsoidType type);
+
+/**
+ * fit() on the design matrix of the points, which are viewed without being
+ * copied
+ */
+Parameters
+fitPoints(const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+          Eigen::Matrix<double, 10, 1>* coefficients_p, Eigen::Vector3d* eval_p,
+          Eigen::Matrix3d* evec_column_p, EllipsoidType type);
+
+//! Algebraic coefficients fitted on the points
+Eigen::Matrix<double, 10, 1> pointsCoefficients(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    EllipsoidType type);
+
+//! Algebraic coefficients fitted on the moments, relative to their origin
+Eigen::Matrix<double, 10, 1> momentsCoefficients(const Moments& moments,
+                                                 EllipsoidType type);
+
+//! Center of the quadric given by its algebraic coefficients
+Eigen::Vector3d centerFromCoefficients(const Eigen::Matrix<double, 10, 1>& v);
+
+//! Eigenvalues and eigenvectors of the quadric translated to its center, in
+//! the order of leastRotationAngle()
+void axesFromCoefficients(const Eigen::Matrix<double, 10, 1>& v,
+                          const Eigen::Vector3d& center, Eigen::Vector3d& eval,
+                          Eigen::Matrix3d& evec_column);
+
+//! Express an algebraic form given relative to origin in the ref. frame
+Eigen::Matrix<double, 10, 1>
+translateCoefficients(const Eigen::Matrix<double, 10, 1>& v,
+                      const Eigen::Vector3d& origin);
+
+//! Rows of the design matrix factorized at once by fitTsqr(), small enough
+//! for the block and its Householder vectors to stay in the L1/L2 caches
+constexpr Eigen::Index tsqr_block_rows = 256;
+
+} // namespace detail
+} // namespace ellipsoid
@@ -0,0 +1,425 @@
+#include <ellipsoid/batch.h>
+#include <ellipsoid/executor.h>
+
+#include "basis.h"
+#include "tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace ellipsoid {
+
+namespace {
+
+// One problem per lane, as many lanes as the widest SIMD registers Eigen
+// targets can hold, with at least 4 for instruction level parallelism
+constexpr int lanes = EIGEN_MAX_STATIC_ALIGN_BYTES >= 64 ? 8 : 4;
+
+using Lane = Eigen::Array<double, lanes, 1>;
+using LaneMask = Eigen::Array<bool, lanes, 1>;
+
+// Number of groups of problems given to an executor task
+constexpr size_t groups_per_task = 16;
+
+// Smallest pivot of the equilibrated normal equations, below it the problem
+// is solved by the SVD of fit(moments)
+constexpr double min_pivot = 1e-12;
+
+constexpr int jacobi_sweeps = 8;
+
+// Eigen decomposition of symmetric 3x3 matrices using cyclic Jacobi
+// rotations, a is overwritten by its diagonal form
+void jacobiEigen(Lane a[3][3], Lane v[3][3]) {
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            v[i][j].setConstant(i == j ? 1. : 0.);
+        }
+    }
+
+    constexpr int pairs[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+    for (int sweep = 0; sweep < jacobi_sweeps; ++sweep) {
+        const Lane off = a[0][1].square() + a[0][2].square() + a[1][2].square();
+        const Lane diag = a[0][0].square() + a[1][1].square() + a[2][2].square();
+        if ((off <= std::numeric_limits<double>::epsilon() *
+                        std::numeric_limits<double>::epsilon() * diag)
+                .all()) {
+            break;
+        }
+
+        for (const auto& pair : pairs) {
+            const int p = pair[0];
+            const int q = pair[1];
+            const int r = 3 - p - q;
+            const Lane apq = a[p][q];
+            const LaneMask rotate = apq != 0.;
+
+            // t = tan of the rotation angle, the smallest root
+            const Lane theta =
+                rotate.select((a[q][q] - a[p][p]) / (2. * apq), Lane::Zero());
+            const Lane sign = (theta >= 0.).select(Lane::Ones(), -Lane::Ones());
+            const Lane t = rotate.select(
+                sign / (theta.abs() + (theta.square() + 1.).sqrt()),
+                Lane::Zero());
+            const Lane c = (t.square() + 1.).rsqrt();
+            const Lane s = t * c;
+
+            a[p][p] -= t * apq;
+            a[q][q] += t * apq;
+            a[p][q] = a[q][p] = Lane::Zero();
+            const Lane arp = a[r][p];
+            const Lane arq = a[r][q];
+            a[r][p] = a[p][r] = c * arp - s * arq;
+            a[r][q] = a[q][r] = s * arp + c * arq;
+
+            for (int k = 0; k < 3; ++k) {
+                const Lane vkp = v[k][p];
+                const Lane vkq = v[k][q];
+                v[k][p] = c * vkp - s * vkq;
+                v[k][q] = s * vkp + c * vkq;
+            }
+        }
+    }
+}
+
+/*
+ * Same choice as eigenOrder::leastRotationAngle(): among the 24
+ * permutations and sign changes of the eigenvectors forming a rotation,
+ * the one with the smallest angle, i.e the largest trace. order[j] receives
+ * the index of the eigenvalue matching the column j of evec.
+ */
+void leastRotation(const Lane v[3][3], Lane order[3], Lane evec[3][3]) {
+    constexpr int orders[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2},
+                                  {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+    constexpr double parities[6] = {1., -1., -1., 1., 1., -1.};
+    constexpr double signs[4][2] = {{1., 1.}, {1., -1.}, {-1., 1.}, {-1., -1.}};
+
+    const Lane det = v[0][0] * (v[1][1] * v[2][2] - v[1][2] * v[2][1]) -
+                     v[0][1] * (v[1][0] * v[2][2] - v[1][2] * v[2][0]) +
+                     v[0][2] * (v[1][0] * v[2][1] - v[1][1] * v[2][0]);
+
+    Lane best_trace = Lane::Constant(-std::numeric_limits<double>::infinity());
+    Lane best_config = Lane::Zero();
+    Lane best_s2 = Lane::Ones();
+    for (int o = 0; o < 6; ++o) {
+        for (int sg = 0; sg < 4; ++sg) {
+            const double s0 = signs[sg][0];
+            const double s1 = signs[sg][1];
+            // the last column is flipped to keep a positive determinant
+            const Lane s2 = (parities[o] * s0 * s1 * det >= 0.)
+                                .select(Lane::Ones(), -Lane::Ones());
+            const Lane trace = s0 * v[0][orders[o][0]] +
+                               s1 * v[1][orders[o][1]] +
+                               s2 * v[2][orders[o][2]];
+            const LaneMask better = trace > best_trace;
+            best_trace = better.select(trace, best_trace);
+            best_config =
+                better.select(Lane::Constant(4 * o + sg), best_config);
+            best_s2 = better.select(s2, best_s2);
+        }
+    }
+
+    for (int l = 0; l < lanes; ++l) {
+        const int config = static_cast<int>(best_config(l));
+        const int* config_order = orders[config / 4];
+        const double column_signs[3] = {signs[config % 4][0],
+                                        signs[config % 4][1], best_s2(l)};
+        for (int j = 0; j < 3; ++j) {
+            order[j](l) = config_order[j];
+            for (int i = 0; i < 3; ++i) {
+                evec[i][j](l) = column_signs[j] * v[i][config_order[j]](l);
+            }
+        }
+    }
+}
+
+// Solve up to `lanes` problems, stored from the row first of results. The
+// fallback flag is set for the ones left to the scalar path
+void solveGroup(const Moments* const* problems, int count,
+                const Eigen::Matrix<double, 10, Eigen::Dynamic>& B,
+                BatchResults& results, Eigen::Index first) {
+    const int n = static_cast<int>(B.cols());
+    Lane N[9][9];
+    Lane rhs[9];
+
+    // normal equations B^T M B u = B^T M s of each problem, padding lanes
+    // get an identity system
+    for (int l = 0; l < lanes; ++l) {
+        if (l < count) {
+            const Moments::Matrix M = problems[l]->matrix();
+            const Eigen::Matrix<double, Eigen::Dynamic, 10, 0, 9, 10> BtM =
+                B.transpose() * M;
+            const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 9, 9>
+                BtMB = BtM * B;
+            const Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 9, 1> r =
+                BtM.leftCols<3>().rowwise().sum();
+            for (int i = 0; i < n; ++i) {
+                rhs[i](l) = r(i);
+                for (int j = 0; j <= i; ++j) {
+                    N[i][j](l) = BtMB(i, j);
+                }
+            }
+        } else {
+            for (int i = 0; i < n; ++i) {
+                rhs[i](l) = 0.;
+                for (int j = 0; j <= i; ++j) {
+                    N[i][j](l) = i == j ? 1. : 0.;
+                }
+            }
+        }
+    }
+
+    // equilibration then Cholesky factorization in place (lower part)
+    LaneMask ok = LaneMask::Constant(true);
+    Lane smallest_pivot =
+        Lane::Constant(std::numeric_limits<double>::infinity());
+    Lane scale[9];
+    for (int i = 0; i < n; ++i) {
+        ok = ok && (N[i][i] > 0.);
+        scale[i] = (N[i][i] > 0.).select(N[i][i].rsqrt(), Lane::Ones());
+    }
+    for (int i = 0; i < n; ++i) {
+        rhs[i] *= scale[i];
+        for (int j = 0; j <= i; ++j) {
+            N[i][j] *= scale[i] * scale[j];
+        }
+    }
+    for (int j = 0; j < n; ++j) {
+        Lane pivot = N[j][j];
+        for (int k = 0; k < j; ++k) {
+            pivot -= N[j][k].square();
+        }
+        ok = ok && (pivot > min_pivot);
+        smallest_pivot = smallest_pivot.min(pivot);
+        N[j][j] = pivot.max(min_pivot).sqrt();
+        const Lane inverse = N[j][j].inverse();
+        for (int i = j + 1; i < n; ++i) {
+            Lane sum = N[i][j];
+            for (int k = 0; k < j; ++k) {
+                sum -= N[i][k] * N[j][k];
+            }
+            N[i][j] = sum * inverse;
+        }
+    }
+    Lane u[9];
+    for (int i = 0; i < n; ++i) {
+        Lane sum = rhs[i];
+        for (int k = 0; k < i; ++k) {
+            sum -= N[i][k] * u[k];
+        }
+        u[i] = sum / N[i][i];
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        Lane sum = u[i];
+        for (int k = i + 1; k < n; ++k) {
+            sum -= N[k][i] * u[k];
+        }
+        u[i] = sum / N[i][i];
+    }
+
+    // algebraic coefficients v = B u - s, relative to each origin
+    Lane v[10];
+    for (int k = 0; k < 10; ++k) {
+        v[k] = Lane::Constant(k < 3 ? -1. : 0.);
+        for (int j = 0; j < n; ++j) {
+            if (B(k, j) != 0.) {
+                v[k] += B(k, j) * scale[j] * u[j];
+            }
+        }
+    }
+
+    // center c = -A^-1 g using the adjugate of the quadratic part A
+    const Lane& a00 = v[0];
+    const Lane& a11 = v[1];
+    const Lane& a22 = v[2];
+    const Lane& a01 = v[3];
+    const Lane& a02 = v[4];
+    const Lane& a12 = v[5];
+    const Lane c00 = a11 * a22 - a12 * a12;
+    const Lane c01 = a02 * a12 - a01 * a22;
+    const Lane c02 = a01 * a12 - a02 * a11;
+    const Lane c11 = a00 * a22 - a02 * a02;
+    const Lane c12 = a01 * a02 - a00 * a12;
+    const Lane c22 = a00 * a11 - a01 * a01;
+    const Lane det = a00 * c00 + a01 * c01 + a02 * c02;
+    const Lane norm =
+        a00.abs().max(a11.abs()).max(a22.abs()).max(a01.abs()).max(
+            a02.abs()).max(a12.abs());
+    ok = ok && (det.abs() > 1e-12 * norm.cube());
+    const Lane inv_det = -det.inverse();
+    Lane center[3];
+    center[0] = inv_det * (c00 * v[6] + c01 * v[7] + c02 * v[8]);
+    center[1] = inv_det * (c01 * v[6] + c11 * v[7] + c12 * v[8]);
+    center[2] = inv_det * (c02 * v[6] + c12 * v[7] + c22 * v[8]);
+
+    // constant term once translated to the center, A c = -g
+    const Lane r33 =
+        center[0] * v[6] + center[1] * v[7] + center[2] * v[8] + v[9];
+    const Lane factor = -r33.inverse();
+    Lane a[3][3] = {{a00 * factor, a01 * factor, a02 * factor},
+                    {a01 * factor, a11 * factor, a12 * factor},
+                    {a02 * factor, a12 * factor, a22 * factor}};
+    Lane vectors[3][3];
+    jacobiEigen(a, vectors);
+
+    Lane order[3];
+    Lane evec[3][3];
+    leastRotation(vectors, order, evec);
+
+    for (int l = 0; l < count; ++l) {
+        const auto row = first + l;
+        results.point_counts(row) = problems[l]->count();
+        results.fallback(row) = not ok(l);
+        if (not ok(l)) {
+            continue;
+        }
+        results.min_pivots(row) = smallest_pivot(l);
+
+        for (int j = 0; j < 3; ++j) {
+            const auto k = static_cast<int>(order[j](l));
+            results.eigenvalues(row, j) = a[k][k](l);
+            results.radii(row, j) = std::sqrt(1. / a[k][k](l));
+            for (int i = 0; i < 3; ++i) {
+                results.rotations(row, 3 * j + i) = evec[i][j](l);
+            }
+        }
+
+        const auto& origin = problems[l]->origin();
+        for (int i = 0; i < 3; ++i) {
+            results.centers(row, i) = center[i](l) + origin(i);
+        }
+
+        // coefficients expressed in the ref. frame
+        Eigen::Matrix3d A;
+        A << a00(l), a01(l), a02(l), a01(l), a11(l), a12(l), a02(l), a12(l),
+            a22(l);
+        const Eigen::Vector3d g(v[6](l), v[7](l), v[8](l));
+        const Eigen::Vector3d g_global = g - A * origin;
+        results.coefficients.row(row) << a00(l), a11(l), a22(l), a01(l),
+            a02(l), a12(l), g_global.transpose(),
+            v[9](l) - 2. * g.dot(origin) + origin.dot(A * origin);
+    }
+}
+
+} // namespace
+
+void BatchResults::resize(size_t size) {
+    const auto rows = static_cast<Eigen::Index>(size);
+    centers.resize(rows, 3);
+    radii.resize(rows, 3);
+    eigenvalues.resize(rows, 3);
+    rotations.resize(rows, 9);
+    coefficients.resize(rows, 10);
+    point_counts.resize(rows);
+    fallback.resize(rows);
+    min_pivots.resize(rows);
+}
+
+size_t BatchResults::size() const {
+    return static_cast<size_t>(centers.rows());
+}
+
+FitResult BatchResults::result(size_t index) const {
+    const auto row = static_cast<Eigen::Index>(index);
+    FitResult result;
+    result.parameters.center = centers.row(row).transpose();
+    result.parameters.radii = radii.row(row).transpose();
+    result.coefficients = coefficients.row(row).transpose();
+    result.eval = eigenvalues.row(row).transpose();
+    result.evec_column =
+        Eigen::Map<const Eigen::Matrix3d>(rotations.row(row).eval().data());
+    return result;
+}
+
+void BatchResults::set(size_t index, const FitResult& result) {
+    const auto row = static_cast<Eigen::Index>(index);
+    centers.row(row) = result.parameters.center.transpose();
+    radii.row(row) = result.parameters.radii.transpose();
+    coefficients.row(row) = result.coefficients.transpose();
+    eigenvalues.row(row) = result.eval.transpose();
+    rotations.row(row) =
+        Eigen::Map<const Eigen::Matrix<double, 1, 9>>(result.evec_column.data());
+}
+
+void fitBatch(
+    const std::vector<Moments, Eigen::aligned_allocator<Moments>>& problems,
+    BatchResults& results, EllipsoidType type) {
+    results.resize(problems.size());
+    const auto B = detail::monomialBasis(type);
+    const size_t groups = (problems.size() + lanes - 1) / lanes;
+    const size_t tasks = (groups + groups_per_task - 1) / groups_per_task;
+
+    defaultExecutor()->parallelFor(tasks, [&](size_t task) {
+        const auto last_group = std::min(groups, (task + 1) * groups_per_task);
+        for (auto group = task * groups_per_task; group < last_group; ++group) {
+            const auto first = group * lanes;
+            const auto count = static_cast<int>(
+                std::min<size_t>(lanes, problems.size() - first));
+            const Moments* group_problems[lanes];
+            for (int l = 0; l < count; ++l) {
+                group_problems[l] = &problems[first + l];
+            }
+            ELLIPSOID_TRACE_COUNT(
+                "batch.solve_group",
+                std::accumulate(group_problems, group_problems + count,
+                                uint64_t{0},
+                                [](uint64_t points, const Moments* problem) {
+                                    return points + problem->count();
+                                }),
+                static_cast<uint64_t>(count) * sizeof(Moments::Matrix));
+            solveGroup(group_problems, count, B, results,
+                       static_cast<Eigen::Index>(first));
+
+            for (int l = 0; l < count; ++l) {
+                const auto index = first + l;
+                if (results.fallback(static_cast<Eigen::Index>(index))) {
+                    FitResult result;
+                    result.parameters =
+                        fit(problems[index], &result.coefficients,
+                            &result.eval, &result.evec_column, type);
+                    results.set(index, result);
+                    results.min_pivots(static_cast<Eigen::Index>(index)) =
+                        std::numeric_limits<double>::quiet_NaN();
+                }
+            }
+        }
+    });
+}
+
+FitResults
+fitBatch(const std::vector<Moments, Eigen::aligned_allocator<Moments>>& problems,
+         EllipsoidType type) {
+    BatchResults columns;
+    fitBatch(problems, columns, type);
+    FitResults results(problems.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        results[i] = columns.result(i);
+    }
+    return results;
+}
+
+void fitBatch(
+    const std::vector<Eigen::Matrix<double, Eigen::Dynamic, 3>>& point_sets,
+    BatchResults& results, EllipsoidType type) {
+    std::vector<Moments, Eigen::aligned_allocator<Moments>> problems(
+        point_sets.size());
+    defaultExecutor()->parallelFor(point_sets.size(), [&](size_t i) {
+        problems[i].add(point_sets[i]);
+    });
+    fitBatch(problems, results, type);
+}
+
+FitResults
+fitBatch(const std::vector<Eigen::Matrix<double, Eigen::Dynamic, 3>>& point_sets,
+         EllipsoidType type) {
+    BatchResults columns;
+    fitBatch(point_sets, columns, type);
+    FitResults results(point_sets.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        results[i] = columns.result(i);
+    }
+    return results;
+}
+
+} // namespace ellipsoid
@@ -0,0 +1,392 @@
+#include <ellipsoid/cache.h>
+
+#include "basis.h"
+#include "tracing.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+
+namespace ellipsoid {
+
+namespace {
+
+constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+
+constexpr char file_magic[8] = {'E', 'F', 'C', 'A', 'C', 'H', 'E', '2'};
+// Files saved before the check hash was added to the keys, ignored on load
+constexpr char file_magic_v1[8] = {'E', 'F', 'C', 'A', 'C', 'H', 'E', '1'};
+
+uint64_t rotate(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Mix an input into an accumulator, as the xxHash64 rounds do
+uint64_t mix(uint64_t accumulator, uint64_t input) {
+    accumulator += input * prime2;
+    accumulator = rotate(accumulator, 31);
+    return accumulator * prime1;
+}
+
+// Mix of the check hash, with other multipliers and rotation than mix() so
+// that both hashes of the points are independent
+uint64_t mixCheck(uint64_t accumulator, uint64_t input) {
+    accumulator ^= input * prime3;
+    accumulator = rotate(accumulator, 27);
+    return accumulator * prime2 + prime1;
+}
+
+uint64_t bits(double value) {
+    uint64_t result;
+    std::memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+uint64_t finalize(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    return hash ^ (hash >> 32);
+}
+
+// Hash of the options changing the result of fit(data, options)
+uint64_t hashOptions(const FitOptions& options) {
+    uint64_t hash = mix(prime3, 1);
+    hash = mix(hash, static_cast<uint64_t>(options.type));
+    hash = mix(hash, static_cast<uint64_t>(options.strategy));
+    hash = mix(hash, options.memory_budget);
+    hash = mix(hash, bits(options.time_budget));
+    hash = mix(hash, options.min_sample_rows);
+    hash = mix(hash, options.threads);
+    const auto& model = options.cost_model;
+    for (double cost : {model.design_matrix_per_point, model.moments_per_point,
+                        model.tsqr_per_point, model.gather_per_point,
+                        model.task, model.solve}) {
+        hash = mix(hash, bits(cost));
+    }
+    return finalize(hash);
+}
+
+// Hash of the type given to fit(data, type)
+uint64_t hashType(EllipsoidType type) {
+    return finalize(mix(mix(prime3, 0), static_cast<uint64_t>(type)));
+}
+
+using Lanes = std::array<uint64_t, 4>;
+
+// Hash the coordinates into four lanes, and into the lanes of the check hash
+// in the same pass if WithCheck
+template <bool WithCheck>
+void hashLanes(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    Lanes& lanes, Lanes& check) {
+    const auto rows = static_cast<size_t>(data.rows());
+    for (Eigen::Index col = 0; col < 3; ++col) {
+        // the columns are contiguous, the outer stride may not be 3 * rows
+        const double* values = data.col(col).data();
+        size_t i = 0;
+        for (; i + 4 <= rows; i += 4) {
+            for (size_t lane = 0; lane < 4; ++lane) {
+                lanes[lane] = mix(lanes[lane], bits(values[i + lane]));
+                if (WithCheck) {
+                    check[lane] = mixCheck(check[lane], bits(values[i + lane]));
+                }
+            }
+        }
+        for (; i < rows; ++i) {
+            lanes[i % 4] = mix(lanes[i % 4], bits(values[i]));
+            if (WithCheck) {
+                check[i % 4] = mixCheck(check[i % 4], bits(values[i]));
+            }
+        }
+    }
+}
+
+uint64_t mergeLanes(const Lanes& lanes, size_t rows) {
+    uint64_t hash = rotate(lanes[0], 1) + rotate(lanes[1], 7) +
+                    rotate(lanes[2], 12) + rotate(lanes[3], 18);
+    for (auto lane : lanes) {
+        hash = (hash ^ mix(0, lane)) * prime1 + prime3;
+    }
+    return finalize(hash + rows);
+}
+
+constexpr Lanes points_seed = {{prime1 + prime2, prime2, 0, 0 - prime1}};
+constexpr Lanes check_seed = {{prime3, prime1 ^ prime3, 0 - prime2, prime1}};
+
+// The 64 bits hash of the points can collide, the rows and the check hash
+// must match too. Both hashes are computed in a single pass.
+struct Key {
+    uint64_t points;
+    uint64_t check;
+    uint64_t options;
+    uint64_t rows;
+
+    bool operator==(const Key& other) const {
+        return points == other.points and check == other.check and
+               options == other.options and rows == other.rows;
+    }
+};
+
+Key makeKey(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    uint64_t options) {
+    ELLIPSOID_TRACE_COUNT("cache.hash", static_cast<uint64_t>(data.rows()),
+                          static_cast<uint64_t>(data.rows()) * 3 *
+                              sizeof(double));
+    Lanes lanes = points_seed;
+    Lanes check = check_seed;
+    hashLanes<true>(data, lanes, check);
+    const auto rows = static_cast<size_t>(data.rows());
+    return Key{mergeLanes(lanes, rows), mergeLanes(check, rows), options,
+               static_cast<uint64_t>(rows)};
+}
+
+struct KeyHash {
+    size_t operator()(const Key& key) const {
+        return static_cast<size_t>(key.points ^ rotate(key.options, 17) ^
+                                   rotate(key.rows, 41));
+    }
+};
+
+struct Entry {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    Key key;
+    FitResult result;
+};
+
+// Values of a result in the cache file: coefficients, center, radii,
+// eigenvalues and eigenvectors
+using Value = Eigen::Matrix<double, 10 + 3 + 3 + 3 + 9, 1>;
+
+using Entries = std::list<Entry, Eigen::aligned_allocator<Entry>>;
+
+// Memory accounted for a cached result: the list node and the index entry
+constexpr size_t entry_memory =
+    sizeof(Entry) + 2 * sizeof(void*) + sizeof(Key) +
+    sizeof(Entries::iterator) + 2 * sizeof(void*);
+
+[[noreturn]] void fail(const std::string& path, const char* what) {
+    throw std::system_error(errno, std::generic_category(),
+                            std::string("ellipsoid::FitCache: ") + what +
+                                " " + path);
+}
+
+} // namespace
+
+uint64_t hashPoints(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data) {
+    ELLIPSOID_TRACE_COUNT("cache.hash", static_cast<uint64_t>(data.rows()),
+                          static_cast<uint64_t>(data.rows()) * 3 *
+                              sizeof(double));
+    Lanes lanes = points_seed;
+    Lanes unused;
+    hashLanes<false>(data, lanes, unused);
+    return mergeLanes(lanes, static_cast<size_t>(data.rows()));
+}
+
+struct FitCache::Impl {
+    explicit Impl(const CacheOptions& opts)
+        : options(opts),
+          capacity(std::max<size_t>(1, opts.memory_budget / entry_memory)),
+          hits(0),
+          misses(0),
+          evictions(0) {
+    }
+
+    template <typename Compute>
+    FitResult get(const Key& key, Compute compute) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = index.find(key);
+            if (it != index.end()) {
+                ++hits;
+                entries.splice(entries.end(), entries, it->second);
+                return it->second->result;
+            }
+            ++misses;
+        }
+
+        // concurrent misses on the same key compute the same result
+        const FitResult result = compute();
+        std::lock_guard<std::mutex> lock(mutex);
+        insert(key, result);
+        return result;
+    }
+
+    // Add or refresh a result as the most recently used, mutex held
+    void insert(const Key& key, const FitResult& result) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->second->result = result;
+            entries.splice(entries.end(), entries, it->second);
+            return;
+        }
+        while (entries.size() >= capacity) {
+            index.erase(entries.front().key);
+            entries.pop_front();
+            ++evictions;
+        }
+        Entry entry;
+        entry.key = key;
+        entry.result = result;
+        entries.push_back(entry);
+        index.emplace(key, std::prev(entries.end()));
+    }
+
+    void load() {
+        auto* file = std::fopen(options.path.c_str(), "rb");
+        if (file == nullptr) {
+            if (errno == ENOENT) {
+                return;
+            }
+            fail(options.path, "cannot open");
+        }
+
+        char magic[sizeof(file_magic)];
+        uint64_t count = 0;
+        bool valid = std::fread(magic, sizeof(magic), 1, file) == 1;
+        if (valid and std::memcmp(magic, file_magic_v1, sizeof(magic)) == 0) {
+            // keys without check hash, the results are computed again
+            std::fclose(file);
+            return;
+        }
+        valid = valid and
+                std::memcmp(magic, file_magic, sizeof(magic)) == 0 and
+                std::fread(&count, sizeof(count), 1, file) == 1;
+        // stored from the least to the most recently used
+        for (uint64_t i = 0; valid and i < count; ++i) {
+            Key key;
+            Value values;
+            valid = std::fread(&key, sizeof(key), 1, file) == 1 and
+                    std::fread(values.data(), sizeof(values), 1, file) == 1;
+            if (valid) {
+                FitResult result;
+                result.coefficients = values.head<10>();
+                result.parameters.center = values.segment<3>(10);
+                result.parameters.radii = values.segment<3>(13);
+                result.eval = values.segment<3>(16);
+                result.evec_column =
+                    Eigen::Map<const Eigen::Matrix3d>(values.data() + 19);
+                insert(key, result);
+            }
+        }
+        std::fclose(file);
+        if (not valid) {
+            throw std::runtime_error("ellipsoid::FitCache: invalid file " +
+                                     options.path);
+        }
+    }
+
+    void save() {
+        const auto temporary = options.path + ".tmp";
+        auto* file = std::fopen(temporary.c_str(), "wb");
+        if (file == nullptr) {
+            fail(temporary, "cannot create");
+        }
+
+        const uint64_t count = entries.size();
+        bool written =
+            std::fwrite(file_magic, sizeof(file_magic), 1, file) == 1 and
+            std::fwrite(&count, sizeof(count), 1, file) == 1;
+        for (auto it = entries.begin(); written and it != entries.end();
+             ++it) {
+            const auto& result = it->result;
+            Value values;
+            values << result.coefficients, result.parameters.center,
+                result.parameters.radii, result.eval,
+                Eigen::Map<const Eigen::Matrix<double, 9, 1>>(
+                    result.evec_column.data());
+            written =
+                std::fwrite(&it->key, sizeof(Key), 1, file) == 1 and
+                std::fwrite(values.data(), sizeof(values), 1, file) == 1;
+        }
+        const int error = errno;
+        if (std::fclose(file) != 0 or not written) {
+            if (not written) {
+                errno = error;
+            }
+            std::remove(temporary.c_str());
+            fail(temporary, "cannot write");
+        }
+        if (std::rename(temporary.c_str(), options.path.c_str()) != 0) {
+            fail(options.path, "cannot replace");
+        }
+    }
+
+    CacheOptions options;
+    size_t capacity;
+    std::mutex mutex;
+    Entries entries; // from the least to the most recently used
+    std::unordered_map<Key, Entries::iterator, KeyHash> index;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
+
+FitCache::FitCache(const CacheOptions& options) : impl_(new Impl(options)) {
+    if (not options.path.empty()) {
+        impl_->load();
+    }
+}
+
+FitCache::~FitCache() = default;
+
+FitResult FitCache::fit(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    EllipsoidType type) {
+    const auto key = makeKey(data, hashType(type));
+    return impl_->get(key, [&] {
+        FitResult result;
+        result.parameters =
+            detail::fitPoints(data, &result.coefficients, &result.eval,
+                              &result.evec_column, type);
+        return result;
+    });
+}
+
+FitResult FitCache::fit(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    const FitOptions& options) {
+    const auto key = makeKey(data, hashOptions(options));
+    return impl_->get(key, [&] { return ellipsoid::fit(data, options); });
+}
+
+CacheStatistics FitCache::statistics() const {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    CacheStatistics statistics;
+    statistics.hits = impl_->hits;
+    statistics.misses = impl_->misses;
+    statistics.evictions = impl_->evictions;
+    statistics.entries = impl_->entries.size();
+    statistics.memory = statistics.entries * entry_memory;
+    return statistics;
+}
+
+void FitCache::clear() {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->index.clear();
+    impl_->entries.clear();
+}
+
+void FitCache::save() const {
+    if (impl_->options.path.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->save();
+}
+
+} // namespace ellipsoid
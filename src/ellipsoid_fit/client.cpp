@@ -0,0 +1,85 @@
+#include <ellipsoid/client.h>
+
+#include "protocol.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+namespace ellipsoid {
+
+Client::Client(const std::string& socket_path)
+    : fd_(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) {
+    if (fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                "ellipsoid::Client: socket");
+    }
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        ::close(fd_);
+        throw std::system_error(ENAMETOOLONG, std::generic_category(),
+                                "ellipsoid::Client: " + socket_path);
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(),
+                 sizeof(address.sun_path) - 1);
+
+    if (::connect(fd_, reinterpret_cast<const sockaddr*>(&address),
+                  sizeof(address)) < 0) {
+        const auto error = errno;
+        ::close(fd_);
+        throw std::system_error(error, std::generic_category(),
+                                "ellipsoid::Client: connect to " +
+                                    socket_path);
+    }
+}
+
+Client::~Client() {
+    ::close(fd_);
+}
+
+FitResult Client::fit(const Eigen::Matrix<double, Eigen::Dynamic, 3>& data,
+                      EllipsoidType type) {
+    detail::RequestHeader header;
+    header.magic = detail::protocol_magic;
+    header.type = static_cast<uint32_t>(type);
+    header.count = static_cast<uint64_t>(data.rows());
+
+    // the matrix storage is sent as is
+    if (not detail::writeAll(fd_, &header, sizeof(header)) or
+        not detail::writeAll(fd_, data.data(),
+                             sizeof(double) * static_cast<size_t>(data.size()))) {
+        throw std::system_error(errno, std::generic_category(),
+                                "ellipsoid::Client: send");
+    }
+
+    detail::Reply reply;
+    if (not detail::readAll(fd_, &reply, sizeof(reply)) or
+        reply.magic != detail::protocol_magic) {
+        throw std::system_error(errno != 0 ? errno : ECONNRESET,
+                                std::generic_category(),
+                                "ellipsoid::Client: receive");
+    }
+
+    switch (reply.status) {
+    case detail::ReplyStatus::Success:
+        break;
+    case detail::ReplyStatus::InvalidRequest:
+        throw std::runtime_error("ellipsoid::Client: invalid request");
+    case detail::ReplyStatus::Overloaded:
+        throw std::runtime_error("ellipsoid::Client: server overloaded");
+    }
+
+    FitResult result;
+    detail::fromReply(reply, result);
+    return result;
+}
+
+} // namespace ellipsoid
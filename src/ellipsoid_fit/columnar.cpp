@@ -0,0 +1,301 @@
+#include <ellipsoid/columnar.h>
+
+#include "flatbuffer.h"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <system_error>
+
+namespace ellipsoid {
+
+namespace {
+
+using detail::FlatNode;
+using detail::FlatNodePtr;
+
+// Arrow IPC format constants (see Schema.fbs, Message.fbs and File.fbs)
+constexpr int16_t metadata_version = 4; // V5
+constexpr uint8_t header_schema = 1;
+constexpr uint8_t header_record_batch = 3;
+constexpr uint8_t type_int = 2;
+constexpr uint8_t type_floating_point = 3;
+constexpr int16_t precision_double = 2;
+constexpr uint32_t continuation = 0xFFFFFFFF;
+constexpr size_t buffer_alignment = 64;
+
+const char magic[8] = {'A', 'R', 'R', 'O', 'W', '1', 0, 0};
+const uint8_t zeros[buffer_alignment] = {};
+
+enum class ColumnType {
+    Double,
+    UInt64,
+    UInt8,
+};
+
+struct Column {
+    std::string name;
+    ColumnType type;
+    const void* data;
+};
+
+size_t elementSize(ColumnType type) {
+    switch (type) {
+    case ColumnType::Double:
+        return sizeof(double);
+    case ColumnType::UInt64:
+        return sizeof(uint64_t);
+    case ColumnType::UInt8:
+        return sizeof(uint8_t);
+    }
+    return 0;
+}
+
+// The columns of the results, in the order of the schema
+std::vector<Column> columns(const BatchResults& results) {
+    std::vector<Column> columns;
+    const auto rows = results.centers.rows();
+    auto add = [&](const std::string& name, const double* data,
+                   Eigen::Index column) {
+        columns.push_back(Column{name, ColumnType::Double, data + column * rows});
+    };
+    const char* axes[] = {"x", "y", "z"};
+    for (int i = 0; i < 3; ++i) {
+        add(std::string("center_") + axes[i], results.centers.data(), i);
+    }
+    for (int i = 0; i < 3; ++i) {
+        add(std::string("radius_") + axes[i], results.radii.data(), i);
+    }
+    for (int i = 0; i < 3; ++i) {
+        add("eigenvalue_" + std::to_string(i), results.eigenvalues.data(), i);
+    }
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            add("rotation_" + std::to_string(i) + std::to_string(j),
+                results.rotations.data(), 3 * j + i);
+        }
+    }
+    for (int i = 0; i < 10; ++i) {
+        add("coefficient_" + std::to_string(i), results.coefficients.data(),
+            i);
+    }
+    columns.push_back(Column{"point_count", ColumnType::UInt64,
+                             results.point_counts.data()});
+    columns.push_back(
+        Column{"fallback", ColumnType::UInt8, results.fallback.data()});
+    add("min_pivot", results.min_pivots.data(), 0);
+    return columns;
+}
+
+FlatNodePtr schema() {
+    std::vector<FlatNodePtr> fields;
+    for (const auto& column : columns(BatchResults{})) {
+        auto field = FlatNode::table();
+        field->add(0, FlatNode::string(column.name));
+        field->add(1, static_cast<uint8_t>(false)); // nullable
+        auto type = FlatNode::table();
+        if (column.type == ColumnType::Double) {
+            field->add(2, type_floating_point);
+            type->add(0, precision_double);
+        } else {
+            field->add(2, type_int);
+            type->add(0, static_cast<int32_t>(8 * elementSize(column.type)));
+            type->add(1, static_cast<uint8_t>(false)); // is_signed
+        }
+        field->add(3, type);
+        field->add(5, FlatNode::tables({})); // children
+        fields.push_back(field);
+    }
+    auto node = FlatNode::table();
+    node->add(1, FlatNode::tables(fields));
+    return node;
+}
+
+std::vector<uint8_t> message(uint8_t header_type, FlatNodePtr header,
+                             int64_t body_length) {
+    FlatNode node(FlatNode::Kind::Table);
+    node.add(0, metadata_version);
+    node.add(1, header_type);
+    node.add(2, header);
+    node.add(3, body_length);
+    return detail::FlatBuilder::finish(node);
+}
+
+[[noreturn]] void fail(const std::string& path, const char* what) {
+    throw std::system_error(errno, std::generic_category(),
+                            std::string("ellipsoid::ArrowWriter: ") + what +
+                                " " + path);
+}
+
+// Write all the buffers, resuming after partial writes
+void writeAll(int fd, std::vector<iovec> buffers, const std::string& path) {
+    size_t first = 0;
+    while (first < buffers.size()) {
+        const auto count = static_cast<int>(
+            std::min<size_t>(buffers.size() - first, IOV_MAX));
+        auto written = ::writev(fd, &buffers[first], count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail(path, "cannot write");
+        }
+        while (first < buffers.size() &&
+               static_cast<size_t>(written) >= buffers[first].iov_len) {
+            written -= static_cast<ssize_t>(buffers[first].iov_len);
+            ++first;
+        }
+        if (first < buffers.size()) {
+            buffers[first].iov_base =
+                static_cast<uint8_t*>(buffers[first].iov_base) + written;
+            buffers[first].iov_len -= static_cast<size_t>(written);
+        }
+    }
+}
+
+iovec buffer(const void* data, size_t size) {
+    return iovec{const_cast<void*>(data), size};
+}
+
+} // namespace
+
+ArrowWriter::ArrowWriter(const std::string& path)
+    : path_(path), fd_(-1), offset_(0) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        fail(path_, "cannot create");
+    }
+    try {
+        writeAll(fd_, {buffer(magic, sizeof(magic))}, path_);
+        offset_ = sizeof(magic);
+        writeMessage(message(header_schema, schema(), 0));
+    } catch (...) {
+        ::close(fd_);
+        throw;
+    }
+}
+
+ArrowWriter::~ArrowWriter() {
+    if (fd_ >= 0) {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+}
+
+void ArrowWriter::writeMessage(const std::vector<uint8_t>& metadata) {
+    const auto length = static_cast<int32_t>(metadata.size());
+    writeAll(fd_,
+             {buffer(&continuation, sizeof(continuation)),
+              buffer(&length, sizeof(length)),
+              buffer(metadata.data(), metadata.size())},
+             path_);
+    offset_ += static_cast<int64_t>(8 + metadata.size());
+}
+
+void ArrowWriter::write(const BatchResults& results) {
+    if (fd_ < 0) {
+        throw std::logic_error("ellipsoid::ArrowWriter: write after close");
+    }
+    struct FieldNode {
+        int64_t length;
+        int64_t null_count;
+    };
+    struct Buffer {
+        int64_t offset;
+        int64_t length;
+    };
+
+    // body layout: one empty validity buffer and one data buffer per column
+    const auto rows = static_cast<int64_t>(results.size());
+    const auto all = columns(results);
+    std::vector<FieldNode> nodes;
+    std::vector<Buffer> buffers;
+    std::vector<iovec> body;
+    int64_t body_length = 0;
+    for (const auto& column : all) {
+        const auto length = rows * static_cast<int64_t>(elementSize(column.type));
+        const auto padding =
+            (buffer_alignment - static_cast<size_t>(body_length) % buffer_alignment) %
+            buffer_alignment;
+        body_length += static_cast<int64_t>(padding);
+        nodes.push_back(FieldNode{rows, 0});
+        buffers.push_back(Buffer{body_length, 0});
+        buffers.push_back(Buffer{body_length, length});
+        if (padding > 0) {
+            body.push_back(buffer(zeros, padding));
+        }
+        body.push_back(buffer(column.data, static_cast<size_t>(length)));
+        body_length += length;
+    }
+    const auto padding = static_cast<size_t>(-body_length) % 8;
+    if (padding > 0) {
+        body.push_back(buffer(zeros, padding));
+        body_length += static_cast<int64_t>(padding);
+    }
+
+    auto batch = FlatNode::table();
+    batch->add(0, rows);
+    batch->add(1, FlatNode::structs(nodes.data(), nodes.size(),
+                                    sizeof(FieldNode)));
+    batch->add(2, FlatNode::structs(buffers.data(), buffers.size(),
+                                    sizeof(Buffer)));
+    const auto metadata = message(header_record_batch, batch, body_length);
+
+    Block block;
+    block.offset = offset_;
+    block.metadata_length = static_cast<int32_t>(8 + metadata.size());
+    block.padding = 0;
+    block.body_length = body_length;
+    writeMessage(metadata);
+    writeAll(fd_, body, path_);
+    offset_ += body_length;
+    blocks_.push_back(block);
+}
+
+void ArrowWriter::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    const int fd = fd_;
+    fd_ = -1;
+    try {
+        const uint32_t end_of_stream[2] = {continuation, 0};
+        FlatNode footer(FlatNode::Kind::Table);
+        footer.add(0, metadata_version);
+        footer.add(1, schema());
+        footer.add(2, FlatNode::structs(nullptr, 0, sizeof(Block)));
+        footer.add(3, FlatNode::structs(blocks_.data(), blocks_.size(),
+                                        sizeof(Block)));
+        const auto metadata = detail::FlatBuilder::finish(footer);
+        const auto length = static_cast<int32_t>(metadata.size());
+        writeAll(fd,
+                 {buffer(end_of_stream, sizeof(end_of_stream)),
+                  buffer(metadata.data(), metadata.size()),
+                  buffer(&length, sizeof(length)), buffer(magic, 6)},
+                 path_);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    if (::close(fd) < 0) {
+        fail(path_, "cannot close");
+    }
+}
+
+size_t ArrowWriter::batches() const {
+    return blocks_.size();
+}
+
+void writeArrow(const std::string& path, const BatchResults& results) {
+    ArrowWriter writer(path);
+    writer.write(results);
+    writer.close();
+}
+
+} // namespace ellipsoid
@@ -0,0 +1,266 @@
+#include <ellipsoid/dataset.h>
+#include <ellipsoid/executor.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace ellipsoid {
+
+namespace {
+
+// Number of records decoded before being accumulated
+constexpr Eigen::Index decode_size = 256;
+
+// Closes the file descriptor on destruction
+class FileDescriptor {
+public:
+    explicit FileDescriptor(const std::string& path)
+        : fd_(::open(path.c_str(), O_RDONLY | O_CLOEXEC)) {
+    }
+
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    ~FileDescriptor() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    int get() const {
+        return fd_;
+    }
+
+private:
+    int fd_;
+};
+
+// Read up to size bytes, returns the number of bytes read or -errno on error
+ssize_t readChunk(int fd, char* buffer, size_t size, off_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        const auto bytes = ::pread(fd, buffer + done, size - done,
+                                   offset + static_cast<off_t>(done));
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (bytes == 0) {
+            break;
+        }
+        done += static_cast<size_t>(bytes);
+    }
+    return static_cast<ssize_t>(done);
+}
+
+// Pool of threads performing the reads of all the files, in submission
+// order. Each file has at most one read in flight, so with one thread per
+// concurrently processed file all their reads are queued to the device
+// together, keeping fast SSDs busy.
+class Reader {
+public:
+    explicit Reader(size_t threads) : stop_(false) {
+        for (size_t i = 0; i < threads; ++i) {
+            threads_.emplace_back([this] { run(); });
+        }
+    }
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    ~Reader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    // Queue a readChunk() call, the buffer must outlive its completion
+    std::future<ssize_t> read(int fd, char* buffer, size_t size,
+                              off_t offset) {
+        std::packaged_task<ssize_t()> task(
+            [=] { return readChunk(fd, buffer, size, offset); });
+        auto done = task.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(task));
+        }
+        wake_.notify_one();
+        return done;
+    }
+
+private:
+    void run() {
+        while (true) {
+            std::packaged_task<ssize_t()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock,
+                           [this] { return stop_ or not queue_.empty(); });
+                if (queue_.empty()) {
+                    return;
+                }
+                task = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::packaged_task<ssize_t()>> queue_;
+    bool stop_;
+    std::vector<std::thread> threads_;
+};
+
+template <typename T>
+void accumulateRecords(Moments& moments, const char* records, size_t count,
+                       const RecordLayout& layout) {
+    Eigen::Matrix<double, decode_size, 3> points;
+    for (size_t start = 0; start < count;
+         start += static_cast<size_t>(decode_size)) {
+        const auto n = std::min(static_cast<size_t>(decode_size), count - start);
+        for (size_t i = 0; i < n; ++i) {
+            // records are not necessarily aligned
+            T xyz[3];
+            std::memcpy(xyz,
+                        records + (start + i) * layout.record_size +
+                            layout.coordinates_offset,
+                        sizeof(xyz));
+            points(i, 0) = static_cast<double>(xyz[0]);
+            points(i, 1) = static_cast<double>(xyz[1]);
+            points(i, 2) = static_cast<double>(xyz[2]);
+        }
+        moments.add(points.topRows(n));
+    }
+}
+
+void processFile(FileResult& result, EllipsoidType type,
+                 const DatasetOptions& options, Reader& reader) {
+    const auto& layout = options.layout;
+    const size_t coordinates_size =
+        3 * (layout.format == ScalarFormat::Float32 ? sizeof(float)
+                                                    : sizeof(double));
+    if (layout.record_size == 0 or
+        layout.coordinates_offset + coordinates_size > layout.record_size) {
+        result.error = "invalid record layout";
+        return;
+    }
+
+    FileDescriptor file(result.path);
+    if (file.get() < 0) {
+        result.error = std::system_category().message(errno);
+        return;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(file.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    const size_t records_per_chunk =
+        std::max<size_t>(1, options.chunk_size / layout.record_size);
+    const size_t chunk_bytes = records_per_chunk * layout.record_size;
+
+    // double buffering: the next chunk is read while the current one is
+    // accumulated
+    std::vector<char> buffers[2] = {std::vector<char>(chunk_bytes),
+                                    std::vector<char>(chunk_bytes)};
+    auto read = [&](int buffer, off_t offset) {
+        return reader.read(file.get(), buffers[buffer].data(), chunk_bytes,
+                           offset);
+    };
+
+    auto offset = static_cast<off_t>(layout.header_size);
+    int current = 0;
+    auto pending = read(current, offset);
+    while (true) {
+        const auto bytes = pending.get();
+        if (bytes < 0) {
+            result.error =
+                std::system_category().message(static_cast<int>(-bytes));
+            return;
+        }
+        if (bytes == 0) {
+            break;
+        }
+        offset += bytes;
+
+        const bool last_chunk = static_cast<size_t>(bytes) < chunk_bytes;
+        if (not last_chunk) {
+            pending = read(1 - current, offset);
+        }
+
+        const auto records = static_cast<size_t>(bytes) / layout.record_size;
+        if (layout.format == ScalarFormat::Float32) {
+            accumulateRecords<float>(result.moments, buffers[current].data(),
+                                     records, layout);
+        } else {
+            accumulateRecords<double>(result.moments, buffers[current].data(),
+                                      records, layout);
+        }
+
+        if (last_chunk) {
+            if (static_cast<size_t>(bytes) % layout.record_size != 0) {
+                result.error = "truncated record at the end of the file";
+            }
+            break;
+        }
+        current = 1 - current;
+    }
+
+    if (result.moments.count() == 0) {
+        result.error = "no records";
+        return;
+    }
+    result.parameters = fit(result.moments, type);
+}
+
+} // namespace
+
+DatasetResult fitDataset(const std::vector<std::string>& paths,
+                         EllipsoidType type, const DatasetOptions& options) {
+    DatasetResult result;
+    result.files.resize(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        result.files[i].path = paths[i];
+    }
+
+    const auto concurrent_files = std::max<size_t>(
+        1, std::min(options.concurrent_files, paths.size()));
+    Reader reader(concurrent_files);
+    defaultExecutor()->parallelFor(
+        paths.size(),
+        [&](size_t i) { processFile(result.files[i], type, options, reader); },
+        concurrent_files);
+
+    for (const auto& file : result.files) {
+        if (file.error.empty()) {
+            result.moments.merge(file.moments);
+        }
+    }
+    if (result.moments.count() > 0) {
+        result.parameters = fit(result.moments, type);
+    }
+
+    return result;
+}
+
+} // namespace ellipsoid
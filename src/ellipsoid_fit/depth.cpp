@@ -0,0 +1,133 @@
+#include <ellipsoid/depth.h>
+#include <ellipsoid/executor.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace ellipsoid {
+
+namespace {
+
+// Number of unprojected points buffered before being accumulated
+constexpr Eigen::Index buffer_size = 256;
+
+// Minimum number of rows processed by a single thread
+constexpr size_t min_rows_per_band = 32;
+
+template <typename T>
+void accumulateRows(Moments& moments, const DepthImage& image,
+                    const CameraIntrinsics& intrinsics, const ImageMask* mask,
+                    const RegionOfInterest& roi, size_t first_row,
+                    size_t last_row, const Eigen::VectorXd& x_factors) {
+    Eigen::Matrix<double, buffer_size, 3> points;
+    Eigen::Index count = 0;
+
+    for (size_t v = first_row; v < last_row; ++v) {
+        const auto* depth = reinterpret_cast<const T*>(
+                                static_cast<const uint8_t*>(image.data) +
+                                v * image.row_stride) +
+                            roi.x;
+        const uint8_t* labels =
+            mask != nullptr ? mask->data + v * mask->row_stride + roi.x
+                            : nullptr;
+        const double y_factor =
+            (static_cast<double>(v) - intrinsics.cy) / intrinsics.fy;
+
+        for (size_t u = 0; u < roi.width; ++u) {
+            if (labels != nullptr and
+                (mask->label < 0 ? labels[u] == 0 : labels[u] != mask->label)) {
+                continue;
+            }
+            const double z = static_cast<double>(depth[u]) * image.depth_scale;
+            if (not(z > 0.) or not std::isfinite(z)) {
+                continue;
+            }
+
+            points(count, 0) = z * x_factors(u);
+            points(count, 1) = z * y_factor;
+            points(count, 2) = z;
+            if (++count == buffer_size) {
+                moments.add(points);
+                count = 0;
+            }
+        }
+    }
+
+    if (count > 0) {
+        moments.add(points.topRows(count));
+    }
+}
+
+} // namespace
+
+void accumulate(Moments& moments, const DepthImage& image,
+                const CameraIntrinsics& intrinsics, const ImageMask* mask,
+                const RegionOfInterest* roi) {
+    RegionOfInterest region{0, 0, image.width, image.height};
+    if (roi != nullptr) {
+        region.x = std::min(roi->x, image.width);
+        region.y = std::min(roi->y, image.height);
+        region.width = std::min(roi->width, image.width - region.x);
+        region.height = std::min(roi->height, image.height - region.y);
+    }
+    if (region.width == 0 or region.height == 0) {
+        return;
+    }
+
+    // the x unprojection factor only depends on the column
+    Eigen::VectorXd x_factors(region.width);
+    for (size_t u = 0; u < region.width; ++u) {
+        x_factors(u) =
+            (static_cast<double>(region.x + u) - intrinsics.cx) / intrinsics.fx;
+    }
+
+    auto process = [&](Moments& band_moments, size_t first_row,
+                       size_t last_row) {
+        switch (image.format) {
+        case DepthFormat::UInt16:
+            accumulateRows<uint16_t>(band_moments, image, intrinsics, mask,
+                                     region, first_row, last_row, x_factors);
+            break;
+        case DepthFormat::Float32:
+            accumulateRows<float>(band_moments, image, intrinsics, mask,
+                                  region, first_row, last_row, x_factors);
+            break;
+        }
+    };
+
+    // split the rows in bands processed in parallel
+    const size_t bands = std::max<size_t>(
+        1, std::min<size_t>(defaultExecutor()->concurrency(),
+                            region.height / min_rows_per_band));
+    if (bands == 1) {
+        process(moments, region.y, region.y + region.height);
+        return;
+    }
+
+    std::vector<Moments, Eigen::aligned_allocator<Moments>> band_moments(
+        bands);
+    const size_t rows_per_band = (region.height + bands - 1) / bands;
+    defaultExecutor()->parallelFor(bands, [&](size_t band) {
+        const size_t first_row = region.y + band * rows_per_band;
+        const size_t last_row =
+            std::min(first_row + rows_per_band, region.y + region.height);
+        if (first_row < last_row) {
+            process(band_moments[band], first_row, last_row);
+        }
+    });
+
+    for (const auto& partial : band_moments) {
+        moments.merge(partial);
+    }
+}
+
+Parameters fit(const DepthImage& image, const CameraIntrinsics& intrinsics,
+               const ImageMask* mask, const RegionOfInterest* roi,
+               EllipsoidType type) {
+    Moments moments;
+    accumulate(moments, image, intrinsics, mask, roi);
+    return fit(moments, type);
+}
+
+} // namespace ellipsoid
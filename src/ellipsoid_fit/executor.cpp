@@ -0,0 +1,232 @@
+#include <ellipsoid/executor.h>
+
+#include <sched.h>
+
+#include <algorithm>
+#include <exception>
+
+namespace ellipsoid {
+
+namespace {
+
+// Pool and queue of the current thread when it belongs to a
+// WorkStealingExecutor
+thread_local const void* current_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+struct LoopState {
+    LoopState(size_t n, const std::function<void(size_t)>& f)
+        : count(n), body(&f), next(0), done(0) {
+    }
+
+    const size_t count;
+    // only dereferenced after claiming an iteration, i.e while the caller
+    // is still waiting
+    const std::function<void(size_t)>* body;
+    std::atomic<size_t> next;
+    std::atomic<size_t> done;
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr error;
+};
+
+void runLoop(LoopState& state) {
+    size_t completed = 0;
+    for (size_t i = state.next++; i < state.count; i = state.next++) {
+        try {
+            (*state.body)(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (not state.error) {
+                state.error = std::current_exception();
+            }
+        }
+        ++completed;
+    }
+    if (completed > 0 and (state.done += completed) == state.count) {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.finished.notify_all();
+    }
+}
+
+std::mutex default_executor_mutex;
+std::shared_ptr<Executor> default_executor;
+
+} // namespace
+
+void Executor::parallelFor(size_t count,
+                           const std::function<void(size_t)>& body,
+                           size_t max_tasks) {
+    auto tasks = std::min(count, concurrency());
+    if (max_tasks > 0) {
+        tasks = std::min(tasks, max_tasks);
+    }
+    if (tasks <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    // the state outlives this call for the tasks starting after the loop
+    // completed
+    auto state = std::make_shared<LoopState>(count, body);
+    for (size_t i = 1; i < tasks; ++i) {
+        submit([state] { runLoop(*state); });
+    }
+    runLoop(*state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done == count; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+void SerialExecutor::submit(std::function<void()> task) {
+    task();
+}
+
+size_t SerialExecutor::concurrency() const {
+    return 1;
+}
+
+void SerialExecutor::parallelFor(size_t count,
+                                 const std::function<void(size_t)>& body,
+                                 size_t /*max_tasks*/) {
+    for (size_t i = 0; i < count; ++i) {
+        body(i);
+    }
+}
+
+CallbackExecutor::CallbackExecutor(
+    std::function<void(std::function<void()>)> submit, size_t concurrency)
+    : submit_(std::move(submit)), concurrency_(std::max<size_t>(concurrency, 1)) {
+}
+
+void CallbackExecutor::submit(std::function<void()> task) {
+    submit_(std::move(task));
+}
+
+size_t CallbackExecutor::concurrency() const {
+    return concurrency_;
+}
+
+WorkStealingExecutor::WorkStealingExecutor(size_t threads,
+                                           std::vector<int> cpus)
+    : cpus_(std::move(cpus)), next_queue_(0), pending_(0), stop_(false) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        queues_.emplace_back(new Queue);
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back(&WorkStealingExecutor::run, this, i);
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkStealingExecutor::submit(std::function<void()> task) {
+    const auto index = current_pool == this
+                           ? current_queue
+                           : next_queue_++ % queues_.size();
+    {
+        // counted first so that pending_ never goes below the number of
+        // queued tasks, under the lock to pair with the sleeping threads
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        ++pending_;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    wake_.notify_one();
+}
+
+size_t WorkStealingExecutor::concurrency() const {
+    return threads_.size();
+}
+
+bool WorkStealingExecutor::isWorker() const {
+    return current_pool == this;
+}
+
+bool WorkStealingExecutor::pop(size_t index, std::function<void()>& task) {
+    // newest task of its own queue first, for locality
+    {
+        auto& queue = *queues_[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (not queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+    // then the oldest task of another queue
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        auto& queue = *queues_[(index + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (not queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingExecutor::run(size_t index) {
+    current_pool = this;
+    current_queue = index;
+
+    if (not cpus_.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu : cpus_) {
+            CPU_SET(cpu, &set);
+        }
+        // best effort, the thread stays unrestricted on failure
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+
+    std::function<void()> task;
+    while (true) {
+        if (pop(index, task)) {
+            --pending_;
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [this] { return stop_ or pending_ > 0; });
+        if (stop_ and pending_ == 0) {
+            return;
+        }
+    }
+}
+
+std::shared_ptr<Executor> defaultExecutor() {
+    std::lock_guard<std::mutex> lock(default_executor_mutex);
+    if (not default_executor) {
+        default_executor = std::make_shared<WorkStealingExecutor>();
+    }
+    return default_executor;
+}
+
+void setDefaultExecutor(std::shared_ptr<Executor> executor) {
+    std::lock_guard<std::mutex> lock(default_executor_mutex);
+    default_executor = std::move(executor);
+}
+
+} // namespace ellipsoid
@@ -1,8 +1,59 @@
 #include <ellipsoid/fit.h>
+#include <ellipsoid/inline.h>
 #include <Eigen/Eigenvalues>
 
+#include "basis.h"
+#include "tracing.h"
+
 namespace ellipsoid {
 
+namespace detail {
+
+Eigen::Matrix<double, 10, Eigen::Dynamic> monomialBasis(EllipsoidType type) {
+    Eigen::Matrix<double, 10, Eigen::Dynamic> B;
+    // coefficients of x^2 + y^2 - 2z^2 and x^2 + z^2 - 2y^2
+    Eigen::Matrix<double, 10, 1> xy_equal, xz_equal;
+    xy_equal << 1., 1., -2., 0., 0., 0., 0., 0., 0., 0.;
+    xz_equal << 1., -2., 1., 0., 0., 0., 0., 0., 0., 0.;
+    const Eigen::Matrix<double, 10, 10> I =
+        Eigen::Matrix<double, 10, 10>::Identity();
+
+    switch (type) {
+    case EllipsoidType::Arbitrary:
+        B.resize(10, 9);
+        B << xy_equal, xz_equal, I.rightCols<7>();
+        break;
+    case EllipsoidType::XYEqual:
+        B.resize(10, 8);
+        B << xy_equal, I.rightCols<7>();
+        break;
+    case EllipsoidType::XZEqual:
+        B.resize(10, 8);
+        B << xz_equal, I.rightCols<7>();
+        break;
+    case EllipsoidType::Sphere:
+        B.resize(10, 4);
+        B << I.rightCols<4>();
+        break;
+    case EllipsoidType::Aligned:
+        B.resize(10, 6);
+        B << xy_equal, xz_equal, I.rightCols<4>();
+        break;
+    case EllipsoidType::AlignedXYEqual:
+        B.resize(10, 5);
+        B << xy_equal, I.rightCols<4>();
+        break;
+    case EllipsoidType::AlignedXZEqual:
+        B.resize(10, 5);
+        B << xz_equal, I.rightCols<4>();
+        break;
+    }
+
+    return B;
+}
+
+} // namespace detail
+
 Parameters fit(const Eigen::Matrix<double, Eigen::Dynamic, 3>& data,
                 EllipsoidType type) {
     return fit(data, nullptr, nullptr, nullptr, type);
@@ -24,178 +75,178 @@ Parameters fit(const Eigen::Matrix<double, Eigen::Dynamic, 3>& data,
                 Eigen::Matrix<double, 10, 1>* coefficients_p, 
                 Eigen::Vector3d* eval_p, Eigen::Matrix3d* evec_column_p,
                 EllipsoidType type) {
-    Parameters params;
+    return detail::fitPoints(data, coefficients_p, eval_p, evec_column_p, type);
+}
 
-    const auto& x = data.col(0);
-    const auto& y = data.col(1);
-    const auto& z = data.col(2);
+namespace detail {
 
-    auto x_sq = x.cwiseProduct(x).eval();
-    auto y_sq = y.cwiseProduct(y).eval();
-    auto z_sq = z.cwiseProduct(z).eval();
+Parameters
+fitPoints(const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+          Eigen::Matrix<double, 10, 1>* coefficients_p, Eigen::Vector3d* eval_p,
+          Eigen::Matrix3d* evec_column_p, EllipsoidType type) {
+    ELLIPSOID_TRACE_COUNT("fit", static_cast<uint64_t>(data.rows()),
+                          static_cast<uint64_t>(data.size()) * sizeof(double));
+    auto v = pointsCoefficients(data, type);
+    auto params = fromCoefficients(v, eval_p, evec_column_p);
 
+    // get the coefficients of the algebraic form
+    if (coefficients_p != nullptr) {
+        *coefficients_p = v;
+    }
+
+    return params;
+}
+
+Eigen::Matrix<double, 10, 1> pointsCoefficients(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    EllipsoidType type) {
     /*
      * fit ellipsoid in the form Ax^2 + By^2 + Cz^2 + 2Dxy + 2Exz + 2Fyz + 2Gx +
      * 2Hy + 2Iz + J = 0 and A + B + C = 3 constraint removing one extra
      * parameter
      */
-    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> D;
-    switch (type) {
-    case EllipsoidType::Arbitrary:
-        D.resize(data.rows(), 9);
-        D.col(0) = x_sq + y_sq - 2. * z_sq;
-        D.col(1) = x_sq + z_sq - 2. * y_sq;
-        D.col(2) = 2. * x.cwiseProduct(y);
-        D.col(3) = 2. * x.cwiseProduct(z);
-        D.col(4) = 2. * y.cwiseProduct(z);
-        D.col(5) = 2. * x;
-        D.col(6) = 2. * y;
-        D.col(7) = 2. * z;
-        D.col(8).setOnes();
-        break;
-    case EllipsoidType::XYEqual:
-        D.resize(data.rows(), 8);
-        D.col(0) = x_sq + y_sq - 2. * z_sq;
-        D.col(1) = 2. * x.cwiseProduct(y);
-        D.col(2) = 2. * x.cwiseProduct(z);
-        D.col(3) = 2. * y.cwiseProduct(z);
-        D.col(4) = 2. * x;
-        D.col(5) = 2. * y;
-        D.col(6) = 2. * z;
-        D.col(7).setOnes();
-        break;
-    case EllipsoidType::XZEqual:
-        D.resize(data.rows(), 8);
-        D.col(0) = x_sq + z_sq - 2. * y_sq;
-        D.col(1) = 2. * x.cwiseProduct(y);
-        D.col(2) = 2. * x.cwiseProduct(z);
-        D.col(3) = 2. * y.cwiseProduct(z);
-        D.col(4) = 2. * x;
-        D.col(5) = 2. * y;
-        D.col(6) = 2. * z;
-        D.col(7).setOnes();
-        break;
-    case EllipsoidType::Sphere:
-        D.resize(data.rows(), 4);
-        D.col(0) = 2. * x;
-        D.col(1) = 2. * y;
-        D.col(2) = 2. * z;
-        D.col(3).setOnes();
-        break;
-    case EllipsoidType::Aligned:
-        D.resize(data.rows(), 6);
-        D.col(0) = x_sq + y_sq - 2. * z_sq;
-        D.col(1) = x_sq + z_sq - 2. * y_sq;
-        D.col(2) = 2. * x;
-        D.col(3) = 2. * y;
-        D.col(4) = 2. * z;
-        D.col(5).setOnes();
-        break;
-    case EllipsoidType::AlignedXYEqual:
-        D.resize(data.rows(), 5);
-        D.col(0) = x_sq + y_sq - 2. * z_sq;
-        D.col(1) = 2. * x;
-        D.col(2) = 2. * y;
-        D.col(3) = 2. * z;
-        D.col(4).setOnes();
-        break;
-    case EllipsoidType::AlignedXZEqual:
-        D.resize(data.rows(), 5);
-        D.col(0) = x_sq + z_sq - 2. * y_sq;
-        D.col(1) = 2. * x;
-        D.col(2) = 2. * y;
-        D.col(3) = 2. * z;
-        D.col(4).setOnes();
-        break;
+    Eigen::VectorXd d2; // the RHS of the llsq problem (y's)
+    FitTypes<Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>>::Design
+        D;
+    {
+        ELLIPSOID_TRACE_COUNT("fit.design_matrix",
+                              static_cast<uint64_t>(data.rows()),
+                              static_cast<uint64_t>(data.rows()) * 13 *
+                                  sizeof(double));
+        D = designMatrix(data, type, d2);
     }
 
     // solve the normal system of equations
-    auto d2 = (x_sq + y_sq + z_sq).eval(); // the RHS of the llsq problem (y's)
-    auto u = (D.transpose() * D)
-                 .bdcSvd(Eigen::ComputeFullU | Eigen::ComputeFullV)
-                 .solve(D.transpose() * d2)
-                 .eval(); // solution to the normal equations
+    Eigen::MatrixXd N;
+    Eigen::VectorXd rhs;
+    {
+        ELLIPSOID_TRACE_COUNT("fit.normal_equations",
+                              static_cast<uint64_t>(data.rows()),
+                              static_cast<uint64_t>(D.size() + d2.size()) *
+                                  sizeof(double));
+        N = D.transpose() * D;
+        rhs = D.transpose() * d2;
+    }
+    Eigen::VectorXd u;
+    {
+        ELLIPSOID_TRACE("fit.svd_solve");
+        u = N.bdcSvd(Eigen::ComputeFullU | Eigen::ComputeFullV)
+                .solve(rhs); // solution to the normal equations
+    }
 
-    /*
-     * find the ellipsoid parameters
-     * convert back to the conventional algebraic form
-     */
-    Eigen::Matrix<double, 10, 1> v;
-    switch (type) {
-    case EllipsoidType::Arbitrary:
-        v(0) = u(0) + u(1) - 1.;
-        v(1) = u(0) - 2. * u(1) - 1.;
-        v(2) = u(1) - 2. * u(0) - 1.;
-        v.segment<7>(3) = u.segment<7>(2);
-        break;
-    case EllipsoidType::XYEqual:
-        v(0) = u(0) - 1.;
-        v(1) = u(0) - 1.;
-        v(2) = -2. * u(0) - 1.;
-        v.segment<7>(3) = u.segment<7>(1);
-        break;
-    case EllipsoidType::XZEqual:
-        v(0) = u(0) - 1.;
-        v(1) = -2. * u(0) - 1.;
-        v(2) = u(0) - 1.;
-        v.segment<7>(3) = u.segment<7>(1);
-        break;
-    case EllipsoidType::Sphere:
-        v.segment<3>(0).setConstant(-1.);
-        v.segment<3>(3).setZero();
-        v.segment<4>(6) = u.segment<4>(0);
-        break;
-    case EllipsoidType::Aligned:
-        v(0) = u(0) + u(1) - 1.;
-        v(1) = u(0) - 2. * u(1) - 1.;
-        v(2) = u(1) - 2. * u(0) - 1.;
-        v.segment<3>(3).setZero();
-        v.segment<4>(6) = u.segment<4>(2);
-        break;
-    case EllipsoidType::AlignedXYEqual:
-        v(0) = u(0) - 1.;
-        v(1) = u(0) - 1.;
-        v(2) = -2. * u(0) - 1.;
-        v.segment<3>(3).setZero();
-        v.segment<4>(6) = u.segment<4>(1);
-        break;
-    case EllipsoidType::AlignedXZEqual:
-        v(0) = u(0) - 1.;
-        v(1) = -2. * u(0) - 1.;
-        v(2) = u(0) - 1.;
-        v.segment<3>(3).setZero();
-        v.segment<4>(6) = u.segment<4>(1);
-        break;
+    // convert back to the conventional algebraic form
+    return coefficientsFromSolution(u, type);
+}
+
+Eigen::Matrix<double, 10, 1> momentsCoefficients(const Moments& moments,
+                                                 EllipsoidType type) {
+    const auto M = moments.matrix();
+    const auto B = monomialBasis(type);
+
+    // same normal equations as D^T D u = D^T d2 with D = m^T B, d2 = m^T s
+    Eigen::MatrixXd N;
+    Eigen::VectorXd rhs;
+    {
+        ELLIPSOID_TRACE_COUNT("fit.normal_equations", 0,
+                              sizeof(Moments::Matrix));
+        N = B.transpose() * M * B;
+        rhs = B.transpose() * M.leftCols<3>().rowwise().sum();
+    }
+    Eigen::VectorXd u;
+    {
+        ELLIPSOID_TRACE("fit.svd_solve");
+        u = N.bdcSvd(Eigen::ComputeFullU | Eigen::ComputeFullV).solve(rhs);
     }
 
-    // form the algebraic form of the ellipsoid
+    return coefficientsFromSolution(u, type);
+}
+
+Eigen::Vector3d centerFromCoefficients(const Eigen::Matrix<double, 10, 1>& v) {
+    ELLIPSOID_TRACE("fit.center_solve");
+    return solveCenter(v);
+}
+
+void axesFromCoefficients(const Eigen::Matrix<double, 10, 1>& v,
+                          const Eigen::Vector3d& center, Eigen::Vector3d& eval,
+                          Eigen::Matrix3d& evec_column) {
+    {
+        ELLIPSOID_TRACE("fit.eigensolver");
+        solveAxes(v, center, eval, evec_column);
+    }
+    // determine the configuration with the minimum angle of rotation from ref. frame
+    {
+        ELLIPSOID_TRACE("fit.least_rotation");
+        eigenOrder::leastRotationAngle(eval, evec_column);
+    }
+}
+
+Eigen::Matrix<double, 10, 1>
+translateCoefficients(const Eigen::Matrix<double, 10, 1>& v,
+                      const Eigen::Vector3d& origin) {
     Eigen::Matrix4d A;
     A << v(0), v(3), v(4), v(6), v(3), v(1), v(5), v(7), v(4), v(5), v(2), v(8),
         v(6), v(7), v(8), v(9);
 
-    // find the center of the ellipsoid
-    params.center = -A.block<3, 3>(0, 0)
-                         .bdcSvd(Eigen::ComputeFullU | Eigen::ComputeFullV)
-                         .solve(v.segment<3>(6));
-    // form the corresponding translation matrix
-    Eigen::Matrix4d T(Eigen::Matrix4d::Identity());
-    T.block<1, 3>(3, 0) = params.center.transpose();
-    // translate to the center
-    auto R = (T * A * T.transpose()).eval();
-    // solve the eigenproblem
-    Eigen::EigenSolver<Eigen::Matrix3d> solver(R.block<3, 3>(0, 0) / -R(3, 3));
-    Eigen::Vector3d eval = solver.eigenvalues().real();
-    Eigen::Matrix3d evec_column = solver.eigenvectors().real();
-    // determine the configuration with the minimum angle of rotation from ref. frame
-    eigenOrder::leastRotationAngle(eval, evec_column);
-    // compute the ellipsoid axes' radius
-    params.radii = eval.cwiseInverse().cwiseSqrt(); // output NaN for hyperboloid surface
+    // homogeneous transformation from the ref. frame to the origin
+    Eigen::Matrix4d S(Eigen::Matrix4d::Identity());
+    S.block<3, 1>(0, 3) = -origin;
+    A = (S.transpose() * A * S).eval();
+
+    Eigen::Matrix<double, 10, 1> translated;
+    translated << A(0, 0), A(1, 1), A(2, 2), A(0, 1), A(0, 2), A(1, 2), A(0, 3),
+        A(1, 3), A(2, 3), A(3, 3);
+    return translated;
+}
+
+} // namespace detail
+
+Parameters fit(const Moments& moments, EllipsoidType type) {
+    return fit(moments, nullptr, nullptr, nullptr, type);
+}
+
+Parameters fit(const Moments& moments,
+                Eigen::Matrix<double, 10, 1>* coefficients_p,
+                EllipsoidType type) {
+    return fit(moments, coefficients_p, nullptr, nullptr, type);
+}
+
+Parameters fit(const Moments& moments,
+                Eigen::Vector3d* eval_p, Eigen::Matrix3d* evec_column_p,
+                EllipsoidType type) {
+    return fit(moments, nullptr, eval_p, evec_column_p, type);
+}
+
+Parameters fit(const Moments& moments,
+                Eigen::Matrix<double, 10, 1>* coefficients_p,
+                Eigen::Vector3d* eval_p, Eigen::Matrix3d* evec_column_p,
+                EllipsoidType type) {
+    ELLIPSOID_TRACE_COUNT("fit", 0, sizeof(Moments::Matrix));
+    // the solution is relative to the moments' origin
+    auto v = detail::momentsCoefficients(moments, type);
+    auto params = fromCoefficients(v, eval_p, evec_column_p);
+    params.center += moments.origin();
 
     // get the coefficients of the algebraic form
     if (coefficients_p != nullptr) {
-        *coefficients_p = v;
+        *coefficients_p = detail::translateCoefficients(v, moments.origin());
     }
 
+    return params;
+}
+
+Parameters fromCoefficients(const Eigen::Matrix<double, 10, 1>& v,
+                            Eigen::Vector3d* eval_p,
+                            Eigen::Matrix3d* evec_column_p) {
+    Parameters params;
+
+    // find the center of the ellipsoid
+    params.center = detail::centerFromCoefficients(v);
+    Eigen::Vector3d eval;
+    Eigen::Matrix3d evec_column;
+    detail::axesFromCoefficients(v, params.center, eval, evec_column);
+    // compute the ellipsoid axes' radius
+    params.radii = eval.cwiseInverse().cwiseSqrt(); // output NaN for hyperboloid surface
+
     // get the arranged eigenvalues
     if (eval_p != nullptr) {
         *eval_p = eval;
@@ -206,11 +257,6 @@ Parameters fit(const Eigen::Matrix<double, Eigen::Dynamic, 3>& data,
         *evec_column_p = evec_column;
     }
 
-    // get the coefficients of the algebraic form
-    if (coefficients_p != nullptr) {
-        *coefficients_p = v;
-    }
-
     return params;
 }
 
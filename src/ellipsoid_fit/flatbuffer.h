@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ellipsoid {
+namespace detail {
+
+/*
+ * Minimal FlatBuffers serializer, enough to produce the metadata of the
+ * Arrow IPC format without depending on the flatbuffers library.
+ *
+ * Objects are described as a tree of FlatNode then serialized front to
+ * back: a table is written before its children so that all the offsets are
+ * positive, as required by the format.
+ */
+struct FlatNode;
+using FlatNodePtr = std::shared_ptr<FlatNode>;
+
+struct FlatNode {
+    enum class Kind {
+        Table,
+        TableVector,
+        StructVector,
+        String,
+    };
+
+    struct Field {
+        int id;
+        size_t size; // 0 for an offset to a child
+        uint64_t bits;
+        FlatNodePtr child;
+    };
+
+    explicit FlatNode(Kind node_kind) : kind(node_kind), element_size(0) {
+    }
+
+    static FlatNodePtr table() {
+        return std::make_shared<FlatNode>(Kind::Table);
+    }
+
+    static FlatNodePtr tables(std::vector<FlatNodePtr> elements) {
+        auto node = std::make_shared<FlatNode>(Kind::TableVector);
+        node->elements = std::move(elements);
+        return node;
+    }
+
+    // Vector of structs (or scalars) of the given size, aligned on it
+    static FlatNodePtr structs(const void* data, size_t count, size_t size) {
+        auto node = std::make_shared<FlatNode>(Kind::StructVector);
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        node->bytes.assign(bytes, bytes + count * size);
+        node->element_size = size;
+        return node;
+    }
+
+    static FlatNodePtr string(const std::string& value) {
+        auto node = std::make_shared<FlatNode>(Kind::String);
+        node->bytes.assign(value.begin(), value.end());
+        return node;
+    }
+
+    template <typename T>
+    FlatNode& add(int id, T value) {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(T));
+        fields.push_back(Field{id, sizeof(T), bits, nullptr});
+        return *this;
+    }
+
+    FlatNode& add(int id, FlatNodePtr child) {
+        fields.push_back(Field{id, 0, 0, std::move(child)});
+        return *this;
+    }
+
+    Kind kind;
+    std::vector<Field> fields;
+    std::vector<FlatNodePtr> elements;
+    std::vector<uint8_t> bytes;
+    size_t element_size;
+};
+
+class FlatBuilder {
+public:
+    // Serialize a buffer whose root is the given table, padded to 8 bytes
+    static std::vector<uint8_t> finish(const FlatNode& root) {
+        FlatBuilder builder;
+        builder.reserve(4, 4);
+        const auto position = builder.write(root);
+        builder.patch(0, position);
+        builder.align(8);
+        return std::move(builder.buffer_);
+    }
+
+private:
+    void align(size_t alignment) {
+        buffer_.resize((buffer_.size() + alignment - 1) / alignment *
+                       alignment);
+    }
+
+    size_t reserve(size_t size, size_t alignment) {
+        align(alignment);
+        const auto position = buffer_.size();
+        buffer_.resize(position + size);
+        return position;
+    }
+
+    template <typename T>
+    void put(size_t position, T value) {
+        std::memcpy(buffer_.data() + position, &value, sizeof(T));
+    }
+
+    // Store at position the offset to target
+    void patch(size_t position, size_t target) {
+        put(position, static_cast<uint32_t>(target - position));
+    }
+
+    size_t write(const FlatNode& node) {
+        switch (node.kind) {
+        case FlatNode::Kind::Table:
+            return writeTable(node);
+        case FlatNode::Kind::TableVector:
+            return writeTables(node);
+        case FlatNode::Kind::StructVector:
+            return writeStructs(node);
+        case FlatNode::Kind::String:
+            return writeString(node);
+        }
+        return 0;
+    }
+
+    size_t writeTable(const FlatNode& node) {
+        // inline layout: the largest fields first to limit the padding
+        std::vector<const FlatNode::Field*> fields;
+        int slots = 0;
+        for (const auto& field : node.fields) {
+            fields.push_back(&field);
+            slots = std::max(slots, field.id + 1);
+        }
+        std::stable_sort(fields.begin(), fields.end(),
+                         [](const FlatNode::Field* a, const FlatNode::Field* b) {
+                             return inlineSize(*a) > inlineSize(*b);
+                         });
+        std::vector<size_t> offsets;
+        size_t size = 4; // offset to the vtable
+        for (const auto* field : fields) {
+            const auto field_size = inlineSize(*field);
+            size = (size + field_size - 1) / field_size * field_size;
+            offsets.push_back(size);
+            size += field_size;
+        }
+
+        const auto vtable = reserve(4 + 2 * static_cast<size_t>(slots), 2);
+        const auto table = reserve(size, 8);
+        put(vtable, static_cast<uint16_t>(4 + 2 * slots));
+        put(vtable + 2, static_cast<uint16_t>(size));
+        put(table, static_cast<int32_t>(table - vtable));
+        for (size_t i = 0; i < fields.size(); ++i) {
+            put(vtable + 4 + 2 * static_cast<size_t>(fields[i]->id),
+                static_cast<uint16_t>(offsets[i]));
+            if (fields[i]->child == nullptr) {
+                std::memcpy(buffer_.data() + table + offsets[i],
+                            &fields[i]->bits, fields[i]->size);
+            }
+        }
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (fields[i]->child != nullptr) {
+                patch(table + offsets[i], write(*fields[i]->child));
+            }
+        }
+        return table;
+    }
+
+    size_t writeTables(const FlatNode& node) {
+        const auto vector = reserve(4 + 4 * node.elements.size(), 4);
+        put(vector, static_cast<uint32_t>(node.elements.size()));
+        for (size_t i = 0; i < node.elements.size(); ++i) {
+            patch(vector + 4 + 4 * i, write(*node.elements[i]));
+        }
+        return vector;
+    }
+
+    size_t writeStructs(const FlatNode& node) {
+        // the elements, following the length, must be aligned
+        const auto alignment =
+            std::min<size_t>(std::max<size_t>(node.element_size, 4), 8);
+        while ((buffer_.size() + 4) % alignment != 0) {
+            buffer_.push_back(0);
+        }
+        const auto vector = reserve(4 + node.bytes.size(), 4);
+        put(vector, static_cast<uint32_t>(node.element_size > 0
+                                              ? node.bytes.size() /
+                                                    node.element_size
+                                              : 0));
+        std::copy(node.bytes.begin(), node.bytes.end(),
+                  buffer_.begin() + static_cast<std::ptrdiff_t>(vector + 4));
+        return vector;
+    }
+
+    size_t writeString(const FlatNode& node) {
+        const auto string = reserve(4 + node.bytes.size() + 1, 4);
+        put(string, static_cast<uint32_t>(node.bytes.size()));
+        std::copy(node.bytes.begin(), node.bytes.end(),
+                  buffer_.begin() + static_cast<std::ptrdiff_t>(string + 4));
+        return string;
+    }
+
+    static size_t inlineSize(const FlatNode::Field& field) {
+        return field.child != nullptr ? 4 : field.size;
+    }
+
+    std::vector<uint8_t> buffer_;
+};
+
+} // namespace detail
+} // namespace ellipsoid
@@ -0,0 +1,103 @@
+#include <ellipsoid/joint.h>
+#include <ellipsoid/executor.h>
+
+#include <cmath>
+#include <stdexcept>
+
+namespace ellipsoid {
+
+Eigen::Vector3d JointCalibration::apply(size_t sensor,
+                                        const Eigen::Vector3d& raw) const {
+    const auto& calibration = sensors.at(sensor);
+    return calibration.rotation * calibration.soft_iron *
+           (raw - calibration.parameters.center);
+}
+
+JointCalibration fitJoint(
+    const std::vector<Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    EllipsoidType type, size_t reference) {
+    if (reference >= data.size()) {
+        throw std::out_of_range(
+            "ellipsoid::fitJoint: invalid reference sensor index");
+    }
+
+    const auto sensor_count = data.size();
+
+    JointCalibration calibration;
+    calibration.sensors.resize(sensor_count);
+
+    // each sensor is an independent block of the normal equations
+    defaultExecutor()->parallelFor(sensor_count, [&](size_t i) {
+        Moments moments;
+        moments.add(data[i]);
+
+        auto& sensor = calibration.sensors[i];
+        Eigen::Vector3d eval;
+        Eigen::Matrix3d evec_column;
+        sensor.parameters = fit(moments, &eval, &evec_column, type);
+        // symmetric square root of the quadratic form, mapping the ellipsoid
+        // onto the unit sphere without rotating the sensor's frame
+        sensor.soft_iron = evec_column * eval.cwiseSqrt().asDiagonal() *
+                           evec_column.transpose();
+        sensor.rotation.setIdentity();
+    });
+
+    // shared field magnitude: sample weighted mean of each sensor's radius
+    // of the sphere of equal volume
+    double magnitude_sum = 0.;
+    size_t samples = 0;
+    for (size_t i = 0; i < sensor_count; ++i) {
+        magnitude_sum +=
+            static_cast<double>(data[i].rows()) *
+            std::cbrt(calibration.sensors[i].parameters.radii.prod());
+        samples += static_cast<size_t>(data[i].rows());
+    }
+    calibration.field_magnitude = magnitude_sum / static_cast<double>(samples);
+
+    for (auto& sensor : calibration.sensors) {
+        sensor.soft_iron *= calibration.field_magnitude;
+    }
+
+    // relative rotations can only be found with synchronized samples
+    calibration.rotations_estimated = true;
+    for (const auto& sensor_data : data) {
+        if (sensor_data.rows() != data[reference].rows()) {
+            calibration.rotations_estimated = false;
+        }
+    }
+    if (not calibration.rotations_estimated) {
+        return calibration;
+    }
+
+    const auto& ref = calibration.sensors[reference];
+    const Eigen::Matrix<double, 3, Eigen::Dynamic> ref_calibrated =
+        ref.soft_iron *
+        (data[reference].rowwise() - ref.parameters.center.transpose())
+            .transpose();
+
+    defaultExecutor()->parallelFor(sensor_count, [&](size_t i) {
+        if (i == reference) {
+            return;
+        }
+        auto& sensor = calibration.sensors[i];
+        const Eigen::Matrix<double, 3, Eigen::Dynamic> calibrated =
+            sensor.soft_iron *
+            (data[i].rowwise() - sensor.parameters.center.transpose())
+                .transpose();
+
+        // orthogonal Procrustes problem: R = argmin sum |R a_k - b_k|^2
+        const Eigen::Matrix3d H = calibrated * ref_calibrated.transpose();
+        Eigen::JacobiSVD<Eigen::Matrix3d> svd(H, Eigen::ComputeFullU |
+                                                     Eigen::ComputeFullV);
+        Eigen::Vector3d d(1., 1., 1.);
+        d(2) = (svd.matrixV() * svd.matrixU().transpose()).determinant() < 0.
+                   ? -1.
+                   : 1.;
+        sensor.rotation =
+            svd.matrixV() * d.asDiagonal() * svd.matrixU().transpose();
+    });
+
+    return calibration;
+}
+
+} // namespace ellipsoid
@@ -0,0 +1,124 @@
+#include <ellipsoid/executor.h>
+#include <ellipsoid/lazy.h>
+
+#include "basis.h"
+#include "tracing.h"
+
+namespace ellipsoid {
+
+namespace {
+
+// Value of the algebraic form at a point
+double evaluateForm(const Eigen::Matrix<double, 10, 1>& v,
+                    const Eigen::Vector3d& p) {
+    return v(0) * p.x() * p.x() + v(1) * p.y() * p.y() + v(2) * p.z() * p.z() +
+           2. * (v(3) * p.x() * p.y() + v(4) * p.x() * p.z() +
+                 v(5) * p.y() * p.z() + v(6) * p.x() + v(7) * p.y() +
+                 v(8) * p.z()) +
+           v(9);
+}
+
+} // namespace
+
+LazyFit::LazyFit()
+    : local_(Eigen::Matrix<double, 10, 1>::Zero()),
+      origin_(Eigen::Vector3d::Zero()),
+      computed_(0) {
+}
+
+LazyFit::LazyFit(const Eigen::Matrix<double, 10, 1>& coefficients,
+                 const Eigen::Vector3d& origin)
+    : local_(coefficients), origin_(origin), computed_(0) {
+}
+
+bool LazyFit::computed(Computed part) const {
+    return (computed_ & part) != 0;
+}
+
+const Eigen::Matrix<double, 10, 1>& LazyFit::coefficients() const {
+    if (not computed(Coefficients)) {
+        coefficients_ = origin_.isZero(0.)
+                            ? local_
+                            : detail::translateCoefficients(local_, origin_);
+        computed_ |= Coefficients;
+    }
+    return coefficients_;
+}
+
+double LazyFit::evaluate(const Eigen::Vector3d& point) const {
+    return evaluateForm(local_, point - origin_);
+}
+
+bool LazyFit::contains(const Eigen::Vector3d& point) const {
+    // the quadratic part is definite, its sign tells which side is inside
+    const auto value = evaluate(point);
+    return local_(0) + local_(1) + local_(2) > 0. ? value < 0. : value > 0.;
+}
+
+const Eigen::Vector3d& LazyFit::center() const {
+    if (not computed(Center)) {
+        center_ = detail::centerFromCoefficients(local_) + origin_;
+        computed_ |= Center;
+    }
+    return center_;
+}
+
+const Eigen::Vector3d& LazyFit::eigenvalues() const {
+    if (not computed(Axes)) {
+        // the axes do not depend on the origin
+        detail::axesFromCoefficients(local_, center() - origin_, eval_,
+                                     evec_column_);
+        computed_ |= Axes;
+    }
+    return eval_;
+}
+
+const Eigen::Matrix3d& LazyFit::eigenvectors() const {
+    eigenvalues();
+    return evec_column_;
+}
+
+Eigen::Vector3d LazyFit::radii() const {
+    return eigenvalues().cwiseInverse().cwiseSqrt();
+}
+
+Parameters LazyFit::parameters() const {
+    Parameters params;
+    params.center = center();
+    params.radii = radii();
+    return params;
+}
+
+FitResult LazyFit::result() const {
+    FitResult result;
+    result.parameters = parameters();
+    result.coefficients = coefficients();
+    result.eval = eigenvalues();
+    result.evec_column = eigenvectors();
+    return result;
+}
+
+LazyFit fitLazy(const Eigen::Matrix<double, Eigen::Dynamic, 3>& data,
+                EllipsoidType type) {
+    ELLIPSOID_TRACE_COUNT("fit", static_cast<uint64_t>(data.rows()),
+                          static_cast<uint64_t>(data.size()) * sizeof(double));
+    return LazyFit(detail::pointsCoefficients(data, type));
+}
+
+LazyFit fitLazy(const Moments& moments, EllipsoidType type) {
+    ELLIPSOID_TRACE_COUNT("fit", 0, sizeof(Moments::Matrix));
+    return LazyFit(detail::momentsCoefficients(moments, type),
+                   moments.origin());
+}
+
+LazyFits
+fitLazy(const std::vector<Moments, Eigen::aligned_allocator<Moments>>& problems,
+        EllipsoidType type) {
+    LazyFits results(problems.size());
+    defaultExecutor()->parallelFor(problems.size(), [&](size_t i) {
+        results[i] = fitLazy(problems[i], type);
+    });
+    return results;
+}
+
+} // namespace ellipsoid
@@ -0,0 +1,105 @@
+#include <ellipsoid/mesh.h>
+#include <ellipsoid/executor.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace ellipsoid {
+
+namespace {
+
+// Number of triangles integrated at once
+constexpr Eigen::Index triangles_per_chunk = 64;
+
+// Minimum number of triangles processed by a single thread
+constexpr Eigen::Index min_triangles_per_band = 4096;
+
+// Dunavant's 6 points quadrature rule, exact for polynomials of degree 4
+constexpr int quadrature_points = 6;
+constexpr double quadrature[quadrature_points][4] = {
+    // barycentric coordinates, weight
+    {0.108103018168070, 0.445948490915965, 0.445948490915965,
+     0.223381589678011},
+    {0.445948490915965, 0.108103018168070, 0.445948490915965,
+     0.223381589678011},
+    {0.445948490915965, 0.445948490915965, 0.108103018168070,
+     0.223381589678011},
+    {0.816847572980459, 0.091576213509771, 0.091576213509771,
+     0.109951743655322},
+    {0.091576213509771, 0.816847572980459, 0.091576213509771,
+     0.109951743655322},
+    {0.091576213509771, 0.091576213509771, 0.816847572980459,
+     0.109951743655322},
+};
+
+void accumulateTriangles(
+    Moments& moments, const Eigen::Matrix<double, Eigen::Dynamic, 3>& vertices,
+    const Eigen::Matrix<int, Eigen::Dynamic, 3>& triangles, Eigen::Index first,
+    Eigen::Index last) {
+    Eigen::Matrix<double, quadrature_points * triangles_per_chunk, 3> points;
+    Eigen::Matrix<double, quadrature_points * triangles_per_chunk, 1> weights;
+
+    for (Eigen::Index start = first; start < last;
+         start += triangles_per_chunk) {
+        const auto n = std::min(triangles_per_chunk, last - start);
+        for (Eigen::Index t = 0; t < n; ++t) {
+            const auto& triangle = triangles.row(start + t);
+            const Eigen::RowVector3d a = vertices.row(triangle(0));
+            const Eigen::RowVector3d b = vertices.row(triangle(1));
+            const Eigen::RowVector3d c = vertices.row(triangle(2));
+            const double area = 0.5 * (b - a).cross(c - a).norm();
+
+            for (int q = 0; q < quadrature_points; ++q) {
+                const auto row = quadrature_points * t + q;
+                points.row(row) = quadrature[q][0] * a + quadrature[q][1] * b +
+                                  quadrature[q][2] * c;
+                weights(row) = area * quadrature[q][3];
+            }
+        }
+        moments.add(points.topRows(quadrature_points * n),
+                    weights.head(quadrature_points * n));
+    }
+}
+
+} // namespace
+
+void accumulate(Moments& moments,
+                const Eigen::Matrix<double, Eigen::Dynamic, 3>& vertices,
+                const Eigen::Matrix<int, Eigen::Dynamic, 3>& triangles) {
+    const Eigen::Index count = triangles.rows();
+    const auto bands = static_cast<size_t>(std::max<Eigen::Index>(
+        1, std::min<Eigen::Index>(defaultExecutor()->concurrency(),
+                                  count / min_triangles_per_band)));
+    if (bands == 1) {
+        accumulateTriangles(moments, vertices, triangles, 0, count);
+        return;
+    }
+
+    std::vector<Moments, Eigen::aligned_allocator<Moments>> band_moments(
+        bands);
+    const Eigen::Index per_band =
+        (count + static_cast<Eigen::Index>(bands) - 1) /
+        static_cast<Eigen::Index>(bands);
+    defaultExecutor()->parallelFor(bands, [&](size_t band) {
+        const Eigen::Index first = static_cast<Eigen::Index>(band) * per_band;
+        const Eigen::Index last = std::min(first + per_band, count);
+        if (first < last) {
+            accumulateTriangles(band_moments[band], vertices, triangles, first,
+                                last);
+        }
+    });
+
+    for (const auto& partial : band_moments) {
+        moments.merge(partial);
+    }
+}
+
+Parameters fit(const Eigen::Matrix<double, Eigen::Dynamic, 3>& vertices,
+               const Eigen::Matrix<int, Eigen::Dynamic, 3>& triangles,
+               EllipsoidType type) {
+    Moments moments;
+    accumulate(moments, vertices, triangles);
+    return fit(moments, type);
+}
+
+} // namespace ellipsoid
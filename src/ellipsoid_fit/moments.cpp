@@ -0,0 +1,314 @@
+#include <ellipsoid/executor.h>
+#include <ellipsoid/moments.h>
+
+#include "tracing.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace ellipsoid {
+
+namespace {
+
+// Number of points converted to monomials at once
+constexpr Eigen::Index chunk_size = 128;
+
+// Number of points processed together by the power sums kernel
+constexpr Eigen::Index lanes = 8;
+
+// Number of monomials x^a y^b z^c with a + b + c <= 4
+constexpr int power_sum_count = 35;
+
+using Chunk = Eigen::Array<double, chunk_size, 1>;
+using Lanes = Eigen::Array<double, lanes, 1>;
+using PowerSums = Eigen::Array<double, lanes, power_sum_count>;
+
+/*
+ * Every entry of m * m^T is, up to a constant factor, a monomial of degree 4
+ * at most. Summing these 35 monomials instead of the 55 distinct entries of
+ * the moment matrix saves work and vectorizes across points, each lane of
+ * the accumulators handling its own subset of the points.
+ */
+void accumulatePowerSums(PowerSums& sums, const Chunk& x, const Chunk& y,
+                         const Chunk& z, const Chunk& w, Eigen::Index count) {
+    for (Eigen::Index start = 0; start < count; start += lanes) {
+        Lanes xp[5], yp[5], zp[5];
+        xp[0] = w.segment<lanes>(start);
+        yp[0].setOnes();
+        zp[0].setOnes();
+        xp[1] = x.segment<lanes>(start) * xp[0];
+        yp[1] = y.segment<lanes>(start);
+        zp[1] = z.segment<lanes>(start);
+        for (int k = 2; k < 5; ++k) {
+            xp[k] = xp[k - 1] * x.segment<lanes>(start);
+            yp[k] = yp[k - 1] * yp[1];
+            zp[k] = zp[k - 1] * zp[1];
+        }
+
+        int idx = 0;
+        for (int a = 0; a < 5; ++a) {
+            for (int b = 0; a + b < 5; ++b) {
+                const Lanes xy = xp[a] * yp[b];
+                for (int c = 0; a + b + c < 5; ++c) {
+                    sums.col(idx++) += xy * zp[c];
+                }
+            }
+        }
+    }
+}
+
+// Index of the sum of x^a y^b z^c in PowerSums
+int powerSumIndex(int a, int b, int c) {
+    int idx = 0;
+    for (int i = 0; i < 5; ++i) {
+        for (int j = 0; i + j < 5; ++j) {
+            for (int k = 0; i + j + k < 5; ++k) {
+                if (i == a and j == b and k == c) {
+                    return idx;
+                }
+                ++idx;
+            }
+        }
+    }
+    return -1;
+}
+
+// Scatter the power sums into the lower part of the moment matrix
+void addPowerSums(Moments::Matrix& lower, const PowerSums& sums) {
+    // exponents and factor of each monomial in m
+    static const int exponents[10][3] = {{2, 0, 0}, {0, 2, 0}, {0, 0, 2},
+                                         {1, 1, 0}, {1, 0, 1}, {0, 1, 1},
+                                         {1, 0, 0}, {0, 1, 0}, {0, 0, 1},
+                                         {0, 0, 0}};
+    static const double factors[10] = {1., 1., 1., 2., 2., 2., 2., 2., 2., 1.};
+    static const auto indices = [] {
+        Eigen::Matrix<int, 10, 10> idx;
+        for (int i = 0; i < 10; ++i) {
+            for (int j = 0; j <= i; ++j) {
+                idx(i, j) = powerSumIndex(exponents[i][0] + exponents[j][0],
+                                          exponents[i][1] + exponents[j][1],
+                                          exponents[i][2] + exponents[j][2]);
+            }
+        }
+        return idx;
+    }();
+
+    const Eigen::Matrix<double, power_sum_count, 1> totals =
+        sums.colwise().sum().transpose();
+    for (int i = 0; i < 10; ++i) {
+        for (int j = 0; j <= i; ++j) {
+            lower(i, j) += factors[i] * factors[j] * totals(indices(i, j));
+        }
+    }
+}
+
+} // namespace
+
+Moments::Moments() : origin_(Eigen::Vector3d::Zero()), has_origin_(false) {
+    reset();
+}
+
+Moments::Moments(const Eigen::Vector3d& origin)
+    : origin_(origin), has_origin_(true) {
+    reset();
+}
+
+void Moments::add(double x, double y, double z, double weight) {
+    if (not has_origin_) {
+        initOrigin(Eigen::Vector3d(x, y, z));
+    }
+    x -= origin_.x();
+    y -= origin_.y();
+    z -= origin_.z();
+
+    Eigen::Matrix<double, 10, 1> m;
+    m << x * x, y * y, z * z, 2. * x * y, 2. * x * z, 2. * y * z, 2. * x,
+        2. * y, 2. * z, 1.;
+    lower_.selfadjointView<Eigen::Lower>().rankUpdate(m, weight);
+    ++count_;
+}
+
+void Moments::add(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data) {
+    if (data.rows() == 0) {
+        return;
+    }
+    if (not has_origin_) {
+        initOrigin(data.topRows(std::min(chunk_size, data.rows()))
+                       .colwise()
+                       .mean()
+                       .transpose());
+    }
+    accumulate(data, nullptr, origin_);
+}
+
+void Moments::add(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    const Eigen::Ref<const Eigen::VectorXd>& weights) {
+    if (data.rows() == 0) {
+        return;
+    }
+    if (not has_origin_) {
+        initOrigin(data.topRows(std::min(chunk_size, data.rows()))
+                       .colwise()
+                       .mean()
+                       .transpose());
+    }
+    accumulate(data, weights.data(), origin_);
+}
+
+void Moments::addRelative(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data) {
+    if (not has_origin_) {
+        initOrigin(Eigen::Vector3d::Zero());
+    }
+    accumulate(data, nullptr, Eigen::Vector3d::Zero());
+}
+
+void Moments::merge(const Moments& other) {
+    if (not other.has_origin_) {
+        return;
+    }
+    if (not has_origin_) {
+        initOrigin(other.origin_);
+    }
+
+    if (other.origin_ == origin_) {
+        lower_ += other.lower_;
+    } else {
+        const auto L = translation(other.origin_ - origin_);
+        const Matrix translated = L * other.matrix() * L.transpose();
+        lower_ += translated.triangularView<Eigen::Lower>().toDenseMatrix();
+    }
+    count_ += other.count_;
+}
+
+Moments& Moments::operator+=(const Moments& other) {
+    merge(other);
+    return *this;
+}
+
+void Moments::reset() {
+    lower_.setZero();
+    count_ = 0;
+}
+
+Moments::Matrix Moments::matrix() const {
+    return lower_.selfadjointView<Eigen::Lower>();
+}
+
+const Eigen::Vector3d& Moments::origin() const {
+    return origin_;
+}
+
+void Moments::setOrigin(const Eigen::Vector3d& origin) {
+    if (has_origin_ and count_ > 0 and origin != origin_) {
+        const auto L = translation(origin_ - origin);
+        const Matrix translated = L * matrix() * L.transpose();
+        lower_ = translated.triangularView<Eigen::Lower>();
+    }
+    initOrigin(origin);
+}
+
+Moments::Matrix Moments::translation(const Eigen::Vector3d& offset) {
+    const double dx = offset.x();
+    const double dy = offset.y();
+    const double dz = offset.z();
+
+    // expand the monomials of (x + dx, y + dy, z + dz)
+    Matrix L(Matrix::Identity());
+    L(0, 6) = dx;
+    L(0, 9) = dx * dx;
+    L(1, 7) = dy;
+    L(1, 9) = dy * dy;
+    L(2, 8) = dz;
+    L(2, 9) = dz * dz;
+    L(3, 6) = dy;
+    L(3, 7) = dx;
+    L(3, 9) = 2. * dx * dy;
+    L(4, 6) = dz;
+    L(4, 8) = dx;
+    L(4, 9) = 2. * dx * dz;
+    L(5, 7) = dz;
+    L(5, 8) = dy;
+    L(5, 9) = 2. * dy * dz;
+    L(6, 9) = 2. * dx;
+    L(7, 9) = 2. * dy;
+    L(8, 9) = 2. * dz;
+    return L;
+}
+
+size_t Moments::count() const {
+    return count_;
+}
+
+void Moments::accumulate(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    const double* weights, const Eigen::Vector3d& shift) {
+    ELLIPSOID_TRACE_COUNT("moments.accumulate",
+                          static_cast<uint64_t>(data.rows()),
+                          static_cast<uint64_t>(data.rows()) *
+                              (weights != nullptr ? 4 : 3) * sizeof(double));
+    PowerSums sums;
+    sums.setZero();
+    Chunk x, y, z, w;
+    for (Eigen::Index start = 0; start < data.rows(); start += chunk_size) {
+        const auto n = std::min(chunk_size, data.rows() - start);
+        x.head(n) = data.col(0).segment(start, n).array() - shift.x();
+        y.head(n) = data.col(1).segment(start, n).array() - shift.y();
+        z.head(n) = data.col(2).segment(start, n).array() - shift.z();
+        if (weights != nullptr) {
+            w.head(n) = Eigen::Map<const Eigen::ArrayXd>(weights + start, n);
+        } else {
+            w.head(n).setOnes();
+        }
+        // padding points get a null weight
+        const auto padded = (n + lanes - 1) / lanes * lanes;
+        x.segment(n, padded - n).setZero();
+        y.segment(n, padded - n).setZero();
+        z.segment(n, padded - n).setZero();
+        w.segment(n, padded - n).setZero();
+
+        accumulatePowerSums(sums, x, y, z, w, padded);
+    }
+
+    addPowerSums(lower_, sums);
+    count_ += static_cast<size_t>(data.rows());
+}
+
+void Moments::initOrigin(const Eigen::Vector3d& origin) {
+    origin_ = origin;
+    has_origin_ = true;
+}
+
+Moments accumulateParallel(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    size_t chunk_rows) {
+    const auto rows = data.rows();
+    const auto chunk = static_cast<Eigen::Index>(std::max<size_t>(chunk_rows, 1));
+    const auto chunks = static_cast<size_t>((rows + chunk - 1) / chunk);
+
+    // a common origin avoids translating the partial sums when merging
+    Moments moments;
+    if (rows == 0) {
+        return moments;
+    }
+    moments.setOrigin(data.topRows(std::min(chunk_size, rows))
+                          .colwise()
+                          .mean()
+                          .transpose());
+
+    std::vector<Moments, Eigen::aligned_allocator<Moments>> partial(
+        chunks, Moments(moments.origin()));
+    defaultExecutor()->parallelFor(chunks, [&](size_t i) {
+        const auto start = static_cast<Eigen::Index>(i) * chunk;
+        partial[i].add(data.middleRows(start, std::min(chunk, rows - start)));
+    });
+
+    for (const auto& part : partial) {
+        moments.merge(part);
+    }
+    return moments;
+}
+
+} // namespace ellipsoid
@@ -0,0 +1,260 @@
+#include <ellipsoid/numa.h>
+
+#include <dirent.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+
+namespace ellipsoid {
+
+namespace {
+
+constexpr size_t huge_page_size = size_t(2) << 20;
+
+// Parse a sysfs CPU list, e.g "0-3,8-11"
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() or range == "\n") {
+            continue;
+        }
+        const auto dash = range.find('-');
+        const int first = std::atoi(range.c_str());
+        const int last =
+            dash == std::string::npos ? first
+                                      : std::atoi(range.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<int> usableCpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+} // namespace
+
+std::vector<NumaNode> numaTopology() {
+    const auto usable = usableCpus();
+    std::vector<NumaNode> nodes;
+
+    if (auto* dir = ::opendir("/sys/devices/system/node")) {
+        while (auto* entry = ::readdir(dir)) {
+            if (std::strncmp(entry->d_name, "node", 4) != 0 or
+                entry->d_name[4] < '0' or entry->d_name[4] > '9') {
+                continue;
+            }
+            std::ifstream file(std::string("/sys/devices/system/node/") +
+                               entry->d_name + "/cpulist");
+            std::string list;
+            std::getline(file, list);
+
+            NumaNode node;
+            node.id = std::atoi(entry->d_name + 4);
+            for (auto cpu : parseCpuList(list)) {
+                if (std::find(usable.begin(), usable.end(), cpu) !=
+                    usable.end()) {
+                    node.cpus.push_back(cpu);
+                }
+            }
+            // memory only nodes are of no use to place threads
+            if (not node.cpus.empty()) {
+                nodes.push_back(node);
+            }
+        }
+        ::closedir(dir);
+    }
+
+    std::sort(nodes.begin(), nodes.end(),
+              [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+    if (nodes.empty()) {
+        nodes.push_back(NumaNode{0, usable});
+    }
+    return nodes;
+}
+
+NumaExecutor::NumaExecutor(const std::vector<NumaNode>& nodes,
+                           size_t threads_per_node)
+    : concurrency_(0), next_pool_(0) {
+    for (const auto& node : nodes) {
+        const auto threads =
+            threads_per_node > 0
+                ? threads_per_node
+                : std::max<size_t>(node.cpus.size(), 1);
+        pools_.emplace_back(new WorkStealingExecutor(threads, node.cpus));
+        concurrency_ += threads;
+    }
+    if (pools_.empty()) {
+        pools_.emplace_back(new WorkStealingExecutor);
+        concurrency_ = pools_.front()->concurrency();
+    }
+}
+
+void NumaExecutor::submit(std::function<void()> task) {
+    const auto pool = next_pool_.fetch_add(1, std::memory_order_relaxed);
+    pools_[pool % pools_.size()]->submit(std::move(task));
+}
+
+size_t NumaExecutor::concurrency() const {
+    return concurrency_;
+}
+
+void NumaExecutor::parallelFor(size_t count,
+                               const std::function<void(size_t)>& body,
+                               size_t max_tasks) {
+    // nested loops stay on the node of the calling thread
+    for (auto& pool : pools_) {
+        if (pool->isWorker()) {
+            pool->parallelFor(count, body, max_tasks);
+            return;
+        }
+    }
+    if (pools_.size() == 1 or
+        (max_tasks > 0 and max_tasks < pools_.size())) {
+        pools_.front()->parallelFor(count, body, max_tasks);
+        return;
+    }
+
+    // contiguous ranges, proportional to the threads of each node
+    std::vector<size_t> bounds(pools_.size() + 1, 0);
+    size_t threads = 0;
+    for (size_t i = 0; i < pools_.size(); ++i) {
+        threads += pools_[i]->concurrency();
+        bounds[i + 1] = count * threads / concurrency_;
+    }
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t remaining = pools_.size();
+    std::exception_ptr error;
+    for (size_t i = 0; i < pools_.size(); ++i) {
+        const auto first = bounds[i];
+        const auto last = bounds[i + 1];
+        auto* pool = pools_[i].get();
+        const auto node_tasks =
+            max_tasks > 0 ? std::max<size_t>(1, max_tasks * pool->concurrency() /
+                                                    concurrency_)
+                          : 0;
+        // the calling thread is not a pool thread so it can wait for the
+        // node tasks without risking a deadlock
+        pool->submit([&, first, last, pool, node_tasks] {
+            std::exception_ptr node_error;
+            try {
+                pool->parallelFor(
+                    last - first, [&](size_t j) { body(first + j); },
+                    node_tasks);
+            } catch (...) {
+                node_error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (node_error and not error) {
+                error = node_error;
+            }
+            if (--remaining == 0) {
+                finished.notify_all();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return remaining == 0; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+size_t NumaExecutor::nodes() const {
+    return pools_.size();
+}
+
+PointBuffer::PointBuffer(size_t rows, const BufferOptions& options)
+    : mapping_(MAP_FAILED), rows_(rows), explicit_huge_pages_(false) {
+    const auto chunk_rows = std::max<size_t>(options.chunk_rows, 1);
+    const auto chunks = (rows + chunk_rows - 1) / chunk_rows;
+    stride_ = std::max<size_t>(chunks, 1) * chunk_rows;
+    const auto size = 3 * stride_ * sizeof(double);
+
+    if (options.huge_pages == HugePages::Explicit) {
+        mapping_size_ = (size + huge_page_size - 1) / huge_page_size *
+                        huge_page_size;
+        mapping_ = ::mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        explicit_huge_pages_ = mapping_ != MAP_FAILED;
+        data_ = static_cast<double*>(mapping_);
+    }
+    if (mapping_ == MAP_FAILED) {
+        // over allocate to align the data on a huge page boundary
+        mapping_size_ = size + huge_page_size;
+        mapping_ = ::mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapping_ == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        const auto address = reinterpret_cast<uintptr_t>(mapping_);
+        data_ = reinterpret_cast<double*>(
+            (address + huge_page_size - 1) / huge_page_size * huge_page_size);
+        if (options.huge_pages != HugePages::None) {
+            ::madvise(data_, size, MADV_HUGEPAGE);
+        }
+    }
+
+    // first touch, by the threads processing each chunk later on
+    auto* data = data_;
+    const auto stride = stride_;
+    defaultExecutor()->parallelFor(chunks, [=](size_t chunk) {
+        for (size_t c = 0; c < 3; ++c) {
+            std::memset(data + c * stride + chunk * chunk_rows, 0,
+                        chunk_rows * sizeof(double));
+        }
+    });
+}
+
+PointBuffer::~PointBuffer() {
+    ::munmap(mapping_, mapping_size_);
+}
+
+PointBuffer::Points PointBuffer::points() {
+    return Points(data_, static_cast<Eigen::Index>(rows_), 3,
+                  Eigen::OuterStride<>(static_cast<Eigen::Index>(stride_)));
+}
+
+PointBuffer::ConstPoints PointBuffer::points() const {
+    return ConstPoints(
+        data_, static_cast<Eigen::Index>(rows_), 3,
+        Eigen::OuterStride<>(static_cast<Eigen::Index>(stride_)));
+}
+
+size_t PointBuffer::rows() const {
+    return rows_;
+}
+
+bool PointBuffer::explicitHugePages() const {
+    return explicit_huge_pages_;
+}
+
+} // namespace ellipsoid
@@ -0,0 +1,60 @@
+#include <ellipsoid/online.h>
+
+#include "tracing.h"
+
+namespace ellipsoid {
+
+OnlineFitter::OnlineFitter(EllipsoidType type, size_t min_samples)
+    : type_(type), min_samples_(min_samples), fits_(0), fitted_count_(0) {
+}
+
+bool OnlineFitter::update(RingReader& reader) {
+    reader.read(moments_);
+    return solve();
+}
+
+bool OnlineFitter::update(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>&
+        samples) {
+    moments_.add(samples);
+    return solve();
+}
+
+const FitResult& OnlineFitter::result() const {
+    return result_;
+}
+
+bool OnlineFitter::ready() const {
+    return fits_ > 0;
+}
+
+size_t OnlineFitter::fits() const {
+    return fits_;
+}
+
+const Moments& OnlineFitter::moments() const {
+    return moments_;
+}
+
+void OnlineFitter::reset() {
+    moments_ = Moments();
+    fits_ = 0;
+    fitted_count_ = 0;
+}
+
+bool OnlineFitter::solve() {
+    const auto count = moments_.count();
+    if (count < min_samples_ or count == fitted_count_) {
+        return false;
+    }
+    ELLIPSOID_TRACE_COUNT("online.solve", count - fitted_count_,
+                          sizeof(Moments::Matrix));
+    result_.parameters =
+        fit(moments_, &result_.coefficients, &result_.eval,
+            &result_.evec_column, type_);
+    fitted_count_ = count;
+    ++fits_;
+    return true;
+}
+
+} // namespace ellipsoid
@@ -0,0 +1,583 @@
+#include <ellipsoid/executor.h>
+#include <ellipsoid/overlap.h>
+
+#include "tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace ellipsoid {
+
+namespace {
+
+// One pair per lane, as many lanes as the widest SIMD registers Eigen
+// targets can hold, with at least 4 for instruction level parallelism
+constexpr int lanes = EIGEN_MAX_STATIC_ALIGN_BYTES >= 64 ? 8 : 4;
+
+using Lane = Eigen::Array<double, lanes, 1>;
+using LaneMask = Eigen::Array<bool, lanes, 1>;
+
+constexpr int contact_iterations = 32;
+constexpr int projection_iterations = 1000;
+constexpr int newton_iterations = 100;
+
+// Ellipsoids per bounding volume hierarchy leaf
+constexpr size_t leaf_size = 4;
+
+// Ellipsoids whose pairs are enumerated by an executor task
+constexpr size_t ellipsoids_per_task = 256;
+
+// Inverse matrix R diag(r^2) R^T of an ellipsoid, symmetric so only stored
+// as xx, yy, zz, xy, xz, yz
+using Shape = Eigen::Matrix<double, 6, 1>;
+
+Shape shapeOf(const Ellipsoid& ellipsoid) {
+    const Eigen::Matrix3d m = ellipsoid.axes *
+                              ellipsoid.radii.cwiseAbs2().asDiagonal() *
+                              ellipsoid.axes.transpose();
+    Shape shape;
+    shape << m(0, 0), m(1, 1), m(2, 2), m(0, 1), m(0, 2), m(1, 2);
+    return shape;
+}
+
+// Smallest axis aligned box containing the ellipsoid
+Eigen::AlignedBox3d boxOf(const Ellipsoid& ellipsoid, const Shape& shape) {
+    const Eigen::Vector3d extent = shape.head<3>().cwiseSqrt();
+    return Eigen::AlignedBox3d(ellipsoid.center - extent,
+                               ellipsoid.center + extent);
+}
+
+// Inverse of symmetric 3x3 matrices stored as in Shape
+void invert(const Lane m[6], Lane inverse[6]) {
+    const Lane c00 = m[1] * m[2] - m[5].square();
+    const Lane c11 = m[0] * m[2] - m[4].square();
+    const Lane c22 = m[0] * m[1] - m[3].square();
+    const Lane c01 = m[4] * m[5] - m[3] * m[2];
+    const Lane c02 = m[3] * m[5] - m[4] * m[1];
+    const Lane c12 = m[3] * m[4] - m[0] * m[5];
+    const Lane inverse_det = (m[0] * c00 + m[3] * c01 + m[4] * c02).inverse();
+    inverse[0] = c00 * inverse_det;
+    inverse[1] = c11 * inverse_det;
+    inverse[2] = c22 * inverse_det;
+    inverse[3] = c01 * inverse_det;
+    inverse[4] = c02 * inverse_det;
+    inverse[5] = c12 * inverse_det;
+}
+
+// r = m v, m symmetric stored as in Shape
+void multiply(const Lane m[6], const Lane v[3], Lane r[3]) {
+    r[0] = m[0] * v[0] + m[3] * v[1] + m[4] * v[2];
+    r[1] = m[3] * v[0] + m[1] * v[1] + m[5] * v[2];
+    r[2] = m[4] * v[0] + m[5] * v[1] + m[2] * v[2];
+}
+
+Lane dot(const Lane a[3], const Lane b[3]) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Maximum over [0, 1] of the contact function of each lane,
+// F(l) = l (1 - l) d^T G(l)^-1 d with G(l) = (1 - l) p + l q. It is concave
+// so the root of its derivative is bracketed and refined by Newton steps,
+// bisecting when a step leaves the bracket. The lanes already above 1 are
+// known to be separated and don't need to converge.
+Lane contactFunction(const Lane p[6], const Lane q[6], const Lane d[3]) {
+    Lane difference[6];
+    for (int k = 0; k < 6; ++k) {
+        difference[k] = q[k] - p[k];
+    }
+
+    Lane lower = Lane::Zero();
+    Lane upper = Lane::Ones();
+    Lane lambda = Lane::Constant(0.5);
+    Lane maximum = Lane::Zero();
+    for (int iteration = 0; iteration < contact_iterations; ++iteration) {
+        Lane g[6];
+        for (int k = 0; k < 6; ++k) {
+            g[k] = p[k] + lambda * difference[k];
+        }
+        Lane g_inverse[6];
+        invert(g, g_inverse);
+
+        // w = G^-1 d, z = (q - p) w and u = G^-1 z give the derivatives:
+        // (d^T w)' = -w^T z and (w^T z)' = -2 z^T u
+        Lane w[3];
+        Lane z[3];
+        Lane u[3];
+        multiply(g_inverse, d, w);
+        multiply(difference, w, z);
+        multiply(g_inverse, z, u);
+        const Lane dw = dot(d, w);
+        const Lane wz = dot(w, z);
+        const Lane zu = dot(z, u);
+
+        const Lane weight = lambda * (1. - lambda);
+        const Lane slope = 1. - 2. * lambda;
+        const Lane f = weight * dw;
+        const Lane df = slope * dw - weight * wz;
+        const Lane d2f = -2. * dw - 2. * slope * wz + 2. * weight * zu;
+        maximum = maximum.max(f);
+
+        lower = (df >= 0.).select(lambda, lower);
+        upper = (df < 0.).select(lambda, upper);
+        const Lane newton = lambda - df / d2f;
+        const Lane next = (newton > lower && newton < upper)
+                              .select(newton, 0.5 * (lower + upper));
+        const bool done =
+            ((next - lambda).abs() <= 1e-12 || maximum > 1.).all();
+        lambda = next;
+        if (done) {
+            break;
+        }
+    }
+    return maximum;
+}
+
+// Overlap tests of count pairs, `lanes` at a time. pair(k, p, q, d) gives
+// the shapes of the pair k and the difference of their centers.
+template <typename Pair>
+std::vector<uint8_t> overlapTests(size_t count, Pair pair) {
+    std::vector<uint8_t> overlapping(count);
+    Shape p;
+    Shape q;
+    Eigen::Vector3d d;
+    for (size_t first = 0; first < count; first += lanes) {
+        const auto group_size =
+            static_cast<int>(std::min<size_t>(lanes, count - first));
+        Lane p_lanes[6];
+        Lane q_lanes[6];
+        Lane d_lanes[3];
+        // padding lanes repeat the last pair of the group
+        for (int l = 0; l < lanes; ++l) {
+            pair(first + static_cast<size_t>(std::min(l, group_size - 1)), p,
+                 q, d);
+            for (int k = 0; k < 6; ++k) {
+                p_lanes[k](l) = p(k);
+                q_lanes[k](l) = q(k);
+            }
+            for (int k = 0; k < 3; ++k) {
+                d_lanes[k](l) = d(k);
+            }
+        }
+        const LaneMask mask = contactFunction(p_lanes, q_lanes, d_lanes) <= 1.;
+        for (int l = 0; l < group_size; ++l) {
+            overlapping[first + static_cast<size_t>(l)] = mask(l);
+        }
+    }
+    return overlapping;
+}
+
+// Point of the ellipsoid closest to a point outside of it
+Eigen::Vector3d project(const Ellipsoid& ellipsoid,
+                        const Eigen::Vector3d& point) {
+    const Eigen::Array3d q =
+        ellipsoid.axes.transpose() * (point - ellipsoid.center);
+    const Eigen::Array3d r = ellipsoid.radii;
+    const Eigen::Array3d r_sq = r.square();
+    const Eigen::Array3d rq = r * q;
+
+    // the closest point is r^2 q / (t + r^2) with t >= 0 the root of
+    // sum (r q / (t + r^2))^2 = 1. The function is convex and decreasing so
+    // Newton's method converges monotonically from a lower bound of the root
+    double t = std::max(0., r.minCoeff() * q.matrix().norm() - r_sq.maxCoeff());
+    for (int i = 0; i < newton_iterations; ++i) {
+        const Eigen::Array3d ratio = rq / (t + r_sq);
+        const double f = ratio.square().sum() - 1.;
+        const double df = -2. * (ratio.square() / (t + r_sq)).sum();
+        const double step = f / df;
+        t -= step;
+        if (f <= 0. or -step <= 1e-15 * (t + r_sq.maxCoeff())) {
+            break;
+        }
+    }
+    return ellipsoid.center +
+           ellipsoid.axes * (r_sq * q / (t + r_sq)).matrix();
+}
+
+// Extent of an ellipsoid from its center along a unit direction, i.e its
+// support function without the center term
+double reach(const Ellipsoid& ellipsoid, const Eigen::Vector3d& direction) {
+    return ellipsoid.radii.cwiseProduct(ellipsoid.axes.transpose() * direction)
+        .norm();
+}
+
+// Distance between two ellipsoids that don't overlap, or a lower bound of it
+// if it is above the cutoff
+double separation(const Ellipsoid& a, const Ellipsoid& b,
+                  double cutoff = std::numeric_limits<double>::infinity()) {
+    const double tolerance =
+        1e-10 * std::max(a.radii.maxCoeff(), b.radii.maxCoeff());
+    Eigen::Vector3d x = project(a, b.center);
+    Eigen::Vector3d y = project(b, x);
+    double upper = (y - x).norm();
+    for (int i = 0; i < projection_iterations; ++i) {
+        // the gap between the planes orthogonal to y - x supporting each
+        // ellipsoid is a lower bound, equal to the distance at the closest
+        // points
+        const Eigen::Vector3d normal = (y - x) / upper;
+        const double lower = normal.dot(b.center - a.center) -
+                             reach(a, normal) - reach(b, normal);
+        if (lower > cutoff) {
+            return lower;
+        }
+        if (upper - lower <= tolerance) {
+            break;
+        }
+        x = project(a, y);
+        y = project(b, x);
+        upper = (y - x).norm();
+    }
+    return upper;
+}
+
+struct Node {
+    Eigen::AlignedBox3d box;
+    //! children of an inner node
+    size_t children[2];
+    //! range of EllipsoidSet::Impl::order of a leaf, count is zero for the
+    //! inner nodes
+    size_t first;
+    size_t count;
+};
+
+} // namespace
+
+Ellipsoid makeEllipsoid(const FitResult& result) {
+    return makeEllipsoid(result.parameters, result.evec_column);
+}
+
+Ellipsoid makeEllipsoid(const Parameters& parameters,
+                        const Eigen::Matrix3d& evec_column) {
+    Ellipsoid ellipsoid;
+    ellipsoid.center = parameters.center;
+    ellipsoid.radii = parameters.radii;
+    ellipsoid.axes = evec_column;
+    return ellipsoid;
+}
+
+bool overlap(const Ellipsoid& a, const Ellipsoid& b) {
+    const Shape a_shape = shapeOf(a);
+    const Shape b_shape = shapeOf(b);
+    return overlapTests(1, [&](size_t, Shape& p, Shape& q,
+                               Eigen::Vector3d& d) {
+               p = a_shape;
+               q = b_shape;
+               d = b.center - a.center;
+           })[0] != 0;
+}
+
+bool contains(const Ellipsoid& a, const Ellipsoid& b) {
+    // b is x = c + L u with |u| <= 1 in the frame where a is the unit ball
+    const Eigen::Matrix3d to_ball =
+        a.radii.cwiseInverse().asDiagonal() * a.axes.transpose();
+    const Eigen::Vector3d c = to_ball * (b.center - a.center);
+    const Eigen::Matrix3d L = to_ball * b.axes * b.radii.asDiagonal();
+
+    // |c + L u|^2 = |c|^2 + u^T M u + 2 g^T u, with M = L^T L and g = L^T c.
+    // The maximum of the last two terms over the unit ball is, by strong
+    // duality, the minimum of mu + sum g_i^2 / (mu - m_i) for mu greater
+    // than the eigenvalues m_i of M, g being expressed in its eigenvectors.
+    const Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(L.transpose() *
+                                                                L);
+    const Eigen::Array3d m = solver.eigenvalues();
+    const Eigen::Array3d g_sq =
+        (solver.eigenvectors().transpose() * (L.transpose() * c))
+            .array()
+            .square();
+
+    // the derivative 1 - sum g_i^2 / (mu - m_i)^2 is convex and increasing,
+    // negative at m_max + |g_max| so Newton's method converges monotonically
+    // from there. If g_max vanishes, the minimum may be at m_max itself and
+    // is overestimated by at most the offset.
+    const double m_max = m(2);
+    double mu = m_max + std::max(std::sqrt(g_sq(2)),
+                                 std::numeric_limits<double>::epsilon() *
+                                     (m_max + std::sqrt(g_sq.sum())));
+    for (int i = 0; i < newton_iterations; ++i) {
+        const Eigen::Array3d gap = mu - m;
+        const double phi = (g_sq / gap.square()).sum();
+        if (phi <= 1. + 1e-12) {
+            break;
+        }
+        mu += (phi - 1.) / (2. * (g_sq / gap.cube()).sum());
+    }
+    const double farthest =
+        c.squaredNorm() + mu + (g_sq / (mu - m)).sum();
+    // identical ellipsoids contain each other despite rounding errors
+    return farthest <= 1. + 1e-12;
+}
+
+double distance(const Ellipsoid& a, const Ellipsoid& b) {
+    return overlap(a, b) ? 0. : separation(a, b);
+}
+
+struct EllipsoidSet::Impl {
+    explicit Impl(Ellipsoids all) : ellipsoids(std::move(all)) {
+        const size_t count = ellipsoids.size();
+        shapes.resize(count);
+        boxes.resize(count);
+        bounding_radii.resize(count);
+        order.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            shapes[i] = shapeOf(ellipsoids[i]);
+            boxes[i] = boxOf(ellipsoids[i], shapes[i]);
+            bounding_radii[i] = ellipsoids[i].radii.maxCoeff();
+            order[i] = i;
+        }
+        if (count > 0) {
+            nodes.reserve(2 * (count / leaf_size + 1));
+            build(0, count);
+        }
+    }
+
+    // Build the subtree of the ellipsoids [first, last) of order, split at
+    // the median of their centers along the longest side of the centers'
+    // box. Returns the index of its root.
+    size_t build(size_t first, size_t last) {
+        const size_t index = nodes.size();
+        nodes.push_back(Node());
+        Eigen::AlignedBox3d box;
+        Eigen::AlignedBox3d centers;
+        for (size_t k = first; k < last; ++k) {
+            box.extend(boxes[order[k]]);
+            centers.extend(ellipsoids[order[k]].center);
+        }
+        nodes[index].box = box;
+        if (last - first <= leaf_size) {
+            nodes[index].first = first;
+            nodes[index].count = last - first;
+            return index;
+        }
+
+        Eigen::Index axis;
+        centers.sizes().maxCoeff(&axis);
+        const size_t middle = first + (last - first) / 2;
+        std::nth_element(order.begin() + static_cast<std::ptrdiff_t>(first),
+                         order.begin() + static_cast<std::ptrdiff_t>(middle),
+                         order.begin() + static_cast<std::ptrdiff_t>(last),
+                         [&](size_t i, size_t j) {
+                             return ellipsoids[i].center(axis) <
+                                    ellipsoids[j].center(axis);
+                         });
+        const size_t left = build(first, middle);
+        const size_t right = build(middle, last);
+        nodes[index].children[0] = left;
+        nodes[index].children[1] = right;
+        nodes[index].count = 0;
+        return index;
+    }
+
+    // Call visit(i) for each ellipsoid whose box intersects the given one
+    template <typename Visit>
+    void query(const Eigen::AlignedBox3d& box, Visit visit) const {
+        if (nodes.empty()) {
+            return;
+        }
+        // the tree is balanced, far less deep than that
+        size_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            if (not node.box.intersects(box)) {
+                continue;
+            }
+            if (node.count == 0) {
+                stack[top++] = node.children[0];
+                stack[top++] = node.children[1];
+                continue;
+            }
+            for (size_t k = node.first; k < node.first + node.count; ++k) {
+                if (boxes[order[k]].intersects(box)) {
+                    visit(order[k]);
+                }
+            }
+        }
+    }
+
+    // Pairs (i, j), i < j, of the ellipsoids [begin, end) whose boxes and
+    // bounding spheres are closer than a margin
+    std::vector<EllipsoidPair> candidates(size_t begin, size_t end,
+                                          double margin) const {
+        std::vector<EllipsoidPair> pairs;
+        for (size_t i = begin; i < end; ++i) {
+            Eigen::AlignedBox3d box = boxes[i];
+            box.min().array() -= margin;
+            box.max().array() += margin;
+            query(box, [&](size_t j) {
+                if (j > i and
+                    (ellipsoids[j].center - ellipsoids[i].center).norm() <=
+                        bounding_radii[i] + bounding_radii[j] + margin) {
+                    pairs.push_back({i, j, 0.});
+                }
+            });
+        }
+        return pairs;
+    }
+
+    // Overlap tests of pairs of the set
+    std::vector<uint8_t>
+    overlapTests(const std::vector<EllipsoidPair>& pairs) const {
+        return ellipsoid::overlapTests(
+            pairs.size(),
+            [&](size_t k, Shape& p, Shape& q, Eigen::Vector3d& d) {
+                p = shapes[pairs[k].first];
+                q = shapes[pairs[k].second];
+                d = ellipsoids[pairs[k].second].center -
+                    ellipsoids[pairs[k].first].center;
+            });
+    }
+
+    // Candidates closer than margin filtered by narrow(candidates, kept),
+    // run in parallel over groups of ellipsoids and sorted
+    template <typename Narrow>
+    std::vector<EllipsoidPair> pairs(double margin, Narrow narrow) const {
+        const size_t tasks =
+            (ellipsoids.size() + ellipsoids_per_task - 1) / ellipsoids_per_task;
+        std::vector<std::vector<EllipsoidPair>> kept(tasks);
+        defaultExecutor()->parallelFor(tasks, [&](size_t task) {
+            ELLIPSOID_TRACE("overlap.pairs");
+            const size_t begin = task * ellipsoids_per_task;
+            const size_t end =
+                std::min(ellipsoids.size(), begin + ellipsoids_per_task);
+            narrow(candidates(begin, end, margin), kept[task]);
+        });
+
+        std::vector<EllipsoidPair> result;
+        for (const auto& task_pairs : kept) {
+            result.insert(result.end(), task_pairs.begin(), task_pairs.end());
+        }
+        std::sort(result.begin(), result.end(),
+                  [](const EllipsoidPair& a, const EllipsoidPair& b) {
+                      return a.first < b.first or
+                             (a.first == b.first and a.second < b.second);
+                  });
+        return result;
+    }
+
+    Ellipsoids ellipsoids;
+    std::vector<Shape, Eigen::aligned_allocator<Shape>> shapes;
+    std::vector<Eigen::AlignedBox3d> boxes;
+    std::vector<double> bounding_radii;
+    // permutation of the ellipsoids, each leaf holding a range of it
+    std::vector<size_t> order;
+    // bounding volume hierarchy, the root first
+    std::vector<Node> nodes;
+};
+
+EllipsoidSet::EllipsoidSet(Ellipsoids ellipsoids)
+    : impl_(new Impl(std::move(ellipsoids))) {
+}
+
+EllipsoidSet::EllipsoidSet(const FitResults& results) {
+    Ellipsoids ellipsoids;
+    ellipsoids.reserve(results.size());
+    for (const auto& result : results) {
+        ellipsoids.push_back(makeEllipsoid(result));
+    }
+    impl_.reset(new Impl(std::move(ellipsoids)));
+}
+
+EllipsoidSet::EllipsoidSet(const BatchResults& results) {
+    Ellipsoids ellipsoids;
+    ellipsoids.reserve(results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        ellipsoids.push_back(makeEllipsoid(results.result(i)));
+    }
+    impl_.reset(new Impl(std::move(ellipsoids)));
+}
+
+EllipsoidSet::~EllipsoidSet() = default;
+
+size_t EllipsoidSet::size() const {
+    return impl_->ellipsoids.size();
+}
+
+const Ellipsoid& EllipsoidSet::operator[](size_t index) const {
+    return impl_->ellipsoids[index];
+}
+
+std::vector<EllipsoidPair> EllipsoidSet::overlappingPairs() const {
+    return impl_->pairs(0., [this](const std::vector<EllipsoidPair>& pairs,
+                                   std::vector<EllipsoidPair>& kept) {
+        const auto overlapping = impl_->overlapTests(pairs);
+        for (size_t k = 0; k < pairs.size(); ++k) {
+            if (overlapping[k]) {
+                kept.push_back(pairs[k]);
+            }
+        }
+    });
+}
+
+std::vector<EllipsoidPair>
+EllipsoidSet::pairsWithin(double max_distance) const {
+    return impl_->pairs(max_distance, [&](const std::vector<EllipsoidPair>&
+                                              pairs,
+                                          std::vector<EllipsoidPair>& kept) {
+        const auto overlapping = impl_->overlapTests(pairs);
+        for (size_t k = 0; k < pairs.size(); ++k) {
+            EllipsoidPair pair = pairs[k];
+            if (not overlapping[k]) {
+                pair.distance = separation(impl_->ellipsoids[pair.first],
+                                           impl_->ellipsoids[pair.second],
+                                           max_distance);
+            }
+            if (pair.distance <= max_distance) {
+                kept.push_back(pair);
+            }
+        }
+    });
+}
+
+std::vector<EllipsoidPair> EllipsoidSet::containedPairs() const {
+    return impl_->pairs(0., [this](const std::vector<EllipsoidPair>& pairs,
+                                   std::vector<EllipsoidPair>& kept) {
+        const auto& ellipsoids = impl_->ellipsoids;
+        const auto& boxes = impl_->boxes;
+        const auto& radii = impl_->bounding_radii;
+        // the contained ellipsoid has the smaller box and bounding sphere
+        const auto contained = [&](size_t i, size_t j) {
+            return radii[j] <= radii[i] and boxes[i].contains(boxes[j]) and
+                   contains(ellipsoids[i], ellipsoids[j]);
+        };
+        for (const auto& pair : pairs) {
+            if (contained(pair.first, pair.second)) {
+                kept.push_back(pair);
+            }
+            if (contained(pair.second, pair.first)) {
+                kept.push_back({pair.second, pair.first, 0.});
+            }
+        }
+    });
+}
+
+std::vector<size_t> EllipsoidSet::overlapping(const Ellipsoid& query) const {
+    const Shape shape = shapeOf(query);
+    const double radius = query.radii.maxCoeff();
+    std::vector<size_t> candidates;
+    impl_->query(boxOf(query, shape), [&](size_t i) {
+        if ((impl_->ellipsoids[i].center - query.center).norm() <=
+            radius + impl_->bounding_radii[i]) {
+            candidates.push_back(i);
+        }
+    });
+
+    const auto overlapping = ellipsoid::overlapTests(
+        candidates.size(),
+        [&](size_t k, Shape& p, Shape& q, Eigen::Vector3d& d) {
+            p = shape;
+            q = impl_->shapes[candidates[k]];
+            d = impl_->ellipsoids[candidates[k]].center - query.center;
+        });
+    std::vector<size_t> result;
+    for (size_t k = 0; k < candidates.size(); ++k) {
+        if (overlapping[k]) {
+            result.push_back(candidates[k]);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+} // namespace ellipsoid
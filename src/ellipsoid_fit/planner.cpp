@@ -0,0 +1,301 @@
+#include <ellipsoid/executor.h>
+#include <ellipsoid/generate.h>
+#include <ellipsoid/planner.h>
+#include <ellipsoid/tsqr.h>
+
+#include "basis.h"
+#include "tracing.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace ellipsoid {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Bounds of the number of points of a parallel task
+constexpr size_t min_chunk_rows = 1 << 14;
+constexpr size_t max_chunk_rows = 1 << 20;
+
+// Parallel tasks per thread, for load balancing
+constexpr size_t tasks_per_thread = 4;
+
+// Points gathered at once when subsampling
+constexpr size_t gather_rows = 4096;
+
+double elapsed(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Working memory of a strategy, the points excluded
+size_t memory(FitStrategy strategy, size_t rows, size_t columns,
+              size_t tasks) {
+    switch (strategy) {
+    case FitStrategy::DesignMatrix:
+        // design matrix, squared coordinates and RHS
+        return (columns + 4) * rows * sizeof(double);
+    case FitStrategy::ParallelAccumulation:
+        return (tasks + 1) * sizeof(Moments);
+    case FitStrategy::Subsampling:
+        return sizeof(Moments) + gather_rows * 3 * sizeof(double);
+    case FitStrategy::Tsqr:
+        // per task, a block of the design matrix below the R factor
+        return tasks *
+               (static_cast<size_t>(detail::tsqr_block_rows) + columns + 1) *
+               (columns + 4) * sizeof(double);
+    default:
+        return sizeof(Moments);
+    }
+}
+
+double seconds(FitStrategy strategy, size_t rows, size_t threads,
+               size_t tasks, const CostModel& model) {
+    const auto n = static_cast<double>(rows);
+    switch (strategy) {
+    case FitStrategy::DesignMatrix:
+        return n * model.design_matrix_per_point + model.solve;
+    case FitStrategy::ParallelAccumulation:
+        return n * model.moments_per_point /
+                   static_cast<double>(std::min(threads, tasks)) +
+               static_cast<double>(tasks) * model.task + model.solve;
+    case FitStrategy::Subsampling:
+        return n * (model.moments_per_point + model.gather_per_point) +
+               model.solve;
+    case FitStrategy::Tsqr:
+        return n * model.tsqr_per_point /
+                   static_cast<double>(std::min(threads, tasks)) +
+               static_cast<double>(tasks) * model.task + model.solve;
+    default:
+        return n * model.moments_per_point + model.solve;
+    }
+}
+
+FitPlan makePlan(FitStrategy strategy, size_t rows, size_t columns,
+                 size_t threads, const CostModel& model) {
+    FitPlan plan;
+    plan.strategy = strategy;
+    plan.stride = 1;
+    plan.rows_used = rows;
+    plan.tasks = 1;
+    plan.chunk_rows = rows;
+    if (strategy == FitStrategy::ParallelAccumulation or
+        strategy == FitStrategy::Tsqr) {
+        const auto target = threads * tasks_per_thread;
+        plan.chunk_rows = std::min(
+            max_chunk_rows,
+            std::max(min_chunk_rows, (rows + target - 1) / target));
+        plan.tasks = std::max<size_t>(
+            1, (rows + plan.chunk_rows - 1) / plan.chunk_rows);
+    } else if (strategy == FitStrategy::Subsampling) {
+        plan.chunk_rows = gather_rows;
+    }
+    plan.memory = memory(strategy, rows, columns, plan.tasks);
+    plan.seconds = seconds(strategy, rows, threads, plan.tasks, model);
+    return plan;
+}
+
+// Keep one point out of stride so that the estimated time fits the budget
+FitPlan subsample(const FitPlan& exact, size_t rows, size_t columns,
+                  const FitOptions& options) {
+    const auto& model = options.cost_model;
+    const auto per_point =
+        model.moments_per_point + model.gather_per_point;
+    const auto affordable = std::max(
+        0., (options.time_budget - model.solve) / per_point);
+    // at least one point, min_sample_rows may be zero
+    const auto sample_rows = std::max<size_t>(
+        std::max<size_t>(options.min_sample_rows, 1),
+        static_cast<size_t>(affordable));
+    if (sample_rows >= rows) {
+        return exact;
+    }
+    auto plan = makePlan(FitStrategy::Subsampling, 0, columns, 1, model);
+    plan.stride = (rows + sample_rows - 1) / sample_rows;
+    plan.rows_used = (rows + plan.stride - 1) / plan.stride;
+    plan.seconds = seconds(FitStrategy::Subsampling, plan.rows_used, 1, 1,
+                           model);
+    return plan;
+}
+
+// Moments of one point out of stride, copied by chunks
+Moments subsampledMoments(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    size_t stride) {
+    Moments moments;
+    Eigen::Matrix<double, Eigen::Dynamic, 3> chunk(gather_rows, 3);
+    const auto step = static_cast<Eigen::Index>(stride);
+    Eigen::Index row = 0;
+    while (row < data.rows()) {
+        Eigen::Index count = 0;
+        for (; count < chunk.rows() and row < data.rows();
+             ++count, row += step) {
+            chunk.row(count) = data.row(row);
+        }
+        moments.add(chunk.topRows(count));
+    }
+    return moments;
+}
+
+} // namespace
+
+CostModel CostModel::measure(size_t rows) {
+    CostModel model;
+    Parameters parameters;
+    parameters.center << 1., 2., 3.;
+    parameters.radii << 4., 5., 6.;
+    const auto points = generate(parameters, std::max<size_t>(rows, 1000));
+    const auto n = static_cast<double>(points.rows());
+
+    // the smallest of a few runs filters out the interruptions
+    auto best = [](const std::function<void()>& run) {
+        double fastest = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < 5; ++i) {
+            const auto start = Clock::now();
+            run();
+            fastest = std::min(fastest, elapsed(start));
+        }
+        return fastest;
+    };
+
+    Moments moments;
+    moments.add(points);
+    model.solve = best([&] {
+        for (int i = 0; i < 100; ++i) {
+            fit(moments);
+        }
+    }) / 100.;
+    model.moments_per_point = best([&] {
+        Moments accumulated;
+        accumulated.add(points);
+    }) / n;
+    model.design_matrix_per_point =
+        std::max(0., best([&] { fit(points); }) - model.solve) / n;
+    model.gather_per_point =
+        std::max(0., best([&] { subsampledMoments(points, 1); }) / n -
+                         model.moments_per_point);
+    // a single task, the per point time of one core
+    model.tsqr_per_point =
+        std::max(0., best([&] {
+                         fitTsqr(points, EllipsoidType::Arbitrary,
+                                 static_cast<size_t>(points.rows()));
+                     }) - model.solve) /
+        n;
+
+    const size_t tasks = 1000;
+    model.task = best([&] {
+        std::vector<Moments, Eigen::aligned_allocator<Moments>> partial(tasks);
+        defaultExecutor()->parallelFor(tasks, [&](size_t i) {
+            partial[i].add(1., 1., 1.);
+        });
+        Moments merged;
+        for (const auto& moment : partial) {
+            merged += moment;
+        }
+    }) / tasks;
+
+    return model;
+}
+
+size_t defaultMemoryBudget() {
+    const long pages = ::sysconf(_SC_PHYS_PAGES);
+    const long page_size = ::sysconf(_SC_PAGESIZE);
+    if (pages <= 0 or page_size <= 0) {
+        return 0;
+    }
+    return static_cast<size_t>(pages) / 4 * static_cast<size_t>(page_size);
+}
+
+FitPlan planFit(size_t rows, const FitOptions& options) {
+    const auto threads = options.threads > 0
+                             ? options.threads
+                             : defaultExecutor()->concurrency();
+    const auto columns =
+        static_cast<size_t>(detail::monomialBasis(options.type).cols());
+    const auto& model = options.cost_model;
+
+    if (options.strategy != FitStrategy::Automatic) {
+        const auto plan =
+            makePlan(options.strategy, rows, columns, threads, model);
+        // without time budget, min_sample_rows points are kept
+        return options.strategy == FitStrategy::Subsampling
+                   ? subsample(plan, rows, columns, options)
+                   : plan;
+    }
+
+    std::vector<FitStrategy> candidates{FitStrategy::DesignMatrix,
+                                        FitStrategy::Streaming};
+    if (threads > 1) {
+        candidates.push_back(FitStrategy::ParallelAccumulation);
+    }
+    // Streaming always fits, its memory does not depend on the points
+    auto best = makePlan(FitStrategy::Streaming, rows, columns, threads, model);
+    for (const auto strategy : candidates) {
+        const auto plan = makePlan(strategy, rows, columns, threads, model);
+        const bool fits =
+            options.memory_budget == 0 or plan.memory <= options.memory_budget;
+        if (fits and plan.seconds < best.seconds) {
+            best = plan;
+        }
+    }
+
+    if (options.time_budget > 0. and best.seconds > options.time_budget) {
+        best = subsample(best, rows, columns, options);
+    }
+    return best;
+}
+
+FitResult
+fit(const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    const FitOptions& options, Diagnostics* diagnostics) {
+    const auto start = Clock::now();
+    FitPlan plan;
+    {
+        ELLIPSOID_TRACE("fit.plan");
+        plan = planFit(static_cast<size_t>(data.rows()), options);
+    }
+
+    FitResult result;
+    auto solve = [&](const Moments& moments) {
+        result.parameters =
+            fit(moments, &result.coefficients, &result.eval,
+                &result.evec_column, options.type);
+    };
+    switch (plan.strategy) {
+    case FitStrategy::DesignMatrix:
+        result.parameters =
+            detail::fitPoints(data, &result.coefficients, &result.eval,
+                              &result.evec_column, options.type);
+        break;
+    case FitStrategy::ParallelAccumulation:
+        solve(accumulateParallel(data, plan.chunk_rows));
+        break;
+    case FitStrategy::Subsampling:
+        solve(subsampledMoments(data, plan.stride));
+        break;
+    case FitStrategy::Tsqr:
+        result = fitTsqr(data, options.type, plan.chunk_rows);
+        break;
+    default: {
+        Moments moments;
+        moments.add(data);
+        solve(moments);
+        break;
+    }
+    }
+
+    if (diagnostics != nullptr) {
+        diagnostics->plan = plan;
+        diagnostics->rows = static_cast<size_t>(data.rows());
+        diagnostics->seconds = elapsed(start);
+    }
+    return result;
+}
+
+} // namespace ellipsoid
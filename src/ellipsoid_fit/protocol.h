@@ -0,0 +1,98 @@
+#pragma once
+
+#include <ellipsoid/fit.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace ellipsoid {
+namespace detail {
+
+/*
+ * Messages exchanged between Client and Server over a stream socket, in the
+ * host's byte order:
+ *  - request: RequestHeader followed by the count x coordinates, the count y
+ *    coordinates and the count z coordinates, i.e the storage of a column
+ *    major Nx3 matrix of doubles
+ *  - reply: Reply
+ */
+
+constexpr uint32_t protocol_magic = 0x45464954; // "EFIT"
+
+struct RequestHeader {
+    uint32_t magic;
+    uint32_t type; // EllipsoidType
+    uint64_t count;
+};
+
+enum class ReplyStatus : int32_t {
+    Success,
+    InvalidRequest,
+    Overloaded,
+};
+
+struct Reply {
+    uint32_t magic;
+    ReplyStatus status;
+    // center, radii, coefficients, eval, evec_column (column major)
+    double values[3 + 3 + 10 + 3 + 9];
+};
+
+inline void toReply(const FitResult& result, Reply& reply) {
+    double* v = reply.values;
+    Eigen::Map<Eigen::Vector3d>{v} = result.parameters.center;
+    Eigen::Map<Eigen::Vector3d>(v + 3) = result.parameters.radii;
+    Eigen::Map<Eigen::Matrix<double, 10, 1>>(v + 6) = result.coefficients;
+    Eigen::Map<Eigen::Vector3d>(v + 16) = result.eval;
+    Eigen::Map<Eigen::Matrix3d>(v + 19) = result.evec_column;
+}
+
+inline void fromReply(const Reply& reply, FitResult& result) {
+    const double* v = reply.values;
+    result.parameters.center = Eigen::Map<const Eigen::Vector3d>(v);
+    result.parameters.radii = Eigen::Map<const Eigen::Vector3d>(v + 3);
+    result.coefficients = Eigen::Map<const Eigen::Matrix<double, 10, 1>>(v + 6);
+    result.eval = Eigen::Map<const Eigen::Vector3d>(v + 16);
+    result.evec_column = Eigen::Map<const Eigen::Matrix3d>(v + 19);
+}
+
+// Read exactly size bytes, false on error or end of stream
+inline bool readAll(int fd, void* buffer, size_t size) {
+    auto* data = static_cast<char*>(buffer);
+    while (size > 0) {
+        const auto bytes = ::recv(fd, data, size, 0);
+        if (bytes < 0 and errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            return false;
+        }
+        data += bytes;
+        size -= static_cast<size_t>(bytes);
+    }
+    return true;
+}
+
+// Write exactly size bytes, false on error
+inline bool writeAll(int fd, const void* buffer, size_t size) {
+    const auto* data = static_cast<const char*>(buffer);
+    while (size > 0) {
+        const auto bytes = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (bytes < 0 and errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            return false;
+        }
+        data += bytes;
+        size -= static_cast<size_t>(bytes);
+    }
+    return true;
+}
+
+} // namespace detail
+} // namespace ellipsoid
@@ -0,0 +1,313 @@
+#include <ellipsoid/quadric.h>
+#include <ellipsoid/inline.h>
+#include <Eigen/Eigenvalues>
+
+#include "basis.h"
+#include "tracing.h"
+
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace ellipsoid {
+
+namespace {
+
+using Vector10d = Eigen::Matrix<double, 10, 1>;
+
+constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+constexpr double infinity = std::numeric_limits<double>::infinity();
+
+// Moments of the gradients of the monomials, N = sum grad(m) grad(m)^T.
+// Each partial derivative of m only holds the linear monomials
+// l = [2x, 2y, 2z, 1], so N is formed from their moments, the bottom right
+// corner of M.
+Moments::Matrix gradientMoments(const Moments::Matrix& M) {
+    const Eigen::Matrix4d L = M.bottomRightCorner<4, 4>();
+    // for d/dx, d/dy and d/dz, the monomials whose derivative is 2x, 2y, 2z
+    // and 2 (i.e twice the constant monomial)
+    const int rows[3][4] = {{0, 3, 4, 6}, {3, 1, 5, 7}, {4, 5, 2, 8}};
+    Moments::Matrix N = Moments::Matrix::Zero();
+    for (const auto& row : rows) {
+        Eigen::Matrix<double, 10, 4> G = Eigen::Matrix<double, 10, 4>::Zero();
+        for (int j = 0; j < 4; ++j) {
+            G(row[j], j) = j < 3 ? 1. : 2.;
+        }
+        N.noalias() += G * L * G.transpose();
+    }
+    return N;
+}
+
+// Orders of three columns moving the column i to the end, the two others
+// keeping their order
+constexpr int last_orders[3][3] = {{1, 2, 0}, {0, 2, 1}, {0, 1, 2}};
+
+// Axes with the column last moved to the end, see last_orders, the first one
+// being flipped if needed to get a right-handed frame
+Eigen::Matrix3d axesWithLast(const Eigen::Matrix3d& vectors, int last) {
+    Eigen::Matrix3d axes;
+    for (int i = 0; i < 3; ++i) {
+        axes.col(i) = vectors.col(last_orders[last][i]);
+    }
+    if (axes.determinant() < 0.) {
+        axes.col(0) = -axes.col(0);
+    }
+    return axes;
+}
+
+// Index of the value whose sign differs from the two others
+int oddSign(const Eigen::Vector3d& values) {
+    const int positives = (values.array() > 0.).count();
+    for (int i = 0; i < 3; ++i) {
+        if ((values(i) > 0.) == (positives == 1)) {
+            return i;
+        }
+    }
+    return 2;
+}
+
+// Type and parameters of the quadric v^T m = 0, in the frame where the
+// points have a unit RMS distance to their centroid at the origin. lambda
+// and e are the eigenvalues, in increasing order, and eigenvectors of its
+// quadratic part
+void classify(const Vector10d& v, const Eigen::Vector3d& lambda,
+              const Eigen::Matrix3d& e, double tolerance, Quadric& quadric) {
+    quadric.type = QuadricType::Degenerate;
+    quadric.center.setConstant(nan);
+    quadric.axes.setConstant(nan);
+    quadric.radii.setConstant(nan);
+    quadric.angles.setConstant(nan);
+
+    const double zero = tolerance * lambda.cwiseAbs().maxCoeff();
+    const Eigen::Array3d nonzero =
+        (lambda.array().abs() > zero).cast<double>();
+    const int rank = static_cast<int>(nonzero.sum());
+    // linear coefficients in the eigenvectors' frame, the quadric being
+    // sum lambda_i y_i^2 + 2 sum bl_i y_i + c = 0
+    const Eigen::Vector3d bl = e.transpose() * v.segment<3>(6);
+    const double c = v(9);
+    // completing the squares of the non zero eigenvalues
+    const Eigen::Vector3d y =
+        (nonzero > 0.).select(-bl.array() / lambda.array(), 0.);
+    const double k = c + bl.dot(y);
+
+    if (rank == 3) {
+        quadric.center = e * y;
+        if (std::abs(k) <= zero) {
+            // sum lambda_i y_i^2 = 0, a cone if the signs differ
+            const int positives = (lambda.array() > 0.).count();
+            if (positives == 0 or positives == 3) {
+                quadric.center.setConstant(nan);
+                return;
+            }
+            const int axis = oddSign(lambda);
+            quadric.type = QuadricType::Cone;
+            quadric.axes = axesWithLast(e, axis);
+            for (int i = 0; i < 2; ++i) {
+                quadric.angles(i) = std::atan(std::sqrt(
+                    -lambda(axis) / lambda(last_orders[axis][i])));
+            }
+            return;
+        }
+
+        // sum q_i y_i^2 = 1
+        const Eigen::Vector3d q = -lambda / k;
+        const int positives = (q.array() > 0.).count();
+        if (positives == 0) {
+            quadric.center.setConstant(nan);
+            return;
+        }
+        if (positives == 3) {
+            quadric.type = QuadricType::Ellipsoid;
+            Eigen::Vector3d eval = q;
+            quadric.axes = e;
+            detail::orderAxes(eval, quadric.axes);
+            quadric.radii = eval.cwiseInverse().cwiseSqrt();
+            return;
+        }
+        quadric.type = positives == 2 ? QuadricType::HyperboloidOfOneSheet
+                                      : QuadricType::HyperboloidOfTwoSheets;
+        const int axis = oddSign(q);
+        quadric.axes = axesWithLast(e, axis);
+        for (int i = 0; i < 3; ++i) {
+            quadric.radii(i) =
+                1. / std::sqrt(std::abs(q(last_orders[axis][i])));
+        }
+        return;
+    }
+
+    if (rank == 2) {
+        // the eigenvalues are sorted, the zero one is the smallest in
+        // magnitude
+        int null = 0;
+        lambda.cwiseAbs().minCoeff(&null);
+        int first = null == 0 ? 1 : 0;
+        int second = null == 2 ? 1 : 2;
+
+        if (std::abs(bl(null)) <= zero) {
+            // cylinder: sum lambda_i y_i^2 + k = 0 in the section
+            if (std::abs(k) <= zero) {
+                return;
+            }
+            const double q_first = -lambda(first) / k;
+            const double q_second = -lambda(second) / k;
+            if (q_first < 0. and q_second < 0.) {
+                return;
+            }
+            if (q_first < 0.) {
+                std::swap(first, second);
+            }
+            quadric.type = q_first > 0. and q_second > 0.
+                               ? QuadricType::EllipticCylinder
+                               : QuadricType::HyperbolicCylinder;
+            quadric.center = e * y;
+            quadric.axes.col(0) = e.col(first);
+            quadric.axes.col(1) = e.col(second);
+            quadric.axes.col(2) = e.col(first).cross(e.col(second));
+            quadric.radii << 1. / std::sqrt(std::abs(lambda(first) / k)),
+                1. / std::sqrt(std::abs(lambda(second) / k)), infinity;
+            return;
+        }
+
+        // paraboloid: sum lambda_i y_i^2 + 2 bl_n y_n = 0 from the vertex,
+        // i.e y_n = -sum lambda_i y_i^2 / (2 bl_n)
+        Eigen::Vector3d vertex = y;
+        vertex(null) = -k / (2. * bl(null));
+        quadric.center = e * vertex;
+        Eigen::Vector3d opening = e.col(null);
+        double rho_first = -bl(null) / lambda(first);
+        double rho_second = -bl(null) / lambda(second);
+        // the smallest radius first, on the side of the opening
+        if (std::abs(rho_second) < std::abs(rho_first)) {
+            std::swap(first, second);
+            std::swap(rho_first, rho_second);
+        }
+        if (rho_first < 0.) {
+            rho_first = -rho_first;
+            rho_second = -rho_second;
+            opening = -opening;
+        }
+        quadric.type = rho_second > 0. ? QuadricType::EllipticParaboloid
+                                       : QuadricType::HyperbolicParaboloid;
+        quadric.axes.col(0) = e.col(first);
+        quadric.axes.col(2) = opening;
+        quadric.axes.col(1) = opening.cross(e.col(first));
+        quadric.radii << rho_first, std::abs(rho_second), infinity;
+        return;
+    }
+
+    if (rank == 1) {
+        int index = 0;
+        lambda.cwiseAbs().maxCoeff(&index);
+        // linear term in the null space of the quadratic part
+        const Eigen::Vector3d b = v.segment<3>(6);
+        const Eigen::Vector3d b_null = b - bl(index) * e.col(index);
+        const double beta = b_null.norm();
+        if (beta <= zero) {
+            return;
+        }
+        // lambda y_1^2 + 2 beta y_3 = 0 from the vertex line
+        Eigen::Vector3d opening = b_null / beta;
+        double rho = -beta / lambda(index);
+        if (rho < 0.) {
+            rho = -rho;
+            opening = -opening;
+        }
+        quadric.type = QuadricType::ParabolicCylinder;
+        quadric.center = y(index) * e.col(index) -
+                         k / (2. * b_null.dot(opening)) * opening;
+        quadric.axes.col(0) = e.col(index);
+        quadric.axes.col(1) = opening.cross(e.col(index));
+        quadric.axes.col(2) = opening;
+        quadric.radii << rho, infinity, infinity;
+    }
+}
+
+} // namespace
+
+Quadric fitQuadric(const Moments& moments, const QuadricOptions& options) {
+    ELLIPSOID_TRACE_COUNT("fit_quadric", 0, sizeof(Moments::Matrix));
+    Quadric quadric;
+    quadric.type = QuadricType::Degenerate;
+    quadric.coefficients.setConstant(nan);
+    quadric.center.setConstant(nan);
+    quadric.axes.setConstant(nan);
+    quadric.radii.setConstant(nan);
+    quadric.angles.setConstant(nan);
+    quadric.rms_distance = nan;
+    if (moments.count() < 9) {
+        return quadric;
+    }
+
+    // express the points relative to their centroid and scale them to a
+    // unit RMS distance, so the problem is well conditioned and the
+    // tolerance relative to their extent: m(p / scale) = S m(p)
+    Moments centered = moments;
+    const Moments::Matrix raw = moments.matrix();
+    const Eigen::Vector3d centroid =
+        moments.origin() + raw.block<3, 1>(6, 9) / (2. * raw(9, 9));
+    centered.setOrigin(centroid);
+    Moments::Matrix M = centered.matrix();
+    const double scale =
+        std::sqrt(M.block<3, 3>(6, 6).trace() / (4. * M(9, 9)));
+    if (not(scale > 0.)) {
+        return quadric;
+    }
+    Vector10d S;
+    S << Eigen::Matrix<double, 6, 1>::Constant(1. / (scale * scale)),
+        Eigen::Vector3d::Constant(1. / scale), 1.;
+    M = S.asDiagonal() * M * S.asDiagonal();
+    const Moments::Matrix N = gradientMoments(M);
+
+    // minimize v^T M v / v^T N v. The constant coefficient doesn't appear in
+    // N, minimizing over it first leaves the Schur complement of M
+    Vector10d v;
+    double ratio;
+    {
+        ELLIPSOID_TRACE("fit_quadric.eigensolver");
+        const Eigen::Matrix<double, 9, 9> reduced =
+            M.topLeftCorner<9, 9>() -
+            M.topRightCorner<9, 1>() * M.bottomLeftCorner<1, 9>() / M(9, 9);
+        const Eigen::GeneralizedSelfAdjointEigenSolver<
+            Eigen::Matrix<double, 9, 9>>
+            solver(reduced, N.topLeftCorner<9, 9>());
+        if (solver.info() != Eigen::Success) {
+            return quadric;
+        }
+        v.head<9>() = solver.eigenvectors().col(0);
+        v(9) = -M.bottomLeftCorner<1, 9>().dot(v.head<9>()) / M(9, 9);
+        ratio = solver.eigenvalues()(0);
+    }
+
+    // the sign of v is arbitrary, the largest eigenvalue is made positive
+    Eigen::Matrix3d A;
+    A << v(0), v(3), v(4), v(3), v(1), v(5), v(4), v(5), v(2);
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> axes(A);
+    int largest = 0;
+    axes.eigenvalues().cwiseAbs().maxCoeff(&largest);
+    if (axes.eigenvalues()(largest) < 0.) {
+        v = -v;
+        axes.compute(-A);
+    }
+    classify(v, axes.eigenvalues(), axes.eigenvectors(), options.tolerance,
+             quadric);
+
+    // back to the ref. frame
+    quadric.center = centroid + scale * quadric.center;
+    quadric.radii *= scale;
+    quadric.coefficients = detail::translateCoefficients(
+        S.asDiagonal() * v, centroid);
+    quadric.coefficients.normalize();
+    quadric.rms_distance = std::sqrt(std::max(ratio, 0.)) * scale;
+    return quadric;
+}
+
+Quadric fitQuadric(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    const QuadricOptions& options) {
+    Moments moments;
+    moments.add(data);
+    return fitQuadric(moments, options);
+}
+
+} // namespace ellipsoid
@@ -0,0 +1,82 @@
+#include <ellipsoid/quantized.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace ellipsoid {
+
+namespace {
+
+// Number of records decoded before being accumulated
+constexpr size_t decode_size = 256;
+
+void readCoordinates(const QuantizedRecords& records, size_t index,
+                     int32_t (&xyz)[3]) {
+    // records are not necessarily aligned
+    std::memcpy(xyz,
+                static_cast<const char*>(records.data) +
+                    index * records.stride + records.coordinates_offset,
+                sizeof(xyz));
+}
+
+} // namespace
+
+void accumulate(Moments& moments, const QuantizedRecords& records) {
+    if (records.count == 0) {
+        return;
+    }
+
+    // put the origin on the quantization grid, at the first record
+    if (moments.count() == 0) {
+        int32_t first[3];
+        readCoordinates(records, 0, first);
+        moments.setOrigin(records.offset +
+                          records.scale.cwiseProduct(
+                              Eigen::Vector3d(first[0], first[1], first[2])));
+    }
+
+    // integer coordinates of the grid point closest to the origin and the
+    // remaining (sub quantum) offset
+    int64_t reference[3];
+    Eigen::Vector3d remainder;
+    for (int i = 0; i < 3; ++i) {
+        reference[i] = static_cast<int64_t>(
+            std::llround((moments.origin()(i) - records.offset(i)) /
+                         records.scale(i)));
+        remainder(i) = records.offset(i) +
+                       records.scale(i) * static_cast<double>(reference[i]) -
+                       moments.origin()(i);
+    }
+
+    Eigen::Matrix<int64_t, decode_size, 3> centered;
+    Eigen::Matrix<double, decode_size, 3> points;
+    for (size_t start = 0; start < records.count; start += decode_size) {
+        const auto n = std::min(decode_size, records.count - start);
+        for (size_t i = 0; i < n; ++i) {
+            int32_t xyz[3];
+            readCoordinates(records, start + i, xyz);
+            centered(i, 0) = xyz[0] - reference[0];
+            centered(i, 1) = xyz[1] - reference[1];
+            centered(i, 2) = xyz[2] - reference[2];
+        }
+
+        // exact integer centering, then scaling
+        const auto rows = static_cast<Eigen::Index>(n);
+        points.topRows(rows) =
+            (centered.topRows(rows).cast<double>() *
+             records.scale.asDiagonal())
+                .rowwise() +
+            remainder.transpose();
+        moments.addRelative(points.topRows(rows));
+    }
+}
+
+Parameters fit(const QuantizedRecords& records, EllipsoidType type) {
+    Moments moments;
+    accumulate(moments, records);
+    return fit(moments, type);
+}
+
+} // namespace ellipsoid
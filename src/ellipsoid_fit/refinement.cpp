@@ -0,0 +1,229 @@
+#include <ellipsoid/refinement.h>
+#include <ellipsoid/inline.h>
+
+#include "basis.h"
+#include "tracing.h"
+
+#include <cmath>
+#include <limits>
+
+namespace ellipsoid {
+
+namespace {
+
+using Types = detail::FitTypes<Eigen::Matrix<double, Eigen::Dynamic, 3>>;
+using Normal = Types::Normal;
+using Unknowns = Types::Unknowns;
+
+// Unevaluated sum hi + lo of two doubles, with |lo| <= ulp(hi) / 2
+struct DoubleDouble {
+    double hi;
+    double lo;
+};
+
+// Exact sum of two doubles
+DoubleDouble twoSum(double a, double b) {
+    const double s = a + b;
+    const double bb = s - a;
+    return {s, (a - (s - bb)) + (b - bb)};
+}
+
+// Exact product of two doubles
+DoubleDouble twoProduct(double a, double b) {
+    const double p = a * b;
+    return {p, std::fma(a, b, -p)};
+}
+
+DoubleDouble add(const DoubleDouble& a, const DoubleDouble& b) {
+    const DoubleDouble s = twoSum(a.hi, b.hi);
+    return twoSum(s.hi, s.lo + a.lo + b.lo);
+}
+
+DoubleDouble multiply(double a, const DoubleDouble& b) {
+    const DoubleDouble p = twoProduct(a, b.hi);
+    return twoSum(p.hi, p.lo + a * b.lo);
+}
+
+// Residual b - N u of the normal equations N = B^T M B, b = B^T M s: with
+// the algebraic coefficients v = B u - s it is -B^T M v, evaluated from the
+// moments in double-double arithmetic
+Unknowns momentsResidual(const Moments::Matrix& M,
+                         const Eigen::Matrix<double, 10, Eigen::Dynamic>& B,
+                         const Unknowns& u) {
+    DoubleDouble v[10];
+    for (int j = 0; j < 10; ++j) {
+        v[j] = {j < 3 ? -1. : 0., 0.};
+        for (Eigen::Index k = 0; k < B.cols(); ++k) {
+            v[j] = add(v[j], twoProduct(B(j, k), u(k)));
+        }
+    }
+    DoubleDouble w[10];
+    for (int i = 0; i < 10; ++i) {
+        w[i] = {0., 0.};
+        for (int j = 0; j < 10; ++j) {
+            w[i] = add(w[i], multiply(M(i, j), v[j]));
+        }
+    }
+    Unknowns r(B.cols());
+    for (Eigen::Index k = 0; k < B.cols(); ++k) {
+        DoubleDouble sum{0., 0.};
+        for (int i = 0; i < 10; ++i) {
+            sum = add(sum, multiply(-B(i, k), w[i]));
+        }
+        r(k) = sum.hi + sum.lo;
+    }
+    return r;
+}
+
+// Solves N x = r with a factorization of the equilibrated matrix S N S, S
+// being the inverse square root of N's diagonal
+class EquilibratedSolver {
+public:
+    EquilibratedSolver(const Normal& N, Factorization factorization)
+        : factorization_(factorization) {
+        scale_ = N.diagonal()
+                     .cwiseMax(std::numeric_limits<double>::min())
+                     .cwiseSqrt()
+                     .cwiseInverse();
+        const Normal equilibrated =
+            scale_.asDiagonal() * N * scale_.asDiagonal();
+        if (factorization_ == Factorization::Float) {
+            llt_.compute(equilibrated.cast<float>());
+            valid_ = llt_.info() == Eigen::Success;
+        } else {
+            ldlt_.compute(equilibrated);
+            valid_ = ldlt_.info() == Eigen::Success;
+        }
+    }
+
+    bool valid() const {
+        return valid_;
+    }
+
+    Unknowns solve(const Unknowns& r) const {
+        const Unknowns scaled = scale_.cwiseProduct(r);
+        Unknowns x;
+        if (factorization_ == Factorization::Float) {
+            x = llt_.solve(scaled.cast<float>()).cast<double>();
+        } else {
+            x = ldlt_.solve(scaled);
+        }
+        return scale_.cwiseProduct(x);
+    }
+
+private:
+    using NormalFloat =
+        Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor,
+                      9, 9>;
+
+    Factorization factorization_;
+    Unknowns scale_;
+    Eigen::LLT<NormalFloat> llt_;
+    Eigen::LDLT<Normal> ldlt_;
+    bool valid_;
+};
+
+} // namespace
+
+FitResult fitRefined(const Moments& moments, EllipsoidType type,
+                     const RefinementOptions& options,
+                     RefinementReport* report) {
+    ELLIPSOID_TRACE_COUNT("fit_refined", 0, sizeof(Moments::Matrix));
+    const auto M = moments.matrix();
+    const auto B = detail::monomialBasis(type);
+
+    // same normal equations as fit(moments)
+    Normal N;
+    Unknowns rhs;
+    {
+        ELLIPSOID_TRACE_COUNT("fit.normal_equations", 0,
+                              sizeof(Moments::Matrix));
+        N = B.transpose() * M * B;
+        rhs = B.transpose() * M.leftCols<3>().rowwise().sum();
+    }
+    auto residual = [&](const Unknowns& u) -> Unknowns {
+        if (options.residuals == ResidualPrecision::DoubleDouble) {
+            return momentsResidual(M, B, u);
+        }
+        return rhs - N * u;
+    };
+
+    RefinementReport outcome;
+    outcome.iterations = 0;
+    outcome.converged = false;
+    outcome.correction = std::numeric_limits<double>::quiet_NaN();
+    outcome.fallback = false;
+    Unknowns u =
+        Unknowns::Constant(B.cols(), std::numeric_limits<double>::quiet_NaN());
+    {
+        ELLIPSOID_TRACE("fit.refined_solve");
+        const EquilibratedSolver solver(N, options.factorization);
+        if (solver.valid()) {
+            u = solver.solve(rhs);
+            // the corrections must shrink geometrically, by at least half
+            // at each step, or they are down to the rounding errors of the
+            // residuals or the factorization doesn't capture the system
+            double previous = std::numeric_limits<double>::infinity();
+            while (outcome.iterations < options.max_iterations) {
+                const Unknowns d = solver.solve(residual(u));
+                u += d;
+                ++outcome.iterations;
+                outcome.correction =
+                    d.lpNorm<Eigen::Infinity>() / u.lpNorm<Eigen::Infinity>();
+                if (outcome.correction <= options.tolerance or
+                    not(outcome.correction < 0.5 * previous)) {
+                    break;
+                }
+                previous = outcome.correction;
+            }
+        }
+    }
+    // normwise backward error, small when u solves a nearby system
+    auto backwardError = [&] {
+        return residual(u).lpNorm<Eigen::Infinity>() /
+               (N.cwiseAbs().rowwise().sum().maxCoeff() *
+                    u.lpNorm<Eigen::Infinity>() +
+                rhs.lpNorm<Eigen::Infinity>());
+    };
+    outcome.backward_error = backwardError();
+    outcome.converged = outcome.correction <= options.tolerance or
+                        outcome.backward_error <= options.tolerance;
+    if (not outcome.converged and options.fallback) {
+        ELLIPSOID_TRACE("fit.svd_solve");
+        u = N.bdcSvd(Eigen::ComputeFullU | Eigen::ComputeFullV).solve(rhs);
+        outcome.fallback = true;
+        outcome.backward_error = backwardError();
+    }
+    if (report != nullptr) {
+        *report = outcome;
+    }
+
+    // the solution is relative to the moments' origin
+    FitResult result;
+    if (not u.allFinite()) {
+        constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+        result.parameters.center.setConstant(nan);
+        result.parameters.radii.setConstant(nan);
+        result.coefficients.setConstant(nan);
+        result.eval.setConstant(nan);
+        result.evec_column.setConstant(nan);
+        return result;
+    }
+    const auto v = detail::coefficientsFromSolution(u, type);
+    result.parameters =
+        fromCoefficients(v, &result.eval, &result.evec_column);
+    result.parameters.center += moments.origin();
+    result.coefficients = detail::translateCoefficients(v, moments.origin());
+    return result;
+}
+
+FitResult fitRefined(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    EllipsoidType type, const RefinementOptions& options,
+    RefinementReport* report) {
+    Moments moments;
+    moments.add(data);
+    return fitRefined(moments, type, options, report);
+}
+
+} // namespace ellipsoid
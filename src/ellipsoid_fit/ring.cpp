@@ -0,0 +1,324 @@
+#include <ellipsoid/ring.h>
+
+#include "tracing.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+namespace ellipsoid {
+
+namespace detail {
+
+constexpr uint32_t ring_magic = 0x45464952; // "EFIR"
+constexpr uint32_t ring_version = 1;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "lock-free 64 bits atomics are required in shared memory");
+
+/*
+ * Start of the shared memory segment, followed by the x, y and z arrays of
+ * capacity doubles each. The producer and consumer indices live on separate
+ * cache lines to avoid false sharing.
+ */
+struct RingHeader {
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint64_t capacity;
+    std::atomic<uint32_t> closed;
+
+    // written by the producer
+    alignas(64) std::atomic<uint64_t> head;
+    std::atomic<uint64_t> overruns;
+    std::atomic<uint64_t> stalls;
+
+    // written by the consumer
+    alignas(64) std::atomic<uint64_t> tail;
+};
+
+} // namespace detail
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t header_size = (sizeof(detail::RingHeader) + 63) / 64 * 64;
+
+std::string segmentName(const std::string& name) {
+    return name.empty() or name[0] != '/' ? '/' + name : name;
+}
+
+size_t segmentSize(size_t capacity) {
+    return header_size + 3 * capacity * sizeof(double);
+}
+
+void* map(int fd, size_t size, const std::string& what) {
+    void* address =
+        ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        const auto error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), what);
+    }
+    ::close(fd);
+    return address;
+}
+
+// Busy wait a little before yielding, true if the condition is met before
+// the deadline
+template <typename Condition>
+bool waitUntil(Condition condition, std::chrono::nanoseconds timeout) {
+    constexpr int spins = 1000;
+    for (int i = 0; i < spins; ++i) {
+        if (condition()) {
+            return true;
+        }
+    }
+    const auto deadline = Clock::now() + timeout;
+    while (Clock::now() < deadline) {
+        if (condition()) {
+            return true;
+        }
+        std::this_thread::yield();
+    }
+    return condition();
+}
+
+RingCounters makeCounters(const detail::RingHeader& header) {
+    RingCounters counters;
+    counters.written = header.head.load(std::memory_order_acquire);
+    counters.read = header.tail.load(std::memory_order_acquire);
+    counters.overruns = header.overruns.load(std::memory_order_relaxed);
+    counters.stalls = header.stalls.load(std::memory_order_relaxed);
+    return counters;
+}
+
+} // namespace
+
+RingWriter::RingWriter(const std::string& name, size_t capacity)
+    : name_(segmentName(name)), cached_tail_(0) {
+    size_t rounded = 1;
+    while (rounded < std::max<size_t>(capacity, 1)) {
+        rounded <<= 1;
+    }
+    size_ = segmentSize(rounded);
+
+    ::shm_unlink(name_.c_str());
+    const int fd = ::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                "ellipsoid::RingWriter: shm_open " + name_);
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size_)) < 0) {
+        const auto error = errno;
+        ::close(fd);
+        ::shm_unlink(name_.c_str());
+        throw std::system_error(error, std::generic_category(),
+                                "ellipsoid::RingWriter: ftruncate " + name_);
+    }
+    void* address = nullptr;
+    try {
+        address = map(fd, size_, "ellipsoid::RingWriter: mmap " + name_);
+    } catch (...) {
+        // map() closed the descriptor, remove the segment it was for
+        ::shm_unlink(name_.c_str());
+        throw;
+    }
+
+    header_ = new (address) detail::RingHeader;
+    header_->version = detail::ring_version;
+    header_->capacity = rounded;
+    header_->closed.store(0, std::memory_order_relaxed);
+    header_->head.store(0, std::memory_order_relaxed);
+    header_->overruns.store(0, std::memory_order_relaxed);
+    header_->stalls.store(0, std::memory_order_relaxed);
+    header_->tail.store(0, std::memory_order_relaxed);
+    // readers check the magic number last
+    header_->magic.store(detail::ring_magic, std::memory_order_release);
+
+    samples_ = reinterpret_cast<double*>(static_cast<char*>(address) +
+                                         header_size);
+    head_ = 0;
+}
+
+RingWriter::~RingWriter() {
+    close();
+    ::munmap(header_, size_);
+    ::shm_unlink(name_.c_str());
+}
+
+size_t RingWriter::write(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& samples,
+    std::chrono::nanoseconds timeout) {
+    const auto capacity = header_->capacity;
+    const auto mask = capacity - 1;
+    const auto count = static_cast<size_t>(samples.rows());
+    size_t written = 0;
+    bool stalled = false;
+
+    while (written < count) {
+        // the reader's index is only fetched when the ring looks full
+        if (head_ - cached_tail_ == capacity) {
+            cached_tail_ = header_->tail.load(std::memory_order_acquire);
+        }
+        if (head_ - cached_tail_ == capacity) {
+            if (not stalled) {
+                stalled = true;
+                header_->stalls.fetch_add(1, std::memory_order_relaxed);
+            }
+            const bool freed = waitUntil(
+                [this, capacity] {
+                    cached_tail_ =
+                        header_->tail.load(std::memory_order_acquire);
+                    return head_ - cached_tail_ < capacity;
+                },
+                timeout);
+            if (not freed) {
+                break;
+            }
+        }
+
+        const auto start = head_ & mask;
+        const auto n = std::min<size_t>(
+            {count - written, capacity - (head_ - cached_tail_),
+             capacity - start});
+        for (Eigen::Index c = 0; c < 3; ++c) {
+            Eigen::Map<Eigen::VectorXd>(samples_ + c * capacity + start,
+                                        static_cast<Eigen::Index>(n)) =
+                samples.col(c).segment(static_cast<Eigen::Index>(written),
+                                       static_cast<Eigen::Index>(n));
+        }
+        head_ += n;
+        written += n;
+        header_->head.store(head_, std::memory_order_release);
+    }
+
+    if (written < count) {
+        header_->overruns.fetch_add(count - written,
+                                    std::memory_order_relaxed);
+    }
+    return written;
+}
+
+bool RingWriter::write(double x, double y, double z,
+                       std::chrono::nanoseconds timeout) {
+    const Eigen::RowVector3d sample(x, y, z);
+    return write(sample, timeout) == 1;
+}
+
+void RingWriter::close() {
+    header_->closed.store(1, std::memory_order_release);
+}
+
+size_t RingWriter::available() const {
+    return header_->capacity -
+           (head_ - header_->tail.load(std::memory_order_acquire));
+}
+
+size_t RingWriter::capacity() const {
+    return header_->capacity;
+}
+
+RingCounters RingWriter::counters() const {
+    return makeCounters(*header_);
+}
+
+RingReader::RingReader(const std::string& name) {
+    const auto segment = segmentName(name);
+    const int fd = ::shm_open(segment.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                "ellipsoid::RingReader: shm_open " + segment);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) < 0) {
+        const auto error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(),
+                                "ellipsoid::RingReader: fstat " + segment);
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ < header_size) {
+        ::close(fd);
+        throw std::runtime_error("ellipsoid::RingReader: " + segment +
+                                 " is not a sample ring");
+    }
+    void* address = map(fd, size_, "ellipsoid::RingReader: mmap " + segment);
+
+    header_ = static_cast<detail::RingHeader*>(address);
+    if (header_->magic.load(std::memory_order_acquire) != detail::ring_magic or
+        header_->version != detail::ring_version or
+        segmentSize(header_->capacity) != size_) {
+        ::munmap(address, size_);
+        throw std::runtime_error("ellipsoid::RingReader: " + segment +
+                                 " is not a sample ring");
+    }
+    samples_ = reinterpret_cast<const double*>(static_cast<char*>(address) +
+                                               header_size);
+    tail_ = header_->tail.load(std::memory_order_acquire);
+}
+
+RingReader::~RingReader() {
+    ::munmap(header_, size_);
+}
+
+size_t RingReader::read(Moments& moments, size_t max) {
+    using Samples = Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 3>,
+                               0, Eigen::OuterStride<>>;
+
+    const auto capacity = header_->capacity;
+    const auto head = header_->head.load(std::memory_order_acquire);
+    const auto count = std::min<uint64_t>(head - tail_, max);
+    const auto start = tail_ & (capacity - 1);
+    ELLIPSOID_TRACE_COUNT("ring.read", count, count * 3 * sizeof(double));
+
+    // at most two contiguous spans when the samples wrap around
+    const auto first = std::min<uint64_t>(count, capacity - start);
+    moments.add(Samples(samples_ + start, static_cast<Eigen::Index>(first), 3,
+                        Eigen::OuterStride<>(capacity)));
+    if (count > first) {
+        moments.add(Samples(samples_, static_cast<Eigen::Index>(count - first),
+                            3, Eigen::OuterStride<>(capacity)));
+    }
+
+    tail_ += count;
+    header_->tail.store(tail_, std::memory_order_release);
+    return count;
+}
+
+bool RingReader::wait(std::chrono::nanoseconds timeout) {
+    return waitUntil(
+        [this] {
+            return header_->head.load(std::memory_order_acquire) != tail_ or
+                   closed();
+        },
+        timeout) and
+           available() > 0;
+}
+
+size_t RingReader::available() const {
+    return header_->head.load(std::memory_order_acquire) - tail_;
+}
+
+bool RingReader::closed() const {
+    return header_->closed.load(std::memory_order_acquire) != 0;
+}
+
+size_t RingReader::capacity() const {
+    return header_->capacity;
+}
+
+RingCounters RingReader::counters() const {
+    return makeCounters(*header_);
+}
+
+} // namespace ellipsoid
@@ -0,0 +1,287 @@
+#include <ellipsoid/robust.h>
+#include <ellipsoid/executor.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace ellipsoid {
+
+namespace {
+
+// Number of points processed at once
+constexpr Eigen::Index chunk_size = 256;
+
+// Minimum number of points processed by a single thread
+constexpr Eigen::Index min_rows_per_band = 16384;
+
+// Quadratic form of an ellipsoid: (p-c)^T Q (p-c) = 1 on its surface
+struct QuadraticForm {
+    Eigen::Vector3d center;
+    Eigen::Matrix3d Q;
+};
+
+QuadraticForm quadraticForm(const Moments& moments, EllipsoidType type) {
+    QuadraticForm form;
+    Eigen::Vector3d eval;
+    Eigen::Matrix3d evec_column;
+    form.center = fit(moments, &eval, &evec_column, type).center;
+    form.Q = evec_column * eval.asDiagonal() * evec_column.transpose();
+    return form;
+}
+
+// Normalized algebraic residuals |(p-c)^T Q (p-c) - 1| of a set of points
+Eigen::ArrayXd
+residuals(const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>&
+              points,
+          const QuadraticForm& form) {
+    const Eigen::Matrix<double, Eigen::Dynamic, 3> centered =
+        points.rowwise() - form.center.transpose();
+    return ((centered * form.Q).cwiseProduct(centered).rowwise().sum().array() -
+            1.)
+        .abs();
+}
+
+using ChunkResiduals = Eigen::Array<double, chunk_size, 1>;
+
+// Same residuals for at most chunk_size points, written at the beginning of
+// r, without heap allocation
+void chunkResiduals(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& points,
+    const QuadraticForm& form, ChunkResiduals& r) {
+    const auto n = points.rows();
+    Eigen::Matrix<double, chunk_size, 3> centered;
+    centered.topRows(n) = points.rowwise() - form.center.transpose();
+    r.head(n) = (centered.topRows(n)
+                     .lazyProduct(form.Q)
+                     .cwiseProduct(centered.topRows(n))
+                     .rowwise()
+                     .sum()
+                     .array() -
+                 1.)
+                    .abs();
+}
+
+// Call body(first, last) on bands of rows, in parallel for large inputs
+template <typename Body>
+void forEachBand(Eigen::Index rows, size_t bands, const Body& body) {
+    const auto per_band = (rows + static_cast<Eigen::Index>(bands) - 1) /
+                          static_cast<Eigen::Index>(bands);
+    defaultExecutor()->parallelFor(bands, [&](size_t band) {
+        const auto first = static_cast<Eigen::Index>(band) * per_band;
+        const auto last = std::min(first + per_band, rows);
+        body(band, first, last);
+    });
+}
+
+} // namespace
+
+QuantileSketch::QuantileSketch(double relative_accuracy, double min_value,
+                               double max_value)
+    : gamma_((1. + relative_accuracy) / (1. - relative_accuracy)),
+      log_gamma_(std::log(gamma_)),
+      min_value_(min_value),
+      count_(0) {
+    bins_.resize(static_cast<size_t>(
+                     std::ceil(std::log(max_value / min_value) / log_gamma_)) +
+                 1);
+}
+
+void QuantileSketch::add(double value) {
+    ++bins_[bin(value)];
+    ++count_;
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    for (size_t i = 0; i < bins_.size(); ++i) {
+        bins_[i] += other.bins_[i];
+    }
+    count_ += other.count_;
+}
+
+double QuantileSketch::quantile(double q) const {
+    if (count_ == 0) {
+        return 0.;
+    }
+    const auto rank = static_cast<size_t>(
+        std::max(0., std::min(q, 1.)) * static_cast<double>(count_ - 1));
+    size_t seen = 0;
+    size_t i = 0;
+    for (; i < bins_.size(); ++i) {
+        seen += bins_[i];
+        if (seen > rank) {
+            break;
+        }
+    }
+    // middle of the bin in the relative sense
+    return min_value_ * std::pow(gamma_, static_cast<double>(i)) * 2. /
+           (1. + gamma_);
+}
+
+size_t QuantileSketch::count() const {
+    return count_;
+}
+
+size_t QuantileSketch::bin(double value) const {
+    if (not(value > min_value_)) {
+        return 0;
+    }
+    const auto idx = std::ceil(std::log(value / min_value_) / log_gamma_);
+    return std::min(static_cast<size_t>(idx), bins_.size() - 1);
+}
+
+Parameters fitRobust(const Eigen::Matrix<double, Eigen::Dynamic, 3>& data,
+                     EllipsoidType type, const RobustOptions& options) {
+    return fitRobust(data, nullptr, nullptr, type, options);
+}
+
+Parameters fitRobust(const Eigen::Matrix<double, Eigen::Dynamic, 3>& data,
+                     Eigen::Matrix<double, 10, 1>* coefficients_p,
+                     size_t* inliers_p, EllipsoidType type,
+                     const RobustOptions& options) {
+    const Eigen::Index rows = data.rows();
+    if (rows == 0) {
+        // no sample to take the medians of
+        constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+        if (coefficients_p != nullptr) {
+            coefficients_p->setConstant(nan);
+        }
+        if (inliers_p != nullptr) {
+            *inliers_p = 0;
+        }
+        Parameters params;
+        params.center.setConstant(nan);
+        params.radii.setConstant(nan);
+        return params;
+    }
+
+    // provisional fit on a subsample, trimmed once to remove the outliers
+    const Eigen::Index stride = std::max<Eigen::Index>(
+        1, rows / static_cast<Eigen::Index>(
+                      std::max<size_t>(options.provisional_samples, 1)));
+    Eigen::Matrix<double, Eigen::Dynamic, 3> samples((rows + stride - 1) /
+                                                         stride,
+                                                     3);
+    // pick a pseudo random point in each stride so that periodic outliers
+    // don't alias with the sampling
+    uint32_t state = 0x9E3779B9u;
+    for (Eigen::Index i = 0; i < samples.rows(); ++i) {
+        state = state * 1664525u + 1013904223u;
+        const auto span = std::min(stride, rows - i * stride);
+        samples.row(i) = data.row(i * stride + static_cast<Eigen::Index>(
+                                                   (state >> 8) % span));
+    }
+
+    auto median = [](Eigen::ArrayXd values) {
+        const auto mid = values.size() / 2;
+        std::nth_element(values.data(), values.data() + mid,
+                         values.data() + values.size());
+        return values(mid);
+    };
+    auto quantile = [&options](Eigen::ArrayXd values) {
+        const auto nth = static_cast<Eigen::Index>(
+            options.quantile * static_cast<double>(values.size() - 1));
+        std::nth_element(values.data(), values.data() + nth,
+                         values.data() + values.size());
+        return values(nth);
+    };
+
+    // refine the ellipsoid keeping only the expected fraction of inliers
+    // (concentration steps), giving the quantile of the final residuals
+    using Selection = Eigen::Array<bool, Eigen::Dynamic, 1>;
+    auto concentrate = [&](Selection kept, double& spread) {
+        QuadraticForm form;
+        for (size_t iteration = 0;
+             iteration <= options.provisional_iterations; ++iteration) {
+            Moments provisional;
+            for (Eigen::Index i = 0; i < samples.rows(); ++i) {
+                if (kept(i)) {
+                    provisional.add(samples(i, 0), samples(i, 1),
+                                    samples(i, 2));
+                }
+            }
+            form = quadraticForm(provisional, type);
+            const Eigen::ArrayXd r = residuals(samples, form);
+            spread = quantile(r);
+            kept = r <= spread;
+        }
+        return form;
+    };
+
+    // start from all the samples and from the ones whose distance to the
+    // median point is typical, keeping the best result
+    const Eigen::Vector3d median_point(median(samples.col(0).array()),
+                                       median(samples.col(1).array()),
+                                       median(samples.col(2).array()));
+    const Eigen::ArrayXd distances =
+        (samples.rowwise() - median_point.transpose()).rowwise().norm();
+    const Eigen::ArrayXd deviations = (distances - median(distances)).abs();
+
+    double spread_all = 0.;
+    double spread_radial = 0.;
+    auto form = concentrate(Selection::Constant(samples.rows(), true),
+                            spread_all);
+    auto radial_form =
+        concentrate(deviations <= quantile(deviations), spread_radial);
+    if (not(spread_all <= spread_radial)) {
+        form = radial_form;
+    }
+
+    const size_t bands = static_cast<size_t>(std::max<Eigen::Index>(
+        1, std::min<Eigen::Index>(defaultExecutor()->concurrency(),
+                                  rows / min_rows_per_band)));
+
+    // first pass: distribution of the residuals
+    std::vector<QuantileSketch> sketches(bands);
+    forEachBand(rows, bands,
+                [&](size_t band, Eigen::Index first, Eigen::Index last) {
+                    ChunkResiduals r;
+                    for (Eigen::Index start = first; start < last;
+                         start += chunk_size) {
+                        const auto n = std::min(chunk_size, last - start);
+                        chunkResiduals(data.middleRows(start, n), form, r);
+                        for (Eigen::Index i = 0; i < n; ++i) {
+                            sketches[band].add(r(i));
+                        }
+                    }
+                });
+    for (size_t band = 1; band < bands; ++band) {
+        sketches[0].merge(sketches[band]);
+    }
+    const double bound = options.margin * sketches[0].quantile(options.quantile);
+
+    // second pass: accumulate the inliers only
+    std::vector<Moments, Eigen::aligned_allocator<Moments>> band_moments(
+        bands);
+    forEachBand(
+        rows, bands, [&](size_t band, Eigen::Index first, Eigen::Index last) {
+            Eigen::Matrix<double, chunk_size, 3> inliers;
+            ChunkResiduals r;
+            for (Eigen::Index start = first; start < last;
+                 start += chunk_size) {
+                const auto n = std::min(chunk_size, last - start);
+                chunkResiduals(data.middleRows(start, n), form, r);
+                Eigen::Index count = 0;
+                for (Eigen::Index i = 0; i < n; ++i) {
+                    if (r(i) <= bound) {
+                        inliers.row(count++) = data.row(start + i);
+                    }
+                }
+                band_moments[band].add(inliers.topRows(count));
+            }
+        });
+
+    Moments moments;
+    for (const auto& partial : band_moments) {
+        moments.merge(partial);
+    }
+
+    if (inliers_p != nullptr) {
+        *inliers_p = moments.count();
+    }
+
+    return fit(moments, coefficients_p, type);
+}
+
+} // namespace ellipsoid
@@ -0,0 +1,354 @@
+#include <ellipsoid/batch.h>
+#include <ellipsoid/server.h>
+
+#include "protocol.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <set>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace ellipsoid {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Request {
+    EllipsoidType type;
+    Eigen::Matrix<double, Eigen::Dynamic, 3> points;
+    std::promise<detail::Reply> reply;
+    Clock::time_point received;
+};
+
+detail::Reply makeReply(detail::ReplyStatus status) {
+    detail::Reply reply;
+    std::memset(&reply, 0, sizeof(reply));
+    reply.magic = detail::protocol_magic;
+    reply.status = status;
+    return reply;
+}
+
+} // namespace
+
+struct Server::Impl {
+    explicit Impl(const ServerOptions& opts) : options(opts) {
+        if (options.workers == 0) {
+            options.workers =
+                std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+        options.max_batch_size = std::max<size_t>(1, options.max_batch_size);
+    }
+
+    void accept() {
+        while (running) {
+            const int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR or errno == ECONNABORTED) {
+                    continue;
+                }
+                // the listening socket has been shut down by stop()
+                return;
+            }
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            if (not running) {
+                ::close(fd);
+                return;
+            }
+            connections.insert(fd);
+            std::thread(&Impl::serve, this, fd).detach();
+        }
+    }
+
+    void serve(int fd) {
+        detail::RequestHeader header;
+        while (detail::readAll(fd, &header, sizeof(header))) {
+            if (header.magic != detail::protocol_magic) {
+                break;
+            }
+
+            // the points of an oversized request are not read so the
+            // stream cannot be resynchronized, close it after replying
+            if (header.count > options.max_points) {
+                ++rejected;
+                const auto reply =
+                    makeReply(detail::ReplyStatus::InvalidRequest);
+                detail::writeAll(fd, &reply, sizeof(reply));
+                break;
+            }
+
+            std::unique_ptr<Request> request(new Request);
+            request->type = static_cast<EllipsoidType>(header.type);
+            request->points.resize(static_cast<Eigen::Index>(header.count), 3);
+            if (not detail::readAll(fd, request->points.data(),
+                                    sizeof(double) * 3 * header.count)) {
+                break;
+            }
+            request->received = Clock::now();
+            points += header.count;
+
+            detail::Reply reply;
+            if (header.count == 0 or
+                header.type >
+                    static_cast<uint32_t>(EllipsoidType::AlignedXZEqual)) {
+                ++rejected;
+                reply = makeReply(detail::ReplyStatus::InvalidRequest);
+            } else {
+                auto future = request->reply.get_future();
+                if (enqueue(request)) {
+                    reply = future.get();
+                } else {
+                    ++rejected;
+                    reply = makeReply(detail::ReplyStatus::Overloaded);
+                }
+            }
+            if (not detail::writeAll(fd, &reply, sizeof(reply))) {
+                break;
+            }
+        }
+
+        // closed under the lock, once erased, so that stop() never shuts
+        // down a reused descriptor
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        connections.erase(fd);
+        ::close(fd);
+        connections_closed.notify_all();
+    }
+
+    // Takes ownership of the request on success
+    bool enqueue(std::unique_ptr<Request>& request) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (not running or queue.size() >= options.max_pending) {
+                return false;
+            }
+            queue.push_back(request.release());
+        }
+        queue_changed.notify_one();
+        return true;
+    }
+
+    void respond(Request& request, const detail::Reply& reply) {
+        const auto latency =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - request.received)
+                .count();
+        latency_sum += static_cast<uint64_t>(latency);
+        auto max = latency_max.load();
+        while (static_cast<uint64_t>(latency) > max and
+               not latency_max.compare_exchange_weak(
+                   max, static_cast<uint64_t>(latency))) {
+        }
+        request.reply.set_value(reply);
+    }
+
+    // Solve the requests of the batch with the given type together
+    void solve(const std::vector<std::unique_ptr<Request>>& batch,
+               EllipsoidType type) {
+        std::vector<Request*> members;
+        std::vector<Moments, Eigen::aligned_allocator<Moments>> problems;
+        for (const auto& request : batch) {
+            if (request->type == type) {
+                members.push_back(request.get());
+                problems.emplace_back(
+                    request->points.colwise().mean().transpose());
+                problems.back().add(request->points);
+            }
+        }
+
+        FitResults results;
+        bool solved = true;
+        try {
+            results = fitBatch(problems, type);
+        } catch (const std::exception&) {
+            solved = false;
+        }
+        for (size_t i = 0; i < members.size(); ++i) {
+            auto reply = makeReply(detail::ReplyStatus::Success);
+            if (solved) {
+                detail::toReply(results[i], reply);
+                ++requests;
+            } else {
+                reply = makeReply(detail::ReplyStatus::InvalidRequest);
+                ++rejected;
+            }
+            respond(*members[i], reply);
+        }
+    }
+
+    void work() {
+        std::vector<std::unique_ptr<Request>> batch;
+        batch.reserve(options.max_batch_size);
+        std::vector<EllipsoidType> types;
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_changed.wait(
+                    lock, [this] { return not queue.empty() or not running; });
+                if (queue.empty()) {
+                    return;
+                }
+                if (queue.size() < options.max_batch_size and running and
+                    options.batch_window.count() > 0) {
+                    queue_changed.wait_for(lock, options.batch_window, [this] {
+                        return queue.size() >= options.max_batch_size or
+                               not running;
+                    });
+                }
+                const auto size = std::min(queue.size(), options.max_batch_size);
+                for (size_t i = 0; i < size; ++i) {
+                    batch.emplace_back(queue.front());
+                    queue.pop_front();
+                }
+            }
+            if (batch.empty()) {
+                // another worker emptied the queue during the batch window
+                continue;
+            }
+
+            // fitBatch() solves problems of a single type at once
+            types.clear();
+            for (const auto& request : batch) {
+                if (std::find(types.begin(), types.end(), request->type) ==
+                    types.end()) {
+                    types.push_back(request->type);
+                }
+            }
+            for (const auto type : types) {
+                solve(batch, type);
+            }
+            batch.clear();
+            ++batches;
+        }
+    }
+
+    ServerOptions options;
+    int listen_fd{-1};
+    std::atomic<bool> running{false};
+    Clock::time_point started;
+
+    std::thread acceptor;
+    std::vector<std::thread> workers;
+
+    std::mutex connections_mutex;
+    std::condition_variable connections_closed;
+    std::set<int> connections;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_changed;
+    std::deque<Request*> queue;
+
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> rejected{0};
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> points{0};
+    std::atomic<uint64_t> latency_sum{0};
+    std::atomic<uint64_t> latency_max{0};
+};
+
+Server::Server(const ServerOptions& options) : impl_(new Impl(options)) {
+}
+
+Server::~Server() {
+    stop();
+}
+
+void Server::start() {
+    if (impl_->running) {
+        return;
+    }
+
+    const auto& path = impl_->options.socket_path;
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::system_error(ENAMETOOLONG, std::generic_category(),
+                                "ellipsoid::Server: " + path);
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                "ellipsoid::Server: socket");
+    }
+    // remove a socket left by a previous instance
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address),
+               sizeof(address)) < 0 or
+        ::listen(fd, SOMAXCONN) < 0) {
+        const auto error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(),
+                                "ellipsoid::Server: bind " + path);
+    }
+
+    impl_->listen_fd = fd;
+    impl_->started = Clock::now();
+    impl_->running = true;
+    for (size_t i = 0; i < impl_->options.workers; ++i) {
+        impl_->workers.emplace_back(&Impl::work, impl_.get());
+    }
+    impl_->acceptor = std::thread(&Impl::accept, impl_.get());
+}
+
+void Server::stop() {
+    {
+        std::lock_guard<std::mutex> lock(impl_->queue_mutex);
+        if (not impl_->running) {
+            return;
+        }
+        impl_->running = false;
+    }
+
+    ::shutdown(impl_->listen_fd, SHUT_RDWR);
+    impl_->acceptor.join();
+    ::close(impl_->listen_fd);
+    ::unlink(impl_->options.socket_path.c_str());
+
+    // the workers solve the requests still queued before exiting
+    impl_->queue_changed.notify_all();
+    for (auto& worker : impl_->workers) {
+        worker.join();
+    }
+    impl_->workers.clear();
+
+    std::unique_lock<std::mutex> lock(impl_->connections_mutex);
+    for (auto fd : impl_->connections) {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+    impl_->connections_closed.wait(
+        lock, [this] { return impl_->connections.empty(); });
+}
+
+ServerMetrics Server::metrics() const {
+    ServerMetrics metrics;
+    metrics.requests = impl_->requests;
+    metrics.rejected = impl_->rejected;
+    metrics.batches = impl_->batches;
+    metrics.points = impl_->points;
+    metrics.mean_latency = std::chrono::nanoseconds(
+        metrics.requests > 0 ? impl_->latency_sum / metrics.requests : 0);
+    metrics.max_latency = std::chrono::nanoseconds(impl_->latency_max.load());
+    const auto elapsed =
+        std::chrono::duration<double>(Clock::now() - impl_->started).count();
+    metrics.throughput =
+        elapsed > 0. ? static_cast<double>(metrics.requests) / elapsed : 0.;
+    return metrics;
+}
+
+} // namespace ellipsoid
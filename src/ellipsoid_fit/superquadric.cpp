@@ -0,0 +1,413 @@
+#include <ellipsoid/superquadric.h>
+#include <ellipsoid/executor.h>
+
+#include "tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ellipsoid {
+
+namespace {
+
+// One point per lane, as many lanes as the widest SIMD registers Eigen
+// targets can hold, with at least 4 for instruction level parallelism
+constexpr int lanes = EIGEN_MAX_STATIC_ALIGN_BYTES >= 64 ? 8 : 4;
+
+using Lane = Eigen::Array<double, lanes, 1>;
+
+// radii, exponents, rotation then translation
+constexpr int parameter_count = 11;
+
+using Vector11d = Eigen::Matrix<double, parameter_count, 1>;
+using Matrix11d = Eigen::Matrix<double, parameter_count, parameter_count>;
+using LaneJacobian = Eigen::Matrix<double, lanes, parameter_count>;
+using Points = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+using PointsRef = Eigen::Ref<const Points>;
+
+// Points whose normal equations are accumulated by an executor task
+constexpr Eigen::Index points_per_task = 4096;
+
+// Keeps the logarithms finite for coordinates on the planes of the axes
+constexpr double tiny = 1e-150;
+
+// Smallest logarithm of the terms of F: they are negligible well before,
+// and the products of the Jacobian's entries would underflow below
+constexpr double log_floor = -100.;
+
+constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+
+// Normal equations J^T J and J^T r of a set of points, with the cost r^T r
+struct NormalEquations {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    NormalEquations() {
+        JtJ.setZero();
+        Jtr.setZero();
+    }
+
+    void merge(const NormalEquations& other) {
+        JtJ += other.JtJ;
+        Jtr += other.Jtr;
+        cost += other.cost;
+    }
+
+    Matrix11d JtJ;
+    Vector11d Jtr;
+    double cost{0.};
+};
+
+// Radial distances, and optionally their derivatives with respect to the
+// parameters, of lanes points already expressed in the superquadric's frame
+template <bool with_jacobian>
+Lane radialDistances(const Superquadric& sq, const Lane y[3],
+                     LaneJacobian* jacobian) {
+    const double e1 = sq.exponents(0);
+    const double e2 = sq.exponents(1);
+
+    // logarithms of |y_i / a_i| and of the terms of F
+    Lane l[3];
+    for (int i = 0; i < 3; ++i) {
+        l[i] = y[i].abs().max(tiny).log() - std::log(sq.radii(i));
+    }
+    const Lane lu = ((2. / e2) * l[0]).max(log_floor);
+    const Lane lv = ((2. / e2) * l[1]).max(log_floor);
+    const Lane lw = ((2. / e1) * l[2]).max(log_floor);
+    const Lane u = lu.exp();
+    const Lane v = lv.exp();
+    const Lane w = lw.exp();
+    const Lane s = u + v;
+    const Lane ls = s.log();
+    const Lane t = ((e2 / e1) * ls).max(log_floor).exp();
+    const Lane F = t + w;
+    const Lane lF = F.log();
+    const Lane g = ((-0.5 * e1) * lF).exp();
+    const Lane n = (y[0].square() + y[1].square() + y[2].square()).sqrt();
+    const Lane r = n * (1. - g);
+    if (not with_jacobian) {
+        return r;
+    }
+
+    // r = n (1 - F^(-e1/2)): dr = common dF for the parameters of F only
+    const Lane common = (0.5 * e1) * n * g / F;
+    const Lane pu = u / s;
+    const Lane pv = v / s;
+    const Lane tu = (2. / e1) * t * pu;
+    const Lane tv = (2. / e1) * t * pv;
+    const Lane tw = (2. / e1) * w;
+
+    // gradient with respect to the coordinates in the superquadric's frame
+    const Lane terms[3] = {tu, tv, tw};
+    const Lane n_inverse = n.max(tiny).inverse();
+    Lane G[3];
+    for (int i = 0; i < 3; ++i) {
+        const Lane signed_inverse =
+            (y[i] < 0.).select(-1., Lane::Ones()) / y[i].abs().max(tiny);
+        G[i] = common * terms[i] * signed_inverse + (1. - g) * y[i] * n_inverse;
+    }
+
+    auto& J = *jacobian;
+    for (int i = 0; i < 3; ++i) {
+        J.col(i) = (-common * terms[i] / sq.radii(i)).matrix();
+    }
+    const Lane dF_de1 = (-e2 / (e1 * e1)) * t * ls - w * lw / e1;
+    const Lane dF_de2 = (t / e1) * (ls - pu * lu - pv * lv);
+    J.col(3) = (0.5 * n * g * lF + common * dF_de1).matrix();
+    J.col(4) = (common * dF_de2).matrix();
+    // y = R^T (p - c) with R right multiplied by a small rotation w:
+    // dy/dw = [y]x and dy/dc = -R^T
+    J.col(5) = (G[1] * y[2] - G[2] * y[1]).matrix();
+    J.col(6) = (G[2] * y[0] - G[0] * y[2]).matrix();
+    J.col(7) = (G[0] * y[1] - G[1] * y[0]).matrix();
+    for (int i = 0; i < 3; ++i) {
+        J.col(8 + i) = -(sq.axes(i, 0) * G[0] + sq.axes(i, 1) * G[1] +
+                         sq.axes(i, 2) * G[2])
+                            .matrix();
+    }
+    return r;
+}
+
+// Normal equations of the points, or only the cost, in parallel
+template <bool with_jacobian>
+NormalEquations accumulate(const PointsRef& points, const Superquadric& sq) {
+    const Eigen::Index rows = points.rows();
+    const size_t tasks = static_cast<size_t>(
+        std::max<Eigen::Index>(1, (rows + points_per_task - 1) /
+                                      points_per_task));
+    std::vector<NormalEquations, Eigen::aligned_allocator<NormalEquations>>
+        partial(tasks);
+    defaultExecutor()->parallelFor(tasks, [&](size_t task) {
+        const auto first = static_cast<Eigen::Index>(task) * points_per_task;
+        const auto last = std::min(first + points_per_task, rows);
+        auto& equations = partial[task];
+        LaneJacobian J;
+        Lane cost = Lane::Zero();
+        for (Eigen::Index start = first; start < last; start += lanes) {
+            const auto n = std::min<Eigen::Index>(lanes, last - start);
+            Lane p[3];
+            for (int i = 0; i < 3; ++i) {
+                // the missing lanes repeat the first point
+                p[i].setConstant(points(start, i) - sq.center(i));
+                p[i].head(n) =
+                    points.col(i).segment(start, n).array() - sq.center(i);
+            }
+            Lane y[3];
+            for (int i = 0; i < 3; ++i) {
+                y[i] = sq.axes(0, i) * p[0] + sq.axes(1, i) * p[1] +
+                       sq.axes(2, i) * p[2];
+            }
+            Lane r = radialDistances<with_jacobian>(sq, y, &J);
+            r.tail(lanes - n).setZero();
+            cost += r.square();
+            if (with_jacobian) {
+                J.bottomRows(lanes - n).setZero();
+                equations.JtJ.noalias() += J.transpose() * J;
+                equations.Jtr.noalias() += J.transpose() * r.matrix();
+            }
+        }
+        equations.cost = cost.sum();
+    });
+    for (size_t task = 1; task < tasks; ++task) {
+        partial[0].merge(partial[task]);
+    }
+    return partial[0];
+}
+
+// Superquadric moved by a step of the parameters, kept within the bounds
+Superquadric step(const Superquadric& sq, const Vector11d& delta,
+                  const SuperquadricOptions& options) {
+    Superquadric moved = sq;
+    moved.radii = (sq.radii + delta.head<3>())
+                      .cwiseMax(1e-6 * sq.radii.maxCoeff());
+    moved.exponents = (sq.exponents + delta.segment<2>(3))
+                          .cwiseMax(options.min_exponent)
+                          .cwiseMin(options.max_exponent);
+    const Eigen::Vector3d rotation = delta.segment<3>(5);
+    const double angle = rotation.norm();
+    if (angle > 0.) {
+        moved.axes =
+            sq.axes * Eigen::AngleAxisd(angle, rotation / angle).matrix();
+    }
+    moved.center = sq.center + delta.tail<3>();
+    return moved;
+}
+
+// Subsample of the points drawn for one iteration, a pseudo random point per
+// stride so that periodic patterns don't alias with the sampling
+void subsample(const PointsRef& data, size_t samples, uint32_t& state,
+               Points& subset) {
+    const Eigen::Index rows = data.rows();
+    const Eigen::Index stride =
+        std::max<Eigen::Index>(1, rows / static_cast<Eigen::Index>(samples));
+    subset.resize((rows + stride - 1) / stride, 3);
+    for (Eigen::Index i = 0; i < subset.rows(); ++i) {
+        state = state * 1664525u + 1013904223u;
+        const auto span = std::min(stride, rows - i * stride);
+        subset.row(i) = data.row(i * stride + static_cast<Eigen::Index>(
+                                                  (state >> 8) % span));
+    }
+}
+
+// Levenberg-Marquardt iterations from an initial guess, the distance of the
+// result being given on the points used by the last iteration
+Superquadric refine(const PointsRef& data, Superquadric sq,
+                    const SuperquadricOptions& options) {
+    const bool subsampled =
+        options.samples > 0 and
+        static_cast<Eigen::Index>(options.samples) < data.rows();
+    uint32_t state = 0x9E3779B9u;
+    Points subset;
+    if (subsampled) {
+        subsample(data, options.samples, state, subset);
+    }
+    // on the points of the current iteration
+    auto normalEquations = [&](const Superquadric& at) {
+        return subsampled ? accumulate<true>(subset, at)
+                          : accumulate<true>(data, at);
+    };
+
+    // the parameters fitted on a subsample are off by its sampling error, so
+    // moving them to the optimum of the next one decreases the cost by about
+    // 2 parameter_count / samples even at the optimum of all the points: the
+    // iterations stop below twice that
+    const double threshold =
+        subsampled ? std::max(options.tolerance,
+                              4. * parameter_count /
+                                  static_cast<double>(subset.rows()))
+                   : options.tolerance;
+
+    NormalEquations equations = normalEquations(sq);
+    double damping = 1e-3;
+    sq.iterations = 0;
+    while (sq.iterations < options.max_iterations and equations.cost > 0.) {
+        ++sq.iterations;
+        // scaled damping, the diagonal of J^T J being kept positive for the
+        // parameters the points don't depend on
+        const Vector11d diagonal = equations.JtJ.diagonal().cwiseMax(
+            1e-12 * equations.JtJ.diagonal().maxCoeff() +
+            std::numeric_limits<double>::min());
+        bool improved = false;
+        NormalEquations moved_equations;
+        Superquadric moved;
+        for (double growth = 2.; damping < 1e16; growth *= 2.) {
+            Matrix11d system = equations.JtJ;
+            system.diagonal() += damping * diagonal;
+            const Vector11d delta = system.ldlt().solve(-equations.Jtr);
+            // decrease of the cost predicted by the linearized residuals,
+            // nothing left to gain when it is negligible
+            const double predicted = delta.dot(
+                damping * diagonal.cwiseProduct(delta) - equations.Jtr);
+            if (not(predicted > threshold * equations.cost)) {
+                break;
+            }
+            moved = step(sq, delta, options);
+            moved_equations = normalEquations(moved);
+            if (moved_equations.cost < equations.cost) {
+                improved = true;
+                damping = std::max(damping / 3., 1e-12);
+                break;
+            }
+            damping *= growth;
+        }
+        if (not improved) {
+            break;
+        }
+        const double decrease = equations.cost - moved_equations.cost;
+        const double previous_cost = equations.cost;
+        moved.iterations = sq.iterations;
+        sq = moved;
+        if (decrease <= threshold * previous_cost) {
+            equations = moved_equations;
+            break;
+        }
+        if (subsampled) {
+            subsample(data, options.samples, state, subset);
+            equations = normalEquations(sq);
+        } else {
+            equations = moved_equations;
+        }
+    }
+    const auto count = subsampled ? subset.rows() : data.rows();
+    sq.rms_distance =
+        std::sqrt(equations.cost / static_cast<double>(count));
+    return sq;
+}
+
+// Ellipsoid fitted on the points, or their principal axes if it fails
+Superquadric seed(const PointsRef& data) {
+    Superquadric sq;
+    Moments moments;
+    moments.add(data);
+    Eigen::Vector3d eval;
+    const Parameters parameters = fit(moments, &eval, &sq.axes);
+    sq.center = parameters.center;
+    sq.radii = parameters.radii;
+    if (not sq.center.allFinite() or not sq.radii.allFinite() or
+        not sq.axes.allFinite()) {
+        // a sphere of radius r has a variance of r^2 / 3 along its axes
+        sq.center = data.colwise().mean().transpose();
+        const Points centered = data.rowwise() - sq.center.transpose();
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(
+            centered.transpose() * centered /
+            static_cast<double>(data.rows()));
+        sq.axes = solver.eigenvectors();
+        if (sq.axes.determinant() < 0.) {
+            sq.axes.col(0) = -sq.axes.col(0);
+        }
+        sq.radii = (3. * solver.eigenvalues().cwiseMax(0.)).cwiseSqrt();
+    }
+    sq.radii = sq.radii.cwiseMax(1e-6 * sq.radii.maxCoeff() +
+                                 std::numeric_limits<double>::min());
+    sq.exponents.setOnes();
+    return sq;
+}
+
+Superquadric invalid() {
+    Superquadric sq;
+    sq.center.setConstant(nan);
+    sq.radii.setConstant(nan);
+    sq.axes.setConstant(nan);
+    sq.exponents.setConstant(nan);
+    sq.rms_distance = nan;
+    sq.iterations = 0;
+    return sq;
+}
+
+// Distance of the refined superquadric to all the points when the
+// iterations used subsamples
+void finalDistance(const PointsRef& data, const SuperquadricOptions& options,
+                   Superquadric& sq) {
+    if (options.samples > 0 and
+        static_cast<Eigen::Index>(options.samples) < data.rows()) {
+        sq.rms_distance =
+            std::sqrt(accumulate<false>(data, sq).cost /
+                      static_cast<double>(data.rows()));
+    }
+}
+
+} // namespace
+
+Superquadric fitSuperquadric(const PointsRef& data,
+                             const SuperquadricOptions& options) {
+    ELLIPSOID_TRACE_COUNT("fit_superquadric",
+                          static_cast<uint64_t>(data.rows()),
+                          static_cast<uint64_t>(data.size()) * sizeof(double));
+    if (data.rows() < parameter_count) {
+        return invalid();
+    }
+    const Superquadric initial = seed(data);
+    Superquadric start = initial;
+    size_t frame_iterations = 0;
+    if (options.all_axes) {
+        // pick the frame on a subsample, then refine it on all the points
+        Points subset;
+        const bool subsampled =
+            options.frame_samples > 0 and
+            static_cast<Eigen::Index>(options.frame_samples) < data.rows();
+        if (subsampled) {
+            uint32_t state = 0x85EBCA6Bu;
+            subsample(data, options.frame_samples, state, subset);
+        }
+        SuperquadricOptions frame_options = options;
+        frame_options.samples = 0;
+        double best_distance = std::numeric_limits<double>::infinity();
+        for (int shift = 0; shift < 3; ++shift) {
+            Superquadric permuted = initial;
+            for (int i = 0; i < 3; ++i) {
+                permuted.axes.col(i) = initial.axes.col((i + shift) % 3);
+                permuted.radii(i) = initial.radii((i + shift) % 3);
+            }
+            const Superquadric candidate =
+                subsampled ? refine(subset, permuted, frame_options)
+                           : refine(data, permuted, frame_options);
+            frame_iterations += candidate.iterations;
+            if (candidate.rms_distance < best_distance) {
+                best_distance = candidate.rms_distance;
+                start = candidate;
+            }
+        }
+    }
+    Superquadric sq = refine(data, start, options);
+    finalDistance(data, options, sq);
+    sq.iterations += frame_iterations;
+    return sq;
+}
+
+Superquadric fitSuperquadric(const PointsRef& data,
+                             const Superquadric& initial,
+                             const SuperquadricOptions& options) {
+    ELLIPSOID_TRACE_COUNT("fit_superquadric",
+                          static_cast<uint64_t>(data.rows()),
+                          static_cast<uint64_t>(data.size()) * sizeof(double));
+    if (data.rows() < parameter_count) {
+        return invalid();
+    }
+    Superquadric sq = refine(data, initial, options);
+    finalDistance(data, options, sq);
+    return sq;
+}
+
+} // namespace ellipsoid
@@ -0,0 +1,331 @@
+#include <ellipsoid/trace.h>
+
+#include "tracing.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <system_error>
+
+namespace ellipsoid {
+
+namespace {
+
+// Write the whole string to a new file
+void writeFile(const std::string& path, const std::string& content) {
+    auto* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        throw std::system_error(errno, std::generic_category(),
+                                "ellipsoid::trace: cannot create " + path);
+    }
+    const bool written =
+        std::fwrite(content.data(), 1, content.size(), file) == content.size();
+    const int error = errno;
+    if (std::fclose(file) != 0 or not written) {
+        throw std::system_error(written ? errno : error,
+                                std::generic_category(),
+                                "ellipsoid::trace: cannot write " + path);
+    }
+}
+
+} // namespace
+
+#ifdef ELLIPSOID_FIT_TRACING
+
+namespace detail {
+
+std::atomic<bool> trace_recording{false};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t trace_buffer_capacity = 1 << 15;
+
+struct TraceEvent {
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+    uint64_t points;
+    uint64_t bytes;
+};
+
+// Events of a single thread, appended by it and read by the exporters
+struct TraceBuffer {
+    explicit TraceBuffer(uint32_t id)
+        : thread(id),
+          events(new TraceEvent[trace_buffer_capacity]),
+          size(0),
+          dropped(0) {
+    }
+
+    uint32_t thread;
+    std::unique_ptr<TraceEvent[]> events;
+    std::atomic<size_t> size;
+    std::atomic<uint64_t> dropped;
+};
+
+// The buffers outlive their thread so that they can be exported later
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    bool started = false;
+    uint64_t start_ticks = 0;
+    Clock::time_point start_time;
+};
+
+TraceRegistry& registry() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+TraceBuffer& threadBuffer() {
+    thread_local std::shared_ptr<TraceBuffer> buffer;
+    if (buffer == nullptr) {
+        auto& traces = registry();
+        std::lock_guard<std::mutex> lock(traces.mutex);
+        buffer = std::make_shared<TraceBuffer>(
+            static_cast<uint32_t>(traces.buffers.size()));
+        traces.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+struct ThreadEvent {
+    uint32_t thread;
+    TraceEvent event;
+};
+
+// Copy of the events recorded so far and conversion of their timestamps
+struct Snapshot {
+    std::vector<ThreadEvent> events;
+    std::vector<uint32_t> threads;
+    uint64_t origin;
+    double ticks_per_us;
+
+    double microseconds(uint64_t ticks) const {
+        return static_cast<double>(ticks - origin) / ticks_per_us;
+    }
+};
+
+Snapshot snapshot() {
+    auto& traces = registry();
+    std::lock_guard<std::mutex> lock(traces.mutex);
+    Snapshot result;
+    result.origin = traces.start_ticks;
+    result.ticks_per_us = 1.;
+    if (not traces.started) {
+        return result;
+    }
+
+    for (const auto& buffer : traces.buffers) {
+        const auto size = buffer->size.load(std::memory_order_acquire);
+        if (size > 0) {
+            result.threads.push_back(buffer->thread);
+        }
+        for (size_t i = 0; i < size; ++i) {
+            result.events.push_back(ThreadEvent{buffer->thread, buffer->events[i]});
+        }
+    }
+
+    // calibrate the counter against the steady clock, over at least 1ms
+    uint64_t ticks;
+    double elapsed;
+    do {
+        ticks = traceTicks();
+        elapsed = std::chrono::duration<double, std::micro>(Clock::now() -
+                                                            traces.start_time)
+                      .count();
+    } while (elapsed < 1000.);
+    result.ticks_per_us = static_cast<double>(ticks - traces.start_ticks) / elapsed;
+    return result;
+}
+
+} // namespace
+
+void traceRecord(const char* name, uint64_t begin, uint64_t end,
+                 uint64_t points, uint64_t bytes) {
+    auto& buffer = threadBuffer();
+    const auto size = buffer.size.load(std::memory_order_relaxed);
+    if (size == trace_buffer_capacity) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[size] = TraceEvent{name, begin, end, points, bytes};
+    buffer.size.store(size + 1, std::memory_order_release);
+}
+
+} // namespace detail
+
+namespace trace {
+
+bool available() {
+    return true;
+}
+
+void start() {
+    auto& traces = detail::registry();
+    {
+        std::lock_guard<std::mutex> lock(traces.mutex);
+        if (not traces.started) {
+            traces.start_time = detail::Clock::now();
+            traces.start_ticks = detail::traceTicks();
+            traces.started = true;
+        }
+    }
+    detail::trace_recording.store(true, std::memory_order_relaxed);
+}
+
+void stop() {
+    detail::trace_recording.store(false, std::memory_order_relaxed);
+}
+
+bool recording() {
+    return detail::traceRecording();
+}
+
+void clear() {
+    auto& traces = detail::registry();
+    std::lock_guard<std::mutex> lock(traces.mutex);
+    for (const auto& buffer : traces.buffers) {
+        buffer->size.store(0, std::memory_order_relaxed);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t dropped() {
+    auto& traces = detail::registry();
+    std::lock_guard<std::mutex> lock(traces.mutex);
+    uint64_t count = 0;
+    for (const auto& buffer : traces.buffers) {
+        count += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+std::vector<StageStatistics> statistics() {
+    const auto records = detail::snapshot();
+    std::map<std::string, StageStatistics> stages;
+    for (const auto& record : records.events) {
+        const auto& event = record.event;
+        auto& stage = stages[event.name];
+        stage.name = event.name;
+        stage.calls += 1;
+        stage.seconds +=
+            static_cast<double>(event.end - event.begin) / records.ticks_per_us * 1e-6;
+        stage.points += event.points;
+        stage.bytes += event.bytes;
+    }
+    std::vector<StageStatistics> result;
+    for (const auto& stage : stages) {
+        result.push_back(stage.second);
+    }
+    return result;
+}
+
+void writeChromeTrace(const std::string& path) {
+    auto records = detail::snapshot();
+    const auto pid = static_cast<long>(::getpid());
+    std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    char line[512];
+    bool first = true;
+    auto append = [&](int length) {
+        if (not first) {
+            json += ",\n";
+        }
+        json.append(line, static_cast<size_t>(length));
+        first = false;
+    };
+
+    for (const auto thread : records.threads) {
+        append(std::snprintf(line, sizeof(line),
+                             "{\"name\":\"thread_name\",\"ph\":\"M\","
+                             "\"pid\":%ld,\"tid\":%u,"
+                             "\"args\":{\"name\":\"thread %u\"}}",
+                             pid, thread, thread));
+    }
+    for (const auto& record : records.events) {
+        const auto& event = record.event;
+        append(std::snprintf(
+            line, sizeof(line),
+            "{\"name\":\"%s\",\"cat\":\"ellipsoid\",\"ph\":\"X\",\"pid\":%ld,"
+            "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+            "\"args\":{\"points\":%llu,\"bytes\":%llu}}",
+            event.name, pid, record.thread, records.microseconds(event.begin),
+            static_cast<double>(event.end - event.begin) / records.ticks_per_us,
+            static_cast<unsigned long long>(event.points),
+            static_cast<unsigned long long>(event.bytes)));
+    }
+
+    // cumulated counters, updated when each stage completes
+    std::sort(records.events.begin(), records.events.end(),
+              [](const detail::ThreadEvent& a, const detail::ThreadEvent& b) {
+                  return a.event.end < b.event.end;
+              });
+    unsigned long long points = 0;
+    unsigned long long bytes = 0;
+    for (const auto& record : records.events) {
+        const auto& event = record.event;
+        if (event.points == 0 and event.bytes == 0) {
+            continue;
+        }
+        points += event.points;
+        bytes += event.bytes;
+        append(std::snprintf(line, sizeof(line),
+                             "{\"name\":\"processed\",\"ph\":\"C\",\"pid\":%ld,"
+                             "\"ts\":%.3f,\"args\":{\"points\":%llu,"
+                             "\"bytes\":%llu}}",
+                             pid, records.microseconds(event.end), points,
+                             bytes));
+    }
+    json += "]}\n";
+
+    writeFile(path, json);
+}
+
+} // namespace trace
+
+#else
+
+namespace trace {
+
+bool available() {
+    return false;
+}
+
+void start() {
+}
+
+void stop() {
+}
+
+bool recording() {
+    return false;
+}
+
+void clear() {
+}
+
+uint64_t dropped() {
+    return 0;
+}
+
+std::vector<StageStatistics> statistics() {
+    return {};
+}
+
+void writeChromeTrace(const std::string& path) {
+    writeFile(path, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[]}\n");
+}
+
+} // namespace trace
+
+#endif
+
+} // namespace ellipsoid
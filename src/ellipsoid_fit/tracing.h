@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Instrumentation points, compiled in only when ELLIPSOID_FIT_TRACING is
+ * defined (ENABLE_TRACING option). Otherwise the macros expand to nothing
+ * and their arguments are not evaluated.
+ *
+ * ELLIPSOID_TRACE(name) records the enclosing scope
+ * ELLIPSOID_TRACE_COUNT(name, points, bytes) records the enclosing scope
+ * with its counters
+ *
+ * name must be a string literal
+ */
+#ifdef ELLIPSOID_FIT_TRACING
+
+#include <atomic>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define ELLIPSOID_TRACE_CONCAT_(a, b) a##b
+#define ELLIPSOID_TRACE_CONCAT(a, b) ELLIPSOID_TRACE_CONCAT_(a, b)
+#define ELLIPSOID_TRACE(name)                                                  \
+    ::ellipsoid::detail::TraceScope ELLIPSOID_TRACE_CONCAT(trace_scope_,       \
+                                                           __LINE__)(name, 0, 0)
+#define ELLIPSOID_TRACE_COUNT(name, points, bytes)                             \
+    ::ellipsoid::detail::TraceScope ELLIPSOID_TRACE_CONCAT(                    \
+        trace_scope_, __LINE__)(                                               \
+        name, ::ellipsoid::detail::traceRecording() ? (points) : 0,            \
+        ::ellipsoid::detail::traceRecording() ? (bytes) : 0)
+
+namespace ellipsoid {
+namespace detail {
+
+extern std::atomic<bool> trace_recording;
+
+inline bool traceRecording() {
+    return trace_recording.load(std::memory_order_relaxed);
+}
+
+// Timestamp counter: the TSC on x86, the virtual counter on ARM64
+inline uint64_t traceTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<uint64_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+void traceRecord(const char* name, uint64_t begin, uint64_t end,
+                 uint64_t points, uint64_t bytes);
+
+class TraceScope {
+public:
+    TraceScope(const char* name, uint64_t points, uint64_t bytes)
+        : name_(traceRecording() ? name : nullptr),
+          points_(points),
+          bytes_(bytes),
+          begin_(name_ != nullptr ? traceTicks() : 0) {
+    }
+
+    ~TraceScope() {
+        if (name_ != nullptr) {
+            traceRecord(name_, begin_, traceTicks(), points_, bytes_);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    uint64_t points_;
+    uint64_t bytes_;
+    uint64_t begin_;
+};
+
+} // namespace detail
+} // namespace ellipsoid
+
+#else
+
+#define ELLIPSOID_TRACE(name)                                                  \
+    do {                                                                       \
+    } while (false)
+#define ELLIPSOID_TRACE_COUNT(name, points, bytes)                             \
+    do {                                                                       \
+    } while (false)
+
+#endif
@@ -0,0 +1,125 @@
+#include <ellipsoid/executor.h>
+#include <ellipsoid/inline.h>
+#include <ellipsoid/tsqr.h>
+
+#include "basis.h"
+#include "tracing.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace ellipsoid {
+
+namespace {
+
+using Points = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+using Types = detail::FitTypes<Points>;
+
+// Upper triangular factor of [D d], at most 10x10
+using Triangular = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                                 Eigen::ColMajor, 10, 10>;
+
+// R factor of [R; B], B being the rows below R in stacked, which is
+// overwritten
+void factorize(Eigen::Ref<Eigen::MatrixXd> stacked) {
+    Eigen::HouseholderQR<Eigen::Ref<Eigen::MatrixXd>> qr(stacked);
+    const auto columns = stacked.cols();
+    stacked.topRows(columns).triangularView<Eigen::StrictlyLower>().setZero();
+}
+
+// R factor of the design matrix of the points, relative to origin, formed
+// block by block
+Triangular chunkFactor(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    const Eigen::Vector3d& origin, EllipsoidType type, Eigen::Index columns) {
+    constexpr auto block_rows = detail::tsqr_block_rows;
+    // the running R factor is kept above the next block of rows
+    Eigen::MatrixXd stacked = Eigen::MatrixXd::Zero(columns + block_rows,
+                                                    columns);
+    Points local;
+    Types::Points d2;
+    for (Eigen::Index start = 0; start < data.rows(); start += block_rows) {
+        const auto rows = std::min(block_rows, data.rows() - start);
+        local = data.middleRows(start, rows).rowwise() - origin.transpose();
+        stacked.middleRows(columns, rows) << detail::designMatrix(local, type,
+                                                                  d2),
+            d2;
+        factorize(stacked.topRows(columns + rows));
+    }
+    return stacked.topRows(columns);
+}
+
+} // namespace
+
+FitResult fitTsqr(
+    const Eigen::Ref<const Eigen::Matrix<double, Eigen::Dynamic, 3>>& data,
+    EllipsoidType type, size_t chunk_rows) {
+    const auto rows = data.rows();
+    ELLIPSOID_TRACE_COUNT("fit_tsqr", static_cast<uint64_t>(rows),
+                          static_cast<uint64_t>(data.size()) * sizeof(double));
+    const auto unknowns = detail::monomialBasis(type).cols();
+    const auto columns = unknowns + 1;
+    const auto chunk =
+        static_cast<Eigen::Index>(std::max<size_t>(chunk_rows, 1));
+    const auto chunks = static_cast<size_t>((rows + chunk - 1) / chunk);
+
+    // the design matrix is far better conditioned close to the points
+    Eigen::Vector3d origin = Eigen::Vector3d::Zero();
+    if (rows > 0) {
+        origin = data.topRows(std::min(chunk, rows)).colwise().mean();
+    }
+
+    std::vector<Triangular, Eigen::aligned_allocator<Triangular>> factors(
+        std::max<size_t>(chunks, 1), Triangular::Zero(columns, columns));
+    {
+        ELLIPSOID_TRACE_COUNT("fit.tsqr_chunks", static_cast<uint64_t>(rows),
+                              static_cast<uint64_t>(data.size()) *
+                                  sizeof(double));
+        defaultExecutor()->parallelFor(chunks, [&](size_t i) {
+            const auto start = static_cast<Eigen::Index>(i) * chunk;
+            factors[i] = chunkFactor(
+                data.middleRows(start, std::min(chunk, rows - start)), origin,
+                type, columns);
+        });
+    }
+
+    // binary reduction tree: at each level, factor i absorbs factor
+    // i + step
+    {
+        ELLIPSOID_TRACE("fit.tsqr_reduction");
+        for (size_t step = 1; step < factors.size(); step *= 2) {
+            const auto pairs = (factors.size() + 2 * step - 1) / (2 * step);
+            defaultExecutor()->parallelFor(pairs, [&](size_t pair) {
+                const auto i = 2 * step * pair;
+                if (i + step >= factors.size()) {
+                    return;
+                }
+                Eigen::MatrixXd stacked(2 * columns, columns);
+                stacked << factors[i], factors[i + step];
+                factorize(stacked);
+                factors[i] = stacked.topRows(columns);
+            });
+        }
+    }
+
+    // [R r; 0 rho] = qr([D d]), the least squares solution solves R u = r
+    const Triangular& R = factors.front();
+    Types::Unknowns u;
+    {
+        ELLIPSOID_TRACE("fit.svd_solve");
+        u = Eigen::JacobiSVD<Types::Normal>(
+                R.topLeftCorner(unknowns, unknowns),
+                Eigen::ComputeFullU | Eigen::ComputeFullV)
+                .solve(R.topRightCorner(unknowns, 1));
+    }
+
+    // the solution is relative to the origin
+    FitResult result;
+    const auto v = detail::coefficientsFromSolution(u, type);
+    result.parameters = fromCoefficients(v, &result.eval, &result.evec_column);
+    result.parameters.center += origin;
+    result.coefficients = detail::translateCoefficients(v, origin);
+    return result;
+}
+
+} // namespace ellipsoid
@@ -0,0 +1,143 @@
+#include <ellipsoid/batch.h>
+#include <ellipsoid/columnar.h>
+#include <ellipsoid/generate.h>
+
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <time.h>
+
+namespace {
+
+// Same values, NaNs included
+template <typename T>
+bool same(const T& a, const T& b) {
+    return ((a.array() == b.array()) or
+            (a.array().isNaN() and b.array().isNaN()))
+        .all();
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    const double tol = 1e-8;
+    std::srand(time(nullptr));
+
+    const auto last_type =
+        static_cast<int>(ellipsoid::EllipsoidType::AlignedXZEqual);
+    for (int t = 0; t <= last_type; ++t) {
+        const auto type = static_cast<ellipsoid::EllipsoidType>(t);
+
+        std::vector<ellipsoid::Moments,
+                    Eigen::aligned_allocator<ellipsoid::Moments>>
+            problems(1001);
+        for (auto& problem : problems) {
+            ellipsoid::Parameters parameters;
+            parameters.center = 10. * Eigen::Vector3d::Random();
+            parameters.radii =
+                5. * Eigen::Vector3d::Random().cwiseAbs().array() + 0.5;
+            switch (type) {
+            case ellipsoid::EllipsoidType::XYEqual:
+            case ellipsoid::EllipsoidType::AlignedXYEqual:
+                parameters.radii.y() = parameters.radii.x();
+                break;
+            case ellipsoid::EllipsoidType::XZEqual:
+            case ellipsoid::EllipsoidType::AlignedXZEqual:
+                parameters.radii.z() = parameters.radii.x();
+                break;
+            case ellipsoid::EllipsoidType::Sphere:
+                parameters.radii.setConstant(parameters.radii.x());
+                break;
+            default:
+                break;
+            }
+            problem.add(ellipsoid::generate(parameters, 20 + std::rand() % 180));
+        }
+        // coplanar points, left to the scalar solver
+        Eigen::Matrix<double, Eigen::Dynamic, 3> flat =
+            Eigen::Matrix<double, Eigen::Dynamic, 3>::Random(50, 3);
+        flat.col(2).setZero();
+        problems[500] = ellipsoid::Moments();
+        problems[500].add(flat);
+
+        const auto results = ellipsoid::fitBatch(problems, type);
+        ellipsoid::BatchResults columns;
+        ellipsoid::fitBatch(problems, columns, type);
+        if (columns.size() != problems.size() or
+            columns.fallback(500) != 1 or
+            not std::isnan(columns.min_pivots(500)) or
+            columns.fallback(0) != 0 or not (columns.min_pivots(0) > 0.) or
+            columns.point_counts(0) != problems[0].count()) {
+            throw std::runtime_error("Wrong batch diagnostics");
+        }
+
+        for (size_t i = 0; i < problems.size(); ++i) {
+            ellipsoid::FitResult expected;
+            expected.parameters =
+                ellipsoid::fit(problems[i], &expected.coefficients,
+                               &expected.eval, &expected.evec_column, type);
+            const auto& result = results[i];
+            const auto row = columns.result(i);
+            if (not same(row.parameters.center, result.parameters.center) or
+                not same(row.coefficients, result.coefficients) or
+                not same(row.evec_column, result.evec_column)) {
+                throw std::runtime_error("Wrong columnar result");
+            }
+
+            if (i == 500) {
+                if (not same(result.parameters.radii,
+                             expected.parameters.radii) or
+                    not same(result.coefficients, expected.coefficients)) {
+                    throw std::runtime_error("Wrong fallback result");
+                }
+                continue;
+            }
+
+            // the eigenvectors of repeated eigenvalues are not unique, the
+            // quadratic form they represent is
+            const Eigen::Matrix3d form = result.evec_column *
+                                         result.eval.asDiagonal() *
+                                         result.evec_column.transpose();
+            const Eigen::Matrix3d expected_form =
+                expected.evec_column * expected.eval.asDiagonal() *
+                expected.evec_column.inverse();
+            if (not result.parameters.center.isApprox(
+                    expected.parameters.center, tol) or
+                not result.parameters.radii.isApprox(expected.parameters.radii,
+                                                     tol) or
+                not result.coefficients.isApprox(expected.coefficients, tol) or
+                not form.isApprox(expected_form, tol)) {
+                std::stringstream ss;
+                ss << "Wrong batch fit for type " << t << ": center "
+                   << result.parameters.center.transpose() << ", radii "
+                   << result.parameters.radii.transpose() << ", expecting "
+                   << expected.parameters.center.transpose() << " and "
+                   << expected.parameters.radii.transpose();
+                throw std::runtime_error(ss.str());
+            }
+        }
+
+        // Arrow file: magic at both ends, the body holds the columns as is
+        const auto path = "/tmp/ellipsoid-batch-" + std::to_string(getpid()) +
+                          ".arrow";
+        ellipsoid::writeArrow(path, columns);
+        std::ifstream file(path, std::ios::binary);
+        const std::string content((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+        ::unlink(path.c_str());
+        const auto center_x = std::string(
+            reinterpret_cast<const char*>(columns.centers.data()),
+            problems.size() * sizeof(double));
+        if (content.compare(0, 6, "ARROW1") != 0 or
+            content.compare(content.size() - 6, 6, "ARROW1") != 0 or
+            content.find(center_x) == std::string::npos) {
+            throw std::runtime_error("Wrong Arrow file");
+        }
+    }
+
+    return 0;
+}
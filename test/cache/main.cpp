@@ -0,0 +1,131 @@
+#include <ellipsoid/cache.h>
+#include <ellipsoid/generate.h>
+
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+
+namespace {
+
+void expect(bool condition, const std::string& what) {
+    if (not condition) {
+        throw std::runtime_error(what);
+    }
+}
+
+bool identical(const ellipsoid::FitResult& a, const ellipsoid::FitResult& b) {
+    return a.coefficients == b.coefficients and
+           a.parameters.center == b.parameters.center and
+           a.parameters.radii == b.parameters.radii and a.eval == b.eval and
+           a.evec_column == b.evec_column;
+}
+
+void expectStatistics(const ellipsoid::FitCache& cache, uint64_t hits,
+                      uint64_t misses, const std::string& step) {
+    const auto statistics = cache.statistics();
+    std::stringstream ss;
+    ss << step << ": " << statistics.hits << " hits and " << statistics.misses
+       << " misses, expecting " << hits << " and " << misses;
+    expect(statistics.hits == hits and statistics.misses == misses, ss.str());
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    std::srand(time(nullptr));
+
+    ellipsoid::Parameters parameters;
+    parameters.center = 10. * Eigen::Vector3d::Random();
+    parameters.radii = 10. * Eigen::Vector3d::Random().cwiseAbs();
+    const Eigen::Matrix<double, Eigen::Dynamic, 3> points =
+        ellipsoid::generate(parameters, 1000);
+
+    ellipsoid::FitCache cache;
+
+    // a hit gives back the result computed on the miss, equal to fit()'s
+    ellipsoid::FitResult expected;
+    expected.parameters = ellipsoid::fit(points, &expected.coefficients,
+                                         &expected.eval, &expected.evec_column);
+    expect(identical(cache.fit(points), expected), "Wrong result on a miss");
+    expect(identical(cache.fit(points), expected), "Wrong result on a hit");
+    expectStatistics(cache, 1, 1, "same points");
+
+    // the type, the options and every coordinate are part of the key
+    cache.fit(points, ellipsoid::EllipsoidType::Aligned);
+    ellipsoid::FitOptions options;
+    options.strategy = ellipsoid::FitStrategy::Streaming;
+    expect(identical(cache.fit(points, options),
+                     ellipsoid::fit(points, options)),
+           "Wrong result with options");
+    options.strategy = ellipsoid::FitStrategy::DesignMatrix;
+    cache.fit(points, options);
+    Eigen::Matrix<double, Eigen::Dynamic, 3> modified = points;
+    modified(500, 2) = std::nextafter(modified(500, 2), 1e9);
+    cache.fit(modified);
+    cache.fit(points.topRows(999));
+    expectStatistics(cache, 1, 6, "different keys");
+
+    // only the content matters, not the storage
+    Eigen::Matrix<double, Eigen::Dynamic, 6> wide(points.rows(), 6);
+    wide.leftCols<3>().setZero();
+    wide.rightCols<3>() = points;
+    expect(ellipsoid::hashPoints(wide.rightCols<3>()) ==
+               ellipsoid::hashPoints(points),
+           "Hash depends on the outer stride");
+    cache.fit(wide.rightCols<3>());
+    expectStatistics(cache, 2, 6, "strided points");
+
+    // the least recently used results are evicted first
+    ellipsoid::CacheOptions small;
+    small.memory_budget = 1;
+    ellipsoid::FitCache lru(small);
+    lru.fit(points);
+    lru.fit(modified);
+    lru.fit(modified);
+    lru.fit(points);
+    expectStatistics(lru, 1, 3, "eviction");
+    expect(lru.statistics().evictions == 2 and lru.statistics().entries == 1,
+           "Wrong eviction count");
+
+    // the results survive through the file
+    char path[] = "/tmp/ellipsoid-cache-XXXXXX";
+    const int fd = mkstemp(path);
+    expect(fd >= 0, "Cannot create a temporary file");
+    close(fd);
+    std::remove(path);
+    ellipsoid::CacheOptions persistent;
+    persistent.path = path;
+    {
+        ellipsoid::FitCache saved(persistent);
+        saved.fit(points);
+        saved.fit(modified);
+        saved.save();
+    }
+    {
+        ellipsoid::FitCache loaded(persistent);
+        expect(loaded.statistics().entries == 2,
+               "Wrong number of loaded entries");
+        expect(identical(loaded.fit(points), expected),
+               "Wrong result loaded from the file");
+        expectStatistics(loaded, 1, 0, "loaded");
+    }
+
+    // the files of the previous version, without check hash, are ignored
+    auto* old = std::fopen(path, "wb");
+    expect(old != nullptr, "Cannot create a previous version file");
+    std::fwrite("EFCACHE1", 8, 1, old);
+    std::fclose(old);
+    {
+        ellipsoid::FitCache loaded(persistent);
+        expect(loaded.statistics().entries == 0,
+               "Entries loaded from a previous version file");
+    }
+    std::remove(path);
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <ellipsoid/dataset.h>
+#include <ellipsoid/generate.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+using Points = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+
+void expect(bool condition, const std::string& what) {
+    if (not condition) {
+        throw std::runtime_error(what);
+    }
+}
+
+void expectSame(const ellipsoid::Parameters& fitted,
+                const ellipsoid::Parameters& expected,
+                const std::string& what) {
+    std::stringstream ss;
+    ss << what << ": center " << fitted.center.transpose() << ", radii "
+       << fitted.radii.transpose() << ", expecting "
+       << expected.center.transpose() << " and "
+       << expected.radii.transpose();
+    expect(fitted.center.isApprox(expected.center, 1e-9) and
+               fitted.radii.isApprox(expected.radii, 1e-9),
+           ss.str());
+}
+
+// Records of 32 bytes: a 4 bytes id, the float coordinates then padding,
+// after a 16 bytes header
+ellipsoid::RecordLayout layout() {
+    ellipsoid::RecordLayout layout;
+    layout.header_size = 16;
+    layout.record_size = 32;
+    layout.coordinates_offset = 4;
+    layout.format = ellipsoid::ScalarFormat::Float32;
+    return layout;
+}
+
+// Write the points in the layout and return them as stored, i.e rounded to
+// floats
+Points writeFile(const std::string& path, const Points& points,
+                 size_t trailing_bytes) {
+    const auto format = layout();
+    std::vector<char> bytes(format.header_size +
+                                static_cast<size_t>(points.rows()) *
+                                    format.record_size +
+                                trailing_bytes,
+                            0);
+    Points stored(points.rows(), 3);
+    for (Eigen::Index i = 0; i < points.rows(); ++i) {
+        const float xyz[3] = {static_cast<float>(points(i, 0)),
+                              static_cast<float>(points(i, 1)),
+                              static_cast<float>(points(i, 2))};
+        std::memcpy(bytes.data() + format.header_size +
+                        static_cast<size_t>(i) * format.record_size +
+                        format.coordinates_offset,
+                    xyz, sizeof(xyz));
+        stored.row(i) << xyz[0], xyz[1], xyz[2];
+    }
+    FILE* file = std::fopen(path.c_str(), "wb");
+    expect(file != nullptr, "Can't create " + path);
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+    return stored;
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    std::srand(time(nullptr));
+    const auto prefix =
+        "/tmp/ellipsoid-dataset-" + std::to_string(::getpid()) + "-";
+
+    // files of several chunks, the last one partially filled
+    std::vector<std::string> paths;
+    std::vector<Points> stored;
+    for (int i = 0; i < 4; ++i) {
+        ellipsoid::Parameters parameters;
+        parameters.center = Eigen::Vector3d::Random();
+        parameters.radii = Eigen::Vector3d::Random().cwiseAbs().array() + 0.5;
+        paths.push_back(prefix + std::to_string(i));
+        stored.push_back(writeFile(paths.back(),
+                                   ellipsoid::generate(parameters, 5000 + i),
+                                   0));
+    }
+    // a truncated trailing record
+    ellipsoid::Parameters parameters;
+    parameters.center = Eigen::Vector3d::Random();
+    parameters.radii = Eigen::Vector3d(1., 2., 3.);
+    paths.push_back(prefix + "truncated");
+    const Points truncated = writeFile(
+        paths.back(), ellipsoid::generate(parameters, 3000), 10);
+    // and a missing file
+    paths.push_back(prefix + "missing");
+
+    ellipsoid::DatasetOptions options;
+    options.layout = layout();
+    options.chunk_size = 1000;
+    options.concurrent_files = 3;
+    const auto result = ellipsoid::fitDataset(
+        paths, ellipsoid::EllipsoidType::Arbitrary, options);
+    expect(result.files.size() == paths.size(), "Wrong number of results");
+
+    Points all(0, 3);
+    for (size_t i = 0; i < stored.size(); ++i) {
+        const auto& file = result.files[i];
+        expect(file.path == paths[i], "Results not in the order of the paths");
+        expect(file.error.empty(), file.path + ": " + file.error);
+        expect(file.moments.count() == static_cast<size_t>(stored[i].rows()),
+               "Wrong number of records in " + file.path);
+        expectSame(file.parameters, ellipsoid::fit(stored[i]), file.path);
+        Points grown(all.rows() + stored[i].rows(), 3);
+        grown << all, stored[i];
+        all = grown;
+    }
+
+    const auto& partial = result.files[stored.size()];
+    expect(partial.error.find("truncated") != std::string::npos,
+           "Truncated record not reported");
+    expect(partial.moments.count() == static_cast<size_t>(truncated.rows()),
+           "Complete records of the truncated file not kept");
+    expectSame(partial.parameters, ellipsoid::fit(truncated),
+               "Truncated file");
+
+    const auto& missing = result.files.back();
+    expect(not missing.error.empty() and missing.moments.count() == 0,
+           "Missing file not reported");
+
+    // the aggregate only contains the files read without error
+    expect(result.moments.count() == static_cast<size_t>(all.rows()),
+           "Wrong number of aggregated records");
+    expectSame(result.parameters, ellipsoid::fit(all), "Aggregate");
+
+    for (size_t i = 0; i + 1 < paths.size(); ++i) {
+        ::unlink(paths[i].c_str());
+    }
+    return 0;
+}
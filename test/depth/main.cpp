@@ -0,0 +1,66 @@
+#include <ellipsoid/depth.h>
+
+#include <time.h>
+#include <sstream>
+#include <vector>
+
+int main(int argc, char const* argv[]) {
+    const double tol = 1e-2;
+    const size_t width = 640;
+    const size_t height = 480;
+    const ellipsoid::CameraIntrinsics intrinsics{525., 525., 319.5, 239.5};
+    std::srand(time(nullptr));
+
+    std::vector<uint16_t> depth(width * height);
+    std::vector<uint8_t> labels(width * height);
+
+    for (size_t i = 0; i < 100; ++i) {
+        // sphere in the field of view, depth in millimeters
+        Eigen::Vector3d center = 0.5 * Eigen::Vector3d::Random();
+        center.z() += 2.5;
+        const double radius = 0.2 + 0.2 * std::abs(Eigen::Vector2d::Random()(0));
+
+        // raycast the sphere, the background gets a different label
+        for (size_t v = 0; v < height; ++v) {
+            for (size_t u = 0; u < width; ++u) {
+                Eigen::Vector3d ray((u - intrinsics.cx) / intrinsics.fx,
+                                    (v - intrinsics.cy) / intrinsics.fy, 1.);
+                const double a = ray.squaredNorm();
+                const double b = -2. * ray.dot(center);
+                const double c = center.squaredNorm() - radius * radius;
+                const double delta = b * b - 4. * a * c;
+                const size_t idx = v * width + u;
+                if (delta > 0.) {
+                    const double t = (-b - std::sqrt(delta)) / (2. * a);
+                    depth[idx] = static_cast<uint16_t>(1000. * t + 0.5);
+                    labels[idx] = 2;
+                } else {
+                    depth[idx] = 5000;
+                    labels[idx] = 1;
+                }
+            }
+        }
+
+        ellipsoid::DepthImage image{depth.data(),
+                                    ellipsoid::DepthFormat::UInt16,
+                                    width,
+                                    height,
+                                    width * sizeof(uint16_t),
+                                    1e-3};
+        ellipsoid::ImageMask mask{labels.data(), width, 2};
+
+        auto identified = ellipsoid::fit(image, intrinsics, &mask, nullptr,
+                                         ellipsoid::EllipsoidType::Sphere);
+
+        if ((identified.center - center).norm() > tol * center.norm() or
+            std::abs(identified.radii.x() - radius) > 5. * tol * radius) {
+            std::stringstream ss;
+            ss << "Wrong sphere: center " << identified.center.transpose()
+               << ", radius " << identified.radii.x() << ", expecting "
+               << center.transpose() << " and " << radius;
+            throw std::runtime_error(ss.str());
+        }
+    }
+
+    return 0;
+}
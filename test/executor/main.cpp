@@ -0,0 +1,101 @@
+#include <ellipsoid/executor.h>
+#include <ellipsoid/generate.h>
+#include <ellipsoid/joint.h>
+#include <ellipsoid/numa.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+void checkParallelFor(ellipsoid::Executor& executor, const std::string& name) {
+    const size_t count = 10000;
+    std::vector<std::atomic<int>> calls(count);
+    for (auto& c : calls) {
+        c = 0;
+    }
+    executor.parallelFor(count, [&](size_t i) { ++calls[i]; });
+    for (const auto& c : calls) {
+        if (c != 1) {
+            throw std::runtime_error(name + ": wrong number of calls");
+        }
+    }
+
+    // nested loops must not deadlock, even with all the threads busy
+    std::atomic<size_t> total{0};
+    executor.parallelFor(16, [&](size_t) {
+        executor.parallelFor(1000, [&](size_t) { ++total; });
+    });
+    if (total != 16000) {
+        throw std::runtime_error(name + ": wrong nested loop");
+    }
+
+    try {
+        executor.parallelFor(100, [](size_t i) {
+            if (i == 42) {
+                throw std::logic_error("failed iteration");
+            }
+        });
+        throw std::runtime_error(name + ": exception not propagated");
+    } catch (const std::logic_error&) {
+    }
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    ellipsoid::SerialExecutor serial;
+    checkParallelFor(serial, "serial");
+
+    ellipsoid::WorkStealingExecutor pool(4);
+    checkParallelFor(pool, "work stealing");
+
+    auto numa = std::make_shared<ellipsoid::NumaExecutor>();
+    checkParallelFor(*numa, "numa");
+
+    // chunked accumulation on a first touched buffer
+    ellipsoid::setDefaultExecutor(numa);
+    ellipsoid::BufferOptions options;
+    options.chunk_rows = 4096;
+    ellipsoid::PointBuffer buffer(100000, options);
+    buffer.points() = Eigen::MatrixX3d::Random(100000, 3);
+    const auto moments =
+        ellipsoid::accumulateParallel(buffer.points(), options.chunk_rows);
+    ellipsoid::setDefaultExecutor(nullptr);
+    ellipsoid::Moments expected(moments.origin());
+    expected.add(buffer.points());
+    if (moments.count() != buffer.rows() or
+        not moments.matrix().isApprox(expected.matrix(), 1e-10)) {
+        throw std::runtime_error("Wrong parallel accumulation");
+    }
+
+    // application pool seen through a callback
+    auto application_pool = std::make_shared<ellipsoid::WorkStealingExecutor>(2);
+    std::atomic<size_t> submitted{0};
+    auto callback = std::make_shared<ellipsoid::CallbackExecutor>(
+        [&](std::function<void()> task) {
+            ++submitted;
+            application_pool->submit(std::move(task));
+        },
+        4);
+    checkParallelFor(*callback, "callback");
+
+    // the library's parallel paths go through the default executor
+    submitted = 0;
+    ellipsoid::setDefaultExecutor(callback);
+    ellipsoid::Parameters parameters;
+    parameters.center = Eigen::Vector3d::Random();
+    parameters.radii = Eigen::Vector3d::Ones();
+    std::vector<Eigen::Matrix<double, Eigen::Dynamic, 3>> sets(
+        4, ellipsoid::generate(parameters, 1000));
+    ellipsoid::fitJoint(sets);
+    ellipsoid::setDefaultExecutor(nullptr);
+    if (submitted == 0) {
+        throw std::runtime_error("The default executor is not used");
+    }
+
+    return 0;
+}
@@ -1,5 +1,7 @@
+#include <ellipsoid/async.h>
 #include <ellipsoid/fit.h>
 #include <ellipsoid/generate.h>
+#include <ellipsoid/robust.h>
 
 #include <time.h>
 #include <sstream>
@@ -21,6 +23,9 @@ int main(int argc, char const* argv[]) {
         } else if (type_name == "sphere") {
             parameters.radii.y() = parameters.radii.x();
             parameters.radii.z() = parameters.radii.x();
+        } else if (type_name == "robust") {
+            // outliers can't be told apart from flat ellipsoids
+            parameters.radii = parameters.radii.cwiseMax(1.);
         }
 
         auto points = ellipsoid::generate(parameters, 10000);
@@ -56,6 +61,44 @@ int main(int argc, char const* argv[]) {
         } else if (type_name == "arbitary") {
             identified_parameters =
                 ellipsoid::fit(points, ellipsoid::EllipsoidType::Arbitrary);
+        } else if (type_name == "moments") {
+            ellipsoid::Moments moments;
+            moments.add(points);
+            identified_parameters =
+                ellipsoid::fit(moments, ellipsoid::EllipsoidType::Arbitrary);
+        } else if (type_name == "async") {
+            ellipsoid::AsyncOptions options;
+            options.chunk_size = 1000;
+            double progress = 0.;
+            options.progress = [&progress](double fraction) {
+                if (fraction <= progress) {
+                    throw std::runtime_error("Non increasing progress");
+                }
+                progress = fraction;
+            };
+            identified_parameters =
+                ellipsoid::fitAsync(points, options).get().parameters;
+            if (progress != 1.) {
+                throw std::runtime_error("Incomplete progress");
+            }
+
+            // a cancelled fit doesn't produce a result, run it in place
+            options.cancellation.cancel();
+            options.progress = nullptr;
+            options.executor = std::make_shared<ellipsoid::SerialExecutor>();
+            auto cancelled = ellipsoid::fitAsync(points, options);
+            try {
+                cancelled.get();
+                throw std::runtime_error("The fit has not been cancelled");
+            } catch (const ellipsoid::FitCancelled&) {
+            }
+        } else if (type_name == "robust") {
+            // corrupt 5% of the points with large spikes
+            for (Eigen::Index j = 0; j < points.rows(); j += 20) {
+                points.row(j) += 100. * Eigen::RowVector3d::Random();
+            }
+            identified_parameters = ellipsoid::fitRobust(
+                points, ellipsoid::EllipsoidType::Arbitrary);
         }
 
         check_vector3d(identified_parameters.center, parameters.center,
@@ -63,5 +106,14 @@ int main(int argc, char const* argv[]) {
         check_vector3d(identified_parameters.radii, parameters.radii, "radii");
     }
 
+    if (type_name == "robust") {
+        size_t inliers = 1;
+        const auto empty = ellipsoid::fitRobust(
+            Eigen::Matrix<double, Eigen::Dynamic, 3>(0, 3), nullptr, &inliers);
+        if (not empty.center.hasNaN() or inliers != 0) {
+            throw std::runtime_error("Robust fit on no point");
+        }
+    }
+
     return 0;
 }
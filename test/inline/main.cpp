@@ -0,0 +1,62 @@
+#include <ellipsoid/generate.h>
+#include <ellipsoid/inline.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <time.h>
+
+namespace {
+
+template <typename Points>
+void check(const Points& points, ellipsoid::EllipsoidType type, double tol) {
+    ellipsoid::FitResult expected;
+    expected.parameters =
+        ellipsoid::fit(Eigen::Matrix<double, Eigen::Dynamic, 3>(points),
+                       &expected.coefficients, &expected.eval,
+                       &expected.evec_column, type);
+    const auto result = ellipsoid::fitInline(points, type);
+    if (not result.coefficients.isApprox(expected.coefficients, tol) or
+        not result.parameters.center.isApprox(expected.parameters.center,
+                                              tol) or
+        not result.eval.isApprox(expected.eval, tol) or
+        not result.evec_column.isApprox(expected.evec_column, tol)) {
+        std::stringstream ss;
+        ss << "Wrong inline fit of " << points.rows() << " points for type "
+           << static_cast<int>(type) << ": center "
+           << result.parameters.center.transpose() << ", radii "
+           << result.parameters.radii.transpose() << ", expecting "
+           << expected.parameters.center.transpose() << " and "
+           << expected.parameters.radii.transpose();
+        throw std::runtime_error(ss.str());
+    }
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    const double tol = 1e-9;
+    std::srand(time(nullptr));
+
+    const auto last_type =
+        static_cast<int>(ellipsoid::EllipsoidType::AlignedXZEqual);
+    for (int t = 0; t <= last_type; ++t) {
+        const auto type = static_cast<ellipsoid::EllipsoidType>(t);
+        for (size_t i = 0; i < 100; ++i) {
+            // noisy points of an arbitrary ellipsoid, fitted by any type (NaN
+            // radii when the result is a hyperboloid)
+            ellipsoid::Parameters parameters;
+            parameters.center = Eigen::Vector3d::Random();
+            parameters.radii =
+                Eigen::Vector3d::Random().cwiseAbs().array() + 0.5;
+            const Eigen::Matrix<double, 20, 3> fixed =
+                ellipsoid::generate(parameters, 20) +
+                0.01 * Eigen::Matrix<double, 20, 3>::Random();
+            check(fixed, type, tol);
+
+            const auto dynamic = ellipsoid::generate(parameters, 500);
+            check(dynamic, type, tol);
+        }
+    }
+
+    return 0;
+}
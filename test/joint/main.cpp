@@ -0,0 +1,84 @@
+#include <ellipsoid/joint.h>
+
+#include <time.h>
+#include <iostream>
+#include <sstream>
+
+int main(int argc, char const* argv[]) {
+    const double tol = 1e-2;
+    const size_t sensor_count = 16;
+    const size_t samples = 2000;
+    const double field_magnitude = 48.;
+    std::srand(time(nullptr));
+
+    for (size_t iter = 0; iter < 20; ++iter) {
+        // true field directions, expressed in the reference sensor's frame
+        Eigen::Matrix<double, Eigen::Dynamic, 3> field(samples, 3);
+        for (size_t i = 0; i < samples; ++i) {
+            field.row(i) =
+                field_magnitude * Eigen::Vector3d::Random().normalized();
+        }
+
+        std::vector<Eigen::Matrix<double, Eigen::Dynamic, 3>> data;
+        std::vector<Eigen::Matrix3d> rotations;
+        for (size_t s = 0; s < sensor_count; ++s) {
+            Eigen::Matrix3d rotation =
+                s == 0 ? Eigen::Matrix3d::Identity()
+                       : Eigen::Quaterniond::UnitRandom().toRotationMatrix();
+            // symmetric distortion with a unit determinant so that each
+            // sensor sees the same field magnitude
+            Eigen::Matrix3d distortion =
+                Eigen::Matrix3d::Identity() + 0.2 * Eigen::Matrix3d::Random();
+            distortion = 0.5 * (distortion + distortion.transpose()).eval();
+            distortion /= std::cbrt(distortion.determinant());
+            Eigen::Vector3d offset = 10. * Eigen::Vector3d::Random();
+
+            Eigen::Matrix<double, Eigen::Dynamic, 3> raw =
+                (distortion * rotation.transpose() * field.transpose())
+                    .transpose();
+            raw.rowwise() += offset.transpose();
+            data.push_back(raw);
+            rotations.push_back(rotation);
+        }
+
+        auto calibration = ellipsoid::fitJoint(data);
+
+        if (not calibration.rotations_estimated) {
+            throw std::runtime_error("Rotations have not been estimated");
+        }
+
+        if (std::abs(calibration.field_magnitude - field_magnitude) >
+            tol * field_magnitude) {
+            std::stringstream ss;
+            ss << "Wrong field magnitude: " << calibration.field_magnitude
+               << ", expecting " << field_magnitude;
+            throw std::runtime_error(ss.str());
+        }
+
+        for (size_t s = 0; s < sensor_count; ++s) {
+            Eigen::AngleAxisd error(calibration.sensors[s].rotation *
+                                    rotations[s].transpose());
+            if (error.angle() > tol) {
+                std::stringstream ss;
+                ss << "Wrong rotation for sensor " << s << ", error is "
+                   << error.angle() << "rad";
+                throw std::runtime_error(ss.str());
+            }
+
+            for (size_t i = 0; i < samples; i += 100) {
+                Eigen::Vector3d calibrated =
+                    calibration.apply(s, data[s].row(i).transpose());
+                Eigen::Vector3d expected = field.row(i).transpose();
+                if ((calibrated - expected).norm() > tol * field_magnitude) {
+                    std::stringstream ss;
+                    ss << "Wrong calibrated sample for sensor " << s << ": "
+                       << calibrated.transpose() << ", expecting "
+                       << expected.transpose();
+                    throw std::runtime_error(ss.str());
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <ellipsoid/generate.h>
+#include <ellipsoid/lazy.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <time.h>
+
+int main(int argc, char const* argv[]) {
+    const double tol = 1e-12;
+    std::srand(time(nullptr));
+
+    std::vector<ellipsoid::Moments,
+                Eigen::aligned_allocator<ellipsoid::Moments>>
+        problems(100);
+    for (auto& problem : problems) {
+        ellipsoid::Parameters parameters;
+        parameters.center = 10. * Eigen::Vector3d::Random();
+        parameters.radii = Eigen::Vector3d::Random().cwiseAbs().array() + 0.5;
+        const auto points = ellipsoid::generate(parameters, 1000);
+        problem.add(points);
+
+        // same computations as fit(), only deferred
+        ellipsoid::FitResult expected;
+        expected.parameters =
+            ellipsoid::fit(points, &expected.coefficients, &expected.eval,
+                           &expected.evec_column);
+        const auto lazy = ellipsoid::fitLazy(points);
+        const auto center = lazy.center();
+        const auto result = lazy.result();
+        if (not lazy.coefficients().isApprox(expected.coefficients, tol) or
+            not center.isApprox(expected.parameters.center, tol) or
+            not result.parameters.radii.isApprox(expected.parameters.radii,
+                                                 tol) or
+            not result.eval.isApprox(expected.eval, tol) or
+            not result.evec_column.isApprox(expected.evec_column, tol)) {
+            std::stringstream ss;
+            ss << "Wrong lazy fit: center " << center.transpose()
+               << ", radii " << result.parameters.radii.transpose()
+               << ", expecting " << expected.parameters.center.transpose()
+               << " and " << expected.parameters.radii.transpose();
+            throw std::runtime_error(ss.str());
+        }
+
+        // inside/outside tests from the coefficients only
+        const auto fresh = ellipsoid::fitLazy(points);
+        const Eigen::Vector3d outside =
+            parameters.center +
+            1.01 * parameters.radii.maxCoeff() * Eigen::Vector3d::UnitX();
+        if (not fresh.contains(parameters.center) or
+            fresh.contains(outside) or
+            std::abs(fresh.evaluate(points.row(0).transpose())) > 1e-6) {
+            throw std::runtime_error("Wrong inside/outside test");
+        }
+    }
+
+    const auto results = ellipsoid::fitLazy(problems);
+    for (size_t i = 0; i < problems.size(); ++i) {
+        ellipsoid::FitResult expected;
+        expected.parameters =
+            ellipsoid::fit(problems[i], &expected.coefficients, &expected.eval,
+                           &expected.evec_column);
+        // evaluated in another order than the getters' one
+        const auto& lazy = results[i];
+        if (not lazy.eigenvectors().isApprox(expected.evec_column, tol) or
+            not lazy.radii().isApprox(expected.parameters.radii, tol) or
+            not lazy.center().isApprox(expected.parameters.center, tol) or
+            not lazy.coefficients().isApprox(expected.coefficients, tol)) {
+            throw std::runtime_error("Wrong lazy fit of moments");
+        }
+    }
+
+    return 0;
+}
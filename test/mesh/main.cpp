@@ -0,0 +1,170 @@
+#include <ellipsoid/mesh.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+using Vertices = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+using Triangles = Eigen::Matrix<int, Eigen::Dynamic, 3>;
+
+void expect(bool condition, const std::string& what) {
+    if (not condition) {
+        throw std::runtime_error(what);
+    }
+}
+
+void expectFit(const ellipsoid::Parameters& fitted,
+               const ellipsoid::Parameters& expected, double tol,
+               const std::string& what) {
+    std::stringstream ss;
+    ss << what << ": center " << fitted.center.transpose() << ", radii "
+       << fitted.radii.transpose() << ", expecting "
+       << expected.center.transpose() << " and "
+       << expected.radii.transpose();
+    expect((fitted.center - expected.center).norm() < tol and
+               (fitted.radii - expected.radii).norm() < tol,
+           ss.str());
+}
+
+// Latitude/longitude tessellation of an axis aligned ellipsoid, the
+// vertices lying on its surface
+void tessellate(const ellipsoid::Parameters& params, int stacks, int slices,
+                Vertices& vertices, Triangles& triangles) {
+    vertices.resize(2 + (stacks - 1) * slices, 3);
+    vertices.row(0) =
+        (params.center + params.radii.cwiseProduct(Eigen::Vector3d::UnitZ()))
+            .transpose();
+    vertices.row(1) =
+        (params.center - params.radii.cwiseProduct(Eigen::Vector3d::UnitZ()))
+            .transpose();
+    auto index = [&](int stack, int slice) {
+        return 2 + (stack - 1) * slices + slice % slices;
+    };
+    for (int i = 1; i < stacks; ++i) {
+        const double theta = M_PI * i / stacks;
+        for (int j = 0; j < slices; ++j) {
+            const double phi = 2. * M_PI * j / slices;
+            const Eigen::Vector3d direction(std::sin(theta) * std::cos(phi),
+                                            std::sin(theta) * std::sin(phi),
+                                            std::cos(theta));
+            vertices.row(index(i, j)) =
+                (params.center + params.radii.cwiseProduct(direction))
+                    .transpose();
+        }
+    }
+
+    std::vector<Eigen::Vector3i> faces;
+    for (int j = 0; j < slices; ++j) {
+        faces.emplace_back(0, index(1, j), index(1, j + 1));
+        faces.emplace_back(1, index(stacks - 1, j + 1),
+                           index(stacks - 1, j));
+        for (int i = 1; i + 1 < stacks; ++i) {
+            faces.emplace_back(index(i, j), index(i + 1, j),
+                               index(i + 1, j + 1));
+            faces.emplace_back(index(i, j), index(i + 1, j + 1),
+                               index(i, j + 1));
+        }
+    }
+    triangles.resize(static_cast<Eigen::Index>(faces.size()), 3);
+    for (size_t i = 0; i < faces.size(); ++i) {
+        triangles.row(static_cast<Eigen::Index>(i)) = faces[i].transpose();
+    }
+}
+
+// Split the triangles of the upper half in four, with new vertices in the
+// middle of their edges: the surface is the same, only finer on one side
+void splitUpperHalf(const ellipsoid::Parameters& params, Vertices& vertices,
+                    Triangles& triangles) {
+    std::vector<Eigen::Vector3d> points;
+    for (Eigen::Index i = 0; i < vertices.rows(); ++i) {
+        points.push_back(vertices.row(i).transpose());
+    }
+    std::vector<Eigen::Vector3i> faces;
+    for (Eigen::Index t = 0; t < triangles.rows(); ++t) {
+        const Eigen::Vector3i face = triangles.row(t).transpose();
+        Eigen::Vector3d centroid = Eigen::Vector3d::Zero();
+        for (int k = 0; k < 3; ++k) {
+            centroid += points[static_cast<size_t>(face(k))] / 3.;
+        }
+        if (centroid.z() < params.center.z()) {
+            faces.push_back(face);
+            continue;
+        }
+        int middle[3];
+        for (int k = 0; k < 3; ++k) {
+            middle[k] = static_cast<int>(points.size());
+            points.push_back(0.5 * (points[static_cast<size_t>(face(k))] +
+                                    points[static_cast<size_t>(
+                                        face((k + 1) % 3))]));
+        }
+        faces.emplace_back(face(0), middle[0], middle[2]);
+        faces.emplace_back(middle[0], face(1), middle[1]);
+        faces.emplace_back(middle[2], middle[1], face(2));
+        faces.emplace_back(middle[0], middle[1], middle[2]);
+    }
+    vertices.resize(static_cast<Eigen::Index>(points.size()), 3);
+    for (size_t i = 0; i < points.size(); ++i) {
+        vertices.row(static_cast<Eigen::Index>(i)) = points[i].transpose();
+    }
+    triangles.resize(static_cast<Eigen::Index>(faces.size()), 3);
+    for (size_t i = 0; i < faces.size(); ++i) {
+        triangles.row(static_cast<Eigen::Index>(i)) = faces[i].transpose();
+    }
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    std::srand(time(nullptr));
+
+    ellipsoid::Parameters expected;
+    expected.center = Eigen::Vector3d::Random();
+    expected.radii = Eigen::Vector3d(1., 1.5, 2.);
+
+    // the flat triangles are inside the surface by O(h^2), h being their
+    // size, so the refined mesh is much closer to the analytic ellipsoid
+    Vertices coarse_vertices, fine_vertices;
+    Triangles coarse_triangles, fine_triangles;
+    tessellate(expected, 30, 60, coarse_vertices, coarse_triangles);
+    tessellate(expected, 200, 400, fine_vertices, fine_triangles);
+    const auto coarse = ellipsoid::fit(coarse_vertices, coarse_triangles);
+    const auto fine = ellipsoid::fit(fine_vertices, fine_triangles);
+    expectFit(coarse, expected, 2e-2, "Coarse mesh");
+    expectFit(fine, expected, 5e-4, "Refined mesh");
+    expect((fine.radii - expected.radii).norm() <
+               0.1 * (coarse.radii - expected.radii).norm(),
+           "Refining the mesh doesn't converge to the ellipsoid");
+
+    // a finer tessellation of the same surface gives the same fit, while
+    // the vertices alone are biased towards the refined half
+    Vertices split_vertices = coarse_vertices;
+    Triangles split_triangles = coarse_triangles;
+    splitUpperHalf(expected, split_vertices, split_triangles);
+    expect(split_triangles.rows() > 2 * coarse_triangles.rows(),
+           "Mesh not refined");
+    const auto split = ellipsoid::fit(split_vertices, split_triangles);
+    std::stringstream ss;
+    ss << "Fit depends on the tessellation: center "
+       << split.center.transpose() << ", radii " << split.radii.transpose()
+       << " instead of " << coarse.center.transpose() << " and "
+       << coarse.radii.transpose();
+    expect((split.center - coarse.center).norm() < 1e-9 and
+               (split.radii - coarse.radii).norm() < 1e-9,
+           ss.str());
+    const auto vertices_only = ellipsoid::fit(split_vertices);
+    expect((vertices_only.center - coarse.center).norm() > 1e-4,
+           "Vertices of the split mesh not biased");
+
+    // moments accumulated mesh by mesh add up
+    ellipsoid::Moments moments;
+    ellipsoid::accumulate(moments, coarse_vertices, coarse_triangles);
+    expectFit(ellipsoid::fit(moments), coarse, 1e-9, "Accumulated mesh");
+
+    return 0;
+}
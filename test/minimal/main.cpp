@@ -0,0 +1,118 @@
+#include <ellipsoid/generate.h>
+#include <ellipsoid/minimal.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <time.h>
+
+namespace {
+
+template <ellipsoid::EllipsoidType Type, typename Scalar>
+ellipsoid::FitResult
+staticFit(const Eigen::Matrix<double, Eigen::Dynamic, 3>& points) {
+    ellipsoid::StaticFitter<Type, Scalar> fitter;
+    ellipsoid::FitResult result;
+    bool fitted;
+    {
+        // neither the accumulation nor the solve may touch the heap
+        Eigen::internal::set_is_malloc_allowed(false);
+        for (Eigen::Index i = 0; i < points.rows(); ++i) {
+            fitter.add(points.row(i).transpose().template cast<Scalar>());
+        }
+        fitted = fitter.fit(result);
+        Eigen::internal::set_is_malloc_allowed(true);
+    }
+    if (not fitted) {
+        throw std::runtime_error("Static fit failed");
+    }
+    return result;
+}
+
+void check(const ellipsoid::FitResult& result,
+           const ellipsoid::Parameters& expected, double tol) {
+    const double center_error =
+        (result.parameters.center - expected.center).norm() /
+        expected.center.norm();
+    const double radii_error =
+        (result.parameters.radii - expected.radii).norm() /
+        expected.radii.norm();
+    if (not(center_error < tol) or not(radii_error < tol)) {
+        std::stringstream ss;
+        ss << "Wrong static fit: center "
+           << result.parameters.center.transpose() << ", radii "
+           << result.parameters.radii.transpose() << ", expecting "
+           << expected.center.transpose() << " and "
+           << expected.radii.transpose();
+        throw std::runtime_error(ss.str());
+    }
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    std::srand(time(nullptr));
+
+    using ellipsoid::EllipsoidType;
+    for (size_t i = 0; i < 100; ++i) {
+        // magnetometer-like samples: far from the origin compared to the
+        // radii, which are at least 10% of the largest one
+        ellipsoid::Parameters parameters;
+        parameters.center = 100. * Eigen::Vector3d::Random();
+        parameters.radii =
+            50. * (Eigen::Vector3d::Random().cwiseAbs().array() + 0.1);
+        const Eigen::Matrix<double, Eigen::Dynamic, 3> points =
+            ellipsoid::generate(parameters, 500);
+
+        const auto exact = staticFit<EllipsoidType::Arbitrary, double>(points);
+        check(exact, parameters, 1e-8);
+
+        // noisy samples, in double and single precision
+        const Eigen::Matrix<double, Eigen::Dynamic, 3> noisy =
+            points + 0.01 * Eigen::Matrix<double, Eigen::Dynamic, 3>::Random(
+                                points.rows(), 3);
+        check(staticFit<EllipsoidType::Arbitrary, double>(noisy), parameters,
+              1e-2);
+        check(staticFit<EllipsoidType::Arbitrary, float>(noisy), parameters,
+              1e-2);
+        check(staticFit<EllipsoidType::Aligned, float>(noisy), parameters,
+              1e-2);
+
+        // same solution as fit(), including the algebraic coefficients, near
+        // the origin where its normal equations are well conditioned
+        ellipsoid::Parameters local;
+        local.center = Eigen::Vector3d::Random();
+        local.radii = Eigen::Vector3d::Random().cwiseAbs().array() + 1.;
+        const Eigen::Matrix<double, Eigen::Dynamic, 3> local_points =
+            ellipsoid::generate(local, 500) +
+            0.01 * Eigen::Matrix<double, Eigen::Dynamic, 3>::Random(500, 3);
+        Eigen::Matrix<double, 10, 1> expected;
+        ellipsoid::fit(local_points, &expected, EllipsoidType::Arbitrary);
+        const auto local_fit =
+            staticFit<EllipsoidType::Arbitrary, double>(local_points);
+        if (not local_fit.coefficients.isApprox(expected, 1e-8)) {
+            std::stringstream ss;
+            ss << "Wrong static fit coefficients: "
+               << local_fit.coefficients.transpose() << ", expecting "
+               << expected.transpose();
+            throw std::runtime_error(ss.str());
+        }
+
+        parameters.radii.setConstant(parameters.radii.x());
+        const Eigen::Matrix<double, Eigen::Dynamic, 3> sphere =
+            ellipsoid::generate(parameters, 500);
+        check(staticFit<EllipsoidType::Sphere, float>(sphere), parameters,
+              1e-3);
+    }
+
+    // not enough samples to define the ellipsoid
+    ellipsoid::StaticFitter<> fitter;
+    ellipsoid::FitResult result;
+    for (int i = 0; i < 5; ++i) {
+        fitter.add(Eigen::Vector3f::Random());
+    }
+    if (fitter.fit(result)) {
+        throw std::runtime_error("Fit succeeded with too few samples");
+    }
+
+    return 0;
+}
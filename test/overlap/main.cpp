@@ -0,0 +1,235 @@
+#include <ellipsoid/overlap.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+
+namespace {
+
+void expect(bool condition, const std::string& what) {
+    if (not condition) {
+        throw std::runtime_error(what);
+    }
+}
+
+Eigen::Matrix3d randomRotation() {
+    return Eigen::Quaterniond(Eigen::Vector4d::Random().normalized())
+        .toRotationMatrix();
+}
+
+ellipsoid::Ellipsoid randomEllipsoid(double extent) {
+    ellipsoid::Ellipsoid e;
+    e.center = extent * Eigen::Vector3d::Random();
+    e.radii =
+        Eigen::Vector3d::Random().cwiseAbs() + Eigen::Vector3d::Constant(0.1);
+    e.axes = randomRotation();
+    return e;
+}
+
+ellipsoid::Ellipsoid sphere(const Eigen::Vector3d& center, double radius) {
+    ellipsoid::Ellipsoid e;
+    e.center = center;
+    e.radii.setConstant(radius);
+    e.axes = randomRotation();
+    return e;
+}
+
+// Point of the ellipsoid for a point u of the unit ball
+Eigen::Vector3d pointOf(const ellipsoid::Ellipsoid& e,
+                        const Eigen::Vector3d& u) {
+    return e.center + e.axes * e.radii.cwiseProduct(u);
+}
+
+bool inside(const ellipsoid::Ellipsoid& e, const Eigen::Vector3d& point) {
+    return (e.axes.transpose() * (point - e.center))
+               .cwiseQuotient(e.radii)
+               .squaredNorm() <= 1.;
+}
+
+std::string pairs(const std::vector<ellipsoid::EllipsoidPair>& pairs) {
+    std::stringstream ss;
+    for (const auto& pair : pairs) {
+        ss << '(' << pair.first << ", " << pair.second << ") ";
+    }
+    return ss.str();
+}
+
+bool samePairs(const std::vector<ellipsoid::EllipsoidPair>& a,
+               const std::vector<ellipsoid::EllipsoidPair>& b, double tol) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t k = 0; k < a.size(); ++k) {
+        if (a[k].first != b[k].first or a[k].second != b[k].second or
+            std::abs(a[k].distance - b[k].distance) > tol) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    const double tol = 1e-8;
+    std::srand(time(nullptr));
+
+    // spheres have closed form answers
+    for (int i = 0; i < 1000; ++i) {
+        const auto a = sphere(Eigen::Vector3d::Random(),
+                              std::abs(Eigen::Vector2d::Random()(0)) + 0.1);
+        const auto b = sphere(Eigen::Vector3d::Random(),
+                              std::abs(Eigen::Vector2d::Random()(0)) + 0.1);
+        const double gap =
+            (b.center - a.center).norm() - a.radii(0) - b.radii(0);
+        if (std::abs(gap) > tol) {
+            expect(ellipsoid::overlap(a, b) == (gap < 0.),
+                   "Wrong overlap of spheres");
+        }
+        expect(std::abs(ellipsoid::distance(a, b) - std::max(gap, 0.)) < tol,
+               "Wrong distance between spheres");
+        const double margin =
+            a.radii(0) - b.radii(0) - (b.center - a.center).norm();
+        if (std::abs(margin) > tol) {
+            expect(ellipsoid::contains(a, b) == (margin > 0.),
+                   "Wrong containment of spheres");
+        }
+    }
+
+    // the tips of two prolate ellipsoids sharing their major axis are their
+    // closest points, in any frame
+    for (int i = 0; i < 100; ++i) {
+        const Eigen::Matrix3d rotation = randomRotation();
+        const Eigen::Vector3d translation = 10. * Eigen::Vector3d::Random();
+        ellipsoid::Ellipsoid a;
+        a.center = translation;
+        a.radii << 3., 1., 0.5;
+        a.axes = rotation;
+        ellipsoid::Ellipsoid b;
+        b.center = translation + rotation * Eigen::Vector3d(10., 0., 0.);
+        b.radii << 1., 0.8, 2.;
+        b.axes =
+            rotation * Eigen::AngleAxisd(M_PI / 2., Eigen::Vector3d::UnitY());
+        expect(not ellipsoid::overlap(a, b), "Separated tips overlapping");
+        expect(std::abs(ellipsoid::distance(a, b) - 5.) < tol,
+               "Wrong distance between tips");
+        b.center = translation + rotation * Eigen::Vector3d(3.9, 0., 0.);
+        expect(ellipsoid::overlap(a, b), "Overlapping tips not detected");
+        expect(ellipsoid::distance(a, b) == 0., "Overlapping at a distance");
+    }
+
+    // arbitrary ellipsoids compared to sampled points
+    for (int i = 0; i < 200; ++i) {
+        const auto a = randomEllipsoid(1.);
+        const auto b = randomEllipsoid(1.);
+        double sampled = std::numeric_limits<double>::infinity();
+        bool common_point = false;
+        for (int k = 0; k < 2000; ++k) {
+            const Eigen::Vector3d u = Eigen::Vector3d::Random().normalized();
+            const Eigen::Vector3d v = Eigen::Vector3d::Random().normalized();
+            sampled = std::min(sampled, (pointOf(a, u) - pointOf(b, v)).norm());
+            common_point =
+                common_point or inside(a, pointOf(b, u)) or
+                inside(a, b.center + 0.5 * (pointOf(b, u) - b.center));
+        }
+        const double computed = ellipsoid::distance(a, b);
+        expect(computed <= sampled + tol, "Distance above a sampled one");
+        if (common_point) {
+            expect(ellipsoid::overlap(a, b), "Missed overlap");
+        }
+        if (not ellipsoid::overlap(a, b)) {
+            expect(computed > 0., "Separated ellipsoids at zero distance");
+        }
+
+        const bool contained = ellipsoid::contains(a, b);
+        for (int k = 0; contained and k < 1000; ++k) {
+            const Eigen::Vector3d u = Eigen::Vector3d::Random().normalized();
+            expect(inside(a, pointOf(b, u)),
+                   "Point of a contained ellipsoid outside");
+        }
+        auto shrunk = a;
+        shrunk.radii *= 0.99;
+        expect(ellipsoid::contains(a, shrunk), "Shrunk copy not contained");
+        expect(not ellipsoid::contains(shrunk, a), "Containing a larger copy");
+    }
+
+    // the set queries match testing all the pairs
+    ellipsoid::Ellipsoids ellipsoids;
+    for (int i = 0; i < 1500; ++i) {
+        ellipsoids.push_back(randomEllipsoid(8.));
+        if (i % 100 == 0) {
+            auto inner = ellipsoids.back();
+            inner.radii *= 0.5;
+            ellipsoids.push_back(inner);
+        }
+    }
+    ellipsoids.push_back(ellipsoids.front());
+    const double max_distance = 0.3;
+    std::vector<ellipsoid::EllipsoidPair> overlapping;
+    std::vector<ellipsoid::EllipsoidPair> within;
+    std::vector<ellipsoid::EllipsoidPair> contained;
+    for (size_t i = 0; i < ellipsoids.size(); ++i) {
+        for (size_t j = 0; j < ellipsoids.size(); ++j) {
+            if (i != j and ellipsoid::contains(ellipsoids[i], ellipsoids[j])) {
+                contained.push_back({i, j, 0.});
+            }
+            if (j <= i) {
+                continue;
+            }
+            const double d = ellipsoid::distance(ellipsoids[i], ellipsoids[j]);
+            if (d == 0.) {
+                overlapping.push_back({i, j, 0.});
+            }
+            if (d <= max_distance) {
+                within.push_back({i, j, d});
+            }
+        }
+    }
+    expect(contained.size() >= 16, "Too few contained pairs to be a test");
+    const size_t copy = ellipsoids.size() - 1;
+    expect(ellipsoid::contains(ellipsoids[0], ellipsoids[copy]) and
+               ellipsoid::contains(ellipsoids[copy], ellipsoids[0]),
+           "Identical ellipsoids not containing each other");
+
+    const ellipsoid::EllipsoidSet set(ellipsoids);
+    expect(set.size() == ellipsoids.size(), "Wrong set size");
+    expect(samePairs(set.overlappingPairs(), overlapping, 0.),
+           "Wrong overlapping pairs " + pairs(set.overlappingPairs()));
+    expect(samePairs(set.pairsWithin(max_distance), within, tol),
+           "Wrong pairs within a distance");
+    expect(samePairs(set.containedPairs(), contained, 0.),
+           "Wrong contained pairs " + pairs(set.containedPairs()));
+
+    for (int i = 0; i < 100; ++i) {
+        const auto query = randomEllipsoid(8.);
+        std::vector<size_t> expected;
+        for (size_t j = 0; j < ellipsoids.size(); ++j) {
+            if (ellipsoid::overlap(query, ellipsoids[j])) {
+                expected.push_back(j);
+            }
+        }
+        expect(set.overlapping(query) == expected,
+               "Wrong ellipsoids overlapping a query");
+    }
+
+    // fit results are accepted as is
+    ellipsoid::FitResults results(2);
+    for (auto& result : results) {
+        result.parameters.center.setZero();
+        result.parameters.radii.setOnes();
+        result.evec_column.setIdentity();
+    }
+    results[1].parameters.center.x() = 2.5;
+    expect(ellipsoid::EllipsoidSet(results).overlappingPairs().empty(),
+           "Wrong overlap of fit results");
+    const auto close = ellipsoid::EllipsoidSet(results).pairsWithin(1.);
+    expect(close.size() == 1 and std::abs(close[0].distance - 0.5) < tol,
+           "Wrong distance between fit results");
+
+    return 0;
+}
@@ -0,0 +1,434 @@
+#include <ellipsoid/async.h>
+#include <ellipsoid/batch.h>
+#include <ellipsoid/cache.h>
+#include <ellipsoid/executor.h>
+#include <ellipsoid/generate.h>
+#include <ellipsoid/inline.h>
+#include <ellipsoid/lazy.h>
+#include <ellipsoid/minimal.h>
+#include <ellipsoid/planner.h>
+#include <ellipsoid/robust.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+ * Performance regression checks: deterministic workloads through each
+ * EllipsoidType and API surface, each timed after a warm-up as the median of
+ * several repetitions, along with its number of heap allocations.
+ *
+ * usage: test-performance <surface> <baseline> [margin] [mode]
+ *
+ * The times are also expressed relative to a reference workload
+ * (Moments::add() on 10k points) timed after each repetition, which mostly
+ * cancels the speed of the machine and its variations. In the default
+ * "relative" mode, a case fails if its relative time exceeds the baseline by
+ * more than the margin (2 by default, i.e twice as slow) or if it allocates
+ * more than 10% above the baseline.
+ * The "absolute" mode compares the times in nanoseconds instead, which is
+ * only meaningful on the machine the baseline was measured on (the
+ * PERFORMANCE_TIMINGS CMake option). With "update", the measurements of the
+ * surface replace those stored in the baseline file.
+ *
+ * Everything runs on a single thread executor so that the measurements do
+ * not depend on the number of cores.
+ */
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+} // namespace
+
+#if defined(__GLIBC__)
+// Count the allocations of the whole process, the library included
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+// Eigen and the standard library may use the aligned allocation functions
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** pointer, size_t alignment, size_t size) noexcept {
+    if (alignment % sizeof(void*) != 0 or
+        (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* result = __libc_memalign(alignment, size);
+    if (result == nullptr) {
+        return ENOMEM;
+    }
+    *pointer = result;
+    return 0;
+}
+}
+constexpr bool counting_allocations = true;
+#else
+constexpr bool counting_allocations = false;
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Points = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+
+constexpr size_t warm_up = 3;
+constexpr size_t repetitions = 15;
+// minimum duration of a repetition, several calls being timed together
+constexpr double repetition_seconds = 2e-3;
+
+struct Case {
+    std::string name;
+    std::function<void()> run;
+};
+
+struct Measure {
+    //! median time of a call, in nanoseconds
+    double nanoseconds;
+    //! median absolute deviation of the time of a call, in nanoseconds
+    double deviation;
+    //! median time of a call relative to the reference workload
+    double relative;
+    //! heap allocations per call
+    double allocations;
+};
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 == 1
+               ? values[middle]
+               : 0.5 * (values[middle - 1] + values[middle]);
+}
+
+// Number of calls timed together, for a repetition to last long enough
+size_t callsPerRepetition(const Case& test) {
+    const auto start = Clock::now();
+    for (size_t i = 0; i < warm_up; ++i) {
+        test.run();
+    }
+    const double call_seconds =
+        std::chrono::duration<double>(Clock::now() - start).count() /
+        warm_up;
+    return std::max<size_t>(
+        1, static_cast<size_t>(repetition_seconds / call_seconds));
+}
+
+// Time of a call, in nanoseconds
+double time(const Case& test, size_t calls) {
+    const auto start = Clock::now();
+    for (size_t i = 0; i < calls; ++i) {
+        test.run();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start)
+               .count() /
+           static_cast<double>(calls);
+}
+
+// The reference workload is timed after each repetition of the case, so
+// that the relative time follows the variations of the machine's speed
+Measure measure(const Case& test, const Case& reference) {
+    const size_t calls = callsPerRepetition(test);
+    const size_t reference_calls = callsPerRepetition(reference);
+
+    std::vector<double> times;
+    std::vector<double> relatives;
+    times.reserve(repetitions);
+    relatives.reserve(repetitions);
+    uint64_t allocated = 0;
+    for (size_t r = 0; r < repetitions; ++r) {
+        const uint64_t allocations_before = allocations.load();
+        times.push_back(time(test, calls));
+        allocated += allocations.load() - allocations_before;
+        relatives.push_back(times.back() / time(reference, reference_calls));
+    }
+
+    Measure result;
+    result.nanoseconds = median(times);
+    for (auto& time : times) {
+        time = std::abs(time - result.nanoseconds);
+    }
+    result.deviation = median(times);
+    result.relative = median(relatives);
+    result.allocations = static_cast<double>(allocated) /
+                         static_cast<double>(repetitions * calls);
+    return result;
+}
+
+// Same point set on every run
+Points points(size_t rows, unsigned seed = 42) {
+    std::srand(seed);
+    ellipsoid::Parameters parameters;
+    parameters.center << 1., -2., 3.;
+    parameters.radii << 4., 5., 6.;
+    return ellipsoid::generate(parameters, rows) +
+           1e-3 * Points::Random(static_cast<Eigen::Index>(rows), 3);
+}
+
+const char* typeName(ellipsoid::EllipsoidType type) {
+    switch (type) {
+    case ellipsoid::EllipsoidType::Arbitrary:
+        return "arbitrary";
+    case ellipsoid::EllipsoidType::XYEqual:
+        return "xy-equal";
+    case ellipsoid::EllipsoidType::XZEqual:
+        return "xz-equal";
+    case ellipsoid::EllipsoidType::Sphere:
+        return "sphere";
+    case ellipsoid::EllipsoidType::Aligned:
+        return "aligned";
+    case ellipsoid::EllipsoidType::AlignedXYEqual:
+        return "aligned-xy-equal";
+    default:
+        return "aligned-xz-equal";
+    }
+}
+
+// Workload the times are expressed relative to, memory bound like most cases
+Case reference() {
+    auto data = std::make_shared<Points>(points(10000));
+    return {"reference", [data] {
+                ellipsoid::Moments moments;
+                moments.add(*data);
+            }};
+}
+
+// The cases of a surface, sharing their data through the closures
+std::vector<Case> cases(const std::string& surface) {
+    using ellipsoid::EllipsoidType;
+    std::vector<Case> result;
+    auto data = std::make_shared<Points>(points(10000));
+
+    if (surface == "types") {
+        for (int t = 0; t <= static_cast<int>(EllipsoidType::AlignedXZEqual);
+             ++t) {
+            const auto type = static_cast<EllipsoidType>(t);
+            result.push_back({std::string("fit.") + typeName(type),
+                              [data, type] { ellipsoid::fit(*data, type); }});
+        }
+    } else if (surface == "moments") {
+        result.push_back({"moments.add", [data] {
+                              ellipsoid::Moments moments;
+                              moments.add(*data);
+                          }});
+        auto moments = std::make_shared<ellipsoid::Moments>();
+        moments->add(*data);
+        result.push_back(
+            {"moments.fit", [moments] { ellipsoid::fit(*moments); }});
+        result.push_back({"moments.parallel", [data] {
+                              ellipsoid::accumulateParallel(*data, 2500);
+                          }});
+    } else if (surface == "planner") {
+        for (auto strategy : {ellipsoid::FitStrategy::DesignMatrix,
+                              ellipsoid::FitStrategy::Streaming,
+                              ellipsoid::FitStrategy::ParallelAccumulation}) {
+            ellipsoid::FitOptions options;
+            options.strategy = strategy;
+            const auto name =
+                strategy == ellipsoid::FitStrategy::DesignMatrix
+                    ? "planner.design-matrix"
+                    : strategy == ellipsoid::FitStrategy::Streaming
+                          ? "planner.streaming"
+                          : "planner.parallel";
+            result.push_back({name, [data, options] {
+                                  ellipsoid::fit(*data, options);
+                              }});
+        }
+    } else if (surface == "lazy") {
+        result.push_back({"lazy.coefficients", [data] {
+                              ellipsoid::fitLazy(*data).coefficients();
+                          }});
+        result.push_back({"lazy.radii",
+                          [data] { ellipsoid::fitLazy(*data).radii(); }});
+    } else if (surface == "small") {
+        auto small =
+            std::make_shared<Eigen::Matrix<double, 20, 3>>(points(20));
+        result.push_back({"small.fit", [small] {
+                              ellipsoid::fit(Points(*small));
+                          }});
+        result.push_back({"small.inline", [small] {
+                              ellipsoid::fitInline(*small);
+                          }});
+        result.push_back({"small.static", [small] {
+                              ellipsoid::StaticFitter<> fitter;
+                              for (Eigen::Index i = 0; i < 20; ++i) {
+                                  fitter.add(
+                                      small->row(i).transpose().cast<float>());
+                              }
+                              ellipsoid::FitResult fitted;
+                              fitter.fit(fitted);
+                          }});
+    } else if (surface == "batch") {
+        auto problems = std::make_shared<
+            std::vector<ellipsoid::Moments,
+                        Eigen::aligned_allocator<ellipsoid::Moments>>>();
+        for (unsigned i = 0; i < 256; ++i) {
+            ellipsoid::Moments moments;
+            moments.add(points(100, i));
+            problems->push_back(moments);
+        }
+        result.push_back({"batch.moments", [problems] {
+                              ellipsoid::fitBatch(*problems);
+                          }});
+    } else if (surface == "robust") {
+        result.push_back(
+            {"robust.fit", [data] { ellipsoid::fitRobust(*data); }});
+    } else if (surface == "cache") {
+        auto cache = std::make_shared<ellipsoid::FitCache>();
+        cache->fit(*data);
+        result.push_back({"cache.hit", [data, cache] { cache->fit(*data); }});
+    } else if (surface == "async") {
+        result.push_back({"async.fit", [data] {
+                              ellipsoid::fitAsync(*data).get();
+                          }});
+    } else {
+        throw std::invalid_argument("Unknown surface " + surface);
+    }
+    return result;
+}
+
+using Baseline = std::map<std::string, Measure>;
+
+Baseline readBaseline(const std::string& path) {
+    Baseline baseline;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() or line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string name;
+        Measure measure{0., 0., 0., 0.};
+        if (fields >> name >> measure.nanoseconds >> measure.relative >>
+            measure.allocations) {
+            baseline[name] = measure;
+        }
+    }
+    return baseline;
+}
+
+void writeBaseline(const std::string& path, const Baseline& baseline) {
+    std::ofstream file(path);
+    file << "# case nanoseconds_per_call relative_time allocations_per_call\n";
+    for (const auto& entry : baseline) {
+        file << entry.first << ' ' << entry.second.nanoseconds << ' '
+             << entry.second.relative << ' ' << entry.second.allocations
+             << '\n';
+    }
+    if (not file) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0]
+                  << " <surface> <baseline> [margin] "
+                     "[relative|absolute|update]\n";
+        return 1;
+    }
+    const std::string surface = argv[1];
+    const std::string path = argv[2];
+    const double margin = argc > 3 ? std::strtod(argv[3], nullptr) : 2.;
+    const std::string mode = argc > 4 ? argv[4] : "relative";
+    if (mode != "relative" and mode != "absolute" and mode != "update") {
+        throw std::invalid_argument("Unknown mode " + mode);
+    }
+    const bool update = mode == "update";
+    const bool absolute = mode == "absolute";
+    ellipsoid::setDefaultExecutor(
+        std::make_shared<ellipsoid::WorkStealingExecutor>(1));
+
+    const auto reference_workload = reference();
+    auto baseline = readBaseline(path);
+    std::vector<std::string> failures;
+    for (const auto& test : cases(surface)) {
+        const auto result = measure(test, reference_workload);
+        std::printf("%-24s %12.0f ns +- %-8.0f %8.2f x ref %8.1f allocations",
+                    test.name.c_str(), result.nanoseconds, result.deviation,
+                    result.relative, result.allocations);
+
+        const auto stored = baseline.find(test.name);
+        if (update) {
+            baseline[test.name] = result;
+            std::printf("\n");
+            continue;
+        }
+        if (stored == baseline.end()) {
+            std::printf("  (no baseline)\n");
+            continue;
+        }
+        const double ratio =
+            absolute ? result.nanoseconds / stored->second.nanoseconds
+                     : result.relative / stored->second.relative;
+        std::printf("  x%.2f of baseline\n", ratio);
+        if (ratio > margin) {
+            failures.push_back(test.name + " is " + std::to_string(ratio) +
+                               " times slower than its baseline (" + mode +
+                               " time)");
+        }
+        if (counting_allocations and
+            result.allocations > 1.1 * stored->second.allocations + 0.5) {
+            failures.push_back(test.name + " allocates " +
+                               std::to_string(result.allocations) +
+                               " times per call, " +
+                               std::to_string(stored->second.allocations) +
+                               " in the baseline");
+        }
+    }
+
+    if (update) {
+        writeBaseline(path, baseline);
+    }
+    if (not failures.empty()) {
+        std::stringstream ss;
+        for (const auto& failure : failures) {
+            ss << failure << '\n';
+        }
+        throw std::runtime_error(ss.str());
+    }
+    return 0;
+}
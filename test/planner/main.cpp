@@ -0,0 +1,121 @@
+#include <ellipsoid/generate.h>
+#include <ellipsoid/planner.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <time.h>
+
+int main(int argc, char const* argv[]) {
+    const double tol = 1e-6;
+    std::srand(time(nullptr));
+
+    // planner decisions
+    ellipsoid::FitOptions options;
+    options.threads = 8;
+    auto plan = ellipsoid::planFit(1000, options);
+    if (plan.strategy == ellipsoid::FitStrategy::Automatic or
+        plan.stride != 1 or plan.rows_used != 1000) {
+        throw std::runtime_error("Wrong plan for a small fit");
+    }
+
+    // the default budget turns the design matrix down for large scans
+    ellipsoid::FitOptions defaults;
+    defaults.threads = 8;
+    defaults.cost_model.design_matrix_per_point = 1e-12;
+    if (defaults.memory_budget == 0) {
+        throw std::runtime_error("No default memory budget");
+    }
+    // at least 8 bytes of design matrix per point and column
+    plan = ellipsoid::planFit(defaults.memory_budget / 8, defaults);
+    if (plan.strategy == ellipsoid::FitStrategy::DesignMatrix or
+        plan.memory > defaults.memory_budget) {
+        throw std::runtime_error("Wrong plan for the default memory budget");
+    }
+
+    // design matrix favored by the cost model but out of the budget
+    options.cost_model.design_matrix_per_point = 1e-12;
+    options.memory_budget = 1 << 20;
+    plan = ellipsoid::planFit(100000000, options);
+    if (plan.strategy != ellipsoid::FitStrategy::ParallelAccumulation or
+        plan.memory > options.memory_budget or plan.tasks < options.threads) {
+        throw std::runtime_error("Wrong plan for a memory budget");
+    }
+    options.memory_budget = 0;
+    plan = ellipsoid::planFit(100000000, options);
+    if (plan.strategy != ellipsoid::FitStrategy::DesignMatrix) {
+        throw std::runtime_error("Wrong plan without memory budget");
+    }
+    options.cost_model = ellipsoid::CostModel();
+
+    options.threads = 1;
+    options.time_budget = 1e-3;
+    plan = ellipsoid::planFit(100000000, options);
+    if (plan.strategy != ellipsoid::FitStrategy::Subsampling or
+        plan.rows_used >= 100000000 or
+        plan.rows_used < options.min_sample_rows or
+        plan.seconds > 2. * options.time_budget) {
+        throw std::runtime_error("Wrong plan for a time budget");
+    }
+
+    // no minimum and a budget too small for a single point
+    options.min_sample_rows = 0;
+    options.time_budget = 1e-9;
+    plan = ellipsoid::planFit(100000000, options);
+    if (plan.strategy != ellipsoid::FitStrategy::Subsampling or
+        plan.rows_used != 1 or plan.stride != 100000000) {
+        throw std::runtime_error("Wrong plan without minimum sample size");
+    }
+    options.strategy = ellipsoid::FitStrategy::Subsampling;
+    options.time_budget = 0.;
+    plan = ellipsoid::planFit(100000000, options);
+    if (plan.rows_used != 1 or plan.stride != 100000000) {
+        throw std::runtime_error("Wrong forced plan without minimum size");
+    }
+    options.strategy = ellipsoid::FitStrategy::Automatic;
+    options.min_sample_rows = 1000;
+
+    // every strategy gives the ellipsoid the points lie on
+    for (size_t i = 0; i < 20; ++i) {
+        ellipsoid::Parameters parameters;
+        parameters.center = Eigen::Vector3d::Random();
+        parameters.radii = Eigen::Vector3d::Random().cwiseAbs().array() + 0.5;
+        const auto points = ellipsoid::generate(parameters, 50000);
+        const auto expected = ellipsoid::fit(points);
+
+        const ellipsoid::FitStrategy strategies[] = {
+            ellipsoid::FitStrategy::Automatic,
+            ellipsoid::FitStrategy::DesignMatrix,
+            ellipsoid::FitStrategy::Streaming,
+            ellipsoid::FitStrategy::ParallelAccumulation,
+            ellipsoid::FitStrategy::Subsampling,
+            ellipsoid::FitStrategy::Tsqr,
+        };
+        for (const auto strategy : strategies) {
+            options.strategy = strategy;
+            ellipsoid::Diagnostics diagnostics;
+            const auto result = ellipsoid::fit(points, options, &diagnostics);
+            if (diagnostics.rows != 50000 or
+                (strategy != ellipsoid::FitStrategy::Automatic and
+                 diagnostics.plan.strategy != strategy) or
+                not(diagnostics.seconds > 0.)) {
+                throw std::runtime_error("Wrong diagnostics");
+            }
+            if (strategy == ellipsoid::FitStrategy::Subsampling and
+                diagnostics.plan.rows_used != 1000) {
+                throw std::runtime_error("Wrong number of subsampled points");
+            }
+            if (not result.parameters.center.isApprox(expected.center, tol) or
+                not result.parameters.radii.isApprox(expected.radii, tol)) {
+                std::stringstream ss;
+                ss << "Wrong fit for strategy " << static_cast<int>(strategy)
+                   << ": center " << result.parameters.center.transpose()
+                   << ", radii " << result.parameters.radii.transpose()
+                   << ", expecting " << expected.center.transpose() << " and "
+                   << expected.radii.transpose();
+                throw std::runtime_error(ss.str());
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,305 @@
+#include <ellipsoid/fit.h>
+#include <ellipsoid/generate.h>
+#include <ellipsoid/quadric.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+
+namespace {
+
+using Points = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+
+void expect(bool condition, const std::string& what) {
+    if (not condition) {
+        throw std::runtime_error(what);
+    }
+}
+
+double uniform(double low, double high) {
+    return low + (high - low) * 0.5 * (Eigen::Vector2d::Random()(0) + 1.);
+}
+
+// Points of a surface given in its canonical frame, moved by a random rigid
+// transformation, with some noise
+struct Surface {
+    Surface(const std::function<Eigen::Vector3d()>& canonical, size_t count) {
+        rotation = Eigen::Quaterniond(Eigen::Vector4d::Random().normalized())
+                       .toRotationMatrix();
+        translation = 5. * Eigen::Vector3d::Random();
+        points.resize(static_cast<Eigen::Index>(count), 3);
+        for (Eigen::Index i = 0; i < points.rows(); ++i) {
+            points.row(i) = (rotation * canonical() + translation +
+                             1e-5 * Eigen::Vector3d::Random())
+                                .transpose();
+        }
+    }
+
+    Eigen::Vector3d point(const Eigen::Vector3d& canonical) const {
+        return rotation * canonical + translation;
+    }
+
+    Eigen::Vector3d direction(const Eigen::Vector3d& canonical) const {
+        return rotation * canonical;
+    }
+
+    Eigen::Matrix3d rotation;
+    Eigen::Vector3d translation;
+    Points points;
+};
+
+const char* typeName(ellipsoid::QuadricType type) {
+    switch (type) {
+    case ellipsoid::QuadricType::Ellipsoid:
+        return "ellipsoid";
+    case ellipsoid::QuadricType::HyperboloidOfOneSheet:
+        return "hyperboloid of one sheet";
+    case ellipsoid::QuadricType::HyperboloidOfTwoSheets:
+        return "hyperboloid of two sheets";
+    case ellipsoid::QuadricType::Cone:
+        return "cone";
+    case ellipsoid::QuadricType::EllipticParaboloid:
+        return "elliptic paraboloid";
+    case ellipsoid::QuadricType::HyperbolicParaboloid:
+        return "hyperbolic paraboloid";
+    case ellipsoid::QuadricType::EllipticCylinder:
+        return "elliptic cylinder";
+    case ellipsoid::QuadricType::HyperbolicCylinder:
+        return "hyperbolic cylinder";
+    case ellipsoid::QuadricType::ParabolicCylinder:
+        return "parabolic cylinder";
+    default:
+        return "degenerate";
+    }
+}
+
+ellipsoid::Quadric fitExpecting(const Surface& surface,
+                                ellipsoid::QuadricType type) {
+    const auto quadric = ellipsoid::fitQuadric(surface.points);
+    expect(quadric.type == type, std::string("Fitted a ") +
+                                     typeName(quadric.type) + " on a " +
+                                     typeName(type));
+    expect(quadric.rms_distance < 1e-4,
+           std::string("Wrong distance to the ") + typeName(type));
+    expect(std::abs(quadric.coefficients.norm() - 1.) < 1e-12,
+           "Coefficients not normalized");
+    return quadric;
+}
+
+void expectNear(const Eigen::VectorXd& value, const Eigen::VectorXd& expected,
+                double tol, const std::string& what) {
+    std::stringstream ss;
+    ss << "Wrong " << what << ": " << value.transpose() << " instead of "
+       << expected.transpose();
+    expect((value - expected).norm() <= tol * (1. + expected.norm()),
+           ss.str());
+}
+
+void expectNear(double value, double expected, double tol,
+                const std::string& what) {
+    expectNear(Eigen::VectorXd::Constant(1, value),
+               Eigen::VectorXd::Constant(1, expected), tol, what);
+}
+
+// Same direction, up to the sign
+void expectParallel(const Eigen::Vector3d& value,
+                    const Eigen::Vector3d& expected, double tol,
+                    const std::string& what) {
+    expect(value.cross(expected).norm() < tol, "Wrong " + what);
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    const double tol = 1e-3;
+    std::srand(time(nullptr));
+    using ellipsoid::QuadricType;
+
+    // same ellipsoid as fit() on points around it
+    ellipsoid::Parameters parameters;
+    parameters.center = 10. * Eigen::Vector3d::Random();
+    parameters.radii << 1., 2., 3.;
+    const Points points = ellipsoid::generate(parameters, 2000);
+    const auto general = ellipsoid::fitQuadric(points);
+    expect(general.type == QuadricType::Ellipsoid, "Ellipsoid not found");
+    Eigen::Matrix<double, 10, 1> coefficients;
+    const auto fitted = ellipsoid::fit(points, &coefficients);
+    expectNear(general.center, fitted.center, 1e-6, "ellipsoid center");
+    expectNear(general.radii, fitted.radii, 1e-6, "ellipsoid radii");
+    coefficients.normalize();
+    expect(std::abs(std::abs(coefficients.dot(general.coefficients)) - 1.) <
+               1e-9,
+           "Coefficients different from fit()'s");
+
+    // moments of parts of the points give the same quadric
+    ellipsoid::Moments first;
+    ellipsoid::Moments second;
+    first.add(points.topRows(1000));
+    second.add(points.bottomRows(1000));
+    first.merge(second);
+    expectNear(ellipsoid::fitQuadric(first).coefficients,
+               general.coefficients, 1e-9, "coefficients from moments");
+
+    // the trace of the quadratic part of this cone is zero, fit() can't
+    // represent it
+    for (double angle : {0.3, std::atan(std::sqrt(2.)), 1.2}) {
+        const Surface cone(
+            [angle] {
+                const double h = uniform(0.5, 3.);
+                const double t = uniform(0., 2. * M_PI);
+                return Eigen::Vector3d(h * std::tan(angle) * std::cos(t),
+                                       h * std::tan(angle) * std::sin(t), h);
+            },
+            5000);
+        const auto quadric = fitExpecting(cone, QuadricType::Cone);
+        expectNear(quadric.center, cone.translation, tol, "apex");
+        expectParallel(quadric.axes.col(2),
+                       cone.direction(Eigen::Vector3d::UnitZ()), tol,
+                       "cone axis");
+        expectNear(quadric.angles, Eigen::Vector2d::Constant(angle), tol,
+                   "cone angles");
+    }
+
+    const Surface cylinder(
+        [] {
+            const double t = uniform(0., 2. * M_PI);
+            return Eigen::Vector3d(2. * std::cos(t), std::sin(t),
+                                   uniform(-5., 5.));
+        },
+        5000);
+    auto quadric = fitExpecting(cylinder, QuadricType::EllipticCylinder);
+    expectParallel(quadric.axes.col(2),
+                   cylinder.direction(Eigen::Vector3d::UnitZ()), tol,
+                   "cylinder axis");
+    const int major = quadric.radii(0) > quadric.radii(1) ? 0 : 1;
+    expectNear(Eigen::Vector2d(quadric.radii(major), quadric.radii(1 - major)),
+               Eigen::Vector2d(2., 1.), tol, "cylinder radii");
+    expectParallel(quadric.axes.col(major),
+                   cylinder.direction(Eigen::Vector3d::UnitX()), tol,
+                   "cylinder section axes");
+    expect(std::isinf(quadric.radii(2)), "Finite cylinder length");
+    // the point of the axis closest to the centroid
+    expectNear(quadric.center,
+               cylinder.point(Eigen::Vector3d(
+                   0., 0.,
+                   (cylinder.rotation.transpose() *
+                    (cylinder.points.colwise().mean().transpose() -
+                     cylinder.translation))(2))),
+               tol, "cylinder center");
+
+    const Surface paraboloid(
+        [] {
+            const double x = uniform(-2., 2.);
+            const double y = uniform(-2., 2.);
+            return Eigen::Vector3d(x, y, x * x / 2. + y * y / 6.);
+        },
+        5000);
+    quadric = fitExpecting(paraboloid, QuadricType::EllipticParaboloid);
+    expectNear(quadric.center, paraboloid.translation, tol, "vertex");
+    expectNear(quadric.axes.col(2),
+               paraboloid.direction(Eigen::Vector3d::UnitZ()), tol,
+               "paraboloid opening");
+    expectParallel(quadric.axes.col(0),
+                   paraboloid.direction(Eigen::Vector3d::UnitX()), tol,
+                   "paraboloid axes");
+    expectNear(quadric.radii.head<2>(), Eigen::Vector2d(1., 3.), tol,
+               "paraboloid curvature radii");
+
+    const Surface saddle(
+        [] {
+            const double x = uniform(-2., 2.);
+            const double y = uniform(-2., 2.);
+            return Eigen::Vector3d(x, y, x * x / 4. - y * y / 2.);
+        },
+        5000);
+    quadric = fitExpecting(saddle, QuadricType::HyperbolicParaboloid);
+    expectNear(quadric.center, saddle.translation, tol, "saddle point");
+    // the sharpest curvature first, along y where the saddle opens down
+    expectNear(quadric.axes.col(2),
+               saddle.direction(-Eigen::Vector3d::UnitZ()), tol,
+               "hyperbolic paraboloid axis");
+    expectParallel(quadric.axes.col(0),
+                   saddle.direction(Eigen::Vector3d::UnitY()), tol,
+                   "hyperbolic paraboloid axes");
+    expectNear(quadric.radii.head<2>(), Eigen::Vector2d(1., 2.), tol,
+               "hyperbolic paraboloid curvature radii");
+
+    const Surface one_sheet(
+        [] {
+            const double s = uniform(-1., 1.);
+            const double t = uniform(0., 2. * M_PI);
+            return Eigen::Vector3d(std::cosh(s) * std::cos(t),
+                                   2. * std::cosh(s) * std::sin(t),
+                                   3. * std::sinh(s));
+        },
+        5000);
+    quadric = fitExpecting(one_sheet, QuadricType::HyperboloidOfOneSheet);
+    expectNear(quadric.center, one_sheet.translation, tol,
+               "hyperboloid center");
+    expectParallel(quadric.axes.col(2),
+                   one_sheet.direction(Eigen::Vector3d::UnitZ()), tol,
+                   "hyperboloid axis");
+    expectNear(quadric.radii(2), 3., tol, "hyperboloid axis radius");
+
+    const Surface two_sheets(
+        [] {
+            const double s = uniform(0., 1.5);
+            const double t = uniform(0., 2. * M_PI);
+            return Eigen::Vector3d(2. * std::sinh(s) * std::cos(t),
+                                   2. * std::sinh(s) * std::sin(t),
+                                   (std::rand() % 2 ? 1. : -1.) * std::cosh(s));
+        },
+        5000);
+    quadric = fitExpecting(two_sheets, QuadricType::HyperboloidOfTwoSheets);
+    expectNear(quadric.radii, Eigen::Vector3d(2., 2., 1.), tol,
+               "hyperboloid radii");
+
+    const Surface hyperbolic_cylinder(
+        [] {
+            const double s = uniform(-1.5, 1.5);
+            return Eigen::Vector3d(std::cosh(s), 2. * std::sinh(s),
+                                   uniform(-3., 3.));
+        },
+        5000);
+    quadric =
+        fitExpecting(hyperbolic_cylinder, QuadricType::HyperbolicCylinder);
+    expectParallel(quadric.axes.col(0),
+                   hyperbolic_cylinder.direction(Eigen::Vector3d::UnitX()), tol,
+                   "hyperbolic cylinder axes");
+    expectNear(quadric.radii.head<2>(), Eigen::Vector2d(1., 2.), tol,
+               "hyperbolic cylinder radii");
+
+    const Surface parabolic_cylinder(
+        [] {
+            const double x = uniform(-2., 2.);
+            return Eigen::Vector3d(x, uniform(-3., 3.), x * x / 3.);
+        },
+        5000);
+    quadric =
+        fitExpecting(parabolic_cylinder, QuadricType::ParabolicCylinder);
+    expectNear(quadric.axes.col(2),
+               parabolic_cylinder.direction(Eigen::Vector3d::UnitZ()), tol,
+               "parabolic cylinder opening");
+    expectParallel(quadric.axes.col(1),
+                   parabolic_cylinder.direction(Eigen::Vector3d::UnitY()), tol,
+                   "parabolic cylinder lines");
+    expectNear(quadric.radii(0), 1.5, tol,
+               "parabolic cylinder curvature radius");
+
+    for (const auto& q : {general, quadric}) {
+        expect(std::abs(q.axes.determinant() - 1.) < 1e-9,
+               "Axes not a rotation");
+    }
+
+    // not enough points
+    const auto degenerate = ellipsoid::fitQuadric(points.topRows(8));
+    expect(degenerate.type == QuadricType::Degenerate and
+               degenerate.coefficients.hasNaN(),
+           "Fitted a quadric on 8 points");
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <ellipsoid/generate.h>
+#include <ellipsoid/quantized.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+using Points = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+
+void expect(bool condition, const std::string& what) {
+    if (not condition) {
+        throw std::runtime_error(what);
+    }
+}
+
+void expectClose(const ellipsoid::Parameters& fitted,
+                 const ellipsoid::Parameters& expected, double tol,
+                 const std::string& what) {
+    std::stringstream ss;
+    ss << what << ": center " << fitted.center.transpose() << ", radii "
+       << fitted.radii.transpose() << ", expecting "
+       << expected.center.transpose() << " and "
+       << expected.radii.transpose();
+    expect((fitted.center - expected.center).norm() < tol and
+               (fitted.radii - expected.radii).norm() < tol,
+           ss.str());
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    std::srand(time(nullptr));
+
+    // LAS like records of 26 bytes: a 2 bytes intensity before the int32
+    // coordinates, then other fields, the records being unaligned
+    const size_t stride = 26;
+    const size_t coordinates_offset = 2;
+    const Eigen::Vector3d scale(1e-3, 2.5e-4, 5e-3);
+    const Eigen::Vector3d offset(431000., 5412000., 120.);
+
+    for (int i = 0; i < 10; ++i) {
+        ellipsoid::Parameters expected;
+        expected.center = offset + 10. * Eigen::Vector3d::Random();
+        expected.radii = 5. * Eigen::Vector3d::Random().cwiseAbs().array() +
+                         1.;
+        const Points points = ellipsoid::generate(expected, 20000);
+
+        std::vector<char> buffer(1 + static_cast<size_t>(points.rows()) *
+                                         stride);
+        Points decoded(points.rows(), 3);
+        for (Eigen::Index row = 0; row < points.rows(); ++row) {
+            int32_t xyz[3];
+            for (int axis = 0; axis < 3; ++axis) {
+                xyz[axis] = static_cast<int32_t>(std::lround(
+                    (points(row, axis) - offset(axis)) / scale(axis)));
+                decoded(row, axis) = scale(axis) * xyz[axis] + offset(axis);
+            }
+            std::memcpy(buffer.data() + 1 +
+                            static_cast<size_t>(row) * stride +
+                            coordinates_offset,
+                        xyz, sizeof(xyz));
+        }
+
+        const ellipsoid::QuantizedRecords records{
+            buffer.data() + 1,  static_cast<size_t>(points.rows()),
+            stride,             coordinates_offset,
+            scale,              offset};
+        const auto fitted = ellipsoid::fit(records);
+
+        // the same points as decoded to double, up to the rounding errors.
+        // They are fitted through moments, relative to a point close to
+        // them, as the design matrix of georeferenced coordinates is far
+        // too ill conditioned
+        ellipsoid::Moments decoded_moments;
+        decoded_moments.add(decoded);
+        expectClose(fitted, ellipsoid::fit(decoded_moments), 1e-8,
+                    "Quantized fit differs from the decoded one");
+        // the quantization moves the points by half a step at most
+        expectClose(fitted, expected, scale.maxCoeff(),
+                    "Quantized fit beyond the quantization error");
+
+        // accumulating in two parts gives the same result
+        auto first = records;
+        first.count = records.count / 3;
+        auto second = records;
+        second.data = static_cast<const char*>(records.data) +
+                      first.count * stride;
+        second.count = records.count - first.count;
+        ellipsoid::Moments moments;
+        ellipsoid::accumulate(moments, first);
+        ellipsoid::accumulate(moments, second);
+        expect(moments.count() == records.count, "Wrong number of points");
+        expectClose(ellipsoid::fit(moments), fitted, 1e-9,
+                    "Accumulation in parts differs");
+    }
+
+    return 0;
+}
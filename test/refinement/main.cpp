@@ -0,0 +1,138 @@
+#include <ellipsoid/refinement.h>
+#include <ellipsoid/generate.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+
+namespace {
+
+using Points = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+
+void expect(bool condition, const std::string& what) {
+    if (not condition) {
+        throw std::runtime_error(what);
+    }
+}
+
+ellipsoid::RefinementOptions options(ellipsoid::Factorization factorization,
+                                     ellipsoid::ResidualPrecision residuals) {
+    ellipsoid::RefinementOptions opt;
+    opt.factorization = factorization;
+    opt.residuals = residuals;
+    return opt;
+}
+
+// Points on a cap of the ellipsoid around its last axis, the smaller the
+// cap the worse the conditioning of the normal equations
+Points capPoints(const ellipsoid::Parameters& params, double half_angle,
+                 Eigen::Index count) {
+    Points points(count, 3);
+    for (Eigen::Index i = 0; i < count; ++i) {
+        const Eigen::Vector2d random =
+            0.5 * (Eigen::Vector2d::Random() + Eigen::Vector2d::Ones());
+        const double theta = half_angle * std::sqrt(random(0));
+        const double phi = 2. * M_PI * random(1);
+        const Eigen::Vector3d direction(std::sin(theta) * std::cos(phi),
+                                        std::sin(theta) * std::sin(phi),
+                                        std::cos(theta));
+        points.row(i) =
+            (params.center + params.radii.cwiseProduct(direction))
+                .transpose();
+    }
+    return points;
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    using ellipsoid::Factorization;
+    using ellipsoid::ResidualPrecision;
+    std::srand(time(nullptr));
+
+    const Factorization factorizations[] = {Factorization::Float,
+                                            Factorization::LDLT};
+    const ResidualPrecision precisions[] = {ResidualPrecision::Double,
+                                           ResidualPrecision::DoubleDouble};
+
+    ellipsoid::Parameters expected;
+    expected.center = Eigen::Vector3d(5., -3., 2.);
+    expected.radii = Eigen::Vector3d(1., 2., 3.);
+
+    // well conditioned: same solution as the SVD, to the last bits
+    ellipsoid::Moments moments;
+    moments.add(ellipsoid::generate(expected, 2000));
+    Eigen::Matrix<double, 10, 1> coefficients;
+    ellipsoid::fit(moments, &coefficients);
+    for (auto factorization : factorizations) {
+        for (auto precision : precisions) {
+            ellipsoid::RefinementReport report;
+            const auto result = ellipsoid::fitRefined(
+                moments, ellipsoid::EllipsoidType::Arbitrary,
+                options(factorization, precision), &report);
+            expect(report.converged and not report.fallback,
+                   "Refinement not converged on a whole ellipsoid");
+            expect(report.iterations > 0 and report.iterations <= 10,
+                   "Wrong number of refinement steps");
+            expect(report.backward_error < 1e-15,
+                   "Wrong backward error on a whole ellipsoid");
+            expect((result.coefficients - coefficients).norm() < 1e-10,
+                   "Refined coefficients differ from the SVD ones");
+            expect((result.parameters.center - expected.center).norm() <
+                           1e-10 and
+                       (result.parameters.radii - expected.radii).norm() <
+                           1e-10,
+                   "Wrong refined ellipsoid");
+        }
+    }
+
+    // a small cap, where the SVD loses about half of the digits: with
+    // double-double residuals, the accuracy doesn't depend on the
+    // factorization
+    ellipsoid::Moments cap;
+    cap.add(capPoints(expected, 0.1, 5000));
+    for (auto factorization : factorizations) {
+        ellipsoid::RefinementReport report;
+        const auto result = ellipsoid::fitRefined(
+            cap, ellipsoid::EllipsoidType::Arbitrary,
+            options(factorization, ResidualPrecision::DoubleDouble), &report);
+        expect(report.converged and not report.fallback,
+               "Refinement not converged on a cap");
+        const double error =
+            (result.parameters.center - expected.center).norm();
+        expect(error < 1e-8, "Inaccurate refined ellipsoid on a cap");
+    }
+
+    // far from the moments' origin, a single precision factorization can't
+    // capture the system and the SVD is used instead
+    expected.center = Eigen::Vector3d(100., -50., 30.);
+    expected.radii = Eigen::Vector3d(0.1, 0.2, 0.3);
+    ellipsoid::Moments far(Eigen::Vector3d::Zero());
+    far.add(ellipsoid::generate(expected, 2000));
+    auto opt = options(Factorization::Float, ResidualPrecision::DoubleDouble);
+    ellipsoid::RefinementReport report;
+    auto result = ellipsoid::fitRefined(
+        far, ellipsoid::EllipsoidType::Arbitrary, opt, &report);
+    ellipsoid::fit(far, &coefficients);
+    expect(not report.converged and report.fallback,
+           "Single precision factorization of a singular system");
+    expect(result.coefficients == coefficients,
+           "Fallback not using the SVD of fit(moments)");
+    opt.fallback = false;
+    result = ellipsoid::fitRefined(far, ellipsoid::EllipsoidType::Arbitrary,
+                                   opt, &report);
+    expect(not report.converged and not report.fallback and
+               result.parameters.center.hasNaN(),
+           "Failed refinement without fallback not reported");
+
+    // not enough points, the system is singular
+    ellipsoid::fitRefined(Points(capPoints(expected, 1., 3)),
+                          ellipsoid::EllipsoidType::Arbitrary,
+                          ellipsoid::RefinementOptions(), &report);
+    expect(not report.converged and report.fallback,
+           "Refinement converged on 3 points");
+
+    return 0;
+}
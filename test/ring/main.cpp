@@ -0,0 +1,88 @@
+#include <ellipsoid/generate.h>
+#include <ellipsoid/online.h>
+#include <ellipsoid/ring.h>
+
+#include <unistd.h>
+
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <time.h>
+
+int main(int argc, char const* argv[]) {
+    const double tol = 1e-6;
+    const auto name = "/ellipsoid-fit-test-" + std::to_string(::getpid());
+    std::srand(time(nullptr));
+
+    for (size_t i = 0; i < 20; ++i) {
+        ellipsoid::Parameters parameters;
+        parameters.center = Eigen::Vector3d::Random();
+        parameters.radii = Eigen::Vector3d::Random().cwiseAbs().array() + 0.5;
+        const auto points = ellipsoid::generate(parameters, 10000);
+
+        // small ring so that the producer wraps around and waits
+        ellipsoid::RingWriter writer(name, 256);
+        ellipsoid::RingReader reader(name);
+
+        std::thread producer([&] {
+            for (Eigen::Index row = 0; row < points.rows(); row += 37) {
+                const auto n = std::min<Eigen::Index>(37, points.rows() - row);
+                writer.write(points.middleRows(row, n),
+                             std::chrono::seconds(10));
+            }
+            writer.close();
+        });
+
+        ellipsoid::OnlineFitter fitter;
+        while (reader.wait(std::chrono::seconds(10))) {
+            fitter.update(reader);
+        }
+        producer.join();
+
+        const auto counters = reader.counters();
+        const auto expected = ellipsoid::fit(points);
+        const auto& identified = fitter.result().parameters;
+        if (counters.overruns != 0 or
+            counters.read != static_cast<uint64_t>(points.rows()) or
+            fitter.moments().count() != static_cast<size_t>(points.rows()) or
+            not identified.center.isApprox(expected.center, tol) or
+            not identified.radii.isApprox(expected.radii, tol)) {
+            std::stringstream ss;
+            ss << "Wrong online fit: " << counters.read << " samples read, "
+               << counters.overruns << " overruns, center "
+               << identified.center.transpose() << ", radii "
+               << identified.radii.transpose() << ", expecting "
+               << expected.center.transpose() << " and "
+               << expected.radii.transpose();
+            throw std::runtime_error(ss.str());
+        }
+    }
+
+    // samples that do not fit in a full ring are counted as overruns
+    {
+        ellipsoid::RingWriter writer(name, 16);
+        ellipsoid::RingReader reader(name);
+        const auto written =
+            writer.write(Eigen::Matrix<double, 20, 3>::Random());
+        const auto counters = writer.counters();
+        if (written != 16 or counters.overruns != 4 or counters.stalls != 1 or
+            reader.available() != 16) {
+            throw std::runtime_error("Wrong overrun accounting");
+        }
+        ellipsoid::Moments moments;
+        if (reader.read(moments) != 16 or writer.available() != 16) {
+            throw std::runtime_error("Wrong space release");
+        }
+    }
+
+    try {
+        ellipsoid::RingReader reader(name);
+        throw std::runtime_error("A removed ring can still be opened");
+    } catch (const std::system_error&) {
+    }
+
+    return 0;
+}
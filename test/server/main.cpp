@@ -0,0 +1,133 @@
+#include <ellipsoid/client.h>
+#include <ellipsoid/generate.h>
+#include <ellipsoid/server.h>
+
+#include <unistd.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+void expect(bool condition, const std::string& what) {
+    if (not condition) {
+        throw std::runtime_error(what);
+    }
+}
+
+const ellipsoid::EllipsoidType types[] = {
+    ellipsoid::EllipsoidType::Arbitrary,
+    ellipsoid::EllipsoidType::XYEqual,
+    ellipsoid::EllipsoidType::XZEqual,
+    ellipsoid::EllipsoidType::Sphere,
+    ellipsoid::EllipsoidType::Aligned,
+    ellipsoid::EllipsoidType::AlignedXYEqual,
+    ellipsoid::EllipsoidType::AlignedXZEqual,
+};
+
+// Axis aligned ellipsoid satisfying the constraints of the type
+ellipsoid::Parameters randomEllipsoid(ellipsoid::EllipsoidType type) {
+    ellipsoid::Parameters parameters;
+    parameters.center = Eigen::Vector3d::Random();
+    parameters.radii = Eigen::Vector3d::Random().cwiseAbs().array() + 0.5;
+    switch (type) {
+    case ellipsoid::EllipsoidType::XYEqual:
+    case ellipsoid::EllipsoidType::AlignedXYEqual:
+        parameters.radii.y() = parameters.radii.x();
+        break;
+    case ellipsoid::EllipsoidType::XZEqual:
+    case ellipsoid::EllipsoidType::AlignedXZEqual:
+        parameters.radii.z() = parameters.radii.x();
+        break;
+    case ellipsoid::EllipsoidType::Sphere:
+        parameters.radii.setConstant(parameters.radii.x());
+        break;
+    default:
+        break;
+    }
+    return parameters;
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    std::srand(time(nullptr));
+
+    ellipsoid::ServerOptions options;
+    options.socket_path =
+        "/tmp/ellipsoid-server-" + std::to_string(::getpid()) + ".sock";
+    options.workers = 2;
+    options.max_batch_size = 16;
+    options.batch_window = std::chrono::microseconds(500);
+    ellipsoid::Server server(options);
+    server.start();
+
+    // concurrent clients, so that the batches mix the types
+    const size_t clients = 4;
+    const size_t rounds = 20;
+    std::vector<std::string> failures(clients);
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            try {
+                ellipsoid::Client client(options.socket_path);
+                for (size_t round = 0; round < rounds; ++round) {
+                    for (const auto type : types) {
+                        const auto expected = randomEllipsoid(type);
+                        const auto points =
+                            ellipsoid::generate(expected, 200);
+                        const auto result = client.fit(points, type);
+                        std::stringstream ss;
+                        ss << "Wrong fit for type " << static_cast<int>(type)
+                           << ": center "
+                           << result.parameters.center.transpose()
+                           << ", radii "
+                           << result.parameters.radii.transpose()
+                           << ", expecting " << expected.center.transpose()
+                           << " and " << expected.radii.transpose();
+                        expect(result.parameters.center.isApprox(
+                                   expected.center, 1e-6) and
+                                   result.parameters.radii.isApprox(
+                                       expected.radii, 1e-6),
+                               ss.str());
+                    }
+                }
+            } catch (const std::exception& error) {
+                failures[c] = error.what();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& failure : failures) {
+        expect(failure.empty(), failure);
+    }
+
+    // requests out of the protocol are rejected, the connection stays
+    // usable
+    ellipsoid::Client client(options.socket_path);
+    bool rejected = false;
+    try {
+        client.fit(ellipsoid::generate(randomEllipsoid(types[0]), 100),
+                   static_cast<ellipsoid::EllipsoidType>(7));
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    expect(rejected, "Invalid ellipsoid type accepted");
+    client.fit(ellipsoid::generate(randomEllipsoid(types[0]), 100));
+
+    const auto metrics = server.metrics();
+    const auto solved = clients * rounds * 7 + 1;
+    expect(metrics.requests == solved and metrics.rejected == 1,
+           "Wrong number of solved and rejected requests");
+    expect(metrics.batches > 0 and metrics.batches <= solved,
+           "Wrong number of batches");
+    server.stop();
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <ellipsoid/superquadric.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+
+namespace {
+
+using Points = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+
+void expect(bool condition, const std::string& what) {
+    if (not condition) {
+        throw std::runtime_error(what);
+    }
+}
+
+double uniform(double low, double high) {
+    return low + (high - low) * 0.5 * (Eigen::Vector2d::Random()(0) + 1.);
+}
+
+double signedPower(double value, double exponent) {
+    return std::copysign(std::pow(std::abs(value), exponent), value);
+}
+
+ellipsoid::Superquadric randomSuperquadric(const Eigen::Vector3d& radii,
+                                           double e1, double e2) {
+    ellipsoid::Superquadric sq;
+    sq.center = 10. * Eigen::Vector3d::Random();
+    sq.radii = radii;
+    sq.axes = Eigen::Quaterniond(Eigen::Vector4d::Random().normalized())
+                  .toRotationMatrix();
+    sq.exponents << e1, e2;
+    return sq;
+}
+
+// Points of the surface from its parametric form, with some noise
+Points surfacePoints(const ellipsoid::Superquadric& sq, size_t count,
+                     double noise) {
+    Points points(static_cast<Eigen::Index>(count), 3);
+    for (Eigen::Index i = 0; i < points.rows(); ++i) {
+        const double eta = uniform(-M_PI / 2., M_PI / 2.);
+        const double omega = uniform(-M_PI, M_PI);
+        const double e1 = sq.exponents(0);
+        const double e2 = sq.exponents(1);
+        const Eigen::Vector3d local(
+            sq.radii(0) * signedPower(std::cos(eta), e1) *
+                signedPower(std::cos(omega), e2),
+            sq.radii(1) * signedPower(std::cos(eta), e1) *
+                signedPower(std::sin(omega), e2),
+            sq.radii(2) * signedPower(std::sin(eta), e1));
+        points.row(i) = (sq.center + sq.axes * local +
+                         noise * Eigen::Vector3d::Random())
+                            .transpose();
+    }
+    return points;
+}
+
+// Same superquadric up to the symmetries of the surface: each fitted axis
+// matches an expected one with the same radius, and the last axis is the
+// same when the exponents differ
+void expectSame(const ellipsoid::Superquadric& fitted,
+                const ellipsoid::Superquadric& expected, double tol,
+                const std::string& what) {
+    std::stringstream ss;
+    ss << what << ": fitted center " << fitted.center.transpose()
+       << ", radii " << fitted.radii.transpose() << ", exponents "
+       << fitted.exponents.transpose() << " instead of "
+       << expected.center.transpose() << ", "
+       << expected.radii.transpose() << ", "
+       << expected.exponents.transpose();
+    expect((fitted.center - expected.center).norm() < tol, ss.str());
+    expect((fitted.exponents - expected.exponents).cwiseAbs().maxCoeff() < tol,
+           ss.str());
+    expect(std::abs(fitted.axes.determinant() - 1.) < 1e-9,
+           what + ": axes not a rotation");
+    for (int i = 0; i < 3; ++i) {
+        int match = 0;
+        (expected.axes.transpose() * fitted.axes.col(i))
+            .cwiseAbs()
+            .maxCoeff(&match);
+        expect(std::abs(fitted.axes.col(i).dot(expected.axes.col(match))) >
+                   1. - tol,
+               ss.str());
+        expect(std::abs(fitted.radii(i) - expected.radii(match)) < tol,
+               ss.str());
+        if (i == 2) {
+            expect(match == 2 or std::abs(expected.exponents(0) -
+                                          expected.exponents(1)) < tol,
+                   what + ": wrong last axis");
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    const double tol = 1e-3;
+    std::srand(time(nullptr));
+
+    // the ellipsoid seed is already the solution
+    auto expected = randomSuperquadric(Eigen::Vector3d(1., 2., 3.), 1., 1.);
+    auto fitted = ellipsoid::fitSuperquadric(
+        surfacePoints(expected, 2000, 0.));
+    expectSame(fitted, expected, tol, "ellipsoid");
+    expect(fitted.rms_distance < 1e-6, "Wrong ellipsoid distance");
+
+    // box like
+    expected = randomSuperquadric(Eigen::Vector3d(1., 2., 1.5), 0.3, 0.3);
+    Points points = surfacePoints(expected, 20000, 1e-5);
+    fitted = ellipsoid::fitSuperquadric(points);
+    expectSame(fitted, expected, tol, "box");
+    expect(fitted.rms_distance < 1e-4, "Wrong box distance");
+
+    // cylinder like, the last axis must be found among the seed's axes
+    expected = randomSuperquadric(Eigen::Vector3d(1., 1.5, 2.), 0.2, 1.);
+    fitted = ellipsoid::fitSuperquadric(surfacePoints(expected, 20000, 1e-5));
+    expectSame(fitted, expected, tol, "cylinder");
+
+    // a few hundred points per iteration are enough
+    expected = randomSuperquadric(Eigen::Vector3d(2., 1., 1.5), 1.5, 0.5);
+    points = surfacePoints(expected, 100000, 1e-5);
+    ellipsoid::SuperquadricOptions options;
+    options.samples = 1000;
+    fitted = ellipsoid::fitSuperquadric(points, options);
+    expectSame(fitted, expected, tol, "subsampled");
+    expect(fitted.rms_distance < 1e-4, "Wrong subsampled distance");
+
+    // refining a previous result keeps its axes
+    ellipsoid::Superquadric guess = expected;
+    guess.center += 0.1 * Eigen::Vector3d::Random();
+    guess.radii *= 1.1;
+    guess.exponents << 1., 1.;
+    guess.axes = guess.axes * Eigen::AngleAxisd(0.1, Eigen::Vector3d::UnitX());
+    fitted = ellipsoid::fitSuperquadric(points, guess);
+    expectSame(fitted, expected, tol, "refined");
+    for (int i = 0; i < 3; ++i) {
+        expect(fitted.axes.col(i).dot(expected.axes.col(i)) > 1. - tol,
+               "Axes of the guess not kept");
+    }
+    expect(fitted.iterations > 0 and
+               fitted.iterations <= options.max_iterations,
+           "Wrong number of iterations");
+
+    // not enough points
+    fitted = ellipsoid::fitSuperquadric(points.topRows(10));
+    expect(fitted.radii.hasNaN() and std::isnan(fitted.rms_distance),
+           "Fitted a superquadric on 10 points");
+
+    return 0;
+}
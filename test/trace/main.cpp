@@ -0,0 +1,100 @@
+#include <ellipsoid/batch.h>
+#include <ellipsoid/generate.h>
+#include <ellipsoid/trace.h>
+
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+
+namespace {
+
+const ellipsoid::trace::StageStatistics*
+find(const std::vector<ellipsoid::trace::StageStatistics>& stages,
+     const std::string& name) {
+    for (const auto& stage : stages) {
+        if (stage.name == name) {
+            return &stage;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    std::srand(time(nullptr));
+
+#ifdef ELLIPSOID_FIT_TRACING
+    // linked with the instrumented library whatever ENABLE_TRACING is
+    if (not ellipsoid::trace::available()) {
+        throw std::runtime_error("Instrumentation not compiled in");
+    }
+#endif
+
+    ellipsoid::Parameters parameters;
+    parameters.center = Eigen::Vector3d::Random();
+    parameters.radii = Eigen::Vector3d::Random().cwiseAbs().array() + 0.5;
+    const auto points = ellipsoid::generate(parameters, 1000);
+
+    // nothing is recorded before start()
+    ellipsoid::fit(points);
+    if (not ellipsoid::trace::statistics().empty()) {
+        throw std::runtime_error("Records before start()");
+    }
+
+    ellipsoid::trace::start();
+    if (ellipsoid::trace::recording() != ellipsoid::trace::available()) {
+        throw std::runtime_error("Wrong recording state");
+    }
+    ellipsoid::fit(points);
+    ellipsoid::Moments moments;
+    moments.add(points);
+    ellipsoid::fit(moments);
+    ellipsoid::fitBatch(
+        std::vector<Eigen::Matrix<double, Eigen::Dynamic, 3>>(10, points));
+    ellipsoid::trace::stop();
+    ellipsoid::fit(points);
+
+    const auto stages = ellipsoid::trace::statistics();
+    if (ellipsoid::trace::available()) {
+        const auto* design = find(stages, "fit.design_matrix");
+        const auto* svd = find(stages, "fit.svd_solve");
+        const auto* accumulate = find(stages, "moments.accumulate");
+        const auto* batch = find(stages, "batch.solve_group");
+        if (design == nullptr or design->calls != 1 or
+            design->points != 1000 or design->bytes == 0 or svd == nullptr or
+            svd->calls != 2 or not(svd->seconds > 0.) or
+            find(stages, "fit.eigensolver") == nullptr or
+            find(stages, "fit.least_rotation") == nullptr or
+            accumulate == nullptr or accumulate->points != 11000 or
+            batch == nullptr or batch->points != 10000) {
+            throw std::runtime_error("Wrong trace statistics");
+        }
+    } else if (not stages.empty()) {
+        throw std::runtime_error("Records without instrumentation");
+    }
+
+    const auto path =
+        "/tmp/ellipsoid-trace-" + std::to_string(::getpid()) + ".json";
+    ellipsoid::trace::writeChromeTrace(path);
+    std::ifstream file(path);
+    const std::string json((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+    ::unlink(path.c_str());
+    if (json.find("\"traceEvents\":[") == std::string::npos or
+        (ellipsoid::trace::available() and
+         json.find("\"name\":\"fit.center_solve\"") == std::string::npos)) {
+        throw std::runtime_error("Wrong Chrome trace");
+    }
+
+    ellipsoid::trace::clear();
+    if (not ellipsoid::trace::statistics().empty()) {
+        throw std::runtime_error("Records after clear()");
+    }
+
+    return 0;
+}
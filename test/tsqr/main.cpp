@@ -0,0 +1,111 @@
+#include <ellipsoid/generate.h>
+#include <ellipsoid/tsqr.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+
+namespace {
+
+using Points = Eigen::Matrix<double, Eigen::Dynamic, 3>;
+
+void expect(bool condition, const std::string& what) {
+    if (not condition) {
+        throw std::runtime_error(what);
+    }
+}
+
+void expectFit(const ellipsoid::FitResult& result,
+               const ellipsoid::Parameters& expected, double tol,
+               const std::string& what) {
+    std::stringstream ss;
+    ss << what << ": center " << result.parameters.center.transpose()
+       << ", radii " << result.parameters.radii.transpose()
+       << ", expecting " << expected.center.transpose() << " and "
+       << expected.radii.transpose();
+    expect((result.parameters.center - expected.center).norm() < tol and
+               (result.parameters.radii - expected.radii).norm() < tol,
+           ss.str());
+}
+
+// Points on a cap of the ellipsoid around its last axis
+Points capPoints(const ellipsoid::Parameters& params, double half_angle,
+                 Eigen::Index count) {
+    Points points(count, 3);
+    for (Eigen::Index i = 0; i < count; ++i) {
+        const Eigen::Vector2d random =
+            0.5 * (Eigen::Vector2d::Random() + Eigen::Vector2d::Ones());
+        const double theta = half_angle * std::sqrt(random(0));
+        const double phi = 2. * M_PI * random(1);
+        const Eigen::Vector3d direction(std::sin(theta) * std::cos(phi),
+                                        std::sin(theta) * std::sin(phi),
+                                        std::cos(theta));
+        points.row(i) =
+            (params.center + params.radii.cwiseProduct(direction))
+                .transpose();
+    }
+    return points;
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    // the tolerances are tight, the seed is printed to reproduce a failure
+    const auto seed = argc > 1 ? static_cast<unsigned>(std::atol(argv[1]))
+                               : static_cast<unsigned>(time(nullptr));
+    std::cout << "seed " << seed << std::endl;
+    std::srand(seed);
+
+    // same ellipsoid as fit(), whatever the number of chunks
+    ellipsoid::Parameters expected;
+    expected.center = Eigen::Vector3d::Random();
+    expected.radii = Eigen::Vector3d::Random().cwiseAbs().array() + 0.5;
+    const Points points = ellipsoid::generate(expected, 5000);
+    Eigen::Matrix<double, 10, 1> coefficients;
+    ellipsoid::fit(points, &coefficients);
+    for (size_t chunk_rows : {size_t(1), size_t(7), size_t(1000),
+                              size_t(1) << 16}) {
+        const auto result = ellipsoid::fitTsqr(
+            points, ellipsoid::EllipsoidType::Arbitrary, chunk_rows);
+        expectFit(result, expected, 1e-9,
+                  "Chunks of " + std::to_string(chunk_rows) + " points");
+        expect(result.coefficients.isApprox(coefficients, 1e-8),
+               "Coefficients differ from fit()");
+    }
+
+    // the reduction tree has a fixed shape
+    const auto first = ellipsoid::fitTsqr(
+        points, ellipsoid::EllipsoidType::Arbitrary, 100);
+    const auto second = ellipsoid::fitTsqr(
+        points, ellipsoid::EllipsoidType::Arbitrary, 100);
+    expect(first.coefficients == second.coefficients,
+           "Result depends on the scheduling");
+
+    // constrained ellipsoids
+    ellipsoid::Parameters sphere;
+    sphere.center = Eigen::Vector3d::Random();
+    sphere.radii.setConstant(2.);
+    expectFit(ellipsoid::fitTsqr(ellipsoid::generate(sphere, 1000),
+                                 ellipsoid::EllipsoidType::Sphere, 300),
+              sphere, 1e-9, "Sphere");
+    ellipsoid::Parameters aligned = expected;
+    aligned.radii(1) = aligned.radii(0);
+    expectFit(ellipsoid::fitTsqr(ellipsoid::generate(aligned, 1000),
+                                 ellipsoid::EllipsoidType::AlignedXYEqual,
+                                 300),
+              aligned, 1e-9, "Aligned XY equal");
+
+    // a small cap far from the origin: the normal equations lose most of
+    // the digits, not the QR of the design matrix
+    expected.center = Eigen::Vector3d(1000., -500., 300.);
+    expected.radii = Eigen::Vector3d(1., 2., 3.);
+    expectFit(ellipsoid::fitTsqr(capPoints(expected, 0.05, 100000),
+                                 ellipsoid::EllipsoidType::Arbitrary, 10000),
+              expected, 1e-8, "Small cap");
+
+    return 0;
+}